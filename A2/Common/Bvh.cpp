@@ -0,0 +1,494 @@
+//***************************************************************************************
+// Bvh.cpp
+//***************************************************************************************
+
+#include "Bvh.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+// Below this many items the build stays on the calling thread.
+static const std::uint32_t ParallelBuildItems = 4096;
+
+static float Component(const XMFLOAT3& v, int axis)
+{
+	return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+static Bvh::Aabb EmptyBox()
+{
+	Bvh::Aabb box;
+	box.Min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+	box.Max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	return box;
+}
+
+static void Grow(Bvh::Aabb& box, const Bvh::Aabb& other)
+{
+	box.Min.x = other.Min.x < box.Min.x ? other.Min.x : box.Min.x;
+	box.Min.y = other.Min.y < box.Min.y ? other.Min.y : box.Min.y;
+	box.Min.z = other.Min.z < box.Min.z ? other.Min.z : box.Min.z;
+	box.Max.x = other.Max.x > box.Max.x ? other.Max.x : box.Max.x;
+	box.Max.y = other.Max.y > box.Max.y ? other.Max.y : box.Max.y;
+	box.Max.z = other.Max.z > box.Max.z ? other.Max.z : box.Max.z;
+}
+
+static void Grow(Bvh::Aabb& box, const XMFLOAT3& p)
+{
+	box.Min.x = p.x < box.Min.x ? p.x : box.Min.x;
+	box.Min.y = p.y < box.Min.y ? p.y : box.Min.y;
+	box.Min.z = p.z < box.Min.z ? p.z : box.Min.z;
+	box.Max.x = p.x > box.Max.x ? p.x : box.Max.x;
+	box.Max.y = p.y > box.Max.y ? p.y : box.Max.y;
+	box.Max.z = p.z > box.Max.z ? p.z : box.Max.z;
+}
+
+static float HalfArea(const Bvh::Aabb& box)
+{
+	float dx = box.Max.x - box.Min.x;
+	float dy = box.Max.y - box.Min.y;
+	float dz = box.Max.z - box.Min.z;
+	if (dx < 0.0f || dy < 0.0f || dz < 0.0f)
+		return 0.0f;
+	return dx * dy + dy * dz + dz * dx;
+}
+
+static bool SameBox(const Bvh::Aabb& a, const Bvh::Aabb& b)
+{
+	return a.Min.x == b.Min.x && a.Min.y == b.Min.y && a.Min.z == b.Min.z &&
+		a.Max.x == b.Max.x && a.Max.y == b.Max.y && a.Max.z == b.Max.z;
+}
+
+Bvh::Aabb Bvh::Aabb::FromCenterExtents(const XMFLOAT3& center, const XMFLOAT3& extents)
+{
+	Aabb box;
+	box.Min = XMFLOAT3(center.x - extents.x, center.y - extents.y, center.z - extents.z);
+	box.Max = XMFLOAT3(center.x + extents.x, center.y + extents.y, center.z + extents.z);
+	return box;
+}
+
+void Bvh::Build(const std::vector<Aabb>& bounds, JobSystem* jobs)
+{
+	const std::uint32_t count = (std::uint32_t)bounds.size();
+
+	mBounds = bounds;
+	mItems.resize(count);
+	mCentroids.resize(count);
+	mItemLeaf.assign(count, 0);
+	mDirtyLeaves.clear();
+
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		mItems[i] = i;
+		mCentroids[i] = XMFLOAT3(
+			0.5f * (bounds[i].Min.x + bounds[i].Max.x),
+			0.5f * (bounds[i].Min.y + bounds[i].Max.y),
+			0.5f * (bounds[i].Min.z + bounds[i].Max.z));
+	}
+
+	mNodes.clear();
+	mParents.clear();
+	if (count == 0)
+		return;
+
+	// A binary tree with at least one item per leaf has at most 2n - 1 nodes.
+	mNodes.resize(2 * (std::size_t)count - 1);
+	mParents.resize(mNodes.size());
+
+	mNodes[0].First = 0;
+	mNodes[0].Count = count;
+	mParents[0] = UINT32_MAX;
+	mNodeCount = 1;
+
+	if (jobs != nullptr && jobs->ThreadCount() > 1 && count >= ParallelBuildItems)
+	{
+		// Split the top until there are a few subtrees per thread, then build those in
+		// parallel.  They own disjoint ranges of mItems and take nodes from the shared
+		// counter, so they never touch each other's data.
+		std::uint32_t deferSize = count / (jobs->ThreadCount() * 4);
+		if (deferSize < ParallelBuildItems / 4)
+			deferSize = ParallelBuildItems / 4;
+
+		std::vector<std::uint32_t> subtrees;
+		BuildRange(0, deferSize, &subtrees);
+
+		jobs->ParallelFor((std::uint32_t)subtrees.size(), 1, [&](std::uint32_t begin, std::uint32_t end)
+		{
+			for (std::uint32_t i = begin; i < end; ++i)
+				BuildRange(subtrees[i], 0, nullptr);
+		});
+	}
+	else
+	{
+		BuildRange(0, 0, nullptr);
+	}
+
+	mNodes.resize(mNodeCount);
+	mParents.resize(mNodeCount);
+
+	for (std::uint32_t n = 0; n < (std::uint32_t)mNodes.size(); ++n)
+	{
+		const Node& node = mNodes[n];
+		for (std::uint32_t i = 0; i < node.Count; ++i)
+			mItemLeaf[mItems[node.First + i]] = n;
+	}
+}
+
+void Bvh::BuildRange(std::uint32_t root, std::uint32_t deferSize, std::vector<std::uint32_t>* deferred)
+{
+	std::vector<std::uint32_t> stack;
+	stack.push_back(root);
+
+	while (!stack.empty())
+	{
+		std::uint32_t n = stack.back();
+		stack.pop_back();
+
+		if (deferred != nullptr && mNodes[n].Count <= deferSize)
+		{
+			deferred->push_back(n);
+			continue;
+		}
+
+		if (Split(n))
+		{
+			stack.push_back(mNodes[n].First + 1);
+			stack.push_back(mNodes[n].First);
+		}
+	}
+}
+
+bool Bvh::Split(std::uint32_t nodeIndex)
+{
+	Node& node = mNodes[nodeIndex];
+	const std::uint32_t first = node.First;
+	const std::uint32_t count = node.Count;
+
+	Aabb centroidBox = EmptyBox();
+	node.Box = EmptyBox();
+	for (std::uint32_t i = first; i < first + count; ++i)
+	{
+		Grow(node.Box, mBounds[mItems[i]]);
+		Grow(centroidBox, mCentroids[mItems[i]]);
+	}
+
+	if (count <= MaxLeafSize)
+		return false;
+
+	// Binned SAH: drop the centroids into BinCount slabs along each axis and try every
+	// boundary between slabs.
+	int bestAxis = -1;
+	std::uint32_t bestSplit = 0;
+	float bestCost = FLT_MAX;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float lo = Component(centroidBox.Min, axis);
+		float hi = Component(centroidBox.Max, axis);
+		if (!(hi > lo))
+			continue;
+
+		float scale = BinCount / (hi - lo);
+
+		Aabb binBox[BinCount];
+		std::uint32_t binCount[BinCount] = {};
+		for (std::uint32_t b = 0; b < BinCount; ++b)
+			binBox[b] = EmptyBox();
+
+		for (std::uint32_t i = first; i < first + count; ++i)
+		{
+			std::uint32_t b = (std::uint32_t)((Component(mCentroids[mItems[i]], axis) - lo) * scale);
+			if (b >= BinCount)
+				b = BinCount - 1;
+			binCount[b]++;
+			Grow(binBox[b], mBounds[mItems[i]]);
+		}
+
+		// Sweep from the right to get the cost of every right side, then from the left.
+		float rightArea[BinCount];
+		std::uint32_t rightCount[BinCount];
+		Aabb box = EmptyBox();
+		std::uint32_t sum = 0;
+		for (std::uint32_t b = BinCount - 1; b > 0; --b)
+		{
+			Grow(box, binBox[b]);
+			sum += binCount[b];
+			rightArea[b] = HalfArea(box);
+			rightCount[b] = sum;
+		}
+
+		box = EmptyBox();
+		sum = 0;
+		for (std::uint32_t b = 1; b < BinCount; ++b)
+		{
+			Grow(box, binBox[b - 1]);
+			sum += binCount[b - 1];
+
+			if (sum == 0 || rightCount[b] == 0)
+				continue;
+
+			float cost = sum * HalfArea(box) + rightCount[b] * rightArea[b];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = b;
+			}
+		}
+	}
+
+	std::uint32_t leftCount;
+	if (bestAxis >= 0)
+	{
+		float lo = Component(centroidBox.Min, bestAxis);
+		float scale = BinCount / (Component(centroidBox.Max, bestAxis) - lo);
+
+		auto mid = std::partition(mItems.begin() + first, mItems.begin() + first + count, [&](std::uint32_t item)
+		{
+			std::uint32_t b = (std::uint32_t)((Component(mCentroids[item], bestAxis) - lo) * scale);
+			return (b >= BinCount ? BinCount - 1 : b) < bestSplit;
+		});
+		leftCount = (std::uint32_t)(mid - (mItems.begin() + first));
+	}
+	else
+	{
+		leftCount = 0;
+	}
+
+	// Every centroid is in the same place; halve the list so leaves stay small.
+	if (leftCount == 0 || leftCount == count)
+		leftCount = count / 2;
+
+	std::uint32_t left = mNodeCount.fetch_add(2);
+
+	mNodes[left].First = first;
+	mNodes[left].Count = leftCount;
+	mNodes[left + 1].First = first + leftCount;
+	mNodes[left + 1].Count = count - leftCount;
+	mParents[left] = nodeIndex;
+	mParents[left + 1] = nodeIndex;
+
+	node.First = left;
+	node.Count = 0;
+	return true;
+}
+
+// Sign of the box against a plane: -1 fully behind, 1 fully in front, 0 crossing.
+static int Classify(const XMFLOAT4& p, const Bvh::Aabb& box)
+{
+	float cx = 0.5f * (box.Min.x + box.Max.x);
+	float cy = 0.5f * (box.Min.y + box.Max.y);
+	float cz = 0.5f * (box.Min.z + box.Max.z);
+	float ex = 0.5f * (box.Max.x - box.Min.x);
+	float ey = 0.5f * (box.Max.y - box.Min.y);
+	float ez = 0.5f * (box.Max.z - box.Min.z);
+
+	float d = (p.x * cx + p.y * cy) + (p.z * cz + p.w);
+	float reach = (std::fabs(p.x) * ex + std::fabs(p.y) * ey) + std::fabs(p.z) * ez;
+
+	if (d + reach < 0.0f)
+		return -1;
+	if (d - reach >= 0.0f)
+		return 1;
+	return 0;
+}
+
+void Bvh::AppendSubtree(std::uint32_t nodeIndex, std::vector<std::uint32_t>& visible)const
+{
+	// Inner nodes do not keep their item range, so walk down to the leaves.
+	std::vector<std::uint32_t> stack;
+	stack.push_back(nodeIndex);
+
+	while (!stack.empty())
+	{
+		const Node& node = mNodes[stack.back()];
+		stack.pop_back();
+
+		if (node.Count > 0)
+		{
+			visible.insert(visible.end(), mItems.begin() + node.First, mItems.begin() + node.First + node.Count);
+		}
+		else
+		{
+			stack.push_back(node.First + 1);
+			stack.push_back(node.First);
+		}
+	}
+}
+
+void Bvh::Cull(const FrustumCull::Frustum& frustum, std::vector<std::uint32_t>& visible)const
+{
+	visible.clear();
+	if (mNodes.empty())
+		return;
+
+	// Node and the planes it still straddles, one bit per plane.
+	struct Entry
+	{
+		std::uint32_t Node;
+		std::uint32_t Planes;
+	};
+
+	std::vector<Entry> stack;
+	stack.push_back({ 0, 0x3f });
+
+	while (!stack.empty())
+	{
+		Entry e = stack.back();
+		stack.pop_back();
+		const Node& node = mNodes[e.Node];
+
+		bool outside = false;
+		for (int p = 0; p < 6 && !outside; ++p)
+		{
+			if ((e.Planes & (1u << p)) == 0)
+				continue;
+
+			int side = Classify(frustum.Planes[p], node.Box);
+			if (side < 0)
+				outside = true;
+			else if (side > 0)
+				e.Planes &= ~(1u << p);
+		}
+
+		if (outside)
+			continue;
+
+		if (e.Planes == 0)
+		{
+			AppendSubtree(e.Node, visible);
+		}
+		else if (node.Count > 0)
+		{
+			for (std::uint32_t i = node.First; i < node.First + node.Count; ++i)
+			{
+				std::uint32_t item = mItems[i];
+
+				bool itemOutside = false;
+				for (int p = 0; p < 6 && !itemOutside; ++p)
+				{
+					if ((e.Planes & (1u << p)) != 0 && Classify(frustum.Planes[p], mBounds[item]) < 0)
+						itemOutside = true;
+				}
+
+				if (!itemOutside)
+					visible.push_back(item);
+			}
+		}
+		else
+		{
+			stack.push_back({ node.First + 1, e.Planes });
+			stack.push_back({ node.First, e.Planes });
+		}
+	}
+}
+
+// Slab test.  Returns the entry distance, or FLT_MAX when the ray misses within maxT.
+static float RayBox(const XMFLOAT3& origin, const XMFLOAT3& invDir, float maxT, const Bvh::Aabb& box)
+{
+	float tx0 = (box.Min.x - origin.x) * invDir.x;
+	float tx1 = (box.Max.x - origin.x) * invDir.x;
+	float ty0 = (box.Min.y - origin.y) * invDir.y;
+	float ty1 = (box.Max.y - origin.y) * invDir.y;
+	float tz0 = (box.Min.z - origin.z) * invDir.z;
+	float tz1 = (box.Max.z - origin.z) * invDir.z;
+
+	float tmin = std::max<float>(std::max<float>(std::min<float>(tx0, tx1), std::min<float>(ty0, ty1)), std::min<float>(tz0, tz1));
+	float tmax = std::min<float>(std::min<float>(std::max<float>(tx0, tx1), std::max<float>(ty0, ty1)), std::max<float>(tz0, tz1));
+
+	tmin = std::max<float>(tmin, 0.0f);
+	tmax = std::min<float>(tmax, maxT);
+
+	return tmin <= tmax ? tmin : FLT_MAX;
+}
+
+bool Bvh::Raycast(const XMFLOAT3& origin, const XMFLOAT3& dir, float maxT, RayHit& hit)const
+{
+	hit = RayHit();
+	if (mNodes.empty())
+		return false;
+
+	XMFLOAT3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+
+	float nearest = maxT;
+	bool found = false;
+
+	std::vector<std::uint32_t> stack;
+	if (RayBox(origin, invDir, nearest, mNodes[0].Box) != FLT_MAX)
+		stack.push_back(0);
+
+	while (!stack.empty())
+	{
+		const Node& node = mNodes[stack.back()];
+		stack.pop_back();
+
+		if (node.Count > 0)
+		{
+			for (std::uint32_t i = node.First; i < node.First + node.Count; ++i)
+			{
+				float t = RayBox(origin, invDir, nearest, mBounds[mItems[i]]);
+				if (t != FLT_MAX && (!found || t < nearest))
+				{
+					nearest = t;
+					hit.Item = mItems[i];
+					hit.T = t;
+					found = true;
+				}
+			}
+			continue;
+		}
+
+		// Visit the nearer child first so the far one is more likely to be skipped.
+		float t0 = RayBox(origin, invDir, nearest, mNodes[node.First].Box);
+		float t1 = RayBox(origin, invDir, nearest, mNodes[node.First + 1].Box);
+
+		std::uint32_t nearChild = node.First;
+		std::uint32_t farChild = node.First + 1;
+		if (t1 < t0)
+		{
+			std::swap(t0, t1);
+			std::swap(nearChild, farChild);
+		}
+
+		if (t1 != FLT_MAX)
+			stack.push_back(farChild);
+		if (t0 != FLT_MAX)
+			stack.push_back(nearChild);
+	}
+
+	return found;
+}
+
+void Bvh::SetBounds(std::uint32_t item, const Aabb& bounds)
+{
+	mBounds[item] = bounds;
+	mDirtyLeaves.push_back(mItemLeaf[item]);
+}
+
+void Bvh::Refit()
+{
+	for (std::uint32_t leaf : mDirtyLeaves)
+	{
+		Node& node = mNodes[leaf];
+		node.Box = EmptyBox();
+		for (std::uint32_t i = node.First; i < node.First + node.Count; ++i)
+			Grow(node.Box, mBounds[mItems[i]]);
+
+		// Walk up while the parents' boxes still change.
+		for (std::uint32_t n = mParents[leaf]; n != UINT32_MAX; n = mParents[n])
+		{
+			Aabb box = mNodes[mNodes[n].First].Box;
+			Grow(box, mNodes[mNodes[n].First + 1].Box);
+
+			if (SameBox(box, mNodes[n].Box))
+				break;
+			mNodes[n].Box = box;
+		}
+	}
+
+	mDirtyLeaves.clear();
+}
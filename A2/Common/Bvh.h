@@ -0,0 +1,109 @@
+//***************************************************************************************
+// Bvh.h
+//
+// Bounding volume hierarchy over a set of axis aligned boxes, one per item.
+//   -Build() splits the items top down with a binned surface area heuristic.  Given a
+//    JobSystem, the upper levels are split on the calling thread and the subtrees
+//    below them are built in parallel.
+//   -Cull() returns the items whose boxes intersect a frustum.  Planes a node lies
+//    fully inside of are not tested again below it, and subtrees fully inside the
+//    frustum are taken whole.
+//   -Raycast() finds the item box nearest along a ray, for picking.
+//   -SetBounds() + Refit() move a few items without a rebuild by growing and
+//    shrinking the boxes on the path from their leaf to the root.  The tree keeps its
+//    old shape, so rebuild when many items have moved far.
+//
+// Only depends on DirectXMath, FrustumCull and JobSystem so it can be benchmarked
+// outside of the D3D12 projects (see Tools/BvhBench).
+//***************************************************************************************
+
+#ifndef BVH_H
+#define BVH_H
+
+#include "FrustumCull.h"
+
+#include <DirectXMath.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+class Bvh
+{
+public:
+	struct Aabb
+	{
+		DirectX::XMFLOAT3 Min;
+		DirectX::XMFLOAT3 Max;
+
+		static Aabb FromCenterExtents(const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents);
+	};
+
+	struct RayHit
+	{
+		std::uint32_t Item = UINT32_MAX;
+
+		// Distance along the ray, in units of the ray direction's length.
+		float T = 0.0f;
+	};
+
+	// Most items a leaf holds.  Nodes with more are always split, by the binned SAH or,
+	// when it finds no split (e.g. coincident centroids), into two halves.
+	static const std::uint32_t MaxLeafSize = 4;
+	static const std::uint32_t BinCount = 16;
+
+	Bvh() = default;
+	Bvh(const Bvh& rhs) = delete;
+	Bvh& operator=(const Bvh& rhs) = delete;
+
+	// Item i is bounds[i].
+	void Build(const std::vector<Aabb>& bounds, JobSystem* jobs = nullptr);
+
+	std::uint32_t ItemCount()const { return (std::uint32_t)mBounds.size(); }
+	std::uint32_t NodeCount()const { return (std::uint32_t)mNodes.size(); }
+
+	const Aabb& Bounds(std::uint32_t item)const { return mBounds[item]; }
+
+	// Replaces the items' visible list with those intersecting the frustum, in tree order.
+	void Cull(const FrustumCull::Frustum& frustum, std::vector<std::uint32_t>& visible)const;
+
+	// Nearest item box hit by origin + t * dir for 0 <= t <= maxT.
+	bool Raycast(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& dir, float maxT, RayHit& hit)const;
+
+	// Moves one item.  Takes effect in queries after the next Refit().
+	void SetBounds(std::uint32_t item, const Aabb& bounds);
+	void Refit();
+
+private:
+	// Leaves have Count > 0 and own mItems[First, First + Count).  Inner nodes have
+	// Count == 0 and children First and First + 1.  Children always come after their
+	// parent in mNodes.
+	struct Node
+	{
+		Aabb Box;
+		std::uint32_t First = 0;
+		std::uint32_t Count = 0;
+	};
+
+	void BuildRange(std::uint32_t root, std::uint32_t deferSize, std::vector<std::uint32_t>* deferred);
+	bool Split(std::uint32_t nodeIndex);
+	void AppendSubtree(std::uint32_t nodeIndex, std::vector<std::uint32_t>& visible)const;
+
+private:
+	std::vector<Node> mNodes;
+	std::vector<std::uint32_t> mParents;
+
+	// Item indices, grouped by leaf.
+	std::vector<std::uint32_t> mItems;
+
+	std::vector<Aabb> mBounds;
+	std::vector<DirectX::XMFLOAT3> mCentroids;
+	std::vector<std::uint32_t> mItemLeaf;
+	std::vector<std::uint32_t> mDirtyLeaves;
+
+	// Next free node during Build(); shared by the build jobs.
+	std::atomic<std::uint32_t> mNodeCount{ 0 };
+};
+
+#endif // BVH_H
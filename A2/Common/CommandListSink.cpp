@@ -0,0 +1,67 @@
+//***************************************************************************************
+// CommandListSink.cpp
+//***************************************************************************************
+
+#include "CommandListSink.h"
+
+CommandListSink::CommandListSink(ID3D12GraphicsCommandList* cmdList,
+	D3D12_GPU_DESCRIPTOR_HANDLE srvHeapStart, UINT srvDescriptorSize,
+	D3D12_GPU_VIRTUAL_ADDRESS objectCB, UINT objectCBByteSize,
+	D3D12_GPU_VIRTUAL_ADDRESS materialCB, UINT materialCBByteSize,
+	D3D12_GPU_VIRTUAL_ADDRESS instanceData, UINT instanceByteSize)
+	: mCmdList(cmdList),
+	mSrvHeapStart(srvHeapStart),
+	mSrvDescriptorSize(srvDescriptorSize),
+	mObjectCB(objectCB),
+	mObjectCBByteSize(objectCBByteSize),
+	mMaterialCB(materialCB),
+	mMaterialCBByteSize(materialCBByteSize),
+	mInstanceData(instanceData),
+	mInstanceByteSize(instanceByteSize)
+{
+}
+
+void CommandListSink::SetPipelineState(ID3D12PipelineState* pso)
+{
+	mCmdList->SetPipelineState(pso);
+}
+
+void CommandListSink::SetGeometry(const MeshGeometry* geo)
+{
+	auto vbv = geo->VertexBufferView();
+	auto ibv = geo->IndexBufferView();
+	mCmdList->IASetVertexBuffers(0, 1, &vbv);
+	mCmdList->IASetIndexBuffer(&ibv);
+}
+
+void CommandListSink::SetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)
+{
+	mCmdList->IASetPrimitiveTopology(topology);
+}
+
+void CommandListSink::SetTexture(UINT textureIndex)
+{
+	CD3DX12_GPU_DESCRIPTOR_HANDLE tex(mSrvHeapStart);
+	tex.Offset(textureIndex, mSrvDescriptorSize);
+	mCmdList->SetGraphicsRootDescriptorTable(0, tex);
+}
+
+void CommandListSink::SetMaterialConstants(UINT materialCBIndex)
+{
+	mCmdList->SetGraphicsRootConstantBufferView(3, mMaterialCB + (UINT64)materialCBIndex * mMaterialCBByteSize);
+}
+
+void CommandListSink::SetObjectConstants(UINT objectCBIndex)
+{
+	mCmdList->SetGraphicsRootConstantBufferView(1, mObjectCB + (UINT64)objectCBIndex * mObjectCBByteSize);
+}
+
+void CommandListSink::SetInstanceData(UINT firstInstance)
+{
+	mCmdList->SetGraphicsRootShaderResourceView(4, mInstanceData + (UINT64)firstInstance * mInstanceByteSize);
+}
+
+void CommandListSink::DrawIndexed(UINT indexCount, UINT instanceCount, UINT startIndexLocation, int baseVertexLocation)
+{
+	mCmdList->DrawIndexedInstanced(indexCount, instanceCount, startIndexLocation, baseVertexLocation, 0);
+}
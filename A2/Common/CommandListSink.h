@@ -0,0 +1,48 @@
+//***************************************************************************************
+// CommandListSink.h
+//
+// DrawCommandSink that records a DrawQueue's packets into a D3D12 command list.
+//***************************************************************************************
+
+#ifndef COMMANDLISTSINK_H
+#define COMMANDLISTSINK_H
+
+#include "d3dUtil.h"
+#include "DrawQueue.h"
+
+// Records into a command list using the root signature layout shared by the demos:
+// 0 = diffuse texture table, 1 = object CBV, 2 = pass CBV, 3 = material CBV,
+// 4 = instance data SRV.
+class CommandListSink : public DrawCommandSink
+{
+public:
+	CommandListSink(ID3D12GraphicsCommandList* cmdList,
+		D3D12_GPU_DESCRIPTOR_HANDLE srvHeapStart, UINT srvDescriptorSize,
+		D3D12_GPU_VIRTUAL_ADDRESS objectCB, UINT objectCBByteSize,
+		D3D12_GPU_VIRTUAL_ADDRESS materialCB, UINT materialCBByteSize,
+		D3D12_GPU_VIRTUAL_ADDRESS instanceData = 0, UINT instanceByteSize = 0);
+
+	virtual void SetPipelineState(ID3D12PipelineState* pso)override;
+	virtual void SetGeometry(const MeshGeometry* geo)override;
+	virtual void SetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)override;
+	virtual void SetTexture(UINT textureIndex)override;
+	virtual void SetMaterialConstants(UINT materialCBIndex)override;
+	virtual void SetObjectConstants(UINT objectCBIndex)override;
+	virtual void SetInstanceData(UINT firstInstance)override;
+	virtual void DrawIndexed(UINT indexCount, UINT instanceCount, UINT startIndexLocation, int baseVertexLocation)override;
+
+private:
+	ID3D12GraphicsCommandList* mCmdList = nullptr;
+
+	D3D12_GPU_DESCRIPTOR_HANDLE mSrvHeapStart;
+	UINT mSrvDescriptorSize = 0;
+
+	D3D12_GPU_VIRTUAL_ADDRESS mObjectCB = 0;
+	UINT mObjectCBByteSize = 0;
+	D3D12_GPU_VIRTUAL_ADDRESS mMaterialCB = 0;
+	UINT mMaterialCBByteSize = 0;
+	D3D12_GPU_VIRTUAL_ADDRESS mInstanceData = 0;
+	UINT mInstanceByteSize = 0;
+};
+
+#endif // COMMANDLISTSINK_H
@@ -24,7 +24,10 @@
 
 #include <wrl.h>
 #include <d3d11_1.h>
+#include <memory>
+#include <vector>
 #include "d3dx12.h"
+#include "TextureContainer.h"
 
 #pragma warning(push)
 #pragma warning(disable : 4005)
@@ -92,6 +95,20 @@ namespace DirectX
 		                               _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
 		                               );
 
+	// Creates the texture in the COPY_DEST state but does not create an upload heap or
+	// record any commands.  'subresources' points into 'ddsData', which must stay alive
+	// until the caller has copied the data into its own upload memory.  The chunks of a
+	// compressed container decode on 'decodeExecutor', or on this thread without one.
+	HRESULT LoadDDSTextureFromFile12(_In_ ID3D12Device* device,
+		                             _In_z_ const wchar_t* szFileName,
+		                             _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& texture,
+		                             _Out_ std::unique_ptr<uint8_t[]>& ddsData,
+		                             _Out_ std::vector<D3D12_SUBRESOURCE_DATA>& subresources,
+		                             _In_ size_t maxsize = 0,
+		                             _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr,
+		                             _In_opt_ const TextureContainer::Executor* decodeExecutor = nullptr
+		                             );
+
     // Standard version with optional auto-gen mipmap support
     HRESULT CreateDDSTextureFromMemory( _In_ ID3D11Device* d3dDevice,
                                         _In_opt_ ID3D11DeviceContext* d3dContext,
@@ -0,0 +1,152 @@
+//***************************************************************************************
+// DescriptorAllocator.cpp
+//***************************************************************************************
+
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+DescriptorAllocator::DescriptorAllocator(std::uint32_t persistentCount, std::uint32_t ringCount)
+	: mPersistentCount(persistentCount),
+	mRingCount(ringCount)
+{
+	if (persistentCount > 0)
+		mFreeRuns[0] = persistentCount;
+}
+
+std::uint32_t DescriptorAllocator::Allocate(std::uint32_t count)
+{
+	assert(count > 0);
+
+	for (auto it = mFreeRuns.begin(); it != mFreeRuns.end(); ++it)
+	{
+		if (it->second < count)
+			continue;
+
+		std::uint32_t first = it->first;
+		std::uint32_t rest = it->second - count;
+		mFreeRuns.erase(it);
+		if (rest > 0)
+			mFreeRuns[first + count] = rest;
+
+		mStats.PersistentUsed += count;
+		mStats.PersistentPeak = std::max<std::uint32_t>(mStats.PersistentPeak, mStats.PersistentUsed);
+		return first;
+	}
+
+	mStats.Failures++;
+	return InvalidIndex;
+}
+
+void DescriptorAllocator::Free(std::uint32_t first, std::uint32_t count)
+{
+	assert(count > 0 && first + count <= mPersistentCount);
+
+	PendingFree f;
+	f.First = first;
+	f.Count = count;
+	mPendingFrees.push_back(f);
+}
+
+void DescriptorAllocator::Release(std::uint32_t first, std::uint32_t count)
+{
+	mStats.PersistentUsed -= count;
+
+	// Merge with the runs right after and right before, if they touch.
+	auto next = mFreeRuns.lower_bound(first);
+	assert(next == mFreeRuns.end() || next->first >= first + count);
+
+	if (next != mFreeRuns.end() && next->first == first + count)
+	{
+		count += next->second;
+		next = mFreeRuns.erase(next);
+	}
+
+	if (next != mFreeRuns.begin())
+	{
+		auto prev = std::prev(next);
+		assert(prev->first + prev->second <= first);
+
+		if (prev->first + prev->second == first)
+		{
+			prev->second += count;
+			return;
+		}
+	}
+
+	mFreeRuns.emplace_hint(next, first, count);
+}
+
+std::uint32_t DescriptorAllocator::AllocateTransient(std::uint32_t count)
+{
+	assert(count > 0);
+
+	if (count > mRingCount)
+	{
+		mStats.Failures++;
+		return InvalidIndex;
+	}
+
+	// Runs must be contiguous, so skip the slots left at the end of the ring if the run
+	// does not fit there.
+	std::uint64_t head = mHead;
+	std::uint64_t offset = head % mRingCount;
+	if (offset + count > mRingCount)
+		head += mRingCount - offset;
+
+	if (head + count - mTail > mRingCount)
+	{
+		mStats.Failures++;
+		return InvalidIndex;
+	}
+
+	mHead = head + count;
+
+	mStats.RingUsed = (std::uint32_t)(mHead - mTail);
+	mStats.RingPeak = std::max<std::uint32_t>(mStats.RingPeak, mStats.RingUsed);
+
+	return mPersistentCount + (std::uint32_t)(head % mRingCount);
+}
+
+void DescriptorAllocator::FinishFrame(std::uint64_t fence)
+{
+	for (auto& f : mPendingFrees)
+	{
+		if (f.Fence == 0)
+			f.Fence = fence;
+	}
+
+	FrameMarker marker;
+	marker.Fence = fence;
+	marker.Head = mHead;
+	mFrames.push_back(marker);
+}
+
+void DescriptorAllocator::Retire(std::uint64_t completedFence)
+{
+	while (!mFrames.empty() && mFrames.front().Fence <= completedFence)
+	{
+		mTail = mFrames.front().Head;
+		mFrames.pop_front();
+	}
+	mStats.RingUsed = (std::uint32_t)(mHead - mTail);
+
+	size_t kept = 0;
+	for (size_t i = 0; i < mPendingFrees.size(); ++i)
+	{
+		const PendingFree& f = mPendingFrees[i];
+		if (f.Fence != 0 && f.Fence <= completedFence)
+			Release(f.First, f.Count);
+		else
+			mPendingFrees[kept++] = f;
+	}
+	mPendingFrees.resize(kept);
+}
+
+const DescriptorAllocator::Stats& DescriptorAllocator::GetStats()const
+{
+	mStats.FreeRuns = (std::uint32_t)mFreeRuns.size();
+	return mStats;
+}
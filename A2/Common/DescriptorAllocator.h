@@ -0,0 +1,107 @@
+//***************************************************************************************
+// DescriptorAllocator.h
+//
+// Hands out slots of a descriptor heap by index.  The heap is split in two regions:
+//   -[0, PersistentCount) holds descriptors that live across frames, such as texture
+//    SRVs.  Runs of slots come from a first fit free list that merges neighbouring
+//    free runs, so the region does not fragment as textures come and go.  A freed run
+//    is only reused once the frame it was freed in has completed on the GPU, since
+//    draws recorded before the Free may still read it.
+//   -[PersistentCount, Capacity) is a ring for descriptors written every frame.  Each
+//    frame's slots are handed back in bulk once its fence has completed, like
+//    UploadRingBuffer does for constants.
+//
+// Only deals in indices, so it runs without a device; DescriptorHeap puts it in front
+// of an ID3D12DescriptorHeap.  Only depends on the C++ standard library.
+//***************************************************************************************
+
+#ifndef DESCRIPTORALLOCATOR_H
+#define DESCRIPTORALLOCATOR_H
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+class DescriptorAllocator
+{
+public:
+	static const std::uint32_t InvalidIndex = UINT32_MAX;
+
+	struct Stats
+	{
+		std::uint32_t PersistentUsed = 0;
+		std::uint32_t PersistentPeak = 0;
+
+		// Separate free runs in the persistent region; 1 when it is not fragmented.
+		std::uint32_t FreeRuns = 0;
+
+		std::uint32_t RingUsed = 0;
+		std::uint32_t RingPeak = 0;
+
+		// Allocations that found no room.
+		std::uint32_t Failures = 0;
+	};
+
+	DescriptorAllocator(std::uint32_t persistentCount, std::uint32_t ringCount);
+	DescriptorAllocator(const DescriptorAllocator& rhs) = delete;
+	DescriptorAllocator& operator=(const DescriptorAllocator& rhs) = delete;
+
+	std::uint32_t PersistentCount()const { return mPersistentCount; }
+	std::uint32_t Capacity()const { return mPersistentCount + mRingCount; }
+
+	// First slot of 'count' contiguous persistent slots, or InvalidIndex if no free run
+	// is long enough.
+	std::uint32_t Allocate(std::uint32_t count = 1);
+
+	// Returns a run from Allocate(); it becomes free after the current frame completes.
+	void Free(std::uint32_t first, std::uint32_t count = 1);
+
+	// First slot of 'count' contiguous ring slots for the current frame, or InvalidIndex
+	// if the ring is full.
+	std::uint32_t AllocateTransient(std::uint32_t count);
+
+	// Frees and transient slots since the previous call belong to the frame that
+	// signals 'fence'.
+	void FinishFrame(std::uint64_t fence);
+
+	// Reclaims the slots of every frame whose fence is <= completedFence.
+	void Retire(std::uint64_t completedFence);
+
+	const Stats& GetStats()const;
+
+private:
+	void Release(std::uint32_t first, std::uint32_t count);
+
+	struct PendingFree
+	{
+		std::uint32_t First = 0;
+		std::uint32_t Count = 0;
+		std::uint64_t Fence = 0;
+	};
+
+	struct FrameMarker
+	{
+		std::uint64_t Fence = 0;
+		std::uint64_t Head = 0;
+	};
+
+private:
+	std::uint32_t mPersistentCount = 0;
+	std::uint32_t mRingCount = 0;
+
+	// Free runs of the persistent region, first slot -> length.
+	std::map<std::uint32_t, std::uint32_t> mFreeRuns;
+
+	// Frees waiting on a fence; those of the current frame have Fence 0.
+	std::vector<PendingFree> mPendingFrees;
+
+	// Monotonic ring positions; the live slots are [mTail, mHead) modulo mRingCount.
+	std::uint64_t mHead = 0;
+	std::uint64_t mTail = 0;
+	std::deque<FrameMarker> mFrames;
+
+	mutable Stats mStats;
+};
+
+#endif // DESCRIPTORALLOCATOR_H
@@ -0,0 +1,27 @@
+//***************************************************************************************
+// DescriptorHeap.cpp
+//***************************************************************************************
+
+#include "DescriptorHeap.h"
+
+DescriptorHeap::DescriptorHeap(ID3D12Device* device, UINT persistentCount, UINT ringCount)
+	: mAllocator(persistentCount, ringCount)
+{
+	D3D12_DESCRIPTOR_HEAP_DESC desc = {};
+	desc.NumDescriptors = persistentCount + ringCount;
+	desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	ThrowIfFailed(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&mHeap)));
+
+	mDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+CD3DX12_CPU_DESCRIPTOR_HANDLE DescriptorHeap::CpuHandle(UINT index)const
+{
+	return CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart(), index, mDescriptorSize);
+}
+
+CD3DX12_GPU_DESCRIPTOR_HANDLE DescriptorHeap::GpuHandle(UINT index)const
+{
+	return CD3DX12_GPU_DESCRIPTOR_HANDLE(mHeap->GetGPUDescriptorHandleForHeapStart(), index, mDescriptorSize);
+}
@@ -0,0 +1,34 @@
+//***************************************************************************************
+// DescriptorHeap.h
+//
+// Shader visible CBV/SRV/UAV heap whose slots are handed out by a DescriptorAllocator,
+// with the CPU and GPU handles of each slot.
+//***************************************************************************************
+
+#ifndef DESCRIPTORHEAP_H
+#define DESCRIPTORHEAP_H
+
+#include "d3dUtil.h"
+#include "DescriptorAllocator.h"
+
+class DescriptorHeap
+{
+public:
+	DescriptorHeap(ID3D12Device* device, UINT persistentCount, UINT ringCount);
+	DescriptorHeap(const DescriptorHeap& rhs) = delete;
+	DescriptorHeap& operator=(const DescriptorHeap& rhs) = delete;
+
+	ID3D12DescriptorHeap* Heap()const { return mHeap.Get(); }
+	DescriptorAllocator& Allocator() { return mAllocator; }
+	UINT DescriptorSize()const { return mDescriptorSize; }
+
+	CD3DX12_CPU_DESCRIPTOR_HANDLE CpuHandle(UINT index)const;
+	CD3DX12_GPU_DESCRIPTOR_HANDLE GpuHandle(UINT index)const;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mHeap;
+	DescriptorAllocator mAllocator;
+	UINT mDescriptorSize = 0;
+};
+
+#endif // DESCRIPTORHEAP_H
@@ -0,0 +1,293 @@
+//***************************************************************************************
+// DrawQueue.cpp
+//***************************************************************************************
+
+#include "DrawQueue.h"
+#include "JobSystem.h"
+
+static UINT64 Field(UINT value, UINT bits)
+{
+	UINT64 mask = (1ull << bits) - 1;
+	return (UINT64)value & mask;
+}
+
+static UINT QuantizeDepth(float depth)
+{
+	if (!(depth > 0.0f))
+		depth = 0.0f;
+	if (depth > 1.0f)
+		depth = 1.0f;
+
+	const UINT maxDepth = (1u << DrawSortKey::DepthBits) - 1;
+	return (UINT)(depth * (float)maxDepth);
+}
+
+UINT64 DrawSortKey::Opaque(UINT layer, UINT pso, UINT material, UINT geometry, float depth)
+{
+	//  63..60  59..52  51..40    39..28    27..4
+	//  layer   pso     material  geometry  depth (near first)
+	UINT64 key = Field(layer, LayerBits) << 60;
+	key |= Field(pso, PsoBits) << 52;
+	key |= Field(material, MaterialBits) << 40;
+	key |= Field(geometry, GeometryBits) << 28;
+	key |= Field(QuantizeDepth(depth), DepthBits) << 4;
+	return key;
+}
+
+UINT64 DrawSortKey::BackToFront(UINT layer, UINT pso, UINT material, UINT geometry, float depth)
+{
+	//  63..60  59..36              35..28  27..16    15..4
+	//  layer   inverted depth      pso     material  geometry
+	const UINT maxDepth = (1u << DepthBits) - 1;
+
+	UINT64 key = Field(layer, LayerBits) << 60;
+	key |= Field(maxDepth - QuantizeDepth(depth), DepthBits) << 36;
+	key |= Field(pso, PsoBits) << 28;
+	key |= Field(material, MaterialBits) << 16;
+	key |= Field(geometry, GeometryBits) << 4;
+	return key;
+}
+
+void DrawQueue::Sort()
+{
+	const UINT count = (UINT)mPackets.size();
+	if (count < 2)
+		return;
+
+	mKeys.resize(count);
+	mOrder.resize(count);
+	mScratch.resize(count);
+
+	UINT64 sameBits = ~0ull;
+	for (UINT i = 0; i < count; ++i)
+	{
+		mKeys[i] = mPackets[i].SortKey;
+		mOrder[i] = i;
+		sameBits &= ~(mKeys[i] ^ mKeys[0]);
+	}
+
+	// Stable LSD radix sort of the packet indices, one byte per pass.
+	for (UINT shift = 0; shift < 64; shift += 8)
+	{
+		if (((sameBits >> shift) & 0xff) == 0xff)
+			continue;
+
+		UINT offsets[256] = {};
+		for (UINT i = 0; i < count; ++i)
+			offsets[(mKeys[mOrder[i]] >> shift) & 0xff]++;
+
+		UINT sum = 0;
+		for (UINT b = 0; b < 256; ++b)
+		{
+			UINT n = offsets[b];
+			offsets[b] = sum;
+			sum += n;
+		}
+
+		for (UINT i = 0; i < count; ++i)
+			mScratch[offsets[(mKeys[mOrder[i]] >> shift) & 0xff]++] = mOrder[i];
+
+		mOrder.swap(mScratch);
+	}
+
+	mSorted.resize(count);
+	for (UINT i = 0; i < count; ++i)
+		mSorted[i] = mPackets[mOrder[i]];
+
+	mPackets.swap(mSorted);
+}
+
+static bool SameDrawState(const DrawPacket& a, const DrawPacket& b)
+{
+	return a.Pso == b.Pso &&
+		a.InstancedPso == b.InstancedPso &&
+		a.Geo == b.Geo &&
+		a.PrimitiveType == b.PrimitiveType &&
+		a.TextureIndex == b.TextureIndex &&
+		a.MaterialCBIndex == b.MaterialCBIndex &&
+		a.IndexCount == b.IndexCount &&
+		a.StartIndexLocation == b.StartIndexLocation &&
+		a.BaseVertexLocation == b.BaseVertexLocation;
+}
+
+void DrawQueue::MergeInstances(UINT minInstances)
+{
+	mInstanceObjects.clear();
+
+	if (minInstances < 2)
+		minInstances = 2;
+
+	size_t out = 0;
+	size_t i = 0;
+	while (i < mPackets.size())
+	{
+		size_t end = i + 1;
+		if (mPackets[i].InstancedPso != nullptr)
+		{
+			while (end < mPackets.size() && SameDrawState(mPackets[end], mPackets[i]))
+				++end;
+		}
+
+		DrawPacket p = mPackets[i];
+
+		if (end - i >= minInstances)
+		{
+			p.Pso = p.InstancedPso;
+			p.InstanceCount = (UINT)(end - i);
+			p.FirstInstance = (UINT)mInstanceObjects.size();
+
+			for (size_t k = i; k < end; ++k)
+				mInstanceObjects.push_back(mPackets[k].ObjectCBIndex);
+
+			mPackets[out++] = p;
+		}
+		else
+		{
+			// Too short a run; keep the packets as they are.
+			for (size_t k = i; k < end; ++k)
+				mPackets[out++] = mPackets[k];
+		}
+
+		i = end;
+	}
+
+	mPackets.resize(out);
+}
+
+UINT DrawQueue::Submit(DrawCommandSink& sink)const
+{
+	PacketRange all;
+	all.Count = (UINT)mPackets.size();
+	return Submit(sink, all);
+}
+
+UINT DrawQueue::Submit(DrawCommandSink& sink, const PacketRange& range)const
+{
+	UINT binds = 0;
+
+	ID3D12PipelineState* pso = nullptr;
+	const MeshGeometry* geo = nullptr;
+	D3D12_PRIMITIVE_TOPOLOGY topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	UINT texture = UINT_MAX;
+	UINT material = UINT_MAX;
+	UINT object = UINT_MAX;
+	UINT instance = UINT_MAX;
+
+	for (UINT i = range.First; i < range.First + range.Count; ++i)
+	{
+		const DrawPacket& p = mPackets[i];
+
+		if (p.Pso != pso)
+		{
+			sink.SetPipelineState(p.Pso);
+			pso = p.Pso;
+			binds++;
+		}
+
+		if (p.Geo != geo)
+		{
+			sink.SetGeometry(p.Geo);
+			geo = p.Geo;
+			binds++;
+		}
+
+		if (p.PrimitiveType != topology)
+		{
+			sink.SetPrimitiveTopology(p.PrimitiveType);
+			topology = p.PrimitiveType;
+			binds++;
+		}
+
+		if (p.TextureIndex != texture)
+		{
+			sink.SetTexture(p.TextureIndex);
+			texture = p.TextureIndex;
+			binds++;
+		}
+
+		if (p.MaterialCBIndex != material)
+		{
+			sink.SetMaterialConstants(p.MaterialCBIndex);
+			material = p.MaterialCBIndex;
+			binds++;
+		}
+
+		if (p.InstanceCount > 1)
+		{
+			if (p.FirstInstance != instance)
+			{
+				sink.SetInstanceData(p.FirstInstance);
+				instance = p.FirstInstance;
+				binds++;
+			}
+		}
+		else if (p.ObjectCBIndex != object)
+		{
+			sink.SetObjectConstants(p.ObjectCBIndex);
+			object = p.ObjectCBIndex;
+			binds++;
+		}
+
+		sink.DrawIndexed(p.IndexCount, p.InstanceCount, p.StartIndexLocation, p.BaseVertexLocation);
+	}
+
+	return binds;
+}
+
+void DrawQueue::SplitByLayer(std::vector<PacketRange>& ranges, UINT maxPackets)const
+{
+	ranges.clear();
+
+	for (UINT i = 0; i < (UINT)mPackets.size(); ++i)
+	{
+		bool newRange = ranges.empty() ||
+			ranges.back().Count >= maxPackets ||
+			DrawSortKey::Layer(mPackets[i].SortKey) != DrawSortKey::Layer(mPackets[i - 1].SortKey);
+
+		if (newRange)
+		{
+			PacketRange r;
+			r.First = i;
+			ranges.push_back(r);
+		}
+
+		ranges.back().Count++;
+	}
+}
+
+void DrawQueue::SubmitParallel(JobSystem& jobs, const std::vector<PacketRange>& ranges, DrawCommandSink* const* sinks)const
+{
+	jobs.ParallelFor((std::uint32_t)ranges.size(), 1, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t i = begin; i < end; ++i)
+			Submit(*sinks[i], ranges[i]);
+	});
+}
+
+UINT DrawQueue::SubmitUnfiltered(DrawCommandSink& sink)const
+{
+	UINT binds = 0;
+
+	ID3D12PipelineState* pso = nullptr;
+	for (const auto& p : mPackets)
+	{
+		// The old loop only changed PSOs between layers.
+		if (p.Pso != pso)
+		{
+			sink.SetPipelineState(p.Pso);
+			pso = p.Pso;
+			binds++;
+		}
+
+		sink.SetGeometry(p.Geo);
+		sink.SetPrimitiveTopology(p.PrimitiveType);
+		sink.SetTexture(p.TextureIndex);
+		sink.SetObjectConstants(p.ObjectCBIndex);
+		sink.SetMaterialConstants(p.MaterialCBIndex);
+		binds += 5;
+
+		sink.DrawIndexed(p.IndexCount, 1, p.StartIndexLocation, p.BaseVertexLocation);
+	}
+
+	return binds;
+}
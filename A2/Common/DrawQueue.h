@@ -0,0 +1,195 @@
+//***************************************************************************************
+// DrawQueue.h
+//
+// Collects a frame's draws as DrawPackets, sorts them on a 64 bit key and submits them
+// with redundant state changes removed.
+//   -Keys put the layer first so layers draw in order.  Within a layer, opaque keys
+//    sort by PSO, material and geometry, then front to back; blended keys sort back
+//    to front first and by state after.
+//   -Sorting is an LSD radix sort over the keys; passes over a byte every key shares
+//    are skipped.
+//   -MergeInstances() turns runs of sorted packets that differ only in their object
+//    into one instanced draw.  The objects of each instanced draw are listed in
+//    InstanceObjects(), for the caller to upload as a structured buffer.
+//   -Submission goes through a DrawCommandSink.  CommandListSink (CommandListSink.h)
+//    records into an ID3D12GraphicsCommandList, RecordingSink only counts what would
+//    be bound so the ordering and state filtering can be checked without a device.
+//   -SplitByLayer() cuts the sorted packets into one range per layer and
+//    SubmitParallel() records the ranges into separate sinks on a JobSystem, one
+//    command list each, to be executed in range order.
+//
+// Only needs the D3D12 type declarations, not a device, so it also builds on Linux
+// against the DirectX-Headers project (see Tools/RecordBench).
+//***************************************************************************************
+
+#ifndef DRAWQUEUE_H
+#define DRAWQUEUE_H
+
+#include <d3d12.h>
+#include <climits>
+#include <vector>
+
+class JobSystem;
+struct MeshGeometry;
+
+struct DrawPacket
+{
+	UINT64 SortKey = 0;
+
+	ID3D12PipelineState* Pso = nullptr;
+
+	// PSO that reads the world matrices from the instance buffer instead of the object
+	// constants; packets without one are never merged.
+	ID3D12PipelineState* InstancedPso = nullptr;
+
+	MeshGeometry* Geo = nullptr;
+	D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+
+	// SRV heap slot of the diffuse texture.
+	UINT TextureIndex = 0;
+
+	// Slots in the frame's material and object constant allocations.
+	UINT MaterialCBIndex = 0;
+	UINT ObjectCBIndex = 0;
+
+	UINT IndexCount = 0;
+	UINT StartIndexLocation = 0;
+	int BaseVertexLocation = 0;
+
+	// Set by MergeInstances.  Instanced packets read InstanceCount entries starting at
+	// FirstInstance of the instance buffer and ignore ObjectCBIndex.
+	UINT InstanceCount = 1;
+	UINT FirstInstance = 0;
+};
+
+class DrawSortKey
+{
+public:
+	static const UINT LayerBits = 4;
+	static const UINT PsoBits = 8;
+	static const UINT MaterialBits = 12;
+	static const UINT GeometryBits = 12;
+	static const UINT DepthBits = 24;
+
+	// 'depth' is the normalized view depth in [0, 1]; out of range values are clamped.
+	static UINT64 Opaque(UINT layer, UINT pso, UINT material, UINT geometry, float depth);
+	static UINT64 BackToFront(UINT layer, UINT pso, UINT material, UINT geometry, float depth);
+
+	static UINT Layer(UINT64 key) { return (UINT)(key >> 60); }
+};
+
+class DrawCommandSink
+{
+public:
+	virtual ~DrawCommandSink() = default;
+
+	virtual void SetPipelineState(ID3D12PipelineState* pso) = 0;
+	virtual void SetGeometry(const MeshGeometry* geo) = 0;
+	virtual void SetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) = 0;
+	virtual void SetTexture(UINT textureIndex) = 0;
+	virtual void SetMaterialConstants(UINT materialCBIndex) = 0;
+	virtual void SetObjectConstants(UINT objectCBIndex) = 0;
+	virtual void SetInstanceData(UINT firstInstance) = 0;
+	virtual void DrawIndexed(UINT indexCount, UINT instanceCount, UINT startIndexLocation, int baseVertexLocation) = 0;
+};
+
+// Counts the calls a submission makes.
+class RecordingSink : public DrawCommandSink
+{
+public:
+	struct Counts
+	{
+		UINT PipelineStates = 0;
+		UINT Geometries = 0;
+		UINT Topologies = 0;
+		UINT Textures = 0;
+		UINT MaterialConstants = 0;
+		UINT ObjectConstants = 0;
+		UINT InstanceData = 0;
+		UINT Draws = 0;
+		UINT Instances = 0;
+
+		UINT StateChanges()const
+		{
+			return PipelineStates + Geometries + Topologies + Textures + MaterialConstants +
+				ObjectConstants + InstanceData;
+		}
+	};
+
+	virtual void SetPipelineState(ID3D12PipelineState*)override { mCounts.PipelineStates++; }
+	virtual void SetGeometry(const MeshGeometry*)override { mCounts.Geometries++; }
+	virtual void SetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY)override { mCounts.Topologies++; }
+	virtual void SetTexture(UINT)override { mCounts.Textures++; }
+	virtual void SetMaterialConstants(UINT)override { mCounts.MaterialConstants++; }
+	virtual void SetObjectConstants(UINT)override { mCounts.ObjectConstants++; }
+	virtual void SetInstanceData(UINT)override { mCounts.InstanceData++; }
+
+	virtual void DrawIndexed(UINT, UINT instanceCount, UINT, int)override
+	{
+		mCounts.Draws++;
+		mCounts.Instances += instanceCount;
+	}
+
+	const Counts& GetCounts()const { return mCounts; }
+
+private:
+	Counts mCounts;
+};
+
+// A run of consecutive packets of a DrawQueue.
+struct PacketRange
+{
+	UINT First = 0;
+	UINT Count = 0;
+};
+
+class DrawQueue
+{
+public:
+	void Clear()
+	{
+		mPackets.clear();
+		mInstanceObjects.clear();
+	}
+
+	void Add(const DrawPacket& packet) { mPackets.push_back(packet); }
+
+	// Orders the packets by SortKey; packets with equal keys keep their insertion order.
+	void Sort();
+
+	// Collapses runs of at least 'minInstances' sorted packets that share everything but
+	// their object into instanced draws.  Call after Sort().
+	void MergeInstances(UINT minInstances = 2);
+
+	// ObjectCBIndex of every instance, in instance buffer order.
+	const std::vector<UINT>& InstanceObjects()const { return mInstanceObjects; }
+
+	// Issues every packet, skipping binds that match the state already set.  Returns
+	// the number of binds issued.
+	UINT Submit(DrawCommandSink& sink)const;
+	UINT Submit(DrawCommandSink& sink, const PacketRange& range)const;
+
+	// Cuts the packets where the layer field of the sort key changes, and also every
+	// 'maxPackets' packets.  Call after Sort().
+	void SplitByLayer(std::vector<PacketRange>& ranges, UINT maxPackets = UINT_MAX)const;
+
+	// Submits ranges[i] to sinks[i], the ranges in parallel.  Each sink starts from no
+	// bound state, so it must be a command list of its own.
+	void SubmitParallel(JobSystem& jobs, const std::vector<PacketRange>& ranges, DrawCommandSink* const* sinks)const;
+
+	// Issues every packet with all of its state, as an unsorted per-item loop would.
+	UINT SubmitUnfiltered(DrawCommandSink& sink)const;
+
+	const std::vector<DrawPacket>& Packets()const { return mPackets; }
+
+private:
+	std::vector<DrawPacket> mPackets;
+	std::vector<UINT> mInstanceObjects;
+
+	std::vector<UINT64> mKeys;
+	std::vector<UINT> mOrder;
+	std::vector<UINT> mScratch;
+	std::vector<DrawPacket> mSorted;
+};
+
+#endif // DRAWQUEUE_H
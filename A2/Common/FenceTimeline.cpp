@@ -0,0 +1,37 @@
+//***************************************************************************************
+// FenceTimeline.cpp
+//***************************************************************************************
+
+#include "FenceTimeline.h"
+
+FenceTimeline::FenceTimeline(ID3D12Fence* fence, std::uint32_t slotCount)
+	: mFence(fence)
+{
+	for (std::uint32_t i = 0; i < slotCount; ++i)
+	{
+		HANDLE e = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+		if (e == nullptr)
+			ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+		mEvents.push_back(e);
+	}
+}
+
+FenceTimeline::~FenceTimeline()
+{
+	for (HANDLE e : mEvents)
+		CloseHandle(e);
+}
+
+std::uint64_t FenceTimeline::CompletedValue()
+{
+	return mFence->GetCompletedValue();
+}
+
+void FenceTimeline::WaitFor(std::uint64_t value, std::uint32_t slot)
+{
+	// The events auto reset, so each wait consumes the signal it set up.  The event
+	// fires at once if the value has already completed.
+	HANDLE e = mEvents[slot % mEvents.size()];
+	ThrowIfFailed(mFence->SetEventOnCompletion(value, e));
+	WaitForSingleObject(e, INFINITE);
+}
@@ -0,0 +1,30 @@
+//***************************************************************************************
+// FenceTimeline.h
+//
+// FrameTimeline over an ID3D12Fence.  Waits block on a Win32 event kept per frame slot
+// and created once, rather than an event created and closed for every wait.
+//***************************************************************************************
+
+#ifndef FENCETIMELINE_H
+#define FENCETIMELINE_H
+
+#include "d3dUtil.h"
+#include "FrameScheduler.h"
+
+class FenceTimeline : public FrameTimeline
+{
+public:
+	FenceTimeline(ID3D12Fence* fence, std::uint32_t slotCount);
+	FenceTimeline(const FenceTimeline& rhs) = delete;
+	FenceTimeline& operator=(const FenceTimeline& rhs) = delete;
+	~FenceTimeline();
+
+	virtual std::uint64_t CompletedValue()override;
+	virtual void WaitFor(std::uint64_t value, std::uint32_t slot)override;
+
+private:
+	ID3D12Fence* mFence = nullptr;
+	std::vector<HANDLE> mEvents;
+};
+
+#endif // FENCETIMELINE_H
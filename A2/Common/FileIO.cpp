@@ -0,0 +1,742 @@
+//***************************************************************************************
+// FileIO.cpp
+//***************************************************************************************
+
+#include "FileIO.h"
+
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+
+namespace
+{
+	// Largest read handed to the OS at once; ReadFile takes 32 bits, read() at most
+	// 0x7ffff000 bytes on Linux.
+	const std::uint64_t MaxChunk = 1ull << 30;
+
+#if defined(_WIN32)
+	HANDLE OpenForRead(const FileIO::Path& path, DWORD flags)
+	{
+		return CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | flags, nullptr);
+	}
+
+	bool HandleSize(HANDLE file, std::uint64_t& size)
+	{
+		LARGE_INTEGER fileSize = {};
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < 0)
+			return false;
+
+		size = (std::uint64_t)fileSize.QuadPart;
+		return true;
+	}
+
+	// Keeps the error of a failed call across closing the handle.
+	void CloseKeepingError(HANDLE file)
+	{
+		DWORD error = GetLastError();
+		CloseHandle(file);
+		SetLastError(error);
+	}
+#else
+	int OpenForRead(const FileIO::Path& path)
+	{
+		int fd;
+		do
+		{
+			fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		} while (fd < 0 && errno == EINTR);
+		return fd;
+	}
+
+	bool DescriptorSize(int fd, std::uint64_t& size)
+	{
+		struct stat st;
+		if (fstat(fd, &st) != 0)
+			return false;
+
+		size = (std::uint64_t)st.st_size;
+		return true;
+	}
+
+	// Reads [offset, offset + size) of the file; false on error or end of file.
+	bool ReadAt(int fd, std::uint8_t* dest, std::uint64_t offset, std::uint64_t size)
+	{
+		while (size > 0)
+		{
+			ssize_t n = pread(fd, dest, (size_t)std::min<std::uint64_t>(size, MaxChunk), (off_t)offset);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n <= 0)
+				return false;
+
+			dest += n;
+			offset += (std::uint64_t)n;
+			size -= (std::uint64_t)n;
+		}
+		return true;
+	}
+
+	void CloseKeepingError(int fd)
+	{
+		int error = errno;
+		close(fd);
+		errno = error;
+	}
+#endif
+}
+
+FileIO::Path FileIO::ToPath(const std::string& utf8)
+{
+#if defined(_WIN32)
+	if (utf8.empty())
+		return Path();
+
+	int count = MultiByteToWideChar(CP_UTF8, 0, utf8.data(), (int)utf8.size(), nullptr, 0);
+	Path path(count, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, utf8.data(), (int)utf8.size(), &path[0], count);
+	return path;
+#else
+	return utf8;
+#endif
+}
+
+bool FileIO::Size(const Path& path, std::uint64_t& size)
+{
+#if defined(_WIN32)
+	HANDLE file = OpenForRead(path, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	bool ok = HandleSize(file, size);
+	CloseKeepingError(file);
+	return ok;
+#else
+	int fd = OpenForRead(path);
+	if (fd < 0)
+		return false;
+
+	bool ok = DescriptorSize(fd, size);
+	CloseKeepingError(fd);
+	return ok;
+#endif
+}
+
+bool FileIO::Read(const Path& path, const AllocateFn& allocate)
+{
+#if defined(_WIN32)
+	HANDLE file = OpenForRead(path, FILE_FLAG_SEQUENTIAL_SCAN);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	std::uint64_t size = 0;
+	if (!HandleSize(file, size))
+	{
+		CloseKeepingError(file);
+		return false;
+	}
+
+	auto dest = static_cast<std::uint8_t*>(allocate(size));
+	if (dest == nullptr && size > 0)
+	{
+		CloseHandle(file);
+		SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+		return false;
+	}
+
+	for (std::uint64_t done = 0; done < size; )
+	{
+		DWORD bytesRead = 0;
+		DWORD chunk = (DWORD)std::min<std::uint64_t>(size - done, MaxChunk);
+		if (!ReadFile(file, dest + done, chunk, &bytesRead, nullptr))
+		{
+			CloseKeepingError(file);
+			return false;
+		}
+
+		// The file got shorter since its size was read.
+		if (bytesRead == 0)
+		{
+			CloseHandle(file);
+			SetLastError(ERROR_HANDLE_EOF);
+			return false;
+		}
+		done += bytesRead;
+	}
+
+	CloseHandle(file);
+	return true;
+#else
+	int fd = OpenForRead(path);
+	if (fd < 0)
+		return false;
+
+	std::uint64_t size = 0;
+	if (!DescriptorSize(fd, size))
+	{
+		CloseKeepingError(fd);
+		return false;
+	}
+
+	auto dest = static_cast<std::uint8_t*>(allocate(size));
+	if (dest == nullptr && size > 0)
+	{
+		close(fd);
+		errno = ENOMEM;
+		return false;
+	}
+
+#if defined(POSIX_FADV_SEQUENTIAL)
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	if (!ReadAt(fd, dest, 0, size))
+	{
+		CloseKeepingError(fd);
+		return false;
+	}
+
+	close(fd);
+	return true;
+#endif
+}
+
+bool FileIO::Read(const Path& path, std::vector<std::uint8_t>& data)
+{
+	return Read(path, [&data](std::uint64_t size) -> void*
+	{
+		if (size > data.max_size())
+			return nullptr;
+
+		data.resize((size_t)size);
+		return data.data();
+	});
+}
+
+MappedFile::MappedFile(MappedFile&& rhs)
+{
+	*this = std::move(rhs);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& rhs)
+{
+	if (this != &rhs)
+	{
+		Close();
+
+		std::swap(mData, rhs.mData);
+		std::swap(mSize, rhs.mSize);
+		std::swap(mOpen, rhs.mOpen);
+#if defined(_WIN32)
+		std::swap(mFile, rhs.mFile);
+		std::swap(mMapping, rhs.mMapping);
+#endif
+	}
+	return *this;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const FileIO::Path& path)
+{
+	Close();
+
+#if defined(_WIN32)
+	HANDLE file = OpenForRead(path, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	std::uint64_t size = 0;
+	if (!HandleSize(file, size) || size > SIZE_MAX)
+	{
+		CloseKeepingError(file);
+		return false;
+	}
+
+	// Mapping an empty file fails, and there is nothing to map.
+	if (size > 0)
+	{
+		HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr)
+		{
+			CloseKeepingError(file);
+			return false;
+		}
+
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (view == nullptr)
+		{
+			CloseKeepingError(mapping);
+			CloseKeepingError(file);
+			return false;
+		}
+
+		mMapping = mapping;
+		mData = static_cast<const std::uint8_t*>(view);
+	}
+
+	mFile = file;
+#else
+	int fd = OpenForRead(path);
+	if (fd < 0)
+		return false;
+
+	std::uint64_t size = 0;
+	if (!DescriptorSize(fd, size) || size > SIZE_MAX)
+	{
+		CloseKeepingError(fd);
+		return false;
+	}
+
+	if (size > 0)
+	{
+		void* view = mmap(nullptr, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (view == MAP_FAILED)
+		{
+			CloseKeepingError(fd);
+			return false;
+		}
+
+		madvise(view, (size_t)size, MADV_SEQUENTIAL);
+		mData = static_cast<const std::uint8_t*>(view);
+	}
+
+	// The mapping keeps the file alive.
+	close(fd);
+#endif
+
+	mSize = size;
+	mOpen = true;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (!mOpen)
+		return;
+
+#if defined(_WIN32)
+	if (mData != nullptr)
+		UnmapViewOfFile(mData);
+	if (mMapping != nullptr)
+		CloseHandle(mMapping);
+	CloseHandle(mFile);
+	mMapping = nullptr;
+	mFile = nullptr;
+#else
+	if (mData != nullptr)
+		munmap(const_cast<std::uint8_t*>(mData), (size_t)mSize);
+#endif
+
+	mData = nullptr;
+	mSize = 0;
+	mOpen = false;
+}
+
+//---------------------------------------------------------------------------------------
+// io_uring, driven through the raw system calls so no library is needed.  One thread
+// opens the queued files, keeps up to QueueDepth reads in flight and chains each file's
+// next chunk as the previous one completes.
+//---------------------------------------------------------------------------------------
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+
+struct AsyncFileReader::Uring
+{
+	static const unsigned QueueDepth = 64;
+
+	struct InFlight
+	{
+		Request* Req = nullptr;
+		int Fd = -1;
+		std::uint64_t Offset = 0;
+	};
+
+	int Fd = -1;
+
+	void* SqRing = nullptr;
+	size_t SqRingSize = 0;
+	void* CqRing = nullptr;
+	size_t CqRingSize = 0;
+	io_uring_sqe* Sqes = nullptr;
+	size_t SqesSize = 0;
+
+	unsigned* SqHead = nullptr;
+	unsigned* SqTail = nullptr;
+	unsigned* SqMask = nullptr;
+	unsigned* SqArray = nullptr;
+	unsigned* CqHead = nullptr;
+	unsigned* CqTail = nullptr;
+	unsigned* CqMask = nullptr;
+	io_uring_cqe* Cqes = nullptr;
+
+	InFlight Slots[QueueDepth];
+	std::vector<unsigned> FreeSlots;
+	unsigned Unsubmitted = 0;
+
+	bool Create()
+	{
+		io_uring_params params = {};
+		Fd = (int)syscall(__NR_io_uring_setup, QueueDepth, &params);
+		if (Fd < 0)
+			return false;
+
+		SqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (single)
+			SqRingSize = CqRingSize = std::max(SqRingSize, CqRingSize);
+
+		SqRing = mmap(nullptr, SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_SQ_RING);
+		if (SqRing == MAP_FAILED)
+		{
+			SqRing = nullptr;
+			return false;
+		}
+
+		if (single)
+			CqRing = SqRing;
+		else
+		{
+			CqRing = mmap(nullptr, CqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_CQ_RING);
+			if (CqRing == MAP_FAILED)
+			{
+				CqRing = nullptr;
+				return false;
+			}
+		}
+
+		SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+		void* sqes = mmap(nullptr, SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_SQES);
+		if (sqes == MAP_FAILED)
+			return false;
+		Sqes = static_cast<io_uring_sqe*>(sqes);
+
+		auto sq = static_cast<std::uint8_t*>(SqRing);
+		SqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+		SqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+		SqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+		SqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+		auto cq = static_cast<std::uint8_t*>(CqRing);
+		CqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+		CqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+		CqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+		Cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+		for (unsigned i = QueueDepth; i > 0; --i)
+			FreeSlots.push_back(i - 1);
+
+		return true;
+	}
+
+	~Uring()
+	{
+		if (Sqes != nullptr)
+			munmap(Sqes, SqesSize);
+		if (CqRing != nullptr && CqRing != SqRing)
+			munmap(CqRing, CqRingSize);
+		if (SqRing != nullptr)
+			munmap(SqRing, SqRingSize);
+		if (Fd >= 0)
+			close(Fd);
+	}
+
+	unsigned InFlightCount()const { return QueueDepth - (unsigned)FreeSlots.size(); }
+
+	// Queues the read of the slot's next chunk.
+	void QueueRead(unsigned slot)
+	{
+		InFlight& f = Slots[slot];
+		std::uint64_t size = f.Req->Data.size();
+
+		unsigned tail = *SqTail;
+		unsigned index = tail & *SqMask;
+
+		io_uring_sqe& sqe = Sqes[index];
+		sqe = io_uring_sqe();
+		sqe.opcode = IORING_OP_READ;
+		sqe.fd = f.Fd;
+		sqe.off = f.Offset;
+		sqe.addr = (std::uint64_t)(uintptr_t)(f.Req->Data.data() + f.Offset);
+		sqe.len = (std::uint32_t)std::min<std::uint64_t>(size - f.Offset, MaxChunk);
+		sqe.user_data = slot;
+
+		SqArray[index] = index;
+		__atomic_store_n(SqTail, tail + 1, __ATOMIC_RELEASE);
+		Unsubmitted++;
+	}
+
+	// Submits the queued reads and waits for at least one to complete.
+	bool SubmitAndWait()
+	{
+		for (;;)
+		{
+			int r = (int)syscall(__NR_io_uring_enter, Fd, Unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+			if (r >= 0)
+			{
+				Unsubmitted -= std::min<unsigned>((unsigned)r, Unsubmitted);
+				return true;
+			}
+			if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+				return false;
+		}
+	}
+};
+
+#else
+
+// No io_uring on this platform; AsyncFileReader falls back to threads.
+struct AsyncFileReader::Uring
+{
+};
+
+#endif
+
+AsyncFileReader::AsyncFileReader(Backend backend, unsigned threadCount)
+	: mBackend(backend)
+{
+#if defined(__linux__) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+	if (mBackend == Backend::IoUring)
+	{
+		mUring.reset(new Uring());
+		if (mUring->Create())
+		{
+			mThreads.emplace_back(&AsyncFileReader::UringLoop, this);
+			return;
+		}
+		mUring.reset();
+	}
+#endif
+
+	mBackend = Backend::Threads;
+
+	if (threadCount == 0)
+		threadCount = std::min(std::max(std::thread::hardware_concurrency(), 1u), 4u);
+
+	for (unsigned i = 0; i < threadCount; ++i)
+		mThreads.emplace_back(&AsyncFileReader::ThreadLoop, this);
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+	mWork.notify_all();
+
+	for (std::thread& t : mThreads)
+		t.join();
+}
+
+AsyncFileReader::Ticket AsyncFileReader::Read(const FileIO::Path& path)
+{
+	std::unique_ptr<Request> request(new Request());
+	request->Path = path;
+
+	Ticket ticket;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		ticket = mNextTicket++;
+		mQueue.push_back(request.get());
+		mRequests.emplace(ticket, std::move(request));
+	}
+	mWork.notify_one();
+
+	return ticket;
+}
+
+bool AsyncFileReader::Wait(Ticket ticket, std::vector<std::uint8_t>& data)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	auto it = mRequests.find(ticket);
+	if (it == mRequests.end())
+		return false;
+
+	Request& request = *it->second;
+	mDone.wait(lock, [&request]() { return request.Done; });
+
+	bool ok = request.Ok;
+	data = std::move(request.Data);
+	mRequests.erase(it);
+
+	return ok;
+}
+
+void AsyncFileReader::Complete(Request& request, bool ok)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		request.Ok = ok;
+		request.Done = true;
+		if (!ok)
+			request.Data.clear();
+	}
+	mDone.notify_all();
+}
+
+void AsyncFileReader::ThreadLoop()
+{
+	for (;;)
+	{
+		Request* request;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWork.wait(lock, [this]() { return mStop || !mQueue.empty(); });
+			if (mQueue.empty())
+				return;
+
+			request = mQueue.front();
+			mQueue.pop_front();
+		}
+
+		// Only this thread touches the request until it is marked done.
+		bool ok = FileIO::Read(request->Path, request->Data);
+		Complete(*request, ok);
+	}
+}
+
+void AsyncFileReader::UringLoop()
+{
+#if defined(__linux__) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+	Uring& ring = *mUring;
+
+	for (;;)
+	{
+		std::vector<Request*> started;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			if (ring.InFlightCount() == 0)
+			{
+				mWork.wait(lock, [this]() { return mStop || !mQueue.empty(); });
+				if (mQueue.empty())
+					return;
+			}
+
+			while (!mQueue.empty() && started.size() < ring.FreeSlots.size())
+			{
+				started.push_back(mQueue.front());
+				mQueue.pop_front();
+			}
+		}
+
+		for (Request* request : started)
+		{
+			int fd = OpenForRead(request->Path);
+			std::uint64_t size = 0;
+			if (fd < 0 || !DescriptorSize(fd, size) || size > request->Data.max_size())
+			{
+				if (fd >= 0)
+					close(fd);
+				Complete(*request, false);
+				continue;
+			}
+
+			if (size == 0)
+			{
+				close(fd);
+				Complete(*request, true);
+				continue;
+			}
+
+			request->Data.resize((size_t)size);
+
+			unsigned slot = ring.FreeSlots.back();
+			ring.FreeSlots.pop_back();
+			ring.Slots[slot].Req = request;
+			ring.Slots[slot].Fd = fd;
+			ring.Slots[slot].Offset = 0;
+			ring.QueueRead(slot);
+		}
+
+		if (ring.InFlightCount() == 0)
+			continue;
+
+		if (!ring.SubmitAndWait())
+		{
+			// The ring is unusable; finish what is in flight synchronously.
+			for (unsigned slot = 0; slot < Uring::QueueDepth; ++slot)
+			{
+				Uring::InFlight& f = ring.Slots[slot];
+				if (f.Req == nullptr)
+					continue;
+
+				bool ok = ReadAt(f.Fd, f.Req->Data.data() + f.Offset, f.Offset, f.Req->Data.size() - f.Offset);
+				close(f.Fd);
+				Complete(*f.Req, ok);
+				f = Uring::InFlight();
+				ring.FreeSlots.push_back(slot);
+			}
+			ring.Unsubmitted = 0;
+
+			// Later reads go through the same path as the thread backend.
+			ThreadLoop();
+			return;
+		}
+
+		unsigned head = *ring.CqHead;
+		unsigned tail = __atomic_load_n(ring.CqTail, __ATOMIC_ACQUIRE);
+		for (; head != tail; ++head)
+		{
+			const io_uring_cqe& cqe = ring.Cqes[head & *ring.CqMask];
+			unsigned slot = (unsigned)cqe.user_data;
+			int result = cqe.res;
+
+			Uring::InFlight& f = ring.Slots[slot];
+			bool done = false;
+			bool ok = false;
+
+			if (result == -EINTR || result == -EAGAIN)
+			{
+				ring.QueueRead(slot);
+			}
+			else if (result == -EINVAL || result == -EOPNOTSUPP)
+			{
+				// Kernels before 5.6 have the ring but not IORING_OP_READ.
+				ok = ReadAt(f.Fd, f.Req->Data.data() + f.Offset, f.Offset, f.Req->Data.size() - f.Offset);
+				done = true;
+			}
+			else if (result <= 0)
+			{
+				// An error, or the file got shorter since it was opened.
+				done = true;
+			}
+			else
+			{
+				f.Offset += (std::uint64_t)result;
+				if (f.Offset < f.Req->Data.size())
+					ring.QueueRead(slot);
+				else
+					done = ok = true;
+			}
+
+			if (done)
+			{
+				close(f.Fd);
+				Complete(*f.Req, ok);
+				f = Uring::InFlight();
+				ring.FreeSlots.push_back(slot);
+			}
+		}
+		__atomic_store_n(ring.CqHead, head, __ATOMIC_RELEASE);
+	}
+#endif
+}
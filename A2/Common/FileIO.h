@@ -0,0 +1,145 @@
+//***************************************************************************************
+// FileIO.h
+//
+// Portable whole-file reads for loading assets (compiled shaders, textures).
+//   -FileIO::Read reads a file straight into memory the caller provides once it knows
+//    the size, so a blob or texture buffer is filled without a temporary copy.  Sizes
+//    are 64 bit; large files are read in chunks the OS accepts.
+//   -MappedFile maps a file read-only, for parsing it in place.
+//   -AsyncFileReader reads files in the background.  Reads are done on a pool of
+//    threads, or on Linux, where the kernel supports it, queued together on an
+//    io_uring from a single thread.
+//
+// Paths are FileIO::Path: wide on Windows, narrow (UTF-8) elsewhere, matching what the
+// OS file APIs take.
+// Only depends on the C++ standard library and the OS file APIs.
+//***************************************************************************************
+
+#ifndef FILEIO_H
+#define FILEIO_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class FileIO
+{
+public:
+#if defined(_WIN32)
+	typedef std::wstring Path;
+#else
+	typedef std::string Path;
+#endif
+
+	// Called with the file's size; returns where to read it to, or null to give up.
+	typedef std::function<void*(std::uint64_t size)> AllocateFn;
+
+	static Path ToPath(const std::string& utf8);
+
+	// False if the file can not be opened.
+	static bool Size(const Path& path, std::uint64_t& size);
+
+	// Reads the whole file into the memory 'allocate' returns.  False if the file can not
+	// be read, is shorter than its size said, or 'allocate' gives up (returning null for
+	// an empty file is fine).
+	static bool Read(const Path& path, const AllocateFn& allocate);
+	static bool Read(const Path& path, std::vector<std::uint8_t>& data);
+};
+
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(MappedFile&& rhs);
+	MappedFile& operator=(MappedFile&& rhs);
+	MappedFile(const MappedFile& rhs) = delete;
+	MappedFile& operator=(const MappedFile& rhs) = delete;
+	~MappedFile();
+
+	// Maps the whole file.  An empty file opens with a null Data().
+	bool Open(const FileIO::Path& path);
+	void Close();
+
+	bool IsOpen()const { return mOpen; }
+	const std::uint8_t* Data()const { return mData; }
+	std::uint64_t Size()const { return mSize; }
+
+private:
+	const std::uint8_t* mData = nullptr;
+	std::uint64_t mSize = 0;
+	bool mOpen = false;
+
+#if defined(_WIN32)
+	void* mFile = nullptr;
+	void* mMapping = nullptr;
+#endif
+};
+
+class AsyncFileReader
+{
+public:
+	enum class Backend
+	{
+		Threads,
+		IoUring
+	};
+
+	typedef std::uint64_t Ticket;
+
+	// threadCount of 0 uses one thread per hardware thread, up to 4.  IoUring falls back
+	// to Threads where it is not available; GetBackend() says which one is used.
+	explicit AsyncFileReader(Backend backend = Backend::IoUring, unsigned threadCount = 0);
+	AsyncFileReader(const AsyncFileReader& rhs) = delete;
+	AsyncFileReader& operator=(const AsyncFileReader& rhs) = delete;
+
+	// Finishes the reads already queued.
+	~AsyncFileReader();
+
+	Backend GetBackend()const { return mBackend; }
+
+	// Queues a read of the whole file.
+	Ticket Read(const FileIO::Path& path);
+
+	// Blocks until the read is done and moves its contents into 'data'.  False if the
+	// file could not be read.  Each ticket is waited on exactly once.
+	bool Wait(Ticket ticket, std::vector<std::uint8_t>& data);
+
+private:
+	struct Request
+	{
+		FileIO::Path Path;
+		std::vector<std::uint8_t> Data;
+		bool Done = false;
+		bool Ok = false;
+	};
+
+	struct Uring;
+
+	void ThreadLoop();
+	void UringLoop();
+	void Complete(Request& request, bool ok);
+
+private:
+	Backend mBackend;
+
+	std::mutex mMutex;
+	std::condition_variable mWork;
+	std::condition_variable mDone;
+	bool mStop = false;
+
+	Ticket mNextTicket = 1;
+	std::deque<Request*> mQueue;
+	std::unordered_map<Ticket, std::unique_ptr<Request>> mRequests;
+
+	std::unique_ptr<Uring> mUring;
+	std::vector<std::thread> mThreads;
+};
+
+#endif // FILEIO_H
@@ -0,0 +1,114 @@
+//***************************************************************************************
+// FrameScheduler.cpp
+//***************************************************************************************
+
+#include "FrameScheduler.h"
+
+#include <cassert>
+#include <chrono>
+
+typedef std::chrono::steady_clock Clock;
+
+static double ElapsedMs(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+FrameScheduler::FrameScheduler(FrameTimeline* timeline, std::uint32_t framesInFlight)
+	: mTimeline(timeline),
+	mSlotFences(framesInFlight > 0 ? framesInFlight : 1, 0)
+{
+	// BeginFrame() advances first, so the first frame gets slot 0.
+	mCurrSlot = FramesInFlight() - 1;
+
+	mAheadThread = std::thread(&FrameScheduler::AheadLoop, this);
+}
+
+FrameScheduler::~FrameScheduler()
+{
+	{
+		std::unique_lock<std::mutex> lock(mAheadMutex);
+		mAheadDone.wait(lock, [this]() { return !mAheadBusy; });
+		mQuit = true;
+	}
+	mAheadWake.notify_one();
+	mAheadThread.join();
+}
+
+std::uint32_t FrameScheduler::BeginFrame()
+{
+	mCurrSlot = (mCurrSlot + 1) % FramesInFlight();
+
+	std::uint64_t fence = mSlotFences[mCurrSlot];
+
+	mStats.LastGpuWaitMs = 0.0;
+	if (fence != 0 && mTimeline->CompletedValue() < fence)
+	{
+		auto start = Clock::now();
+		mTimeline->WaitFor(fence, mCurrSlot);
+		mStats.LastGpuWaitMs = ElapsedMs(start);
+		mStats.TotalGpuWaitMs += mStats.LastGpuWaitMs;
+		mStats.StalledFrames++;
+	}
+
+	mStats.Frames++;
+	return mCurrSlot;
+}
+
+void FrameScheduler::EndFrame(std::uint64_t fenceValue)
+{
+	assert(fenceValue > mLastFence);
+
+	mSlotFences[mCurrSlot] = fenceValue;
+	mLastFence = fenceValue;
+}
+
+void FrameScheduler::WaitIdle()
+{
+	if (mLastFence != 0 && mTimeline->CompletedValue() < mLastFence)
+		mTimeline->WaitFor(mLastFence, mCurrSlot);
+}
+
+void FrameScheduler::RunAhead(std::function<void()> fn)
+{
+	WaitAhead();
+
+	{
+		std::lock_guard<std::mutex> lock(mAheadMutex);
+		mAheadFn = std::move(fn);
+		mAheadBusy = true;
+	}
+	mAheadWake.notify_one();
+}
+
+void FrameScheduler::WaitAhead()
+{
+	std::unique_lock<std::mutex> lock(mAheadMutex);
+	if (!mAheadBusy)
+		return;
+
+	auto start = Clock::now();
+	mAheadDone.wait(lock, [this]() { return !mAheadBusy; });
+	mStats.TotalAheadWaitMs += ElapsedMs(start);
+}
+
+void FrameScheduler::AheadLoop()
+{
+	std::unique_lock<std::mutex> lock(mAheadMutex);
+	for (;;)
+	{
+		mAheadWake.wait(lock, [this]() { return mQuit || mAheadFn; });
+		if (mQuit)
+			return;
+
+		std::function<void()> fn = std::move(mAheadFn);
+		mAheadFn = nullptr;
+
+		lock.unlock();
+		fn();
+		lock.lock();
+
+		mAheadBusy = false;
+		mAheadDone.notify_all();
+	}
+}
@@ -0,0 +1,103 @@
+//***************************************************************************************
+// FrameScheduler.h
+//
+// Paces the CPU against the GPU for a configurable number of frames in flight.
+//   -BeginFrame() picks the next frame slot (frame resource) and blocks until the GPU
+//    has finished the frame that last used it.  EndFrame() records the fence value the
+//    frame's commands signal.
+//   -The GPU's progress is read through a FrameTimeline, so the same scheduling runs
+//    against a D3D12 fence (FenceTimeline.h) or a simulated GPU (see Tools/FrameSim).
+//   -RunAhead() starts work for the next frame, such as its simulation step, on the
+//    scheduler's own thread while the caller records and submits the current one.
+//    WaitAhead() joins it.
+//   -The time spent blocked in each is measured; see GetStats().
+//
+// Only depends on the C++ standard library.
+//***************************************************************************************
+
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fence values completed by the GPU.  Values are signaled in increasing order.
+class FrameTimeline
+{
+public:
+	virtual ~FrameTimeline() = default;
+
+	virtual std::uint64_t CompletedValue() = 0;
+
+	// Blocks until CompletedValue() >= value.  'slot' is the frame slot that is waiting,
+	// so an implementation can keep one wait object per slot.
+	virtual void WaitFor(std::uint64_t value, std::uint32_t slot) = 0;
+};
+
+class FrameScheduler
+{
+public:
+	struct Stats
+	{
+		std::uint64_t Frames = 0;
+
+		// Frames whose slot was still in use by the GPU in BeginFrame().
+		std::uint64_t StalledFrames = 0;
+
+		// Time blocked in BeginFrame() on the GPU, last frame and in total.
+		double LastGpuWaitMs = 0.0;
+		double TotalGpuWaitMs = 0.0;
+
+		// Time blocked in WaitAhead() on unfinished RunAhead() work, in total.
+		double TotalAheadWaitMs = 0.0;
+	};
+
+	FrameScheduler(FrameTimeline* timeline, std::uint32_t framesInFlight);
+	FrameScheduler(const FrameScheduler& rhs) = delete;
+	FrameScheduler& operator=(const FrameScheduler& rhs) = delete;
+	~FrameScheduler();
+
+	std::uint32_t FramesInFlight()const { return (std::uint32_t)mSlotFences.size(); }
+
+	// Waits until the next slot is free and returns it.
+	std::uint32_t BeginFrame();
+
+	// 'fenceValue' is signaled once the GPU has finished the frame begun last.
+	void EndFrame(std::uint64_t fenceValue);
+
+	// Waits for every frame ended so far.
+	void WaitIdle();
+
+	// Runs 'fn' on the scheduler's thread.  Any earlier RunAhead() work is joined first.
+	void RunAhead(std::function<void()> fn);
+	void WaitAhead();
+
+	const Stats& GetStats()const { return mStats; }
+
+private:
+	void AheadLoop();
+
+private:
+	FrameTimeline* mTimeline = nullptr;
+
+	// Fence value of the last frame to use each slot, 0 if none.
+	std::vector<std::uint64_t> mSlotFences;
+	std::uint32_t mCurrSlot = 0;
+	std::uint64_t mLastFence = 0;
+
+	Stats mStats;
+
+	std::thread mAheadThread;
+	std::mutex mAheadMutex;
+	std::condition_variable mAheadWake;
+	std::condition_variable mAheadDone;
+	std::function<void()> mAheadFn;
+	bool mAheadBusy = false;
+	bool mQuit = false;
+};
+
+#endif // FRAMESCHEDULER_H
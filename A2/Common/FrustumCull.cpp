@@ -0,0 +1,264 @@
+//***************************************************************************************
+// FrustumCull.cpp
+//***************************************************************************************
+
+#include "FrustumCull.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#else
+#include <xmmintrin.h>
+#endif
+
+using namespace DirectX;
+
+namespace FrustumCull
+{
+
+// Thin wrappers so the batch kernels below are written once for either register width.
+#if defined(__AVX__)
+	typedef __m256 Batch;
+	static const std::uint32_t Width = 8;
+
+	static inline Batch Load(const float* p) { return _mm256_loadu_ps(p); }
+	static inline Batch Splat(float v) { return _mm256_set1_ps(v); }
+	static inline Batch Add(Batch a, Batch b) { return _mm256_add_ps(a, b); }
+	static inline Batch Mul(Batch a, Batch b) { return _mm256_mul_ps(a, b); }
+	static inline Batch GreaterEqual(Batch a, Batch b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	static inline Batch And(Batch a, Batch b) { return _mm256_and_ps(a, b); }
+	static inline Batch AllTrue() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+	static inline int Mask(Batch a) { return _mm256_movemask_ps(a); }
+#else
+	typedef __m128 Batch;
+	static const std::uint32_t Width = 4;
+
+	static inline Batch Load(const float* p) { return _mm_loadu_ps(p); }
+	static inline Batch Splat(float v) { return _mm_set1_ps(v); }
+	static inline Batch Add(Batch a, Batch b) { return _mm_add_ps(a, b); }
+	static inline Batch Mul(Batch a, Batch b) { return _mm_mul_ps(a, b); }
+	static inline Batch GreaterEqual(Batch a, Batch b) { return _mm_cmpge_ps(a, b); }
+	static inline Batch And(Batch a, Batch b) { return _mm_and_ps(a, b); }
+	static inline Batch AllTrue() { return _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps()); }
+	static inline int Mask(Batch a) { return _mm_movemask_ps(a); }
+#endif
+
+	static XMFLOAT4 NormalizePlane(float a, float b, float c, float d)
+	{
+		float invLength = 1.0f / std::sqrt(a * a + b * b + c * c);
+		return XMFLOAT4(a * invLength, b * invLength, c * invLength, d * invLength);
+	}
+
+	Frustum Frustum::FromViewProj(FXMMATRIX viewProj)
+	{
+		// With row vectors clip = p * M, so each clip coordinate is p dotted with a column
+		// of M.  The planes are -w <= x <= w, -w <= y <= w and 0 <= z <= w.
+		XMFLOAT4X4 m;
+		XMStoreFloat4x4(&m, viewProj);
+
+		Frustum f;
+		f.Planes[0] = NormalizePlane(m(0, 3) + m(0, 0), m(1, 3) + m(1, 0), m(2, 3) + m(2, 0), m(3, 3) + m(3, 0));
+		f.Planes[1] = NormalizePlane(m(0, 3) - m(0, 0), m(1, 3) - m(1, 0), m(2, 3) - m(2, 0), m(3, 3) - m(3, 0));
+		f.Planes[2] = NormalizePlane(m(0, 3) + m(0, 1), m(1, 3) + m(1, 1), m(2, 3) + m(2, 1), m(3, 3) + m(3, 1));
+		f.Planes[3] = NormalizePlane(m(0, 3) - m(0, 1), m(1, 3) - m(1, 1), m(2, 3) - m(2, 1), m(3, 3) - m(3, 1));
+		f.Planes[4] = NormalizePlane(m(0, 2), m(1, 2), m(2, 2), m(3, 2));
+		f.Planes[5] = NormalizePlane(m(0, 3) - m(0, 2), m(1, 3) - m(1, 2), m(2, 3) - m(2, 2), m(3, 3) - m(3, 2));
+		return f;
+	}
+
+	void SphereList::Resize(std::uint32_t count)
+	{
+		CenterX.resize(count);
+		CenterY.resize(count);
+		CenterZ.resize(count);
+		Radius.resize(count);
+	}
+
+	void SphereList::Set(std::uint32_t i, const XMFLOAT3& center, float radius)
+	{
+		CenterX[i] = center.x;
+		CenterY[i] = center.y;
+		CenterZ[i] = center.z;
+		Radius[i] = radius;
+	}
+
+	void AabbList::Resize(std::uint32_t count)
+	{
+		CenterX.resize(count);
+		CenterY.resize(count);
+		CenterZ.resize(count);
+		ExtentX.resize(count);
+		ExtentY.resize(count);
+		ExtentZ.resize(count);
+	}
+
+	void AabbList::Set(std::uint32_t i, const XMFLOAT3& center, const XMFLOAT3& extents)
+	{
+		CenterX[i] = center.x;
+		CenterY[i] = center.y;
+		CenterZ[i] = center.z;
+		ExtentX[i] = extents.x;
+		ExtentY[i] = extents.y;
+		ExtentZ[i] = extents.z;
+	}
+
+	static bool SphereVisible(const Frustum& f, float x, float y, float z, float r)
+	{
+		for (const auto& p : f.Planes)
+		{
+			// Same grouping as the batch kernels so both round alike.
+			float d = (p.x * x + p.y * y) + (p.z * z + p.w);
+			if (d + r < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	static bool AabbVisible(const Frustum& f, float cx, float cy, float cz, float ex, float ey, float ez)
+	{
+		// Distance of the box corner furthest along the plane normal.
+		for (const auto& p : f.Planes)
+		{
+			float d = (p.x * cx + p.y * cy) + (p.z * cz + p.w);
+			float reach = (std::fabs(p.x) * ex + std::fabs(p.y) * ey) + std::fabs(p.z) * ez;
+			if (d + reach < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	// Appends base + lane for every lane set in 'mask'.  Writes a slot for every lane
+	// but only advances past the visible ones, so there is no branch per volume.
+	static inline std::uint32_t Compact(int mask, std::uint32_t base, std::uint32_t* visible, std::uint32_t n)
+	{
+		for (std::uint32_t lane = 0; lane < Width; ++lane)
+		{
+			visible[n] = base + lane;
+			n += (mask >> lane) & 1;
+		}
+		return n;
+	}
+
+	std::uint32_t CullSpheres(const Frustum& f, const SphereList& s, std::uint32_t* visible)
+	{
+		const std::uint32_t count = s.Size();
+		const std::uint32_t batched = count - count % Width;
+
+		Batch planeX[6], planeY[6], planeZ[6], planeW[6];
+		for (int p = 0; p < 6; ++p)
+		{
+			planeX[p] = Splat(f.Planes[p].x);
+			planeY[p] = Splat(f.Planes[p].y);
+			planeZ[p] = Splat(f.Planes[p].z);
+			planeW[p] = Splat(f.Planes[p].w);
+		}
+
+		const Batch zero = Splat(0.0f);
+
+		std::uint32_t n = 0;
+		for (std::uint32_t i = 0; i < batched; i += Width)
+		{
+			Batch x = Load(&s.CenterX[i]);
+			Batch y = Load(&s.CenterY[i]);
+			Batch z = Load(&s.CenterZ[i]);
+			Batch r = Load(&s.Radius[i]);
+
+			Batch inside = AllTrue();
+			for (int p = 0; p < 6; ++p)
+			{
+				// dot(n, c) + d + r >= 0
+				Batch d = Add(Add(Mul(planeX[p], x), Mul(planeY[p], y)), Add(Mul(planeZ[p], z), planeW[p]));
+				inside = And(inside, GreaterEqual(Add(d, r), zero));
+			}
+
+			n = Compact(Mask(inside), i, visible, n);
+		}
+
+		for (std::uint32_t i = batched; i < count; ++i)
+		{
+			if (SphereVisible(f, s.CenterX[i], s.CenterY[i], s.CenterZ[i], s.Radius[i]))
+				visible[n++] = i;
+		}
+
+		return n;
+	}
+
+	std::uint32_t CullAabbs(const Frustum& f, const AabbList& b, std::uint32_t* visible)
+	{
+		const std::uint32_t count = b.Size();
+		const std::uint32_t batched = count - count % Width;
+
+		Batch planeX[6], planeY[6], planeZ[6], planeW[6];
+		Batch absX[6], absY[6], absZ[6];
+		for (int p = 0; p < 6; ++p)
+		{
+			planeX[p] = Splat(f.Planes[p].x);
+			planeY[p] = Splat(f.Planes[p].y);
+			planeZ[p] = Splat(f.Planes[p].z);
+			planeW[p] = Splat(f.Planes[p].w);
+			absX[p] = Splat(std::fabs(f.Planes[p].x));
+			absY[p] = Splat(std::fabs(f.Planes[p].y));
+			absZ[p] = Splat(std::fabs(f.Planes[p].z));
+		}
+
+		const Batch zero = Splat(0.0f);
+
+		std::uint32_t n = 0;
+		for (std::uint32_t i = 0; i < batched; i += Width)
+		{
+			Batch cx = Load(&b.CenterX[i]);
+			Batch cy = Load(&b.CenterY[i]);
+			Batch cz = Load(&b.CenterZ[i]);
+			Batch ex = Load(&b.ExtentX[i]);
+			Batch ey = Load(&b.ExtentY[i]);
+			Batch ez = Load(&b.ExtentZ[i]);
+
+			Batch inside = AllTrue();
+			for (int p = 0; p < 6; ++p)
+			{
+				// dot(n, c) + d + dot(|n|, e) >= 0
+				Batch d = Add(Add(Mul(planeX[p], cx), Mul(planeY[p], cy)), Add(Mul(planeZ[p], cz), planeW[p]));
+				Batch reach = Add(Add(Mul(absX[p], ex), Mul(absY[p], ey)), Mul(absZ[p], ez));
+				inside = And(inside, GreaterEqual(Add(d, reach), zero));
+			}
+
+			n = Compact(Mask(inside), i, visible, n);
+		}
+
+		for (std::uint32_t i = batched; i < count; ++i)
+		{
+			if (AabbVisible(f, b.CenterX[i], b.CenterY[i], b.CenterZ[i], b.ExtentX[i], b.ExtentY[i], b.ExtentZ[i]))
+				visible[n++] = i;
+		}
+
+		return n;
+	}
+
+	std::uint32_t CullSpheresScalar(const Frustum& f, const SphereList& s, std::uint32_t* visible)
+	{
+		std::uint32_t n = 0;
+		for (std::uint32_t i = 0; i < s.Size(); ++i)
+		{
+			if (SphereVisible(f, s.CenterX[i], s.CenterY[i], s.CenterZ[i], s.Radius[i]))
+				visible[n++] = i;
+		}
+		return n;
+	}
+
+	std::uint32_t CullAabbsScalar(const Frustum& f, const AabbList& b, std::uint32_t* visible)
+	{
+		std::uint32_t n = 0;
+		for (std::uint32_t i = 0; i < b.Size(); ++i)
+		{
+			if (AabbVisible(f, b.CenterX[i], b.CenterY[i], b.CenterZ[i], b.ExtentX[i], b.ExtentY[i], b.ExtentZ[i]))
+				visible[n++] = i;
+		}
+		return n;
+	}
+
+	std::uint32_t BatchWidth()
+	{
+		return Width;
+	}
+}
@@ -0,0 +1,73 @@
+//***************************************************************************************
+// FrustumCull.h
+//
+// Culls batches of bounding volumes against a view frustum.
+//   -A Frustum is six planes pulled out of a view * projection matrix, normalized and
+//    facing inwards, so a point is inside when dot(n, p) + d >= 0 for every plane.
+//   -Bounds are kept structure-of-arrays (SphereList, AabbList) so one SIMD register
+//    holds the same coordinate of 4 volumes (SSE) or 8 (when built with AVX).
+//   -CullSpheres()/CullAabbs() write the indices of the volumes that intersect the
+//    frustum, in increasing order, to a caller provided array and return their count.
+//    The *Scalar versions test one volume at a time and give the same result.
+//
+// Only depends on DirectXMath and SSE/AVX intrinsics so it can be benchmarked outside
+// of the D3D12 projects (see Tools/CullBench).
+//***************************************************************************************
+
+#ifndef FRUSTUMCULL_H
+#define FRUSTUMCULL_H
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+namespace FrustumCull
+{
+	struct Frustum
+	{
+		// Left, right, bottom, top, near, far as (nx, ny, nz, d).
+		DirectX::XMFLOAT4 Planes[6];
+
+		// Planes of the clip volume of a D3D style matrix (0 <= z <= w).  Pass
+		// view * proj for world space planes, or world * view * proj for a local space.
+		static Frustum FromViewProj(DirectX::FXMMATRIX viewProj);
+	};
+
+	struct SphereList
+	{
+		std::vector<float> CenterX;
+		std::vector<float> CenterY;
+		std::vector<float> CenterZ;
+		std::vector<float> Radius;
+
+		std::uint32_t Size()const { return (std::uint32_t)Radius.size(); }
+		void Resize(std::uint32_t count);
+		void Set(std::uint32_t i, const DirectX::XMFLOAT3& center, float radius);
+	};
+
+	struct AabbList
+	{
+		std::vector<float> CenterX;
+		std::vector<float> CenterY;
+		std::vector<float> CenterZ;
+		std::vector<float> ExtentX;
+		std::vector<float> ExtentY;
+		std::vector<float> ExtentZ;
+
+		std::uint32_t Size()const { return (std::uint32_t)ExtentX.size(); }
+		void Resize(std::uint32_t count);
+		void Set(std::uint32_t i, const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents);
+	};
+
+	// 'visible' must have room for Size() indices.
+	std::uint32_t CullSpheres(const Frustum& frustum, const SphereList& spheres, std::uint32_t* visible);
+	std::uint32_t CullAabbs(const Frustum& frustum, const AabbList& boxes, std::uint32_t* visible);
+
+	std::uint32_t CullSpheresScalar(const Frustum& frustum, const SphereList& spheres, std::uint32_t* visible);
+	std::uint32_t CullAabbsScalar(const Frustum& frustum, const AabbList& boxes, std::uint32_t* visible);
+
+	// Volumes tested per SIMD batch in this build.
+	std::uint32_t BatchWidth();
+}
+
+#endif // FRUSTUMCULL_H
@@ -2,16 +2,21 @@
 // GameTimer.cpp by Frank Luna (C) 2011 All Rights Reserved.
 //***************************************************************************************
 
-#include <windows.h>
 #include "GameTimer.h"
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 GameTimer::GameTimer()
-: mSecondsPerCount(0.0), mDeltaTime(-1.0), mBaseTime(0), 
-  mPausedTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
+: GameTimer(HighResClock::Now)
+{
+}
+
+GameTimer::GameTimer(Clock clock)
+: mClock(std::move(clock)), mDeltaTime(-1.0), mBaseTime(0),
+  mPausedTime(0), mStopTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
 {
-	__int64 countsPerSec;
-	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
-	mSecondsPerCount = 1.0 / (double)countsPerSec;
 }
 
 // Returns the total time elapsed since Reset() was called, NOT counting any
@@ -19,9 +24,9 @@ GameTimer::GameTimer()
 float GameTimer::TotalTime()const
 {
 	// If we are stopped, do not count the time that has passed since we stopped.
-	// Moreover, if we previously already had a pause, the distance 
+	// Moreover, if we previously already had a pause, the distance
 	// mStopTime - mBaseTime includes paused time, which we do not want to count.
-	// To correct this, we can subtract the paused time from mStopTime:  
+	// To correct this, we can subtract the paused time from mStopTime:
 	//
 	//                     |<--paused time-->|
 	// ----*---------------*-----------------*------------*------------*------> time
@@ -29,22 +34,22 @@ float GameTimer::TotalTime()const
 
 	if( mStopped )
 	{
-		return (float)(((mStopTime - mPausedTime)-mBaseTime)*mSecondsPerCount);
+		return (float)HighResClock::ToSeconds((mStopTime - mPausedTime)-mBaseTime);
 	}
 
 	// The distance mCurrTime - mBaseTime includes paused time,
-	// which we do not want to count.  To correct this, we can subtract 
-	// the paused time from mCurrTime:  
+	// which we do not want to count.  To correct this, we can subtract
+	// the paused time from mCurrTime:
 	//
-	//  (mCurrTime - mPausedTime) - mBaseTime 
+	//  (mCurrTime - mPausedTime) - mBaseTime
 	//
 	//                     |<--paused time-->|
 	// ----*---------------*-----------------*------------*------> time
 	//  mBaseTime       mStopTime        startTime     mCurrTime
-	
+
 	else
 	{
-		return (float)(((mCurrTime-mPausedTime)-mBaseTime)*mSecondsPerCount);
+		return (float)HighResClock::ToSeconds((mCurrTime-mPausedTime)-mBaseTime);
 	}
 }
 
@@ -55,34 +60,41 @@ float GameTimer::DeltaTime()const
 
 void GameTimer::Reset()
 {
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+	HighResClock::Ticks currTime = mClock();
 
 	mBaseTime = currTime;
 	mPrevTime = currTime;
+	mCurrTime = currTime;
+	mPausedTime = 0;
 	mStopTime = 0;
 	mStopped  = false;
+
+	mAccumulator = 0;
+	mFixedSteps = 0;
+	mNextFrameSet = false;
 }
 
 void GameTimer::Start()
 {
-	__int64 startTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+	HighResClock::Ticks startTime = mClock();
 
 
 	// Accumulate the time elapsed between stop and start pairs.
 	//
 	//                     |<-------d------->|
 	// ----*---------------*-----------------*------------> time
-	//  mBaseTime       mStopTime        startTime     
+	//  mBaseTime       mStopTime        startTime
 
 	if( mStopped )
 	{
-		mPausedTime += (startTime - mStopTime);	
+		mPausedTime += (startTime - mStopTime);
 
 		mPrevTime = startTime;
 		mStopTime = 0;
 		mStopped  = false;
+
+		// Pace from now on rather than from before the pause.
+		mNextFrameSet = false;
 	}
 }
 
@@ -90,10 +102,7 @@ void GameTimer::Stop()
 {
 	if( !mStopped )
 	{
-		__int64 currTime;
-		QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
-
-		mStopTime = currTime;
+		mStopTime = mClock();
 		mStopped  = true;
 	}
 }
@@ -106,27 +115,74 @@ void GameTimer::Tick()
 		return;
 	}
 
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
-	mCurrTime = currTime;
+	if( mFramePeriod > 0 )
+		WaitForFrame();
+
+	mCurrTime = mClock();
 
-	// Time difference between this frame and the previous.
-	mDeltaTime = (mCurrTime - mPrevTime)*mSecondsPerCount;
+	// Time difference between this frame and the previous.  The clock is monotonic,
+	// so unlike QueryPerformanceCounter across processors this is never negative.
+	HighResClock::Ticks delta = mCurrTime - mPrevTime;
+	mDeltaTime = HighResClock::ToSeconds(delta);
 
 	// Prepare for next frame.
 	mPrevTime = mCurrTime;
 
-	// Force nonnegative.  The DXSDK's CDXUTTimer mentions that if the 
-	// processor goes into a power save mode or we get shuffled to another
-	// processor, then mDeltaTime can be negative.
-	if(mDeltaTime < 0.0)
-	{
-		mDeltaTime = 0.0;
-	}
+	if( mFixedStep > 0 )
+		mAccumulator += std::min<HighResClock::Ticks>(delta, mMaxFrameTime);
+}
+
+void GameTimer::SetFixedStep(float stepSeconds, float maxFrameSeconds)
+{
+	mFixedStep = std::max<HighResClock::Ticks>(HighResClock::FromSeconds(stepSeconds), 0);
+	mMaxFrameTime = std::max<HighResClock::Ticks>(HighResClock::FromSeconds(maxFrameSeconds), mFixedStep);
+	mAccumulator = 0;
 }
 
+bool GameTimer::StepFixed()
+{
+	if( mFixedStep == 0 || mAccumulator < mFixedStep )
+		return false;
 
+	mAccumulator -= mFixedStep;
+	mFixedSteps++;
+	return true;
+}
 
+float GameTimer::FixedStep()const
+{
+	return (float)HighResClock::ToSeconds(mFixedStep);
+}
 
+float GameTimer::Alpha()const
+{
+	if( mFixedStep == 0 )
+		return 0.0f;
 
+	return (float)((double)mAccumulator / (double)mFixedStep);
+}
+
+void GameTimer::SetTargetFrameRate(float framesPerSecond)
+{
+	mFramePeriod = framesPerSecond > 0.0f ? HighResClock::FromSeconds(1.0 / framesPerSecond) : 0;
+	mNextFrameSet = false;
+}
 
+void GameTimer::WaitForFrame()
+{
+	HighResClock::Ticks now = mClock();
+
+	// Start pacing from the first frame, and start over rather than hurry to catch up
+	// once more than a frame behind.
+	if( !mNextFrameSet || now - mNextFrame > mFramePeriod )
+	{
+		mNextFrame = now;
+		mNextFrameSet = true;
+	}
+	else if( now < mNextFrame )
+	{
+		std::this_thread::sleep_for(std::chrono::nanoseconds(mNextFrame - now));
+	}
+
+	mNextFrame += mFramePeriod;
+}
@@ -1,14 +1,33 @@
 //***************************************************************************************
 // GameTimer.h by Frank Luna (C) 2011 All Rights Reserved.
+//
+// Frame timer on a monotonic clock (HighResClock, or a clock supplied by the caller),
+// so it builds anywhere the C++ standard library does.  On top of the frame delta it
+// offers
+//   -fixed-step updates: Tick() feeds the frame's time, clamped to a maximum, into an
+//    accumulator that StepFixed() takes whole steps out of, and Alpha() says how far
+//    the leftover is into the next step, for blending the last two states,
+//   -frame pacing: with a target frame rate, Tick() sleeps until the next frame is
+//    due rather than returning at once.  Deadlines are absolute, so sleeping late by
+//    a little does not drift the rate.
 //***************************************************************************************
 
 #ifndef GAMETIMER_H
 #define GAMETIMER_H
 
+#include "HighResClock.h"
+
+#include <cstdint>
+#include <functional>
+
 class GameTimer
 {
 public:
+	// Returns the current time; must never go backwards.
+	typedef std::function<HighResClock::Ticks()> Clock;
+
 	GameTimer();
+	explicit GameTimer(Clock clock);
 
 	float TotalTime()const; // in seconds
 	float DeltaTime()const; // in seconds
@@ -18,17 +37,45 @@ public:
 	void Stop();  // Call when paused.
 	void Tick();  // Call every frame.
 
+	// Fixed-step updates.  After each Tick():
+	//     while (timer.StepFixed())
+	//         Simulate(timer.FixedStep());
+	//     Render(timer.Alpha());
+	// A frame longer than maxFrameSeconds only adds maxFrameSeconds, so a stall does
+	// not turn into a burst of steps.  A step of 0 turns fixed steps off.
+	void SetFixedStep(float stepSeconds, float maxFrameSeconds = 0.25f);
+	bool StepFixed();
+	float FixedStep()const;     // in seconds
+	float Alpha()const;         // in [0, 1)
+	std::uint64_t FixedStepCount()const { return mFixedSteps; }
+
+	// Frame pacing.  0 turns it off.
+	void SetTargetFrameRate(float framesPerSecond);
+
 private:
-	double mSecondsPerCount;
+	void WaitForFrame();
+
+private:
+	Clock mClock;
+
 	double mDeltaTime;
 
-	__int64 mBaseTime;
-	__int64 mPausedTime;
-	__int64 mStopTime;
-	__int64 mPrevTime;
-	__int64 mCurrTime;
+	HighResClock::Ticks mBaseTime;
+	HighResClock::Ticks mPausedTime;
+	HighResClock::Ticks mStopTime;
+	HighResClock::Ticks mPrevTime;
+	HighResClock::Ticks mCurrTime;
 
 	bool mStopped;
+
+	HighResClock::Ticks mFixedStep = 0;
+	HighResClock::Ticks mMaxFrameTime = 0;
+	HighResClock::Ticks mAccumulator = 0;
+	std::uint64_t mFixedSteps = 0;
+
+	HighResClock::Ticks mFramePeriod = 0;
+	HighResClock::Ticks mNextFrame = 0;
+	bool mNextFrameSet = false;
 };
 
-#endif // GAMETIMER_H
\ No newline at end of file
+#endif // GAMETIMER_H
@@ -678,7 +678,7 @@ GeometryGenerator::MeshData GeometryGenerator::CreatePyramid(float width, float
 	v[3] = Vertex(+w2, -h2, +d2, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
 	v[4] = Vertex(-w2, -h2, +d2, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
 
-	meshData.Vertices.assign(&v[0], &v[24]);
+	meshData.Vertices.assign(&v[0], &v[5]);
 
 	//
 	// Create the indices.
@@ -755,7 +755,7 @@ GeometryGenerator::MeshData GeometryGenerator::CreateWedge(float width, float he
 	v[16] = Vertex(-w2, +h2, -d2, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f);
 	v[17] = Vertex(-w2, -h2, -d2, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f);
 
-	meshData.Vertices.assign(&v[0], &v[24]);
+	meshData.Vertices.assign(&v[0], &v[18]);
 
 	//
 	// Create the indices.
@@ -784,7 +784,9 @@ GeometryGenerator::MeshData GeometryGenerator::CreateWedge(float width, float he
 	i[27] = 14; i[28] = 16; i[29] = 17;
 
 
-	meshData.Indices32.assign(&i[0], &i[36]);
+	// Only the front, back, top, bottom and left faces are filled in.
+	meshData.Indices32.assign(&i[0], &i[18]);
+	meshData.Indices32.insert(meshData.Indices32.end(), &i[24], &i[30]);
 
 	// Put a cap on the number of subdivisions.
 	numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
@@ -836,7 +838,7 @@ GeometryGenerator::MeshData GeometryGenerator::CreateTriangularPrism(float width
 	v[16] = Vertex(+w2, +h2, -d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
 	v[17] = Vertex(+w2, +h2, +d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f);
 
-	meshData.Vertices.assign(&v[0], &v[24]);
+	meshData.Vertices.assign(&v[0], &v[18]);
 
 	//
 	// Create the indices.
@@ -862,7 +864,7 @@ GeometryGenerator::MeshData GeometryGenerator::CreateTriangularPrism(float width
 	// Fill in the right face index data
 	i[21] = 4; i[22] = 1; i[23] = 0;
 
-	meshData.Indices32.assign(&i[0], &i[36]);
+	meshData.Indices32.assign(&i[0], &i[24]);
 
 	// Put a cap on the number of subdivisions.
 	numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
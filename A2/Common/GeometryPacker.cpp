@@ -0,0 +1,76 @@
+//***************************************************************************************
+// GeometryPacker.cpp
+//***************************************************************************************
+
+#include "GeometryPacker.h"
+
+#include <cassert>
+#include <cstring>
+
+GeometryPacker::GeometryPacker(std::uint32_t vertexStride)
+	: mVertexStride(vertexStride)
+{
+	assert(vertexStride > 0);
+}
+
+std::uint64_t GeometryPacker::Hash(const void* data, std::uint64_t byteSize, std::uint64_t seed)
+{
+	// FNV-1a, 64 bit.
+	auto bytes = static_cast<const std::uint8_t*>(data);
+
+	std::uint64_t h = seed ^ 14695981039346656037ull;
+	for (std::uint64_t i = 0; i < byteSize; ++i)
+	{
+		h ^= bytes[i];
+		h *= 1099511628211ull;
+	}
+
+	return h;
+}
+
+bool GeometryPacker::Matches(const Range& r, const void* vertices, std::uint32_t vertexCount,
+	const std::uint16_t* indices, std::uint32_t indexCount)const
+{
+	if (r.VertexCount != vertexCount || r.IndexCount != indexCount)
+		return false;
+
+	return std::memcmp(&mVertices[(size_t)r.BaseVertex * mVertexStride], vertices, (size_t)vertexCount * mVertexStride) == 0 &&
+		std::memcmp(&mIndices[r.StartIndex], indices, (size_t)indexCount * sizeof(std::uint16_t)) == 0;
+}
+
+GeometryPacker::Range GeometryPacker::Add(const void* vertices, std::uint32_t vertexCount,
+	const std::uint16_t* indices, std::uint32_t indexCount)
+{
+	assert(vertexCount > 0 && vertexCount <= 65536 && indexCount > 0);
+
+	const std::uint64_t vertexBytes = (std::uint64_t)vertexCount * mVertexStride;
+	const std::uint64_t indexBytes = (std::uint64_t)indexCount * sizeof(std::uint16_t);
+
+	mStats.Meshes++;
+	mStats.InputVertexBytes += vertexBytes;
+	mStats.InputIndexBytes += indexBytes;
+
+	std::uint64_t hash = Hash(indices, indexBytes, Hash(vertices, vertexBytes, 0));
+
+	auto found = mRanges.equal_range(hash);
+	for (auto it = found.first; it != found.second; ++it)
+	{
+		if (Matches(it->second, vertices, vertexCount, indices, indexCount))
+			return it->second;
+	}
+
+	Range r;
+	r.BaseVertex = (std::uint32_t)(mVertices.size() / mVertexStride);
+	r.VertexCount = vertexCount;
+	r.StartIndex = (std::uint32_t)mIndices.size();
+	r.IndexCount = indexCount;
+
+	auto v = static_cast<const std::uint8_t*>(vertices);
+	mVertices.insert(mVertices.end(), v, v + vertexBytes);
+	mIndices.insert(mIndices.end(), indices, indices + indexCount);
+
+	mRanges.emplace(hash, r);
+	mStats.UniqueMeshes++;
+
+	return r;
+}
@@ -0,0 +1,81 @@
+//***************************************************************************************
+// GeometryPacker.h
+//
+// Appends meshes into one vertex array and one 16 bit index array, so that a group of
+// small meshes can share one vertex buffer and one index buffer and be drawn as
+// submeshes (StartIndexLocation / BaseVertexLocation) without rebinding.
+//   -Indices stay relative to each mesh's first vertex; the BaseVertexLocation of the
+//    draw adds the offset, so every mesh may have up to 65536 vertices.
+//   -Meshes with the same vertex and index bytes are stored once.  They are found by
+//    a 64 bit content hash and then compared byte for byte, so a hash collision can
+//    not alias two different meshes.
+//
+// Only depends on the C++ standard library.
+//***************************************************************************************
+
+#ifndef GEOMETRYPACKER_H
+#define GEOMETRYPACKER_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class GeometryPacker
+{
+public:
+	// Where a mesh ended up in the packed arrays.
+	struct Range
+	{
+		std::uint32_t BaseVertex = 0;
+		std::uint32_t VertexCount = 0;
+		std::uint32_t StartIndex = 0;
+		std::uint32_t IndexCount = 0;
+	};
+
+	struct Stats
+	{
+		std::uint32_t Meshes = 0;
+		std::uint32_t UniqueMeshes = 0;
+
+		// Bytes of every mesh added, as separate buffers would hold them.
+		std::uint64_t InputVertexBytes = 0;
+		std::uint64_t InputIndexBytes = 0;
+	};
+
+	explicit GeometryPacker(std::uint32_t vertexStride);
+	GeometryPacker(const GeometryPacker& rhs) = delete;
+	GeometryPacker& operator=(const GeometryPacker& rhs) = delete;
+
+	// Adds a mesh, or returns the range of an identical mesh added before.
+	Range Add(const void* vertices, std::uint32_t vertexCount,
+		const std::uint16_t* indices, std::uint32_t indexCount);
+
+	std::uint32_t VertexStride()const { return mVertexStride; }
+
+	const std::vector<std::uint8_t>& Vertices()const { return mVertices; }
+	const std::vector<std::uint16_t>& Indices()const { return mIndices; }
+
+	std::uint64_t VertexBytes()const { return mVertices.size(); }
+	std::uint64_t IndexBytes()const { return mIndices.size() * sizeof(std::uint16_t); }
+
+	const Stats& GetStats()const { return mStats; }
+
+	static std::uint64_t Hash(const void* data, std::uint64_t byteSize, std::uint64_t seed);
+
+private:
+	bool Matches(const Range& r, const void* vertices, std::uint32_t vertexCount,
+		const std::uint16_t* indices, std::uint32_t indexCount)const;
+
+private:
+	std::uint32_t mVertexStride = 0;
+
+	std::vector<std::uint8_t> mVertices;
+	std::vector<std::uint16_t> mIndices;
+
+	// Content hash -> ranges of the unique meshes with that hash.
+	std::unordered_multimap<std::uint64_t, Range> mRanges;
+
+	Stats mStats;
+};
+
+#endif // GEOMETRYPACKER_H
@@ -0,0 +1,50 @@
+//***************************************************************************************
+// HeadlessApp.cpp
+//***************************************************************************************
+
+#include "HeadlessApp.h"
+
+HeadlessApp::HeadlessApp(float fixedStep)
+	: mTimer([this]() { return mSimTime; }),
+	mStep(HighResClock::FromSeconds(fixedStep))
+{
+}
+
+bool HeadlessApp::Initialize()
+{
+	mTimer.Reset();
+	return true;
+}
+
+float HeadlessApp::AspectRatio()const
+{
+	return static_cast<float>(mClientWidth) / mClientHeight;
+}
+
+int HeadlessApp::Run(std::uint64_t updates)
+{
+	mQuit = false;
+
+	std::uint64_t done = 0;
+	HighResClock::Ticks start = HighResClock::Now();
+
+	while (!mQuit && (updates == 0 || done < updates))
+	{
+		mSimTime += mStep;
+		mTimer.Tick();
+
+		Update(mTimer);
+		Draw(mTimer, mSink);
+
+		done++;
+	}
+
+	double seconds = HighResClock::ToSeconds(HighResClock::Now() - start);
+
+	mStats.Updates = done;
+	mStats.Seconds = seconds;
+	mStats.UpdatesPerSecond = seconds > 0.0 ? (double)done / seconds : 0.0;
+	mStats.Recorded = mSink.GetCounts();
+
+	return 0;
+}
@@ -0,0 +1,77 @@
+//***************************************************************************************
+// HeadlessApp.h
+//
+// Runs an application's scene logic without a window or a device, for validation,
+// AI and soak tests on servers.  The counterpart of D3DApp:
+//   -Run() calls Update() and Draw() back to back as fast as it can.  The timer reads
+//    a clock that moves exactly one fixed step per update, so every run sees the
+//    same DeltaTime and TotalTime however fast the machine is.
+//   -Draw() submits into a RecordingSink (DrawQueue.h) in place of a command list;
+//    it counts the state changes and draws that would have been recorded.
+//   -GetStats() reports the updates per second of the last Run() and the totals the
+//    sink recorded.
+//
+// Needs the D3D12 type declarations through DrawQueue.h but no device, so it also
+// builds on Linux against the DirectX-Headers project (see Tools/HeadlessSim).
+//***************************************************************************************
+
+#ifndef HEADLESSAPP_H
+#define HEADLESSAPP_H
+
+#include "DrawQueue.h"
+#include "GameTimer.h"
+
+#include <cstdint>
+
+class HeadlessApp
+{
+public:
+	struct Stats
+	{
+		std::uint64_t Updates = 0;
+
+		// Wall clock time Run() took.
+		double Seconds = 0.0;
+		double UpdatesPerSecond = 0.0;
+
+		// Sums over every Draw() since construction.
+		RecordingSink::Counts Recorded;
+	};
+
+	explicit HeadlessApp(float fixedStep = 1.0f / 60.0f);
+	HeadlessApp(const HeadlessApp& rhs) = delete;
+	HeadlessApp& operator=(const HeadlessApp& rhs) = delete;
+	virtual ~HeadlessApp() = default;
+
+	virtual bool Initialize();
+
+	// Runs 'updates' updates, or until Quit() if 0.
+	int Run(std::uint64_t updates);
+	void Quit() { mQuit = true; }
+
+	const Stats& GetStats()const { return mStats; }
+
+	float AspectRatio()const;
+
+protected:
+	virtual void Update(const GameTimer& gt) = 0;
+	virtual void Draw(const GameTimer& gt, DrawCommandSink& sink) = 0;
+
+protected:
+	GameTimer mTimer;
+
+	// The client area the scene is set up for.
+	int mClientWidth = 800;
+	int mClientHeight = 600;
+
+private:
+	HighResClock::Ticks mStep = 0;
+	HighResClock::Ticks mSimTime = 0;
+
+	RecordingSink mSink;
+
+	bool mQuit = false;
+	Stats mStats;
+};
+
+#endif // HEADLESSAPP_H
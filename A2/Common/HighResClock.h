@@ -0,0 +1,38 @@
+//***************************************************************************************
+// HighResClock.h
+//
+// Monotonic high resolution time stamps for profiling and timing, the same on every
+// platform: std::chrono::steady_clock, which is QueryPerformanceCounter on Windows and
+// clock_gettime(CLOCK_MONOTONIC) on Linux.  Time stamps are integer nanoseconds from an
+// arbitrary start, so they can be stored in atomics and subtracted without rounding.
+//
+// Only depends on the C++ standard library.
+//***************************************************************************************
+
+#ifndef HIGHRESCLOCK_H
+#define HIGHRESCLOCK_H
+
+#include <chrono>
+#include <cstdint>
+
+namespace HighResClock
+{
+	// Nanoseconds.
+	typedef std::int64_t Ticks;
+
+	static const Ticks TicksPerSecond = 1000000000;
+
+	inline Ticks Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	inline double ToSeconds(Ticks t) { return (double)t * 1e-9; }
+	inline double ToMilliseconds(Ticks t) { return (double)t * 1e-6; }
+	inline double ToMicroseconds(Ticks t) { return (double)t * 1e-3; }
+
+	inline Ticks FromSeconds(double s) { return (Ticks)(s * 1e9); }
+}
+
+#endif // HIGHRESCLOCK_H
@@ -0,0 +1,107 @@
+//***************************************************************************************
+// JobSystem.cpp
+//***************************************************************************************
+
+#include "JobSystem.h"
+
+JobSystem::JobSystem(unsigned workerCount)
+{
+	if (workerCount == 0)
+	{
+		unsigned hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	for (unsigned i = 0; i < workerCount; ++i)
+		mWorkers.emplace_back(&JobSystem::WorkerLoop, this);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuit = true;
+	}
+	mWake.notify_all();
+
+	for (auto& w : mWorkers)
+		w.join();
+}
+
+void JobSystem::ParallelFor(std::uint32_t count, std::uint32_t grainSize, const RangeFn& fn)
+{
+	if (count == 0)
+		return;
+
+	if (grainSize == 0)
+		grainSize = 1;
+
+	std::uint32_t chunks = (count - 1) / grainSize + 1;
+	if (chunks == 1 || mWorkers.empty())
+	{
+		fn(0, count);
+		return;
+	}
+
+	Job job;
+	job.Fn = &fn;
+	job.Count = count;
+	job.GrainSize = grainSize;
+	job.Chunks = chunks;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJob = &job;
+		mGeneration++;
+	}
+	mWake.notify_all();
+
+	RunChunks(job);
+
+	// 'job' lives on this stack frame, so wait for every worker to let go of it too.
+	std::unique_lock<std::mutex> lock(mMutex);
+	mFinished.wait(lock, [&]() { return job.DoneChunks == job.Chunks && mActiveWorkers == 0; });
+	mJob = nullptr;
+}
+
+void JobSystem::RunChunks(Job& job)
+{
+	for (std::uint32_t chunk = job.NextChunk++; chunk < job.Chunks; chunk = job.NextChunk++)
+	{
+		std::uint32_t begin = chunk * job.GrainSize;
+		std::uint32_t end = job.Count - begin < job.GrainSize ? job.Count : begin + job.GrainSize;
+
+		(*job.Fn)(begin, end);
+
+		job.DoneChunks++;
+	}
+}
+
+void JobSystem::WorkerLoop()
+{
+	std::uint64_t seenGeneration = 0;
+
+	for (;;)
+	{
+		Job* job = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWake.wait(lock, [&]() { return mQuit || (mJob != nullptr && mGeneration != seenGeneration); });
+
+			if (mQuit)
+				return;
+
+			seenGeneration = mGeneration;
+			job = mJob;
+			mActiveWorkers++;
+		}
+
+		RunChunks(*job);
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mActiveWorkers--;
+		}
+		mFinished.notify_one();
+	}
+}
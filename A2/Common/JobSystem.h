@@ -0,0 +1,75 @@
+//***************************************************************************************
+// JobSystem.h
+//
+// Small pool of worker threads that stay alive for the life of the application, for
+// splitting per-frame loops into chunks.  ParallelFor hands chunks of an index range
+// to the workers and the calling thread alike and returns once all of them are done,
+// so callers can write disjoint parts of a buffer from each chunk without further
+// synchronization.
+//
+// ParallelFor is meant to be called from one thread (the main thread) at a time.
+// Only depends on the C++ standard library.
+//***************************************************************************************
+
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem
+{
+public:
+	// Called with a half open range [begin, end) of indices.
+	typedef std::function<void(std::uint32_t begin, std::uint32_t end)> RangeFn;
+
+	// workerCount of 0 uses one worker per hardware thread besides the caller's.
+	explicit JobSystem(unsigned workerCount = 0);
+	JobSystem(const JobSystem& rhs) = delete;
+	JobSystem& operator=(const JobSystem& rhs) = delete;
+	~JobSystem();
+
+	// Workers plus the calling thread.
+	unsigned ThreadCount()const { return (unsigned)mWorkers.size() + 1; }
+
+	// Splits [0, count) into ranges of 'grainSize' indices (the last may be shorter) and
+	// runs them in parallel.  Ranges always start on a multiple of grainSize.  Runs
+	// inline when there is only one range.
+	void ParallelFor(std::uint32_t count, std::uint32_t grainSize, const RangeFn& fn);
+
+private:
+	struct Job
+	{
+		const RangeFn* Fn = nullptr;
+		std::uint32_t Count = 0;
+		std::uint32_t GrainSize = 0;
+		std::uint32_t Chunks = 0;
+		std::atomic<std::uint32_t> NextChunk{ 0 };
+		std::atomic<std::uint32_t> DoneChunks{ 0 };
+	};
+
+	void WorkerLoop();
+	void RunChunks(Job& job);
+
+private:
+	std::vector<std::thread> mWorkers;
+
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::condition_variable mFinished;
+
+	Job* mJob = nullptr;
+	std::uint64_t mGeneration = 0;
+
+	// Workers currently holding a pointer to mJob.
+	unsigned mActiveWorkers = 0;
+
+	bool mQuit = false;
+};
+
+#endif // JOBSYSTEM_H
@@ -0,0 +1,85 @@
+//***************************************************************************************
+// NameRegistry.h
+//
+// Interns names into dense integer ids and stores one value per id in a flat array.
+//   -Names are hashed once, when a value is added or an id is looked up at load time.
+//    Runtime code keeps the ids and indexes the array with them, so there is no string
+//    hashing or key allocation per item or per frame.
+//   -Ids are handed out in insertion order starting at 0 and stay valid for the life
+//    of the registry; values are never removed.
+//
+// Only depends on the C++ standard library.
+//***************************************************************************************
+
+#ifndef NAMEREGISTRY_H
+#define NAMEREGISTRY_H
+
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+template<typename T>
+class NameRegistry
+{
+public:
+	typedef std::uint32_t Id;
+	static const Id InvalidId = UINT32_MAX;
+
+	NameRegistry() = default;
+	NameRegistry(const NameRegistry& rhs) = delete;
+	NameRegistry& operator=(const NameRegistry& rhs) = delete;
+
+	// Stores 'value' under 'name', replacing the value of a name added before.
+	Id Add(const std::string& name, T value)
+	{
+		auto it = mIds.find(name);
+		if (it != mIds.end())
+		{
+			mValues[it->second] = std::move(value);
+			return it->second;
+		}
+
+		Id id = (Id)mValues.size();
+		mIds.emplace(name, id);
+		mNames.push_back(name);
+		mValues.push_back(std::move(value));
+		return id;
+	}
+
+	// InvalidId if no value has that name.
+	Id Find(const std::string& name)const
+	{
+		auto it = mIds.find(name);
+		return it != mIds.end() ? it->second : InvalidId;
+	}
+
+	// Like Find, but the name must exist.
+	Id Get(const std::string& name)const
+	{
+		Id id = Find(name);
+		assert(id != InvalidId);
+		return id;
+	}
+
+	std::uint32_t Size()const { return (std::uint32_t)mValues.size(); }
+
+	const std::string& Name(Id id)const { return mNames[id]; }
+
+	T& operator[](Id id) { return mValues[id]; }
+	const T& operator[](Id id)const { return mValues[id]; }
+
+	// Values in id order.
+	typename std::vector<T>::iterator begin() { return mValues.begin(); }
+	typename std::vector<T>::iterator end() { return mValues.end(); }
+	typename std::vector<T>::const_iterator begin()const { return mValues.begin(); }
+	typename std::vector<T>::const_iterator end()const { return mValues.end(); }
+
+private:
+	std::unordered_map<std::string, Id> mIds;
+	std::vector<std::string> mNames;
+	std::vector<T> mValues;
+};
+
+#endif // NAMEREGISTRY_H
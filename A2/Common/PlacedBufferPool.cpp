@@ -0,0 +1,114 @@
+//***************************************************************************************
+// PlacedBufferPool.cpp
+//***************************************************************************************
+
+#include "PlacedBufferPool.h"
+
+using Microsoft::WRL::ComPtr;
+
+static const UINT64 PlacementAlignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+static UINT64 AlignUp(UINT64 value, UINT64 alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+PlacedBufferPool::PlacedBufferPool(ID3D12Device* device, UINT64 heapSize)
+	: mDevice(device),
+	mHeapSize(AlignUp(heapSize, PlacementAlignment))
+{
+}
+
+UINT PlacedBufferPool::AddHeap(UINT64 size)
+{
+	D3D12_HEAP_DESC desc = {};
+	desc.SizeInBytes = size;
+	desc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+	desc.Alignment = PlacementAlignment;
+	desc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+
+	Heap heap;
+	ThrowIfFailed(mDevice->CreateHeap(&desc, IID_PPV_ARGS(&heap.Resource)));
+	heap.Allocator = std::make_unique<TlsfAllocator>(size, PlacementAlignment);
+
+	mHeaps.push_back(std::move(heap));
+	return (UINT)mHeaps.size() - 1;
+}
+
+ComPtr<ID3D12Resource> PlacedBufferPool::CreateBuffer(UINT64 byteSize, D3D12_RESOURCE_STATES initialState)
+{
+	UINT64 size = AlignUp(std::max<UINT64>(byteSize, 1), PlacementAlignment);
+
+	Placement where;
+	where.Offset = TlsfAllocator::InvalidOffset;
+
+	for (UINT i = 0; i < (UINT)mHeaps.size() && where.Offset == TlsfAllocator::InvalidOffset; ++i)
+	{
+		where.HeapIndex = i;
+		where.Offset = mHeaps[i].Allocator->Allocate(size, PlacementAlignment);
+	}
+
+	if (where.Offset == TlsfAllocator::InvalidOffset)
+	{
+		where.HeapIndex = AddHeap(std::max<UINT64>(size, mHeapSize));
+		where.Offset = mHeaps[where.HeapIndex].Allocator->Allocate(size, PlacementAlignment);
+	}
+
+	ComPtr<ID3D12Resource> buffer;
+	auto desc = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
+	ThrowIfFailed(mDevice->CreatePlacedResource(
+		mHeaps[where.HeapIndex].Resource.Get(),
+		where.Offset,
+		&desc,
+		initialState,
+		nullptr,
+		IID_PPV_ARGS(&buffer)));
+
+	mPlacements[buffer.Get()] = where;
+
+	return buffer;
+}
+
+void PlacedBufferPool::Free(ID3D12Resource* buffer, UINT64 fence)
+{
+	auto it = mPlacements.find(buffer);
+	assert(it != mPlacements.end());
+	if (it == mPlacements.end())
+		return;
+
+	PendingFree f;
+	f.Where = it->second;
+	f.Fence = fence;
+	mPendingFrees.push_back(f);
+
+	mPlacements.erase(it);
+}
+
+void PlacedBufferPool::Retire(UINT64 completedFence)
+{
+	auto last = std::remove_if(mPendingFrees.begin(), mPendingFrees.end(),
+		[&](const PendingFree& f)
+		{
+			if (f.Fence > completedFence)
+				return false;
+
+			mHeaps[f.Where.HeapIndex].Allocator->Free(f.Where.Offset);
+			return true;
+		});
+	mPendingFrees.erase(last, mPendingFrees.end());
+}
+
+PlacedBufferPool::Stats PlacedBufferPool::GetStats()const
+{
+	Stats stats;
+	stats.Heaps = (UINT)mHeaps.size();
+	stats.Buffers = (UINT)mPlacements.size();
+
+	for (const auto& heap : mHeaps)
+	{
+		stats.HeapBytes += heap.Allocator->GetStats().Size;
+		stats.UsedBytes += heap.Allocator->GetStats().UsedBytes;
+	}
+
+	return stats;
+}
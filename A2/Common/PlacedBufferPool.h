@@ -0,0 +1,77 @@
+//***************************************************************************************
+// PlacedBufferPool.h
+//
+// Creates default heap buffers as placed resources inside a few large ID3D12Heaps
+// instead of one committed resource (and one implicit heap) each.  Space in a heap is
+// handed out by a TlsfAllocator at the 64KB placement alignment; a new heap is added
+// when none has room, and buffers bigger than a heap get a heap of their own.
+//
+// A freed buffer's range is reused only after the fence of the frame that freed it
+// has completed, since the GPU may still read the buffer until then.
+//***************************************************************************************
+
+#ifndef PLACEDBUFFERPOOL_H
+#define PLACEDBUFFERPOOL_H
+
+#include "d3dUtil.h"
+#include "TlsfAllocator.h"
+
+class PlacedBufferPool
+{
+public:
+	struct Stats
+	{
+		UINT Heaps = 0;
+		UINT64 HeapBytes = 0;
+		UINT64 UsedBytes = 0;
+		UINT Buffers = 0;
+	};
+
+	PlacedBufferPool(ID3D12Device* device, UINT64 heapSize);
+	PlacedBufferPool(const PlacedBufferPool& rhs) = delete;
+	PlacedBufferPool& operator=(const PlacedBufferPool& rhs) = delete;
+	~PlacedBufferPool() = default;
+
+	// The pool must outlive the buffers it creates.
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateBuffer(UINT64 byteSize, D3D12_RESOURCE_STATES initialState);
+
+	// Hands the buffer's range back once 'fence' has completed; the caller drops its
+	// references to the buffer.
+	void Free(ID3D12Resource* buffer, UINT64 fence);
+
+	// Reuses the ranges of frees whose fence is <= completedFence.
+	void Retire(UINT64 completedFence);
+
+	Stats GetStats()const;
+
+private:
+	struct Heap
+	{
+		Microsoft::WRL::ComPtr<ID3D12Heap> Resource;
+		std::unique_ptr<TlsfAllocator> Allocator;
+	};
+
+	struct Placement
+	{
+		UINT HeapIndex = 0;
+		UINT64 Offset = 0;
+	};
+
+	struct PendingFree
+	{
+		Placement Where;
+		UINT64 Fence = 0;
+	};
+
+	UINT AddHeap(UINT64 size);
+
+private:
+	ID3D12Device* mDevice = nullptr;
+	UINT64 mHeapSize = 0;
+
+	std::vector<Heap> mHeaps;
+	std::unordered_map<ID3D12Resource*, Placement> mPlacements;
+	std::vector<PendingFree> mPendingFrees;
+};
+
+#endif // PLACEDBUFFERPOOL_H
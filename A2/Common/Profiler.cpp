@@ -0,0 +1,297 @@
+//***************************************************************************************
+// Profiler.cpp
+//***************************************************************************************
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace
+{
+	struct Slot
+	{
+		// 2n+1 while event n is written into the slot, 2n+2 once it is complete.
+		std::atomic<std::uint64_t> Sequence{ 0 };
+
+		std::atomic<const char*> Name{ nullptr };
+		std::atomic<HighResClock::Ticks> Start{ 0 };
+		std::atomic<HighResClock::Ticks> End{ 0 };
+		std::atomic<std::uint32_t> Depth{ 0 };
+	};
+
+	struct ThreadBuffer
+	{
+		explicit ThreadBuffer(std::uint32_t index)
+			: Index(index), Slots(new Slot[Profiler::EventsPerThread])
+		{
+		}
+
+		std::uint32_t Index;
+		std::unique_ptr<Slot[]> Slots;
+
+		// Events written so far, and the first one not cleared.
+		std::atomic<std::uint64_t> Head{ 0 };
+		std::atomic<std::uint64_t> Floor{ 0 };
+
+		// Open scopes; only the owning thread touches these.
+		std::uint32_t Depth = 0;
+		const char* OpenNames[Profiler::MaxDepth];
+		HighResClock::Ticks OpenStarts[Profiler::MaxDepth];
+	};
+
+	// Buffers stay alive after their thread exits, so their history can still be read.
+	struct Registry
+	{
+		std::atomic<bool> Enabled{ true };
+		std::mutex Mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> Threads;
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	thread_local ThreadBuffer* tBuffer = nullptr;
+
+	ThreadBuffer& GetThreadBuffer()
+	{
+		if (tBuffer == nullptr)
+		{
+			Registry& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock(registry.Mutex);
+			registry.Threads.emplace_back(new ThreadBuffer((std::uint32_t)registry.Threads.size()));
+			tBuffer = registry.Threads.back().get();
+		}
+
+		return *tBuffer;
+	}
+
+	void WriteJsonString(std::ostream& out, const char* s)
+	{
+		out << '"';
+		for (; *s != '\0'; ++s)
+		{
+			unsigned char c = (unsigned char)*s;
+			if (c == '"' || c == '\\')
+				out << '\\' << (char)c;
+			else if (c < 0x20)
+				out << "\\u00" << "0123456789abcdef"[c >> 4] << "0123456789abcdef"[c & 15];
+			else
+				out << (char)c;
+		}
+		out << '"';
+	}
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+	GetRegistry().Enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Profiler::Enabled()
+{
+	return GetRegistry().Enabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::Begin(const char* name)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+
+	if (buffer.Depth < MaxDepth)
+	{
+		buffer.OpenNames[buffer.Depth] = name;
+		buffer.OpenStarts[buffer.Depth] = HighResClock::Now();
+	}
+
+	buffer.Depth++;
+}
+
+void Profiler::End()
+{
+	HighResClock::Ticks end = HighResClock::Now();
+
+	ThreadBuffer& buffer = GetThreadBuffer();
+	if (buffer.Depth == 0)
+		return;
+
+	std::uint32_t depth = --buffer.Depth;
+	if (depth >= MaxDepth)
+		return;
+
+	// Only this thread writes the buffer, so the head needs no read-modify-write.
+	std::uint64_t n = buffer.Head.load(std::memory_order_relaxed);
+	Slot& slot = buffer.Slots[n % EventsPerThread];
+
+	slot.Sequence.store(2 * n + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot.Name.store(buffer.OpenNames[depth], std::memory_order_relaxed);
+	slot.Start.store(buffer.OpenStarts[depth], std::memory_order_relaxed);
+	slot.End.store(end, std::memory_order_relaxed);
+	slot.Depth.store(depth, std::memory_order_relaxed);
+
+	slot.Sequence.store(2 * n + 2, std::memory_order_release);
+	buffer.Head.store(n + 1, std::memory_order_release);
+}
+
+std::vector<Profiler::Event> Profiler::Collect()
+{
+	std::vector<Event> events;
+
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	for (const auto& buffer : registry.Threads)
+	{
+		std::uint64_t head = buffer->Head.load(std::memory_order_acquire);
+		std::uint64_t first = head > EventsPerThread ? head - EventsPerThread : 0;
+		first = std::max<std::uint64_t>(first, buffer->Floor.load(std::memory_order_relaxed));
+
+		for (std::uint64_t n = first; n < head; ++n)
+		{
+			const Slot& slot = buffer->Slots[n % EventsPerThread];
+
+			// Skip the slot if the owner has moved on to a newer event in it, before or
+			// while we read it.
+			std::uint64_t sequence = slot.Sequence.load(std::memory_order_acquire);
+			if (sequence != 2 * n + 2)
+				continue;
+
+			Event e;
+			e.Name = slot.Name.load(std::memory_order_relaxed);
+			e.Start = slot.Start.load(std::memory_order_relaxed);
+			e.End = slot.End.load(std::memory_order_relaxed);
+			e.Depth = slot.Depth.load(std::memory_order_relaxed);
+			e.Thread = buffer->Index;
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.Sequence.load(std::memory_order_relaxed) != sequence)
+				continue;
+
+			events.push_back(e);
+		}
+	}
+
+	std::stable_sort(events.begin(), events.end(),
+		[](const Event& a, const Event& b) { return a.Start < b.Start; });
+
+	return events;
+}
+
+std::vector<Profiler::ScopeStats> Profiler::Summarize()
+{
+	return Summarize(Collect());
+}
+
+std::vector<Profiler::ScopeStats> Profiler::Summarize(const std::vector<Event>& events)
+{
+	std::vector<ScopeStats> stats;
+	std::vector<std::vector<HighResClock::Ticks>> durations;
+	std::vector<HighResClock::Ticks> lastStarts;
+	std::map<std::pair<std::string, std::uint32_t>, size_t> index;
+
+	for (const Event& e : events)
+	{
+		auto key = std::make_pair(std::string(e.Name), e.Depth);
+		auto it = index.find(key);
+		if (it == index.end())
+		{
+			it = index.emplace(key, stats.size()).first;
+
+			ScopeStats s;
+			s.Name = key.first;
+			s.Depth = e.Depth;
+			stats.push_back(s);
+			durations.emplace_back();
+			lastStarts.push_back(e.Start);
+		}
+
+		durations[it->second].push_back(e.End - e.Start);
+		lastStarts[it->second] = std::max<HighResClock::Ticks>(lastStarts[it->second], e.Start);
+	}
+
+	for (size_t i = 0; i < stats.size(); ++i)
+	{
+		std::vector<HighResClock::Ticks>& d = durations[i];
+		std::sort(d.begin(), d.end());
+
+		HighResClock::Ticks total = 0;
+		for (HighResClock::Ticks t : d)
+			total += t;
+
+		// Nearest rank: the smallest duration at least 99% of the samples do not exceed.
+		size_t p99 = (size_t)std::ceil(0.99 * (double)d.size());
+
+		ScopeStats& s = stats[i];
+		s.Count = d.size();
+		s.MinMs = HighResClock::ToMilliseconds(d.front());
+		s.AvgMs = HighResClock::ToMilliseconds(total) / (double)d.size();
+		s.P99Ms = HighResClock::ToMilliseconds(d[std::max<size_t>(p99, 1) - 1]);
+		s.MaxMs = HighResClock::ToMilliseconds(d.back());
+	}
+
+	std::vector<size_t> order(stats.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(),
+		[&](size_t a, size_t b) { return lastStarts[a] < lastStarts[b]; });
+
+	std::vector<ScopeStats> sorted;
+	sorted.reserve(stats.size());
+	for (size_t i : order)
+		sorted.push_back(std::move(stats[i]));
+
+	return sorted;
+}
+
+void Profiler::WriteChromeTrace(std::ostream& out)
+{
+	WriteChromeTrace(out, Collect());
+}
+
+void Profiler::WriteChromeTrace(std::ostream& out, const std::vector<Event>& events)
+{
+	// Complete ("X") events with microsecond times from the first event.
+	HighResClock::Ticks origin = events.empty() ? 0 : events.front().Start;
+	for (const Event& e : events)
+		origin = std::min<HighResClock::Ticks>(origin, e.Start);
+
+	std::ios::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	out.setf(std::ios::fixed, std::ios::floatfield);
+	out.precision(3);
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	for (size_t i = 0; i < events.size(); ++i)
+	{
+		const Event& e = events[i];
+
+		out << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+		WriteJsonString(out, e.Name);
+		out << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.Thread
+			<< ",\"ts\":" << HighResClock::ToMicroseconds(e.Start - origin)
+			<< ",\"dur\":" << HighResClock::ToMicroseconds(e.End - e.Start)
+			<< ",\"args\":{\"depth\":" << e.Depth << "}}";
+	}
+	out << "\n]}\n";
+
+	out.flags(flags);
+	out.precision(precision);
+}
+
+void Profiler::Clear()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	for (const auto& buffer : registry.Threads)
+		buffer->Floor.store(buffer->Head.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
@@ -0,0 +1,111 @@
+//***************************************************************************************
+// Profiler.h
+//
+// Hierarchical CPU scope profiler.  PROFILE_SCOPE("Name") times the rest of the
+// enclosing block; scopes opened inside it on the same thread nest under it.
+//   -Each thread records its finished scopes into a ring buffer of its own, which keeps
+//    the last EventsPerThread of them.  Recording takes no lock and does not allocate;
+//    only a thread's first scope registers its buffer.
+//   -Any thread may read the buffers while others record.  Every slot carries a
+//    sequence number, so a reader skips a slot the owner is rewriting instead of
+//    blocking it.
+//   -Summarize() reports min, avg, p99 and max per scope over the recorded history;
+//    WriteChromeTrace() writes it as Chrome trace event JSON (chrome://tracing,
+//    ui.perfetto.dev).
+//
+// Scope names must be string literals or otherwise outlive the profiler; they are
+// stored by pointer.  Times come from HighResClock.
+// Only depends on the C++ standard library.
+//***************************************************************************************
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "HighResClock.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class Profiler
+{
+public:
+	static const std::uint32_t EventsPerThread = 1u << 14;
+
+	// Deeper scopes are not recorded.
+	static const std::uint32_t MaxDepth = 32;
+
+	struct Event
+	{
+		const char* Name = nullptr;
+		HighResClock::Ticks Start = 0;
+		HighResClock::Ticks End = 0;
+		std::uint32_t Depth = 0;
+
+		// Order in which the thread recorded its first scope.
+		std::uint32_t Thread = 0;
+	};
+
+	struct ScopeStats
+	{
+		std::string Name;
+		std::uint32_t Depth = 0;
+		std::uint64_t Count = 0;
+		double MinMs = 0.0;
+		double AvgMs = 0.0;
+		double P99Ms = 0.0;
+		double MaxMs = 0.0;
+	};
+
+	// Scopes opened while disabled are not recorded.  Enabled by default.
+	static void SetEnabled(bool enabled);
+	static bool Enabled();
+
+	static void Begin(const char* name);
+	static void End();
+
+	// Copies the events every thread still holds, sorted by start time.
+	static std::vector<Event> Collect();
+
+	// One entry per scope name and depth, in the order the scopes last started, which
+	// lists a frame's scopes parents first even when the oldest frame kept is partial.
+	static std::vector<ScopeStats> Summarize();
+	static std::vector<ScopeStats> Summarize(const std::vector<Event>& events);
+
+	static void WriteChromeTrace(std::ostream& out);
+	static void WriteChromeTrace(std::ostream& out, const std::vector<Event>& events);
+
+	// Drops the recorded history of every thread.  Scopes open meanwhile are lost.
+	static void Clear();
+};
+
+// Times a scope until it goes out of scope.
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name)
+		: mActive(Profiler::Enabled())
+	{
+		if (mActive)
+			Profiler::Begin(name);
+	}
+
+	~ProfileScope()
+	{
+		if (mActive)
+			Profiler::End();
+	}
+
+	ProfileScope(const ProfileScope& rhs) = delete;
+	ProfileScope& operator=(const ProfileScope& rhs) = delete;
+
+private:
+	bool mActive;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+#endif // PROFILER_H
@@ -0,0 +1,181 @@
+//***************************************************************************************
+// SceneStore.cpp
+//***************************************************************************************
+
+#include "SceneStore.h"
+
+#include <cassert>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace DirectX;
+
+static_assert(sizeof(SceneStore::ObjectData) == 256, "ObjectData must fill one constant buffer slot.");
+
+static std::uint32_t LowestSetBit(std::uint64_t bits)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+#if defined(_WIN64)
+	_BitScanForward64(&index, bits);
+#else
+	if (!_BitScanForward(&index, (unsigned long)bits))
+	{
+		_BitScanForward(&index, (unsigned long)(bits >> 32));
+		index += 32;
+	}
+#endif
+	return (std::uint32_t)index;
+#else
+	return (std::uint32_t)__builtin_ctzll(bits);
+#endif
+}
+
+SceneStore::Handle SceneStore::Create(const XMFLOAT4X4& world, const XMFLOAT4X4& texTransform)
+{
+	std::uint32_t dense = Size();
+
+	Handle h;
+	if (!mFreeSlots.empty())
+	{
+		h.Slot = mFreeSlots.back();
+		mFreeSlots.pop_back();
+	}
+	else
+	{
+		h.Slot = (std::uint32_t)mSlots.size();
+		mSlots.push_back(Slot());
+	}
+
+	mSlots[h.Slot].Dense = dense;
+	h.Generation = mSlots[h.Slot].Generation;
+
+	mWorld.push_back(world);
+	mTexTransform.push_back(texTransform);
+	mConstants.push_back(ObjectData());
+	mDenseToSlot.push_back(h.Slot);
+
+	if (mDirty.size() * 64 < mWorld.size())
+		mDirty.push_back(0);
+
+	MarkDirty(dense);
+
+	return h;
+}
+
+void SceneStore::Destroy(Handle h)
+{
+	if (!IsValid(h))
+		return;
+
+	// Move the last item into the hole so the arrays stay packed.
+	std::uint32_t dense = mSlots[h.Slot].Dense;
+	std::uint32_t last = Size() - 1;
+
+	if (dense != last)
+	{
+		mWorld[dense] = mWorld[last];
+		mTexTransform[dense] = mTexTransform[last];
+		mConstants[dense] = mConstants[last];
+		mDenseToSlot[dense] = mDenseToSlot[last];
+		mSlots[mDenseToSlot[dense]].Dense = dense;
+
+		if (mDirty[last / 64] & (1ull << (last % 64)))
+			MarkDirty(dense);
+	}
+
+	mDirty[last / 64] &= ~(1ull << (last % 64));
+
+	mWorld.pop_back();
+	mTexTransform.pop_back();
+	mConstants.pop_back();
+	mDenseToSlot.pop_back();
+
+	if (mDirty.size() * 64 >= mWorld.size() + 64)
+		mDirty.pop_back();
+
+	mSlots[h.Slot].Generation++;
+	mFreeSlots.push_back(h.Slot);
+}
+
+bool SceneStore::IsValid(Handle h)const
+{
+	return h.Slot < mSlots.size() && mSlots[h.Slot].Generation == h.Generation;
+}
+
+void SceneStore::SetWorld(Handle h, const XMFLOAT4X4& world)
+{
+	assert(IsValid(h));
+
+	std::uint32_t dense = DenseIndex(h);
+	mWorld[dense] = world;
+	MarkDirty(dense);
+}
+
+void SceneStore::SetTexTransform(Handle h, const XMFLOAT4X4& texTransform)
+{
+	assert(IsValid(h));
+
+	std::uint32_t dense = DenseIndex(h);
+	mTexTransform[dense] = texTransform;
+	MarkDirty(dense);
+}
+
+void SceneStore::MarkDirty(std::uint32_t denseIndex)
+{
+	mDirty[denseIndex / 64] |= 1ull << (denseIndex % 64);
+}
+
+void SceneStore::MarkAllDirty()
+{
+	std::uint32_t count = Size();
+	for (std::size_t w = 0; w < mDirty.size(); ++w)
+	{
+		std::uint32_t bits = count - (std::uint32_t)w * 64;
+		mDirty[w] = bits >= 64 ? ~0ull : ((1ull << bits) - 1);
+	}
+}
+
+std::uint32_t SceneStore::UpdateConstants()
+{
+	return UpdateConstants(0, Size());
+}
+
+std::uint32_t SceneStore::UpdateConstants(std::uint32_t begin, std::uint32_t end)
+{
+	assert(begin % UpdateGranularity == 0 && end <= Size());
+
+	std::uint32_t updated = 0;
+
+	std::size_t lastWord = ((std::size_t)end + 63) / 64;
+	for (std::size_t w = begin / 64; w < lastWord; ++w)
+	{
+		std::uint64_t bits = mDirty[w];
+
+		// The last word may hold bits past 'end' that belong to the next range.
+		if (w * 64 + 64 > end)
+			bits &= (1ull << (end - w * 64)) - 1;
+
+		mDirty[w] &= ~bits;
+
+		while (bits != 0)
+		{
+			// Lowest set bit first, so the arrays are still walked in order.
+			std::uint32_t bit = LowestSetBit(bits);
+			bits &= bits - 1;
+
+			std::size_t i = w * 64 + bit;
+
+			XMMATRIX world = XMLoadFloat4x4(&mWorld[i]);
+			XMMATRIX texTransform = XMLoadFloat4x4(&mTexTransform[i]);
+
+			XMStoreFloat4x4(&mConstants[i].World, XMMatrixTranspose(world));
+			XMStoreFloat4x4(&mConstants[i].TexTransform, XMMatrixTranspose(texTransform));
+
+			++updated;
+		}
+	}
+
+	return updated;
+}
@@ -0,0 +1,96 @@
+//***************************************************************************************
+// SceneStore.h
+//
+// Packed storage for the per-object transforms of a scene.
+//   -World and texture transforms live in parallel arrays indexed by a dense index, so
+//    updates walk memory linearly instead of chasing one heap object per item.
+//   -Items are addressed through Handles that stay valid while other items come and
+//    go; the dense index behind a handle changes when an item is destroyed.
+//   -Changing a transform sets a bit in a dirty bitset.  UpdateConstants() transposes
+//    only the dirty items into a 256 byte stride array laid out like the shaders'
+//    cbPerObject, which can then be copied to the GPU in one streaming write.
+//***************************************************************************************
+
+#ifndef SCENESTORE_H
+#define SCENESTORE_H
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+class SceneStore
+{
+public:
+	struct Handle
+	{
+		std::uint32_t Slot = UINT32_MAX;
+		std::uint32_t Generation = 0;
+	};
+
+	// One item's constants as the shaders see them: transposed, padded to the 256 byte
+	// constant buffer granularity.
+	struct ObjectData
+	{
+		DirectX::XMFLOAT4X4 World;
+		DirectX::XMFLOAT4X4 TexTransform;
+		float Pad[32];
+	};
+
+	static const std::uint32_t ConstantsStride = sizeof(ObjectData);
+
+	Handle Create(const DirectX::XMFLOAT4X4& world, const DirectX::XMFLOAT4X4& texTransform);
+	void Destroy(Handle h);
+
+	bool IsValid(Handle h)const;
+
+	// Position of the item in the packed arrays and in Constants().
+	std::uint32_t DenseIndex(Handle h)const { return mSlots[h.Slot].Dense; }
+
+	std::uint32_t Size()const { return (std::uint32_t)mWorld.size(); }
+
+	const DirectX::XMFLOAT4X4& World(Handle h)const { return mWorld[DenseIndex(h)]; }
+	const DirectX::XMFLOAT4X4& TexTransform(Handle h)const { return mTexTransform[DenseIndex(h)]; }
+
+	void SetWorld(Handle h, const DirectX::XMFLOAT4X4& world);
+	void SetTexTransform(Handle h, const DirectX::XMFLOAT4X4& texTransform);
+
+	// Bulk access for systems that rewrite many transforms at once; call MarkDirty for
+	// every index written.
+	DirectX::XMFLOAT4X4* WorldData() { return mWorld.data(); }
+	DirectX::XMFLOAT4X4* TexTransformData() { return mTexTransform.data(); }
+	void MarkDirty(std::uint32_t denseIndex);
+	void MarkAllDirty();
+
+	// Refreshes Constants() for the items changed since the last call and clears the
+	// dirty bits.  Returns the number of items refreshed.
+	std::uint32_t UpdateConstants();
+
+	// Same for dense indices [begin, end) only.  Ranges starting on a multiple of
+	// UpdateGranularity touch disjoint dirty words, so they can run in parallel.
+	std::uint32_t UpdateConstants(std::uint32_t begin, std::uint32_t end);
+
+	static const std::uint32_t UpdateGranularity = 64;
+
+	// Size() entries, ConstantsStride bytes apart.
+	const ObjectData* Constants()const { return mConstants.data(); }
+
+private:
+	struct Slot
+	{
+		std::uint32_t Dense = 0;
+		std::uint32_t Generation = 0;
+	};
+
+	std::vector<DirectX::XMFLOAT4X4> mWorld;
+	std::vector<DirectX::XMFLOAT4X4> mTexTransform;
+	std::vector<ObjectData> mConstants;
+	std::vector<std::uint32_t> mDenseToSlot;
+
+	// One bit per dense index.
+	std::vector<std::uint64_t> mDirty;
+
+	std::vector<Slot> mSlots;
+	std::vector<std::uint32_t> mFreeSlots;
+};
+
+#endif // SCENESTORE_H
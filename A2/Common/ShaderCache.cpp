@@ -0,0 +1,282 @@
+//***************************************************************************************
+// ShaderCache.cpp
+//***************************************************************************************
+
+#include "ShaderCache.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#if defined(_WIN32)
+#include <direct.h>
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+	std::string ParentDirectory(const std::string& path)
+	{
+		size_t slash = path.find_last_of("/\\");
+		return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+	}
+
+	// Paths are UTF-8.  On Windows they are widened for the file functions, whose narrow
+	// versions would read them in the ANSI code page.
+#if defined(_WIN32)
+	std::wstring NativePath(const std::string& path)
+	{
+		if (path.empty())
+			return std::wstring();
+
+		int count = MultiByteToWideChar(CP_UTF8, 0, path.data(), (int)path.size(), nullptr, 0);
+		std::wstring wide(count, L'\0');
+		MultiByteToWideChar(CP_UTF8, 0, path.data(), (int)path.size(), &wide[0], count);
+		return wide;
+	}
+
+	void MakeDirectory(const std::string& path)
+	{
+		if (!path.empty())
+			_wmkdir(NativePath(path).c_str());
+	}
+
+	int RemoveFile(const std::string& path) { return _wremove(NativePath(path).c_str()); }
+	int RenameFile(const std::string& from, const std::string& to)
+	{
+		return _wrename(NativePath(from).c_str(), NativePath(to).c_str());
+	}
+#else
+	const std::string& NativePath(const std::string& path) { return path; }
+
+	void MakeDirectory(const std::string& path)
+	{
+		if (!path.empty())
+			mkdir(path.c_str(), 0755);
+	}
+
+	int RemoveFile(const std::string& path) { return std::remove(path.c_str()); }
+	int RenameFile(const std::string& from, const std::string& to) { return std::rename(from.c_str(), to.c_str()); }
+#endif
+
+	// Names in #include "..." and #include <...> lines, in order.  Directives inside
+	// comments or inactive #if blocks are picked up too, which only makes the key depend
+	// on a file it need not.
+	std::vector<std::string> FindIncludes(const std::string& source)
+	{
+		std::vector<std::string> names;
+
+		size_t i = 0;
+		while (i < source.size())
+		{
+			size_t end = source.find('\n', i);
+			if (end == std::string::npos)
+				end = source.size();
+
+			size_t p = i;
+			auto skipBlanks = [&]() { while (p < end && (source[p] == ' ' || source[p] == '\t')) ++p; };
+
+			skipBlanks();
+			if (p < end && source[p] == '#')
+			{
+				++p;
+				skipBlanks();
+				if (source.compare(p, 7, "include") == 0)
+				{
+					p += 7;
+					skipBlanks();
+					if (p < end && (source[p] == '"' || source[p] == '<'))
+					{
+						char close = source[p] == '"' ? '"' : '>';
+						size_t q = source.find(close, p + 1);
+						if (q != std::string::npos && q < end)
+							names.push_back(source.substr(p + 1, q - p - 1));
+					}
+				}
+			}
+
+			i = end + 1;
+		}
+
+		return names;
+	}
+
+	// Length prefixed, so adjacent fields can not run into each other.
+	std::uint64_t HashField(const std::string& s, std::uint64_t seed)
+	{
+		std::uint64_t size = s.size();
+		return ShaderCache::Hash(s.data(), size, ShaderCache::Hash(&size, sizeof(size), seed));
+	}
+
+	std::string ToHex(std::uint64_t value)
+	{
+		std::string s(16, '0');
+		for (int i = 15; i >= 0; --i, value >>= 4)
+			s[i] = "0123456789abcdef"[value & 15];
+		return s;
+	}
+
+	// Keeps the name of an entry a plain file name.
+	std::string Sanitize(const std::string& s)
+	{
+		std::string out = s;
+		for (char& c : out)
+		{
+			if (!std::isalnum((unsigned char)c) && c != '_')
+				c = '_';
+		}
+		return out;
+	}
+}
+
+bool ShaderCache::DiskStorage::Read(const std::string& path, std::string& contents)
+{
+	std::ifstream fin(NativePath(path), std::ios::binary);
+	if (!fin)
+		return false;
+
+	contents.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+	return !fin.bad();
+}
+
+bool ShaderCache::DiskStorage::Write(const std::string& path, const void* data, std::uint64_t byteSize)
+{
+	std::string temp = path + ".tmp";
+
+	std::ofstream fout(NativePath(temp), std::ios::binary | std::ios::trunc);
+	if (!fout)
+	{
+		MakeDirectory(ParentDirectory(path));
+		fout.open(NativePath(temp), std::ios::binary | std::ios::trunc);
+		if (!fout)
+			return false;
+	}
+
+	fout.write(static_cast<const char*>(data), (std::streamsize)byteSize);
+	fout.close();
+	if (!fout)
+	{
+		RemoveFile(temp);
+		return false;
+	}
+
+	// Fails on Windows if another process stored the same entry first, which is as good.
+	if (RenameFile(temp, path) != 0)
+	{
+		RemoveFile(temp);
+		return Exists(path);
+	}
+
+	return true;
+}
+
+bool ShaderCache::DiskStorage::Exists(const std::string& path)
+{
+	std::ifstream fin(NativePath(path), std::ios::binary);
+	return fin.good();
+}
+
+ShaderCache::ShaderCache(const std::string& directory, const std::string& salt, std::unique_ptr<Storage> storage)
+	: mDirectory(directory), mSalt(salt), mStorage(std::move(storage))
+{
+	if (mStorage == nullptr)
+		mStorage.reset(new DiskStorage());
+
+	if (!mDirectory.empty() && mDirectory.back() != '/' && mDirectory.back() != '\\')
+		mDirectory += '/';
+}
+
+std::uint64_t ShaderCache::Hash(const void* data, std::uint64_t byteSize, std::uint64_t seed)
+{
+	// FNV-1a, 64 bit.
+	auto bytes = static_cast<const std::uint8_t*>(data);
+
+	std::uint64_t h = seed ^ 14695981039346656037ull;
+	for (std::uint64_t i = 0; i < byteSize; ++i)
+	{
+		h ^= bytes[i];
+		h *= 1099511628211ull;
+	}
+
+	return h;
+}
+
+bool ShaderCache::HashFile(const std::string& path, std::vector<std::string>& visited, std::uint64_t& hash)
+{
+	// Include guards make a second visit a no-op for the compiler; it adds nothing here.
+	if (std::find(visited.begin(), visited.end(), path) != visited.end())
+		return true;
+	visited.push_back(path);
+
+	std::string source;
+	if (!mStorage->Read(path, source))
+	{
+		// Let the compiler report it.  Creating the file later changes the key.
+		hash = HashField("<missing>", HashField(path, hash));
+		return false;
+	}
+
+	hash = HashField(source, HashField(path, hash));
+
+	std::string directory = ParentDirectory(path);
+	for (const std::string& name : FindIncludes(source))
+		HashFile(directory + name, visited, hash);
+
+	return true;
+}
+
+bool ShaderCache::MakeKey(const std::string& sourcePath, const std::vector<Define>& defines,
+	const std::string& entryPoint, const std::string& target, std::uint32_t flags,
+	std::string& key)
+{
+	std::uint64_t hash = HashField(mSalt, 0);
+	hash = HashField(entryPoint, hash);
+	hash = HashField(target, hash);
+	hash = Hash(&flags, sizeof(flags), hash);
+
+	// Order matters: a later define of the same name wins.
+	std::uint64_t defineCount = defines.size();
+	hash = Hash(&defineCount, sizeof(defineCount), hash);
+	for (const Define& d : defines)
+		hash = HashField(d.Value, HashField(d.Name, hash));
+
+	std::vector<std::string> visited;
+	if (!HashFile(sourcePath, visited, hash))
+		return false;
+
+	key = Sanitize(entryPoint) + "_" + Sanitize(target) + "_" + ToHex(hash);
+	return true;
+}
+
+std::string ShaderCache::EntryPath(const std::string& key)const
+{
+	return mDirectory + key + ".cso";
+}
+
+bool ShaderCache::Lookup(const std::string& key)
+{
+	if (mStorage->Exists(EntryPath(key)))
+	{
+		mStats.Hits++;
+		return true;
+	}
+
+	mStats.Misses++;
+	return false;
+}
+
+bool ShaderCache::Store(const std::string& key, const void* data, std::uint64_t byteSize)
+{
+	if (!mStorage->Write(EntryPath(key), data, byteSize))
+	{
+		mStats.StoreFailures++;
+		return false;
+	}
+
+	mStats.Stores++;
+	return true;
+}
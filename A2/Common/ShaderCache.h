@@ -0,0 +1,103 @@
+//***************************************************************************************
+// ShaderCache.h
+//
+// Content addressed cache of compiled shader bytecode on disk, so unchanged shaders are
+// not compiled again on every launch.
+//   -The key of a compile hashes the source, every file it #includes (transitively,
+//    resolved next to the including file as D3D_COMPILE_STANDARD_FILE_INCLUDE does),
+//    the defines, entry point, target, compile flags and a salt naming the compiler.
+//    Editing any of them gives a new key, so entries never need invalidating.
+//   -Each key is one file in the cache directory, named after the entry point, the
+//    target and the hash; Lookup() reports whether it is there, Store() writes it.
+//   -Files are read and written through a Storage, so the key and the hit/miss logic
+//    can be exercised in memory without a disk or the compiler (see
+//    Tools/ShaderCacheCheck).  d3dUtil::CompileShader(ShaderCache&, ...) ties it to
+//    D3DCompileFromFile and loads hits with d3dUtil::LoadBinary.
+//
+// Only depends on the C++ standard library.
+//***************************************************************************************
+
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ShaderCache
+{
+public:
+	class Storage
+	{
+	public:
+		virtual ~Storage() = default;
+
+		// Whole file; false if it can not be read.
+		virtual bool Read(const std::string& path, std::string& contents) = 0;
+		virtual bool Write(const std::string& path, const void* data, std::uint64_t byteSize) = 0;
+		virtual bool Exists(const std::string& path) = 0;
+	};
+
+	// Files on disk, by UTF-8 path.  Writes go to a temporary file that is renamed into
+	// place, so a reader never sees a partial entry.
+	class DiskStorage : public Storage
+	{
+	public:
+		virtual bool Read(const std::string& path, std::string& contents)override;
+		virtual bool Write(const std::string& path, const void* data, std::uint64_t byteSize)override;
+		virtual bool Exists(const std::string& path)override;
+	};
+
+	struct Define
+	{
+		std::string Name;
+		std::string Value;
+	};
+
+	struct Stats
+	{
+		std::uint32_t Hits = 0;
+		std::uint32_t Misses = 0;
+		std::uint32_t Stores = 0;
+
+		// Stores that could not be written; the shader still compiled.
+		std::uint32_t StoreFailures = 0;
+	};
+
+	// 'directory' is created if missing.  Storage defaults to DiskStorage.
+	explicit ShaderCache(const std::string& directory, const std::string& salt = "d3dcompiler_47",
+		std::unique_ptr<Storage> storage = nullptr);
+	ShaderCache(const ShaderCache& rhs) = delete;
+	ShaderCache& operator=(const ShaderCache& rhs) = delete;
+
+	// False if the source can not be read; the caller should then compile uncached.
+	bool MakeKey(const std::string& sourcePath, const std::vector<Define>& defines,
+		const std::string& entryPoint, const std::string& target, std::uint32_t flags,
+		std::string& key);
+
+	// Path of the entry for 'key'.
+	std::string EntryPath(const std::string& key)const;
+
+	// True, and counted as a hit, if the entry for 'key' exists.
+	bool Lookup(const std::string& key);
+
+	bool Store(const std::string& key, const void* data, std::uint64_t byteSize);
+
+	const Stats& GetStats()const { return mStats; }
+
+	static std::uint64_t Hash(const void* data, std::uint64_t byteSize, std::uint64_t seed);
+
+private:
+	// Hashes 'path' and, depth first, the files it includes into 'hash'.
+	bool HashFile(const std::string& path, std::vector<std::string>& visited, std::uint64_t& hash);
+
+private:
+	std::string mDirectory;
+	std::string mSalt;
+	std::unique_ptr<Storage> mStorage;
+
+	Stats mStats;
+};
+
+#endif // SHADERCACHE_H
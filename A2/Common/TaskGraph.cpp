@@ -0,0 +1,146 @@
+//***************************************************************************************
+// TaskGraph.cpp
+//***************************************************************************************
+
+#include "TaskGraph.h"
+#include "HighResClock.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+
+TaskGraph::TaskId TaskGraph::Add(const char* name, TaskFn fn, const std::vector<TaskId>& dependencies)
+{
+	TaskId id = (TaskId)mTasks.size();
+
+	Task task;
+	task.Name = name;
+	task.Fn = std::move(fn);
+	task.Dependencies = dependencies;
+	mTasks.push_back(std::move(task));
+
+	for (TaskId d : dependencies)
+	{
+		assert(d < id);
+		mTasks[d].Dependents.push_back(id);
+	}
+
+	Timing timing;
+	timing.Name = name;
+	mTimings.push_back(timing);
+
+	return id;
+}
+
+void TaskGraph::Run(JobSystem& jobs)
+{
+	std::mutex mutex;
+	std::condition_variable changed;
+
+	std::vector<std::uint32_t> waitingOn(mTasks.size());
+	std::deque<TaskId> ready;
+	for (TaskId id = 0; id < (TaskId)mTasks.size(); ++id)
+	{
+		waitingOn[id] = (std::uint32_t)mTasks[id].Dependencies.size();
+		if (waitingOn[id] == 0)
+			ready.push_back(id);
+
+		mTimings[id] = Timing();
+		mTimings[id].Name = mTasks[id].Name;
+	}
+
+	std::size_t unfinished = mTasks.size();
+	bool failed = false;
+	std::exception_ptr error;
+
+	HighResClock::Ticks start = HighResClock::Now();
+
+	// One lane per thread.  A lane only returns once every task has run (or the graph
+	// failed), so lanes the job system runs after others have returned find no work.
+	jobs.ParallelFor(jobs.ThreadCount(), 1, [&](std::uint32_t lane, std::uint32_t)
+	{
+		for (;;)
+		{
+			TaskId id;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [&]() { return failed || unfinished == 0 || !ready.empty(); });
+				if (failed || unfinished == 0)
+					return;
+
+				id = ready.front();
+				ready.pop_front();
+			}
+
+			Task& task = mTasks[id];
+			HighResClock::Ticks taskStart = HighResClock::Now();
+			try
+			{
+				PROFILE_SCOPE(task.Name);
+				task.Fn();
+			}
+			catch (...)
+			{
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (!failed)
+					{
+						failed = true;
+						error = std::current_exception();
+					}
+				}
+				changed.notify_all();
+				return;
+			}
+			HighResClock::Ticks taskEnd = HighResClock::Now();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+
+				Timing& t = mTimings[id];
+				t.StartMs = HighResClock::ToMilliseconds(taskStart - start);
+				t.EndMs = HighResClock::ToMilliseconds(taskEnd - start);
+				t.Lane = lane;
+				t.Ran = true;
+
+				for (TaskId d : task.Dependents)
+				{
+					if (--waitingOn[d] == 0)
+						ready.push_back(d);
+				}
+				unfinished--;
+			}
+			changed.notify_all();
+		}
+	});
+
+	mWallMs = HighResClock::ToMilliseconds(HighResClock::Now() - start);
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
+double TaskGraph::CriticalPathMs()const
+{
+	// Tasks only depend on earlier ones, so one pass in order finds each task's longest
+	// chain.
+	std::vector<double> finish(mTasks.size(), 0.0);
+	double longest = 0.0;
+
+	for (TaskId id = 0; id < (TaskId)mTasks.size(); ++id)
+	{
+		double begin = 0.0;
+		for (TaskId d : mTasks[id].Dependencies)
+			begin = std::max<double>(begin, finish[d]);
+
+		const Timing& t = mTimings[id];
+		finish[id] = begin + (t.Ran ? t.EndMs - t.StartMs : 0.0);
+		longest = std::max<double>(longest, finish[id]);
+	}
+
+	return longest;
+}
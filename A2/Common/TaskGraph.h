@@ -0,0 +1,85 @@
+//***************************************************************************************
+// TaskGraph.h
+//
+// Runs a set of named tasks once each, in parallel where their declared dependencies
+// allow, e.g. the stages of application startup:
+//
+//   TaskGraph graph;
+//   auto textures = graph.Add("Textures", [&]() { ... });
+//   auto shaders = graph.Add("Shaders", [&]() { ... });
+//   graph.Add("PSOs", [&]() { ... }, { shaders });
+//   graph.Run(jobs);
+//
+//   -Run() borrows every thread of a JobSystem; each takes the next task whose
+//    dependencies have finished, in the order the tasks were added.  Tasks never run
+//    concurrently with a task they depend on, so a dependency's results are safe to
+//    read without further synchronization.
+//   -A task that throws stops the graph: tasks already running finish, the rest are
+//    skipped, and Run() rethrows the first exception on the calling thread.
+//   -Every task records when and on which lane it ran, and is profiled as a scope of
+//    its own (see Profiler.h).
+//
+// Tasks must not call ParallelFor on the JobSystem the graph runs on; its threads are
+// all busy running the graph.  Task names must be string literals or otherwise outlive
+// the profiler; they are stored by pointer.
+// Only depends on the C++ standard library.
+//***************************************************************************************
+
+#ifndef TASKGRAPH_H
+#define TASKGRAPH_H
+
+#include "JobSystem.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class TaskGraph
+{
+public:
+	typedef std::uint32_t TaskId;
+	typedef std::function<void()> TaskFn;
+
+	struct Timing
+	{
+		const char* Name = nullptr;
+
+		// From the start of Run().
+		double StartMs = 0.0;
+		double EndMs = 0.0;
+
+		// Which of Run()'s threads ran the task, from 0.
+		std::uint32_t Lane = 0;
+
+		// False if the task was skipped because another one threw.
+		bool Ran = false;
+	};
+
+	// Dependencies must have been added before, which keeps the graph acyclic.
+	TaskId Add(const char* name, TaskFn fn, const std::vector<TaskId>& dependencies = {});
+
+	void Run(JobSystem& jobs);
+
+	// One per task, in the order they were added.
+	const std::vector<Timing>& Timings()const { return mTimings; }
+
+	// How long Run() took, and the longest chain of dependent tasks in it: what Run()
+	// would take with a thread for every task.
+	double WallMs()const { return mWallMs; }
+	double CriticalPathMs()const;
+
+private:
+	struct Task
+	{
+		const char* Name = nullptr;
+		TaskFn Fn;
+		std::vector<TaskId> Dependencies;
+		std::vector<TaskId> Dependents;
+	};
+
+	std::vector<Task> mTasks;
+	std::vector<Timing> mTimings;
+	double mWallMs = 0.0;
+};
+
+#endif // TASKGRAPH_H
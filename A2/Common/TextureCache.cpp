@@ -0,0 +1,66 @@
+//***************************************************************************************
+// TextureCache.cpp
+//***************************************************************************************
+
+#include "TextureCache.h"
+
+TextureCache::TextureCache(Allocator* allocator, UINT64 budgetBytes)
+	: mAllocator(allocator), mResidency(this, budgetBytes)
+{
+	assert(mAllocator != nullptr);
+}
+
+void TextureCache::Register(const std::string& name, const std::wstring& filename, int priority)
+{
+	mFilenames[name] = filename;
+	mResidency.Register(name, priority);
+}
+
+Texture* TextureCache::Acquire(const std::string& name, UINT64 fence)
+{
+	std::uint64_t allocation = 0;
+	if (!mResidency.Acquire(name, fence, allocation))
+		return nullptr;
+
+	return &mTextures[allocation];
+}
+
+Texture* TextureCache::Find(const std::string& name)
+{
+	std::uint64_t allocation = 0;
+	if (!mResidency.Find(name, allocation))
+		return nullptr;
+
+	return &mTextures[allocation];
+}
+
+std::uint64_t TextureCache::Load(const std::string& name, std::uint64_t& residentBytes, bool& uploading)
+{
+	Texture tex;
+	tex.Name = name;
+	tex.Filename = mFilenames[name];
+
+	UINT64 bytes = 0;
+	ThrowIfFailed(mAllocator->Create(tex, bytes));
+
+	std::uint64_t allocation = mNextAllocation++;
+	residentBytes = bytes;
+	uploading = tex.UploadHeap != nullptr;
+	mTextures.emplace(allocation, std::move(tex));
+
+	return allocation;
+}
+
+void TextureCache::Unload(std::uint64_t allocation)
+{
+	auto it = mTextures.find(allocation);
+	assert(it != mTextures.end());
+
+	mAllocator->Destroy(it->second);
+	mTextures.erase(it);
+}
+
+void TextureCache::ReleaseUpload(std::uint64_t allocation)
+{
+	mAllocator->ReleaseUploadHeap(mTextures[allocation]);
+}
@@ -0,0 +1,92 @@
+//***************************************************************************************
+// TextureCache.h
+//
+// Owns the application's textures and keeps their GPU memory under a byte budget.
+// The residency policy (references, priorities, LRU, deferred destruction) lives in
+// TextureResidency; the cache pairs it with the Texture objects and creates them
+// through a TextureCache::Allocator.
+//***************************************************************************************
+
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include "d3dUtil.h"
+#include "TextureResidency.h"
+
+class TextureCache : private TextureResidency::Loader
+{
+public:
+	class Allocator
+	{
+	public:
+		virtual ~Allocator() = default;
+
+		// Creates tex.Resource (and tex.UploadHeap if a copy is needed) from tex.Filename
+		// and returns the GPU memory the resource occupies.
+		virtual HRESULT Create(Texture& tex, UINT64& residentBytes) = 0;
+
+		virtual void Destroy(Texture& tex)
+		{
+			tex.Resource = nullptr;
+			tex.UploadHeap = nullptr;
+		}
+
+		virtual void ReleaseUploadHeap(Texture& tex)
+		{
+			tex.UploadHeap = nullptr;
+		}
+	};
+
+	typedef TextureResidency::Stats Stats;
+
+	TextureCache(Allocator* allocator, UINT64 budgetBytes);
+	TextureCache(const TextureCache& rhs) = delete;
+	TextureCache& operator=(const TextureCache& rhs) = delete;
+	~TextureCache() = default;
+
+	// Makes a texture known to the cache without creating it.  Higher priority
+	// textures are kept resident longer.
+	void Register(const std::string& name, const std::wstring& filename, int priority = 0);
+
+	// Returns the texture, creating it on a miss, and adds a reference.  'fence' is the
+	// fence value that will be signaled once the commands recorded for this frame
+	// (including any upload) have executed.
+	Texture* Acquire(const std::string& name, UINT64 fence);
+	void Release(const std::string& name) { mResidency.Release(name); }
+
+	// Returns a resident texture without adding a reference, or nullptr.
+	Texture* Find(const std::string& name);
+
+	// Marks a resident texture as used by the commands that complete at 'fence'.
+	void Touch(const std::string& name, UINT64 fence) { mResidency.Touch(name, fence); }
+
+	// Call once per frame with the GPU's completed fence value.  Frees finished upload
+	// heaps, destroys evicted textures that are no longer in flight and evicts until
+	// the resident size fits the budget.
+	void Update(UINT64 completedFence) { mResidency.Update(completedFence); }
+
+	void SetBudget(UINT64 budgetBytes) { mResidency.SetBudget(budgetBytes); }
+	UINT64 Budget()const { return mResidency.Budget(); }
+
+	const Stats& GetStats()const { return mResidency.GetStats(); }
+
+private:
+	virtual std::uint64_t Load(const std::string& name, std::uint64_t& residentBytes, bool& uploading)override;
+	virtual void Unload(std::uint64_t allocation)override;
+	virtual void ReleaseUpload(std::uint64_t allocation)override;
+
+private:
+	Allocator* mAllocator = nullptr;
+
+	std::unordered_map<std::string, std::wstring> mFilenames;
+
+	// Every live texture, including evicted ones the GPU may still be reading, by the
+	// allocation id TextureResidency knows it by.
+	std::unordered_map<std::uint64_t, Texture> mTextures;
+	std::uint64_t mNextAllocation = 1;
+
+	// Declared last so its destructor unloads into the members above.
+	TextureResidency mResidency;
+};
+
+#endif // TEXTURECACHE_H
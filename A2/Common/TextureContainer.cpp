@@ -0,0 +1,385 @@
+//***************************************************************************************
+// TextureContainer.cpp
+//***************************************************************************************
+
+#include "TextureContainer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace
+{
+	const std::size_t MinMatch = 4;
+	const std::size_t LastLiterals = 5;   // the last 5 bytes are always literals
+	const std::size_t MatchSafeLimit = 12; // no match may start in the last 12 bytes
+	const std::size_t MaxOffset = 65535;
+	const int HashBits = 16;
+
+	std::uint32_t ReadU32(const std::uint8_t* p)
+	{
+		return (std::uint32_t)p[0] | ((std::uint32_t)p[1] << 8) |
+			((std::uint32_t)p[2] << 16) | ((std::uint32_t)p[3] << 24);
+	}
+
+	std::uint64_t ReadU64(const std::uint8_t* p)
+	{
+		return (std::uint64_t)ReadU32(p) | ((std::uint64_t)ReadU32(p + 4) << 32);
+	}
+
+	void WriteU32(std::uint8_t* p, std::uint32_t v)
+	{
+		p[0] = (std::uint8_t)(v & 0xff);
+		p[1] = (std::uint8_t)((v >> 8) & 0xff);
+		p[2] = (std::uint8_t)((v >> 16) & 0xff);
+		p[3] = (std::uint8_t)(v >> 24);
+	}
+
+	std::uint32_t Hash4(const std::uint8_t* p)
+	{
+		std::uint32_t v;
+		std::memcpy(&v, p, 4);
+		return (v * 2654435761u) >> (32 - HashBits);
+	}
+
+	// Runs work(i) for i in [0, count) on 'executor', or in turn without one.
+	template<typename F>
+	void ForEach(const TextureContainer::Executor& executor, std::size_t count, F&& work)
+	{
+		if (executor && count > 1)
+		{
+			executor(count, work);
+			return;
+		}
+
+		for (std::size_t i = 0; i < count; ++i)
+			work(i);
+	}
+}
+
+std::size_t TextureContainer::CompressBlock(const std::uint8_t* src, std::size_t srcSize,
+	std::uint8_t* dst, std::size_t dstCapacity)
+{
+	std::uint8_t* op = dst;
+	std::uint8_t* const opEnd = dst + dstCapacity;
+
+	const std::uint8_t* anchor = src;
+	const std::uint8_t* ip = src;
+	const std::uint8_t* const iend = src + srcSize;
+
+	auto emitSequence = [&](const std::uint8_t* literals, std::size_t litLen,
+		std::size_t offset, std::size_t matchLen, bool last) -> bool
+	{
+		// token + literal length bytes + literals + offset + match length bytes
+		std::size_t worst = 1 + litLen / 255 + 1 + litLen + 2 + matchLen / 255 + 1;
+		if ((std::size_t)(opEnd - op) < worst)
+			return false;
+
+		std::uint8_t* token = op++;
+		std::size_t litCode = std::min<std::size_t>(litLen, 15);
+		*token = (std::uint8_t)(litCode << 4);
+		if (litLen >= 15)
+		{
+			std::size_t rest = litLen - 15;
+			for (; rest >= 255; rest -= 255)
+				*op++ = 255;
+			*op++ = (std::uint8_t)rest;
+		}
+		std::memcpy(op, literals, litLen);
+		op += litLen;
+
+		if (last)
+			return true;
+
+		*op++ = (std::uint8_t)(offset & 0xff);
+		*op++ = (std::uint8_t)(offset >> 8);
+
+		std::size_t m = matchLen - MinMatch;
+		*token |= (std::uint8_t)std::min<std::size_t>(m, 15);
+		if (m >= 15)
+		{
+			std::size_t rest = m - 15;
+			for (; rest >= 255; rest -= 255)
+				*op++ = 255;
+			*op++ = (std::uint8_t)rest;
+		}
+		return true;
+	};
+
+	if (srcSize > MatchSafeLimit)
+	{
+		std::vector<std::uint32_t> table((std::size_t)1 << HashBits, 0xffffffffu);
+		const std::uint8_t* const matchLimit = iend - MatchSafeLimit;
+
+		while (ip < matchLimit)
+		{
+			std::uint32_t h = Hash4(ip);
+			std::uint32_t candidate = table[h];
+			table[h] = (std::uint32_t)(ip - src);
+
+			if (candidate != 0xffffffffu)
+			{
+				const std::uint8_t* ref = src + candidate;
+				if ((std::size_t)(ip - ref) <= MaxOffset && std::memcmp(ref, ip, MinMatch) == 0)
+				{
+					// Extend the match, keeping the last literals intact.
+					const std::uint8_t* mEnd = ip + MinMatch;
+					const std::uint8_t* r = ref + MinMatch;
+					const std::uint8_t* const maxEnd = iend - LastLiterals;
+					while (mEnd < maxEnd && *mEnd == *r)
+					{
+						++mEnd;
+						++r;
+					}
+
+					if (!emitSequence(anchor, (std::size_t)(ip - anchor), (std::size_t)(ip - ref),
+						(std::size_t)(mEnd - ip), false))
+						return 0;
+
+					ip = mEnd;
+					anchor = ip;
+					continue;
+				}
+			}
+
+			++ip;
+		}
+	}
+
+	if (!emitSequence(anchor, (std::size_t)(iend - anchor), 0, 0, true))
+		return 0;
+
+	return (std::size_t)(op - dst);
+}
+
+bool TextureContainer::DecompressBlock(const std::uint8_t* src, std::size_t srcSize,
+	std::uint8_t* dst, std::size_t dstSize)
+{
+	const std::uint8_t* ip = src;
+	const std::uint8_t* const iend = src + srcSize;
+	std::uint8_t* op = dst;
+	std::uint8_t* const oend = dst + dstSize;
+
+	while (ip < iend)
+	{
+		std::uint8_t token = *ip++;
+
+		std::size_t litLen = token >> 4;
+		if (litLen == 15)
+		{
+			std::uint8_t b;
+			do
+			{
+				if (ip >= iend)
+					return false;
+				b = *ip++;
+				litLen += b;
+			} while (b == 255);
+		}
+
+		if ((std::size_t)(iend - ip) < litLen || (std::size_t)(oend - op) < litLen)
+			return false;
+
+		std::memcpy(op, ip, litLen);
+		ip += litLen;
+		op += litLen;
+
+		// The final sequence has no match part.
+		if (ip == iend)
+			break;
+
+		if (iend - ip < 2)
+			return false;
+
+		std::size_t offset = (std::size_t)ip[0] | ((std::size_t)ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (std::size_t)(op - dst))
+			return false;
+
+		std::size_t matchLen = token & 15;
+		if (matchLen == 15)
+		{
+			std::uint8_t b;
+			do
+			{
+				if (ip >= iend)
+					return false;
+				b = *ip++;
+				matchLen += b;
+			} while (b == 255);
+		}
+		matchLen += MinMatch;
+
+		if ((std::size_t)(oend - op) < matchLen)
+			return false;
+
+		// Matches may overlap their own output, so copy forward byte by byte when close.
+		const std::uint8_t* ref = op - offset;
+		if (offset >= matchLen)
+		{
+			std::memcpy(op, ref, matchLen);
+			op += matchLen;
+		}
+		else
+		{
+			for (std::size_t i = 0; i < matchLen; ++i)
+				*op++ = *ref++;
+		}
+	}
+
+	return op == oend;
+}
+
+bool TextureContainer::IsContainer(const std::uint8_t* data, std::size_t size)
+{
+	return UncompressedSize(data, size) != 0;
+}
+
+std::uint64_t TextureContainer::UncompressedSize(const std::uint8_t* data, std::size_t size)
+{
+	if (data == nullptr || size < HeaderSize || ReadU32(data) != Magic || ReadU32(data + 4) != 1)
+		return 0;
+
+	std::uint64_t uncompressed = ReadU64(data + 8);
+	std::uint32_t chunkSize = ReadU32(data + 16);
+	std::uint32_t chunkCount = ReadU32(data + 20);
+
+	if (chunkSize == 0 || uncompressed == 0)
+		return 0;
+
+	// The chunk count must describe exactly the uncompressed size.
+	if ((uncompressed + chunkSize - 1) / chunkSize != chunkCount)
+		return 0;
+
+	if ((std::uint64_t)chunkCount * ChunkEntrySize > size - HeaderSize)
+		return 0;
+
+	// Walk the chunk table before anyone allocates 'uncompressed' bytes: a few bytes of
+	// header must not be able to ask for gigabytes.
+	std::uint64_t offset = HeaderSize + (std::uint64_t)chunkCount * ChunkEntrySize;
+	for (std::uint32_t i = 0; i < chunkCount; ++i)
+	{
+		const std::uint8_t* entry = data + HeaderSize + (std::size_t)i * ChunkEntrySize;
+		std::uint64_t storedSize = ReadU32(entry);
+		std::uint32_t flags = ReadU32(entry + 4);
+		std::uint64_t chunkBytes = std::min<std::uint64_t>(chunkSize, uncompressed - (std::uint64_t)i * chunkSize);
+
+		if (flags == ChunkRaw ? storedSize != chunkBytes :
+			flags != ChunkLZ4 || chunkBytes > storedSize * MaxExpansion)
+			return 0;
+
+		offset += storedSize;
+		if (offset > size)
+			return 0;
+	}
+
+	return uncompressed;
+}
+
+std::vector<std::uint8_t> TextureContainer::Compress(const std::uint8_t* dds, std::size_t size,
+	std::uint32_t chunkSize, const Executor& executor)
+{
+	if (chunkSize == 0)
+		chunkSize = DefaultChunkSize;
+
+	std::size_t chunkCount = (size + chunkSize - 1) / chunkSize;
+
+	struct Chunk
+	{
+		std::vector<std::uint8_t> Data;
+		std::uint32_t Flags = ChunkRaw;
+	};
+	std::vector<Chunk> chunks(chunkCount);
+
+	ForEach(executor, chunkCount, [&](std::size_t i)
+	{
+		const std::uint8_t* src = dds + i * chunkSize;
+		std::size_t srcSize = std::min<std::size_t>(chunkSize, size - i * chunkSize);
+
+		// Only keep the compressed form if it is actually smaller.
+		chunks[i].Data.resize(srcSize);
+		std::size_t packed = CompressBlock(src, srcSize, chunks[i].Data.data(), srcSize - 1);
+		if (packed != 0)
+		{
+			chunks[i].Data.resize(packed);
+			chunks[i].Flags = ChunkLZ4;
+		}
+		else
+		{
+			std::memcpy(chunks[i].Data.data(), src, srcSize);
+		}
+	});
+
+	std::size_t total = HeaderSize + chunkCount * ChunkEntrySize;
+	for (auto& c : chunks)
+		total += c.Data.size();
+
+	std::vector<std::uint8_t> out(total);
+	WriteU32(&out[0], Magic);
+	WriteU32(&out[4], 1);
+	WriteU32(&out[8], (std::uint32_t)((std::uint64_t)size & 0xffffffffu));
+	WriteU32(&out[12], (std::uint32_t)((std::uint64_t)size >> 32));
+	WriteU32(&out[16], chunkSize);
+	WriteU32(&out[20], (std::uint32_t)chunkCount);
+
+	std::size_t offset = HeaderSize + chunkCount * ChunkEntrySize;
+	for (std::size_t i = 0; i < chunkCount; ++i)
+	{
+		WriteU32(&out[HeaderSize + i * ChunkEntrySize], (std::uint32_t)chunks[i].Data.size());
+		WriteU32(&out[HeaderSize + i * ChunkEntrySize + 4], chunks[i].Flags);
+
+		std::memcpy(&out[offset], chunks[i].Data.data(), chunks[i].Data.size());
+		offset += chunks[i].Data.size();
+	}
+
+	return out;
+}
+
+bool TextureContainer::Decompress(const std::uint8_t* data, std::size_t size,
+	std::uint8_t* out, std::size_t outSize, const Executor& executor)
+{
+	std::uint64_t uncompressed = UncompressedSize(data, size);
+	if (uncompressed == 0 || uncompressed != outSize || out == nullptr)
+		return false;
+
+	std::uint32_t chunkSize = ReadU32(data + 16);
+	std::size_t chunkCount = ReadU32(data + 20);
+
+	// Resolve every chunk's stored offset up front so the chunks can decode independently.
+	// UncompressedSize() has checked the table, so every chunk lies inside 'data'.
+	std::vector<std::uint64_t> offsets(chunkCount);
+	std::uint64_t offset = HeaderSize + (std::uint64_t)chunkCount * ChunkEntrySize;
+	for (std::size_t i = 0; i < chunkCount; ++i)
+	{
+		offsets[i] = offset;
+		offset += ReadU32(data + HeaderSize + i * ChunkEntrySize);
+	}
+
+	std::atomic<bool> ok(true);
+	ForEach(executor, chunkCount, [&](std::size_t i)
+	{
+		const std::uint8_t* entry = data + HeaderSize + i * ChunkEntrySize;
+		std::uint32_t storedSize = ReadU32(entry);
+		std::uint32_t flags = ReadU32(entry + 4);
+
+		std::uint8_t* dst = out + i * (std::size_t)chunkSize;
+		std::size_t dstSize = std::min<std::size_t>(chunkSize, outSize - i * (std::size_t)chunkSize);
+		const std::uint8_t* src = data + offsets[i];
+
+		if (flags == ChunkRaw)
+		{
+			if (storedSize != dstSize)
+			{
+				ok = false;
+				return;
+			}
+			std::memcpy(dst, src, dstSize);
+		}
+		else if (!DecompressBlock(src, storedSize, dst, dstSize))
+		{
+			ok = false;
+		}
+	});
+
+	return ok;
+}
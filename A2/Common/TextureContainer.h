@@ -0,0 +1,75 @@
+//***************************************************************************************
+// TextureContainer.h
+//
+// Compressed wrapper ("DDZ") around a DDS file.  The DDS bytes are split into fixed
+// size chunks that are LZ4-block compressed independently, so they can be decoded in
+// parallel straight into the buffer the DDS loader parses.  Chunks that do not shrink
+// are stored raw.
+//
+// Layout (little endian):
+//   uint32 Magic ('DDZ1'), uint32 Version, uint64 UncompressedSize,
+//   uint32 ChunkSize, uint32 ChunkCount,
+//   ChunkCount x { uint32 StoredSize, uint32 Flags },
+//   chunk data, back to back.
+//
+// Chunks are coded on the caller's Executor (e.g. the app's JobSystem); without one
+// they are coded in turn on the calling thread.
+// Only depends on the C++ standard library so the packing tool builds on Linux.
+//***************************************************************************************
+
+#ifndef TEXTURECONTAINER_H
+#define TEXTURECONTAINER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class TextureContainer
+{
+public:
+	static const std::uint32_t Magic = 0x315A4444; // "DDZ1"
+	static const std::uint32_t DefaultChunkSize = 256 * 1024;
+
+	// An LZ4 block decodes to at most this many bytes per stored byte.
+	static const std::uint32_t MaxExpansion = 255;
+
+	// Runs work(i) for every i in [0, count), in parallel or not, and returns once all
+	// of them are done.
+	typedef std::function<void(std::size_t count, const std::function<void(std::size_t)>& work)> Executor;
+
+	// True if 'data' starts with a valid container header.
+	static bool IsContainer(const std::uint8_t* data, std::size_t size);
+
+	// Size of the DDS file stored in the container, or 0 if the header or the chunk table
+	// is invalid: every chunk must lie inside 'size' bytes and be able to decode to its
+	// share of the DDS, so the size can be trusted for an allocation.
+	static std::uint64_t UncompressedSize(const std::uint8_t* data, std::size_t size);
+
+	static std::vector<std::uint8_t> Compress(const std::uint8_t* dds, std::size_t size,
+		std::uint32_t chunkSize = DefaultChunkSize, const Executor& executor = Executor());
+
+	// Decodes the container into 'out', which must be UncompressedSize() bytes.  Every
+	// read and write is bounds checked; returns false on malformed input.
+	static bool Decompress(const std::uint8_t* data, std::size_t size,
+		std::uint8_t* out, std::size_t outSize, const Executor& executor = Executor());
+
+	// LZ4 block format codec.  CompressBlock returns 0 if the output does not fit in
+	// 'dstCapacity'; DecompressBlock returns false unless exactly 'dstSize' bytes decode.
+	static std::size_t CompressBlock(const std::uint8_t* src, std::size_t srcSize,
+		std::uint8_t* dst, std::size_t dstCapacity);
+	static bool DecompressBlock(const std::uint8_t* src, std::size_t srcSize,
+		std::uint8_t* dst, std::size_t dstSize);
+
+private:
+	enum ChunkFlags : std::uint32_t
+	{
+		ChunkRaw = 0,
+		ChunkLZ4 = 1
+	};
+
+	static const std::size_t HeaderSize = 24;
+	static const std::size_t ChunkEntrySize = 8;
+};
+
+#endif // TEXTURECONTAINER_H
@@ -0,0 +1,173 @@
+//***************************************************************************************
+// TextureResidency.cpp
+//***************************************************************************************
+
+#include "TextureResidency.h"
+
+#include <algorithm>
+#include <cassert>
+
+TextureResidency::TextureResidency(Loader* loader, std::uint64_t budgetBytes)
+	: mLoader(loader), mBudgetBytes(budgetBytes)
+{
+	assert(mLoader != nullptr);
+}
+
+TextureResidency::~TextureResidency()
+{
+	for (auto& p : mPendingUnloads)
+		mLoader->Unload(p.Allocation);
+
+	for (auto& e : mEntries)
+	{
+		if (e.second.Resident)
+			mLoader->Unload(e.second.Allocation);
+	}
+}
+
+void TextureResidency::Register(const std::string& name, int priority)
+{
+	mEntries[name].Priority = priority;
+}
+
+bool TextureResidency::Acquire(const std::string& name, std::uint64_t fence, std::uint64_t& allocation)
+{
+	auto it = mEntries.find(name);
+	if (it == mEntries.end())
+		return false;
+
+	Entry& e = it->second;
+	if (e.Resident)
+	{
+		mStats.Hits++;
+	}
+	else
+	{
+		mStats.Misses++;
+
+		std::uint64_t bytes = 0;
+		bool uploading = false;
+		e.Allocation = mLoader->Load(name, bytes, uploading);
+
+		e.Resident = true;
+		e.Uploading = uploading;
+		e.ResidentBytes = bytes;
+		e.UploadFence = uploading ? fence : 0;
+		e.LruPos = mLru.insert(mLru.end(), name);
+
+		mStats.ResidentBytes += bytes;
+		mStats.PeakResidentBytes = std::max<std::uint64_t>(mStats.PeakResidentBytes, mStats.ResidentBytes);
+	}
+
+	e.RefCount++;
+	e.LastUsedFence = std::max<std::uint64_t>(e.LastUsedFence, fence);
+	MarkRecentlyUsed(e);
+
+	allocation = e.Allocation;
+	return true;
+}
+
+void TextureResidency::Release(const std::string& name)
+{
+	auto it = mEntries.find(name);
+	if (it == mEntries.end())
+		return;
+
+	assert(it->second.RefCount > 0);
+	if (it->second.RefCount > 0)
+		it->second.RefCount--;
+}
+
+bool TextureResidency::Find(const std::string& name, std::uint64_t& allocation)const
+{
+	auto it = mEntries.find(name);
+	if (it == mEntries.end() || !it->second.Resident)
+		return false;
+
+	allocation = it->second.Allocation;
+	return true;
+}
+
+void TextureResidency::Touch(const std::string& name, std::uint64_t fence)
+{
+	auto it = mEntries.find(name);
+	if (it == mEntries.end() || !it->second.Resident)
+		return;
+
+	it->second.LastUsedFence = std::max<std::uint64_t>(it->second.LastUsedFence, fence);
+	MarkRecentlyUsed(it->second);
+}
+
+void TextureResidency::Update(std::uint64_t completedFence)
+{
+	for (auto& e : mEntries)
+	{
+		Entry& entry = e.second;
+		if (entry.Resident && entry.Uploading && entry.UploadFence <= completedFence)
+		{
+			mLoader->ReleaseUpload(entry.Allocation);
+			entry.Uploading = false;
+			mStats.UploadHeapsReleased++;
+		}
+	}
+
+	auto last = std::remove_if(mPendingUnloads.begin(), mPendingUnloads.end(),
+		[&](const PendingUnload& p)
+		{
+			if (p.Fence > completedFence)
+				return false;
+
+			mLoader->Unload(p.Allocation);
+			return true;
+		});
+	mPendingUnloads.erase(last, mPendingUnloads.end());
+
+	EvictToBudget();
+}
+
+void TextureResidency::SetBudget(std::uint64_t budgetBytes)
+{
+	mBudgetBytes = budgetBytes;
+	EvictToBudget();
+}
+
+void TextureResidency::MarkRecentlyUsed(Entry& e)
+{
+	mLru.splice(mLru.end(), mLru, e.LruPos);
+}
+
+void TextureResidency::EvictToBudget()
+{
+	while (mStats.ResidentBytes > mBudgetBytes)
+	{
+		// Pick the lowest priority unreferenced texture; the LRU order breaks ties
+		// because we scan from the least recently used end.
+		Entry* victim = nullptr;
+		for (auto& name : mLru)
+		{
+			Entry& e = mEntries[name];
+			if (e.RefCount == 0 && (victim == nullptr || e.Priority < victim->Priority))
+				victim = &e;
+		}
+
+		// Everything left is in use; stay over budget rather than pull a texture
+		// out from under a material.
+		if (victim == nullptr)
+			break;
+
+		// The GPU may still be sampling it, so defer the unload until its fence passes.
+		// The allocation id moves to the pending list; a later Acquire loads a new one.
+		PendingUnload p;
+		p.Allocation = victim->Allocation;
+		p.Fence = victim->LastUsedFence;
+		mPendingUnloads.push_back(p);
+
+		victim->Resident = false;
+		victim->Uploading = false;
+		mLru.erase(victim->LruPos);
+
+		mStats.ResidentBytes -= victim->ResidentBytes;
+		mStats.Evictions++;
+		victim->ResidentBytes = 0;
+	}
+}
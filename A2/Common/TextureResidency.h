@@ -0,0 +1,132 @@
+//***************************************************************************************
+// TextureResidency.h
+//
+// The bookkeeping behind TextureCache: which textures are resident, who references
+// them, and which to evict to stay under a byte budget.
+//   -Textures are registered by name and loaded on first Acquire().
+//   -Only unreferenced textures can be evicted, lowest priority first and least
+//    recently used within a priority.
+//   -Upload memory is released as soon as the fence of its copy has completed, and
+//    evicted textures are unloaded only once the GPU can no longer be using them.
+//
+// Creating and destroying the textures themselves goes through a Loader, which hands
+// back an opaque allocation id; nothing here touches a device.  TextureCache supplies a
+// D3D12 loader, and a simulated one can drive the policy on any platform.
+// Only depends on the C++ standard library.
+//***************************************************************************************
+
+#ifndef TEXTURERESIDENCY_H
+#define TEXTURERESIDENCY_H
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class TextureResidency
+{
+public:
+	class Loader
+	{
+	public:
+		virtual ~Loader() = default;
+
+		// Creates the named texture.  Returns the id later calls refer to it by, the
+		// memory it occupies, and whether it holds upload memory that can be released
+		// once its copy completes.  May throw; the residency state is left unchanged.
+		virtual std::uint64_t Load(const std::string& name, std::uint64_t& residentBytes, bool& uploading) = 0;
+
+		// The GPU is done with the allocation.
+		virtual void Unload(std::uint64_t allocation) = 0;
+
+		// The allocation's copy has completed.
+		virtual void ReleaseUpload(std::uint64_t allocation) = 0;
+	};
+
+	struct Stats
+	{
+		std::uint64_t Hits = 0;
+		std::uint64_t Misses = 0;
+		std::uint64_t Evictions = 0;
+		std::uint64_t UploadHeapsReleased = 0;
+		std::uint64_t ResidentBytes = 0;
+		std::uint64_t PeakResidentBytes = 0;
+	};
+
+	TextureResidency(Loader* loader, std::uint64_t budgetBytes);
+	TextureResidency(const TextureResidency& rhs) = delete;
+	TextureResidency& operator=(const TextureResidency& rhs) = delete;
+
+	// Unloads everything; the owner must have flushed the GPU.
+	~TextureResidency();
+
+	// Makes a texture known without loading it.  Higher priority textures are kept
+	// resident longer.
+	void Register(const std::string& name, int priority = 0);
+
+	// Loads the texture on a miss and adds a reference.  'fence' is the fence value
+	// that will be signaled once the commands recorded for this frame (including any
+	// upload) have executed.  Returns false for a name that was never registered.
+	bool Acquire(const std::string& name, std::uint64_t fence, std::uint64_t& allocation);
+	void Release(const std::string& name);
+
+	// Looks up a resident texture without adding a reference.
+	bool Find(const std::string& name, std::uint64_t& allocation)const;
+
+	// Marks a resident texture as used by the commands that complete at 'fence'.
+	void Touch(const std::string& name, std::uint64_t fence);
+
+	// Call once per frame with the GPU's completed fence value.  Releases finished
+	// uploads, unloads evicted textures that are no longer in flight and evicts until
+	// the resident size fits the budget.
+	void Update(std::uint64_t completedFence);
+
+	void SetBudget(std::uint64_t budgetBytes);
+	std::uint64_t Budget()const { return mBudgetBytes; }
+
+	const Stats& GetStats()const { return mStats; }
+
+private:
+	struct Entry
+	{
+		int Priority = 0;
+		int RefCount = 0;
+		bool Resident = false;
+		bool Uploading = false;
+		std::uint64_t Allocation = 0;
+		std::uint64_t ResidentBytes = 0;
+
+		// Fence after which the upload memory is no longer needed.
+		std::uint64_t UploadFence = 0;
+
+		// Fence after which the GPU no longer reads the texture.
+		std::uint64_t LastUsedFence = 0;
+
+		std::list<std::string>::iterator LruPos;
+	};
+
+	struct PendingUnload
+	{
+		std::uint64_t Allocation = 0;
+		std::uint64_t Fence = 0;
+	};
+
+	void MarkRecentlyUsed(Entry& e);
+	void EvictToBudget();
+
+private:
+	Loader* mLoader = nullptr;
+	std::uint64_t mBudgetBytes = 0;
+
+	std::unordered_map<std::string, Entry> mEntries;
+
+	// Resident textures, least recently used at the front.
+	std::list<std::string> mLru;
+
+	std::vector<PendingUnload> mPendingUnloads;
+
+	Stats mStats;
+};
+
+#endif // TEXTURERESIDENCY_H
@@ -0,0 +1,101 @@
+//***************************************************************************************
+// TextureUploadBatch.cpp
+//***************************************************************************************
+
+#include "TextureUploadBatch.h"
+
+using Microsoft::WRL::ComPtr;
+
+static_assert(TextureUploadQueue::Alignment == D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT,
+	"Texture copy sources must start on a D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT boundary.");
+
+TextureUploadBatch::TextureUploadBatch(ID3D12Device* device, TextureContainer::Executor decodeExecutor)
+	: mDevice(device), mDecodeExecutor(std::move(decodeExecutor)), mQueue(this)
+{
+}
+
+HRESULT TextureUploadBatch::Create(Texture& tex, UINT64& residentBytes)
+{
+	PendingTexture pending;
+	HRESULT hr = DirectX::LoadDDSTextureFromFile12(mDevice, tex.Filename.c_str(),
+		pending.Resource, pending.FileData, pending.Subresources, 0, nullptr, &mDecodeExecutor);
+	if (FAILED(hr))
+		return hr;
+
+	auto desc = pending.Resource->GetDesc();
+	residentBytes = mDevice->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+
+	// The batch owns the upload memory, so the texture never gets its own UploadHeap.
+	tex.Resource = pending.Resource;
+	tex.UploadHeap = nullptr;
+
+	std::uint64_t id = mNextId++;
+	mPending.emplace(id, std::move(pending));
+	mQueue.Add(id);
+
+	return S_OK;
+}
+
+void TextureUploadBatch::Record(ID3D12GraphicsCommandList* cmdList, UINT64 fence)
+{
+	mCmdList = cmdList;
+	mQueue.Record(fence);
+	mCmdList = nullptr;
+}
+
+std::uint64_t TextureUploadBatch::UploadSize(std::uint64_t texture)
+{
+	PendingTexture& p = mPending.at(texture);
+	return GetRequiredIntermediateSize(p.Resource.Get(), 0, (UINT)p.Subresources.size());
+}
+
+std::uint64_t TextureUploadBatch::CreateUploadBuffer(std::uint64_t bytes)
+{
+	ComPtr<ID3D12Resource> buffer;
+
+	auto properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	auto desc = CD3DX12_RESOURCE_DESC::Buffer(bytes);
+	ThrowIfFailed(mDevice->CreateCommittedResource(
+		&properties,
+		D3D12_HEAP_FLAG_NONE,
+		&desc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(buffer.GetAddressOf())));
+
+	std::uint64_t id = mNextId++;
+	mBuffers.emplace(id, buffer);
+	return id;
+}
+
+void TextureUploadBatch::DestroyUploadBuffer(std::uint64_t buffer)
+{
+	mBuffers.erase(buffer);
+}
+
+void TextureUploadBatch::RecordCopy(std::uint64_t texture, std::uint64_t buffer, std::uint64_t offset)
+{
+	assert(mCmdList != nullptr);
+
+	PendingTexture& p = mPending.at(texture);
+	UpdateSubresources(mCmdList, p.Resource.Get(), mBuffers.at(buffer).Get(), offset,
+		0, (UINT)p.Subresources.size(), p.Subresources.data());
+}
+
+void TextureUploadBatch::RecordTransitions(const std::vector<std::uint64_t>& textures)
+{
+	std::vector<D3D12_RESOURCE_BARRIER> barriers;
+	barriers.reserve(textures.size());
+
+	for (std::uint64_t texture : textures)
+	{
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(mPending.at(texture).Resource.Get(),
+			D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+	}
+
+	mCmdList->ResourceBarrier((UINT)barriers.size(), barriers.data());
+
+	// The source data has been copied into the upload buffer, so the file data can go.
+	for (std::uint64_t texture : textures)
+		mPending.erase(texture);
+}
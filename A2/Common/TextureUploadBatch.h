@@ -0,0 +1,77 @@
+//***************************************************************************************
+// TextureUploadBatch.h
+//
+// Collects the textures the cache creates and uploads them through one shared upload
+// buffer per Record() instead of one committed upload heap per texture.  The layout
+// and buffer lifetimes are TextureUploadQueue's; this class is its D3D12 backend,
+// creating the buffers on the device and recording the copies on a command list.
+//
+// The batch doubles as a TextureCache allocator so the cache can create textures
+// through it.  Textures created after startup (e.g. reloaded after an eviction) stay
+// in COPY_DEST until the next Record(), so the app records pending uploads every frame.
+// Compressed textures decode on the executor given to the constructor, if any.
+//***************************************************************************************
+
+#ifndef TEXTUREUPLOADBATCH_H
+#define TEXTUREUPLOADBATCH_H
+
+#include "TextureCache.h"
+#include "TextureContainer.h"
+#include "TextureUploadQueue.h"
+
+class TextureUploadBatch : public TextureCache::Allocator, private TextureUploadQueue::Backend
+{
+public:
+	typedef TextureUploadQueue::Stats Stats;
+
+	explicit TextureUploadBatch(ID3D12Device* device,
+		TextureContainer::Executor decodeExecutor = TextureContainer::Executor());
+	TextureUploadBatch(const TextureUploadBatch& rhs) = delete;
+	TextureUploadBatch& operator=(const TextureUploadBatch& rhs) = delete;
+	~TextureUploadBatch() = default;
+
+	// Creates the texture resource and queues its data; nothing is recorded yet.
+	virtual HRESULT Create(Texture& tex, UINT64& residentBytes)override;
+
+	// Allocates one upload buffer for everything queued since the last Record and
+	// records the copies and the transitions to PIXEL_SHADER_RESOURCE.  'fence' is the
+	// value that will be signaled after 'cmdList' has executed.
+	void Record(ID3D12GraphicsCommandList* cmdList, UINT64 fence);
+
+	// Frees upload buffers whose copies have completed.
+	void Update(UINT64 completedFence) { mQueue.Update(completedFence); }
+
+	bool HasPending()const { return mQueue.HasPending(); }
+
+	const Stats& GetStats()const { return mQueue.GetStats(); }
+
+private:
+	virtual std::uint64_t UploadSize(std::uint64_t texture)override;
+	virtual std::uint64_t CreateUploadBuffer(std::uint64_t bytes)override;
+	virtual void DestroyUploadBuffer(std::uint64_t buffer)override;
+	virtual void RecordCopy(std::uint64_t texture, std::uint64_t buffer, std::uint64_t offset)override;
+	virtual void RecordTransitions(const std::vector<std::uint64_t>& textures)override;
+
+private:
+	struct PendingTexture
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		std::unique_ptr<uint8_t[]> FileData;
+		std::vector<D3D12_SUBRESOURCE_DATA> Subresources;
+	};
+
+	ID3D12Device* mDevice = nullptr;
+	TextureContainer::Executor mDecodeExecutor;
+
+	// Only set during Record().
+	ID3D12GraphicsCommandList* mCmdList = nullptr;
+
+	std::unordered_map<std::uint64_t, PendingTexture> mPending;
+	std::unordered_map<std::uint64_t, Microsoft::WRL::ComPtr<ID3D12Resource>> mBuffers;
+	std::uint64_t mNextId = 1;
+
+	// Declared last so its destructor can still reach the buffers.
+	TextureUploadQueue mQueue;
+};
+
+#endif // TEXTUREUPLOADBATCH_H
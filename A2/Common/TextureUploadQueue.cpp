@@ -0,0 +1,68 @@
+//***************************************************************************************
+// TextureUploadQueue.cpp
+//***************************************************************************************
+
+#include "TextureUploadQueue.h"
+
+#include <algorithm>
+#include <cassert>
+
+TextureUploadQueue::TextureUploadQueue(Backend* backend)
+	: mBackend(backend)
+{
+	assert(mBackend != nullptr);
+}
+
+TextureUploadQueue::~TextureUploadQueue()
+{
+	for (auto& u : mInFlight)
+		mBackend->DestroyUploadBuffer(u.Buffer);
+}
+
+void TextureUploadQueue::Record(std::uint64_t fence)
+{
+	if (mPending.empty())
+		return;
+
+	// Lay every texture out back to back.
+	std::vector<std::uint64_t> offsets;
+	offsets.reserve(mPending.size());
+
+	std::uint64_t totalBytes = 0;
+	for (std::uint64_t texture : mPending)
+	{
+		totalBytes = (totalBytes + Alignment - 1) & ~(Alignment - 1);
+		offsets.push_back(totalBytes);
+		totalBytes += mBackend->UploadSize(texture);
+	}
+
+	InFlightUpload upload;
+	upload.Buffer = mBackend->CreateUploadBuffer(totalBytes);
+	upload.Fence = fence;
+	mInFlight.push_back(upload);
+
+	for (std::size_t i = 0; i < mPending.size(); ++i)
+		mBackend->RecordCopy(mPending[i], upload.Buffer, offsets[i]);
+
+	mBackend->RecordTransitions(mPending);
+
+	mStats.TexturesUploaded += mPending.size();
+	mStats.UploadBytes += totalBytes;
+	mStats.UploadAllocations++;
+
+	mPending.clear();
+}
+
+void TextureUploadQueue::Update(std::uint64_t completedFence)
+{
+	auto last = std::remove_if(mInFlight.begin(), mInFlight.end(),
+		[&](const InFlightUpload& u)
+		{
+			if (u.Fence > completedFence)
+				return false;
+
+			mBackend->DestroyUploadBuffer(u.Buffer);
+			return true;
+		});
+	mInFlight.erase(last, mInFlight.end());
+}
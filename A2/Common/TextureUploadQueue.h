@@ -0,0 +1,90 @@
+//***************************************************************************************
+// TextureUploadQueue.h
+//
+// The batching behind TextureUploadBatch: textures queued since the last Record() are
+// laid out back to back in one upload buffer (each copy source 512 byte aligned, as
+// D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT requires), their copies and transitions are
+// recorded in one go, and the buffer is destroyed once its fence completes.
+//
+// Everything that touches the device or a command list goes through a Backend, with
+// textures and buffers named by opaque ids, so the layout and lifetime logic can be
+// checked against a recording stand-in on any platform.
+// Only depends on the C++ standard library.
+//***************************************************************************************
+
+#ifndef TEXTUREUPLOADQUEUE_H
+#define TEXTUREUPLOADQUEUE_H
+
+#include <cstdint>
+#include <vector>
+
+class TextureUploadQueue
+{
+public:
+	class Backend
+	{
+	public:
+		virtual ~Backend() = default;
+
+		// Upload memory the texture's subresources need (GetRequiredIntermediateSize).
+		virtual std::uint64_t UploadSize(std::uint64_t texture) = 0;
+
+		// Creates an upload buffer and returns its id.  May throw.
+		virtual std::uint64_t CreateUploadBuffer(std::uint64_t bytes) = 0;
+		virtual void DestroyUploadBuffer(std::uint64_t buffer) = 0;
+
+		// Records the copy of every subresource of 'texture' from 'buffer' at 'offset'.
+		virtual void RecordCopy(std::uint64_t texture, std::uint64_t buffer, std::uint64_t offset) = 0;
+
+		// Records the transitions of the copied textures to shader resources.  The
+		// queue is done with them afterwards.
+		virtual void RecordTransitions(const std::vector<std::uint64_t>& textures) = 0;
+	};
+
+	struct Stats
+	{
+		std::uint64_t TexturesUploaded = 0;
+		std::uint64_t UploadBytes = 0;
+		std::uint64_t UploadAllocations = 0;
+	};
+
+	static const std::uint64_t Alignment = 512;
+
+	explicit TextureUploadQueue(Backend* backend);
+	TextureUploadQueue(const TextureUploadQueue& rhs) = delete;
+	TextureUploadQueue& operator=(const TextureUploadQueue& rhs) = delete;
+
+	// Destroys the buffers still in flight; the owner must have flushed the GPU.
+	~TextureUploadQueue();
+
+	void Add(std::uint64_t texture) { mPending.push_back(texture); }
+
+	// Allocates one upload buffer for everything added since the last Record and records
+	// the copies and transitions.  'fence' is the value that will be signaled after the
+	// commands have executed.
+	void Record(std::uint64_t fence);
+
+	// Destroys upload buffers whose copies have completed.
+	void Update(std::uint64_t completedFence);
+
+	bool HasPending()const { return !mPending.empty(); }
+	std::size_t InFlightCount()const { return mInFlight.size(); }
+
+	const Stats& GetStats()const { return mStats; }
+
+private:
+	struct InFlightUpload
+	{
+		std::uint64_t Buffer = 0;
+		std::uint64_t Fence = 0;
+	};
+
+	Backend* mBackend = nullptr;
+
+	std::vector<std::uint64_t> mPending;
+	std::vector<InFlightUpload> mInFlight;
+
+	Stats mStats;
+};
+
+#endif // TEXTUREUPLOADQUEUE_H
@@ -0,0 +1,303 @@
+//***************************************************************************************
+// TlsfAllocator.cpp
+//***************************************************************************************
+
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Index of the highest and lowest set bit; 'v' must not be 0.
+static std::uint32_t HighBit(std::uint64_t v)
+{
+#if defined(_MSC_VER)
+	unsigned long i;
+	_BitScanReverse64(&i, v);
+	return (std::uint32_t)i;
+#else
+	return 63u - (std::uint32_t)__builtin_clzll(v);
+#endif
+}
+
+static std::uint32_t LowBit(std::uint64_t v)
+{
+#if defined(_MSC_VER)
+	unsigned long i;
+	_BitScanForward64(&i, v);
+	return (std::uint32_t)i;
+#else
+	return (std::uint32_t)__builtin_ctzll(v);
+#endif
+}
+
+TlsfAllocator::TlsfAllocator(std::uint64_t size, std::uint64_t granularity)
+	: mGranularity(granularity)
+{
+	assert(granularity != 0 && (granularity & (granularity - 1)) == 0);
+
+	for (auto& fl : mFreeHeads)
+	{
+		for (auto& head : fl)
+			head = NoBlock;
+	}
+
+	mStats.Size = size & ~(granularity - 1);
+	if (mStats.Size == 0)
+		return;
+
+	std::uint32_t b = NewBlock();
+	mBlocks[b].Size = mStats.Size;
+	InsertFree(b);
+}
+
+void TlsfAllocator::Mapping(std::uint64_t units, std::uint32_t& fl, std::uint32_t& sl)
+{
+	// Sizes below SecondLevelCount units each get their own list in first level 0.
+	if (units < SecondLevelCount)
+	{
+		fl = 0;
+		sl = (std::uint32_t)units;
+		return;
+	}
+
+	std::uint32_t msb = HighBit(units);
+	fl = msb - SecondLevelBits + 1;
+	sl = (std::uint32_t)(units >> (msb - SecondLevelBits)) ^ SecondLevelCount;
+}
+
+std::uint32_t TlsfAllocator::NewBlock()
+{
+	if (!mUnusedBlocks.empty())
+	{
+		std::uint32_t b = mUnusedBlocks.back();
+		mUnusedBlocks.pop_back();
+		mBlocks[b] = Block();
+		return b;
+	}
+
+	mBlocks.push_back(Block());
+	return (std::uint32_t)mBlocks.size() - 1;
+}
+
+void TlsfAllocator::InsertFree(std::uint32_t b)
+{
+	Block& block = mBlocks[b];
+
+	std::uint32_t fl, sl;
+	Mapping(block.Size / mGranularity, fl, sl);
+
+	std::uint32_t head = mFreeHeads[fl][sl];
+	block.Free = true;
+	block.PrevFree = NoBlock;
+	block.NextFree = head;
+	if (head != NoBlock)
+		mBlocks[head].PrevFree = b;
+
+	mFreeHeads[fl][sl] = b;
+	mFirstLevelMap |= 1ull << fl;
+	mSecondLevelMap[fl] |= 1u << sl;
+
+	mStats.FreeBlocks++;
+}
+
+void TlsfAllocator::RemoveFree(std::uint32_t b)
+{
+	Block& block = mBlocks[b];
+
+	std::uint32_t fl, sl;
+	Mapping(block.Size / mGranularity, fl, sl);
+
+	if (block.PrevFree != NoBlock)
+		mBlocks[block.PrevFree].NextFree = block.NextFree;
+	else
+		mFreeHeads[fl][sl] = block.NextFree;
+
+	if (block.NextFree != NoBlock)
+		mBlocks[block.NextFree].PrevFree = block.PrevFree;
+
+	if (mFreeHeads[fl][sl] == NoBlock)
+	{
+		mSecondLevelMap[fl] &= ~(1u << sl);
+		if (mSecondLevelMap[fl] == 0)
+			mFirstLevelMap &= ~(1ull << fl);
+	}
+
+	block.Free = false;
+	block.PrevFree = NoBlock;
+	block.NextFree = NoBlock;
+
+	mStats.FreeBlocks--;
+}
+
+std::uint32_t TlsfAllocator::FindFree(std::uint64_t size)const
+{
+	// Round up to the next size class so any block in the list found is big enough.
+	std::uint64_t units = size / mGranularity;
+	if (units >= SecondLevelCount)
+		units += (1ull << (HighBit(units) - SecondLevelBits)) - 1;
+
+	std::uint32_t fl, sl;
+	Mapping(units, fl, sl);
+	if (fl >= FirstLevelCount)
+		return NoBlock;
+
+	std::uint32_t slMap = mSecondLevelMap[fl] & (~0u << sl);
+	if (slMap == 0)
+	{
+		std::uint64_t flMap = fl + 1 < FirstLevelCount ? mFirstLevelMap & (~0ull << (fl + 1)) : 0;
+		if (flMap == 0)
+			return NoBlock;
+
+		fl = LowBit(flMap);
+		slMap = mSecondLevelMap[fl];
+	}
+
+	return mFreeHeads[fl][LowBit(slMap)];
+}
+
+std::uint32_t TlsfAllocator::FindFreeInClass(std::uint64_t size, std::uint64_t alignment)const
+{
+	std::uint32_t fl, sl;
+	Mapping((size + alignment - mGranularity) / mGranularity, fl, sl);
+
+	for (std::uint32_t b = mFreeHeads[fl][sl]; b != NoBlock; b = mBlocks[b].NextFree)
+	{
+		const Block& block = mBlocks[b];
+		if (AlignUp(block.Offset, alignment) + size <= block.Offset + block.Size)
+			return b;
+	}
+
+	return NoBlock;
+}
+
+void TlsfAllocator::Split(std::uint32_t b, std::uint64_t size)
+{
+	std::uint32_t rest = NewBlock();
+
+	Block& block = mBlocks[b];
+	Block& r = mBlocks[rest];
+	r.Offset = block.Offset + size;
+	r.Size = block.Size - size;
+	r.PrevPhysical = b;
+	r.NextPhysical = block.NextPhysical;
+	if (r.NextPhysical != NoBlock)
+		mBlocks[r.NextPhysical].PrevPhysical = rest;
+
+	block.Size = size;
+	block.NextPhysical = rest;
+
+	InsertFree(rest);
+}
+
+std::uint32_t TlsfAllocator::MergePrev(std::uint32_t b)
+{
+	std::uint32_t prev = mBlocks[b].PrevPhysical;
+	Block& p = mBlocks[prev];
+	const Block& block = mBlocks[b];
+
+	p.Size += block.Size;
+	p.NextPhysical = block.NextPhysical;
+	if (p.NextPhysical != NoBlock)
+		mBlocks[p.NextPhysical].PrevPhysical = prev;
+
+	mUnusedBlocks.push_back(b);
+	return prev;
+}
+
+std::uint64_t TlsfAllocator::Allocate(std::uint64_t size, std::uint64_t alignment)
+{
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+	size = AlignUp(std::max<std::uint64_t>(size, 1), mGranularity);
+	alignment = std::max<std::uint64_t>(alignment, mGranularity);
+
+	// Every block starts on the granularity, so this covers the worst case padding.
+	std::uint32_t b = FindFree(size + alignment - mGranularity);
+	if (b == NoBlock)
+		b = FindFreeInClass(size, alignment);
+	if (b == NoBlock)
+	{
+		mStats.Failures++;
+		return InvalidOffset;
+	}
+
+	RemoveFree(b);
+
+	// Padding in front becomes a free block of its own.  The block before is in use,
+	// since free blocks never touch, so there is nothing to merge it with.
+	std::uint64_t offset = AlignUp(mBlocks[b].Offset, alignment);
+	std::uint64_t padding = offset - mBlocks[b].Offset;
+	if (padding > 0)
+	{
+		Split(b, padding);
+		std::uint32_t front = b;
+		b = mBlocks[b].NextPhysical;
+		RemoveFree(b);
+		InsertFree(front);
+	}
+
+	if (mBlocks[b].Size > size)
+		Split(b, size);
+
+	mAllocated.emplace(offset, b);
+
+	mStats.UsedBytes += size;
+	mStats.PeakUsedBytes = std::max<std::uint64_t>(mStats.PeakUsedBytes, mStats.UsedBytes);
+	mStats.Allocations++;
+
+	return offset;
+}
+
+void TlsfAllocator::Free(std::uint64_t offset)
+{
+	auto it = mAllocated.find(offset);
+	assert(it != mAllocated.end());
+	if (it == mAllocated.end())
+		return;
+
+	std::uint32_t b = it->second;
+	mAllocated.erase(it);
+
+	mStats.UsedBytes -= mBlocks[b].Size;
+	mStats.Allocations--;
+
+	std::uint32_t next = mBlocks[b].NextPhysical;
+	if (next != NoBlock && mBlocks[next].Free)
+	{
+		RemoveFree(next);
+		MergePrev(next);
+	}
+
+	std::uint32_t prev = mBlocks[b].PrevPhysical;
+	if (prev != NoBlock && mBlocks[prev].Free)
+	{
+		RemoveFree(prev);
+		b = MergePrev(b);
+	}
+
+	InsertFree(b);
+}
+
+std::uint64_t TlsfAllocator::LargestFreeBlock()const
+{
+	if (mFirstLevelMap == 0)
+		return 0;
+
+	std::uint32_t fl = HighBit(mFirstLevelMap);
+	std::uint32_t sl = HighBit(mSecondLevelMap[fl]);
+
+	std::uint64_t largest = 0;
+	for (std::uint32_t b = mFreeHeads[fl][sl]; b != NoBlock; b = mBlocks[b].NextFree)
+		largest = std::max<std::uint64_t>(largest, mBlocks[b].Size);
+
+	return largest;
+}
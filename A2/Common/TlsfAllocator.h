@@ -0,0 +1,115 @@
+//***************************************************************************************
+// TlsfAllocator.h
+//
+// Two level segregated fit allocator over a range of offsets, for placing resources in
+// an ID3D12Heap.  The allocator never touches the memory it manages; block headers live
+// in a side table, so it works the same over GPU heaps and in CPU benchmarks.
+//   -Free blocks sit in lists by size class: the first level is the power of two of
+//    the size, the second splits it into 16 linear steps.  Two bitmasks find the
+//    first non-empty list that is big enough with a couple of bit scans, so Allocate
+//    and Free are O(1) whatever the number of blocks.
+//   -A block is split on allocation and merged with free neighbours on Free, so two
+//    free blocks never touch.
+//   -Offsets and sizes are multiples of the granularity given to the constructor.
+//
+// Only depends on the C++ standard library.
+//***************************************************************************************
+
+#ifndef TLSFALLOCATOR_H
+#define TLSFALLOCATOR_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class TlsfAllocator
+{
+public:
+	static const std::uint64_t InvalidOffset = UINT64_MAX;
+
+	struct Stats
+	{
+		std::uint64_t Size = 0;
+		std::uint64_t UsedBytes = 0;
+		std::uint64_t PeakUsedBytes = 0;
+		std::uint32_t Allocations = 0;
+		std::uint32_t FreeBlocks = 0;
+
+		// Requests that found no block big enough.
+		std::uint32_t Failures = 0;
+	};
+
+	// 'granularity' must be a power of two.
+	TlsfAllocator(std::uint64_t size, std::uint64_t granularity);
+	TlsfAllocator(const TlsfAllocator& rhs) = delete;
+	TlsfAllocator& operator=(const TlsfAllocator& rhs) = delete;
+
+	// Offset of 'size' bytes aligned to 'alignment' (a power of two), or InvalidOffset.
+	std::uint64_t Allocate(std::uint64_t size, std::uint64_t alignment);
+
+	// 'offset' must come from Allocate.
+	void Free(std::uint64_t offset);
+
+	// Largest request that would currently succeed at the granularity's alignment.
+	std::uint64_t LargestFreeBlock()const;
+
+	bool Empty()const { return mStats.Allocations == 0; }
+
+	const Stats& GetStats()const { return mStats; }
+
+private:
+	static const std::uint32_t SecondLevelBits = 4;
+	static const std::uint32_t SecondLevelCount = 1u << SecondLevelBits;
+	static const std::uint32_t FirstLevelCount = 64;
+	static const std::uint32_t NoBlock = UINT32_MAX;
+
+	struct Block
+	{
+		std::uint64_t Offset = 0;
+		std::uint64_t Size = 0;
+
+		// Neighbours in address order.
+		std::uint32_t PrevPhysical = NoBlock;
+		std::uint32_t NextPhysical = NoBlock;
+
+		// Neighbours in the free list of the block's size class.
+		std::uint32_t PrevFree = NoBlock;
+		std::uint32_t NextFree = NoBlock;
+
+		bool Free = false;
+	};
+
+	static void Mapping(std::uint64_t size, std::uint32_t& fl, std::uint32_t& sl);
+
+	std::uint32_t NewBlock();
+	void InsertFree(std::uint32_t b);
+	void RemoveFree(std::uint32_t b);
+	std::uint32_t FindFree(std::uint64_t size)const;
+
+	// Walks the list of the request's own size class, which FindFree skips since not
+	// every block in it is big enough.  Only used when FindFree finds nothing.
+	std::uint32_t FindFreeInClass(std::uint64_t size, std::uint64_t alignment)const;
+
+	// Splits 'size' bytes off the front of block 'b'; the rest becomes a free block.
+	void Split(std::uint32_t b, std::uint64_t size);
+
+	// Merges block 'b' into the free block before it.
+	std::uint32_t MergePrev(std::uint32_t b);
+
+private:
+	std::uint64_t mGranularity = 0;
+
+	std::vector<Block> mBlocks;
+	std::vector<std::uint32_t> mUnusedBlocks;
+
+	std::uint64_t mFirstLevelMap = 0;
+	std::uint32_t mSecondLevelMap[FirstLevelCount] = {};
+	std::uint32_t mFreeHeads[FirstLevelCount][SecondLevelCount];
+
+	// Allocated offset -> block.
+	std::unordered_map<std::uint64_t, std::uint32_t> mAllocated;
+
+	Stats mStats;
+};
+
+#endif // TLSFALLOCATOR_H
@@ -0,0 +1,357 @@
+//***************************************************************************************
+// TreeBillboardsScene.cpp
+//***************************************************************************************
+
+#include "TreeBillboardsScene.h"
+#include "FrustumCull.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "UploadCopy.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	// Position of each layer in the frame, indexed by RenderLayer.  Blended geometry goes last.
+	const UINT gLayerDrawOrder[(int)RenderLayer::Count] = { 0, 3, 1, 2 };
+
+	// Far plane the draw depths are normalized to, as in the camera's projection.
+	const float gFarZ = 1000.0f;
+
+	XMFLOAT4X4 Identity()
+	{
+		XMFLOAT4X4 m;
+		XMStoreFloat4x4(&m, XMMatrixIdentity());
+		return m;
+	}
+}
+
+static_assert(TreeBillboardsScene::ObjectsPerJob % SceneStore::UpdateGranularity == 0,
+	"Object jobs must not share SceneStore dirty words.");
+
+TreeBillboardsScene::TreeBillboardsScene(JobSystem& jobs)
+	: mJobs(jobs)
+{
+}
+
+void TreeBillboardsScene::CreateShapes(const std::function<void(const std::string&, const GeometryGenerator::MeshData&)>& add)
+{
+	GeometryGenerator geoGen;
+	add("Box", geoGen.CreateBox(1.0f, 1.0f, 1.0f, 0));
+	add("Box2", geoGen.CreateBox(1.0f, 1.0f, 1.0f, 0));
+	add("Box3", geoGen.CreateBox(1.0f, 1.0f, 1.0f, 0));
+	add("Cylinder", geoGen.CreateCylinder(1.0f, 1.0f, 1.0f, 30, 1));
+	add("Sphere", geoGen.CreateSphere(1.0f, 30, 30));
+	add("Grid", geoGen.CreateGrid(1.0f, 5.0f, 2, 2));
+	add("Grid2", geoGen.CreateGrid(1.0f, 5.0f, 2, 2));
+	add("Grid3", geoGen.CreateGrid(1.0f, 5.0f, 2, 2));
+	add("Pyramid", geoGen.CreatePyramid(1.0f, 1.0f, 1.0f, 0));
+	add("Cone2", geoGen.CreateCone(1.0f, 1.0f, 10, 2));
+	add("Wedge", geoGen.CreateWedge(1.0f, 1.0f, 1.0f, 0));
+	add("TriangularPrism", geoGen.CreateTriangularPrism(1.0f, 1.0f, 1.0f, 0));
+	add("Diamond", geoGen.CreateDiamond(1.0f));
+}
+
+TreeBillboardsScene::MeshId TreeBillboardsScene::AddMesh(const std::string& name, const Mesh& mesh)
+{
+	return mMeshes.Add(name, mesh);
+}
+
+void TreeBillboardsScene::BuildMaterials()
+{
+	struct Def
+	{
+		const char* Name;
+		const char* Texture;
+		UINT MatCBIndex;
+		float Alpha;
+		float Fresnel;
+		float Roughness;
+	};
+
+	// This is not a good water material definition, but we do not have all the rendering
+	// tools we need (transparency, environment reflection), so we fake it for now.
+	const Def defs[] =
+	{
+		{ "grass", "grassTex", 0, 1.0f, 0.01f, 0.125f },
+		{ "water", "waterTex", 4, 0.5f, 0.1f, 0.0f },
+		{ "wirefence", "fenceTex", 5, 1.0f, 0.02f, 0.25f },
+		{ "treeSprites", "treeArrayTex", 6, 1.0f, 0.01f, 0.125f },
+		{ "woodCrate", "woodCrateTex", 1, 1.0f, 0.05f, 0.2f },
+		{ "bricks", "bricksTex", 3, 1.0f, 0.05f, 0.2f },
+		{ "ice", "iceTex", 2, 1.0f, 0.05f, 0.2f },
+	};
+
+	for (const Def& d : defs)
+	{
+		auto mat = std::make_unique<Material>();
+		mat->Name = d.Name;
+		mat->DiffuseTexture = d.Texture;
+		mat->MatCBIndex = d.MatCBIndex;
+		mat->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, d.Alpha);
+		mat->FresnelR0 = XMFLOAT3(d.Fresnel, d.Fresnel, d.Fresnel);
+		mat->Roughness = d.Roughness;
+		mat->MatTransform = Identity();
+
+		mMaterialList.push_back(mat.get());
+		mMaterials.Add(d.Name, std::move(mat));
+	}
+
+	mWaterMaterial = mMaterials.Get("water");
+}
+
+void TreeBillboardsScene::BuildScene()
+{
+	//Decoration
+	BuildRenderItems("Diamond", "ice", 2.0f, 2.0f, 2.0f, 0.0f, 10.0f, 0.0f);
+	BuildRenderItems("Diamond", "ice", 2.0f, 2.0f, 2.0f, 0.0f, 10.0f, 0.0f);
+
+	//Chains for bridge
+	BuildRenderItems("Wedge", "woodCrate", 6.0f, 5.0f, 0.5f, 11.0f, 0.5f, -3.0f);
+	BuildRenderItems("Wedge", "woodCrate", 6.0f, 5.0f, 0.5f, 11.0f, 0.5f, 3.0f);
+	BuildRenderItems("Wedge", "woodCrate", 6.0f, 5.0f, 0.5f, 11.0f, 0.5f, 3.0f);
+
+	//Walls
+	BuildRenderItems("Box", "bricks", 2.0f, 6.0f, 12.0f, -8.0f, 1.0f, 0.0f);
+	BuildRenderItems("Box", "bricks", 2.0f, 6.0f, 12.0f, 8.0f, 1.0f, 0.0f);
+	BuildRenderItems("Box", "bricks", 12.0f, 6.0f, 2.0f, 0.0f, 1.0f, 8.0f);
+	BuildRenderItems("Box", "bricks", 12.0f, 6.0f, 2.0f, 0.0f, 1.0f, -8.0f);
+	BuildRenderItems("Box", "bricks", 2.0f, 6.0f, 12.0f, -8.0f, 1.0f, 0.0f);
+
+	////Towers
+	BuildRenderItems("Cylinder", "grass", 2.0f, 8.0f, 2.0f, -8.0f, 2.0f, 8.0f);
+	BuildRenderItems("Cylinder", "grass", 2.0f, 8.0f, 2.0f, 8.0f, 2.0f, 8.0f);
+	BuildRenderItems("Cylinder", "grass", 2.0f, 8.0f, 2.0f, -8.0f, 2.0f, -8.0f);
+	BuildRenderItems("Cylinder", "grass", 2.0f, 8.0f, 2.0f, 8.0f, 2.0f, -8.0f);
+
+	//Tower roofs
+	BuildRenderItems("Cone2", "woodCrate", 2.0f, 8.0f, 2.0f, -8.0f, 8.0f, 8.0f);
+	BuildRenderItems("Cone2", "woodCrate", 2.0f, 8.0f, 2.0f, 8.0f, 8.0f, 8.0f);
+	BuildRenderItems("Cone2", "woodCrate", 2.0f, 8.0f, 2.0f, -8.0f, 8.0f, -8.0f);
+	BuildRenderItems("Cone2", "woodCrate", 2.0f, 8.0f, 2.0f, 8.0f, 8.0f, -8.0f);
+
+	////Tower balls
+	BuildRenderItems("Sphere", "ice", 1.0f, 1.0f, 1.0f, -8.0f, 12.0f, 8.0f);
+	BuildRenderItems("Sphere", "ice", 1.0f, 1.0f, 1.0f, 8.0f, 12.0f, 8.0f);
+	BuildRenderItems("Sphere", "ice", 1.0f, 1.0f, 1.0f, -8.0f, 12.0f, -8.0f);
+	BuildRenderItems("Sphere", "ice", 1.0f, 1.0f, 1.0f, 8.0f, 12.0f, -8.0f);
+
+	////Gate and door
+	BuildRenderItems("Box2", "woodCrate", 6.0f, 0.5f, 6.0f, 11.0f, -2.0f, 0.0f);
+	BuildRenderItems("Box3", "woodCrate", 0.5f, 6.0f, 6.0f, 9.0f, 1.0f, 0.0f);
+
+	////Decoration on walls
+	BuildRenderItems("Pyramid", "ice", 1.0f, 1.0f, 1.0f, -8.0f, 4.0f, 0.0f);
+	BuildRenderItems("Pyramid", "ice", 1.0f, 1.0f, 1.0f, -8.0f, 4.0f, 4.0f);
+	BuildRenderItems("Pyramid", "ice", 1.0f, 1.0f, 1.0f, -8.0f, 4.0f, -4.0f);
+
+	BuildRenderItems("Pyramid", "ice", 1.0f, 1.0f, 1.0f, 0.0f, 4.0f, 8.0f);
+	BuildRenderItems("Pyramid", "ice", 1.0f, 1.0f, 1.0f, 4.0f, 4.0f, 8.0f);
+	BuildRenderItems("Pyramid", "ice", 1.0f, 1.0f, 1.0f, -4.0f, 4.0f, 8.0f);
+
+	BuildRenderItems("Pyramid", "ice", 1.0f, 1.0f, 1.0f, 4.0f, 4.0f, -8.0f);
+	BuildRenderItems("Pyramid", "ice", 1.0f, 1.0f, 1.0f, 0.0f, 4.0f, -8.0f);
+	BuildRenderItems("Pyramid", "ice", 1.0f, 1.0f, 1.0f, -4.0f, 4.0f, -8.0f);
+
+	//Moat, floor and grass
+	BuildRenderItems("Grid", "water", 25.0f, 20.0f, 5.0f, 0.0f, -2.0f, 0.0f);
+	BuildRenderItems("Grid2", "grass", 40.0f, 20.0f, 10.0f, 0.0f, -2.8f, 0.0f);
+	BuildRenderItems("Grid3", "woodCrate", 15.0f, 20.0f, 4.0f, 0.0f, -1.8f, 0.0f);
+
+	// The wave pool and the tree sprites.
+	XMFLOAT4X4 wavesWorld;
+	XMFLOAT4X4 wavesTexTransform;
+	XMStoreFloat4x4(&wavesWorld, XMMatrixTranslation(0.0f, -5.0f, 0.0f));
+	XMStoreFloat4x4(&wavesTexTransform, XMMatrixScaling(5.0f, 5.0f, 1.0f));
+	AddRenderItem(mMeshes.Get("waterGeo"), mMaterials[mWaterMaterial].get(), wavesWorld, wavesTexTransform,
+		RenderLayer::Transparent, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	//step2
+	AddRenderItem(mMeshes.Get("treeSpritesGeo"), mMaterials[mMaterials.Get("treeSprites")].get(), Identity(), Identity(),
+		RenderLayer::AlphaTestedTreeSprites, D3D_PRIMITIVE_TOPOLOGY_POINTLIST);
+
+	BuildCullBounds();
+}
+
+void TreeBillboardsScene::BuildRenderItems(const std::string& mesh, const std::string& material,
+	float sX, float sY, float sZ, float tX, float tY, float tZ)
+{
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixMultiply(XMMatrixScaling(sX, sY, sZ), XMMatrixTranslation(tX, tY, tZ)));
+
+	// Pieces with a see-through material are blended; everything else is opaque.
+	Material* mat = mMaterials[mMaterials.Get(material)].get();
+	RenderLayer layer = mat->DiffuseAlbedo.w < 1.0f ? RenderLayer::Transparent : RenderLayer::Opaque;
+
+	AddRenderItem(mMeshes.Get(mesh), mat, world, Identity(), layer, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+void TreeBillboardsScene::AddRenderItem(MeshId mesh, Material* mat, const XMFLOAT4X4& world,
+	const XMFLOAT4X4& texTransform, RenderLayer layer, D3D12_PRIMITIVE_TOPOLOGY topology)
+{
+	auto ri = std::make_unique<RenderItem>();
+	ri->Transform = mStore.Create(world, texTransform);
+	ri->Mat = mat;
+	ri->MeshId = mesh;
+	ri->PrimitiveType = topology;
+	ri->Layer = layer;
+	mAllRitems.push_back(std::move(ri));
+}
+
+void TreeBillboardsScene::BuildCullBounds()
+{
+	std::vector<Bvh::Aabb> bounds(mAllRitems.size());
+
+	for (size_t i = 0; i < mAllRitems.size(); ++i)
+	{
+		const RenderItem* ri = mAllRitems[i].get();
+		const Mesh& mesh = mMeshes[ri->MeshId];
+		const XMFLOAT4X4& w = mStore.World(ri->Transform);
+		const float c[3] = { mesh.Center.x, mesh.Center.y, mesh.Center.z };
+		const float e[3] = { mesh.Extents.x, mesh.Extents.y, mesh.Extents.z };
+
+		// Box of the transformed box, as BoundingBox::Transform gives for an affine world.
+		float center[3];
+		float extents[3];
+		for (int j = 0; j < 3; ++j)
+		{
+			center[j] = w.m[3][j];
+			extents[j] = 0.0f;
+			for (int k = 0; k < 3; ++k)
+			{
+				center[j] += c[k] * w.m[k][j];
+				extents[j] += std::fabs(e[k] * w.m[k][j]);
+			}
+		}
+
+		bounds[i] = Bvh::Aabb::FromCenterExtents(XMFLOAT3(center[0], center[1], center[2]),
+			XMFLOAT3(extents[0], extents[1], extents[2]));
+	}
+
+	mSceneBvh.Build(bounds, &mJobs);
+}
+
+void TreeBillboardsScene::SetLayerPsos(RenderLayer layer, ID3D12PipelineState* pso, ID3D12PipelineState* instancedPso)
+{
+	mLayerPSOs[(int)layer] = pso;
+	mLayerInstancedPSOs[(int)layer] = instancedPso;
+}
+
+void TreeBillboardsScene::AnimateMaterials(float dt)
+{
+	// Scroll the water material texture coordinates.
+	XMFLOAT4X4& m = mMaterials[mWaterMaterial]->MatTransform;
+
+	m.m[3][0] += 0.1f * dt;
+	m.m[3][1] += 0.02f * dt;
+
+	if (m.m[3][0] >= 1.0f)
+		m.m[3][0] -= 1.0f;
+
+	if (m.m[3][1] >= 1.0f)
+		m.m[3][1] -= 1.0f;
+}
+
+void TreeBillboardsScene::CullRenderItems(const XMFLOAT4X4& view, const XMFLOAT4X4& proj)
+{
+	XMMATRIX viewProj = XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&proj));
+	FrustumCull::Frustum frustum = FrustumCull::Frustum::FromViewProj(viewProj);
+
+	mSceneBvh.Cull(frustum, mVisibleIndices);
+
+	mVisibleRitems.clear();
+	for (std::uint32_t i : mVisibleIndices)
+		mVisibleRitems.push_back(mAllRitems[i].get());
+}
+
+void TreeBillboardsScene::AllVisible()
+{
+	mVisibleRitems.clear();
+	for (auto& ri : mAllRitems)
+		mVisibleRitems.push_back(ri.get());
+}
+
+void TreeBillboardsScene::UpdateObjectConstants(std::uint8_t* dst, std::uint32_t dstStride)
+{
+	PROFILE_SCOPE("UpdateObjectCBs");
+
+	// Only items whose transforms changed are transposed again.  The destination may be
+	// fresh memory every frame, so the packed constants of every item are streamed into
+	// it.  Each job owns one chunk of the items and the matching region of 'dst'.
+	mJobs.ParallelFor(mStore.Size(), ObjectsPerJob, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		mStore.UpdateConstants(begin, end);
+
+		UploadCopy::Stream(dst + (std::uint64_t)begin * dstStride, dstStride, mStore.Constants() + begin,
+			SceneStore::ConstantsStride, SceneStore::ConstantsStride, end - begin);
+
+		// Streaming stores are only ordered on the thread that issued them.
+		UploadCopy::Fence();
+	});
+}
+
+void TreeBillboardsScene::UpdateMaterialConstants(std::uint8_t* dst, std::uint32_t dstStride)
+{
+	assert(dstStride >= sizeof(MaterialData));
+
+	mJobs.ParallelFor((std::uint32_t)mMaterialList.size(), MaterialsPerJob, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t i = begin; i < end; ++i)
+		{
+			const Material* mat = mMaterialList[i];
+
+			MaterialData data = {};
+			data.DiffuseAlbedo = mat->DiffuseAlbedo;
+			data.FresnelR0 = mat->FresnelR0;
+			data.Roughness = mat->Roughness;
+			XMStoreFloat4x4(&data.MatTransform, XMMatrixTranspose(XMLoadFloat4x4(&mat->MatTransform)));
+			data.DiffuseMapIndex = mat->DiffuseSrvHeapIndex;
+
+			std::memcpy(dst + (std::uint64_t)mat->MatCBIndex * dstStride, &data, sizeof(data));
+		}
+	});
+}
+
+void TreeBillboardsScene::BuildDrawQueue(const XMFLOAT4X4& view)
+{
+	mDrawQueue.Clear();
+
+	// Only the items that survived CullRenderItems; the sort puts the layers in order.
+	for (const RenderItem* ri : mVisibleRitems)
+	{
+		// View space depth of the item's origin, normalized to the far plane.
+		const XMFLOAT4X4& world = mStore.World(ri->Transform);
+		float z = world.m[3][0] * view.m[0][2] + world.m[3][1] * view.m[1][2] +
+			world.m[3][2] * view.m[2][2] + view.m[3][2];
+		float depth = z / gFarZ;
+
+		UINT layer = (UINT)ri->Layer;
+		UINT order = gLayerDrawOrder[layer];
+		UINT material = ri->Mat->MatCBIndex;
+		UINT geometry = ri->MeshId;
+		const Mesh& mesh = mMeshes[ri->MeshId];
+
+		DrawPacket p;
+		p.SortKey = ri->Layer == RenderLayer::Transparent ?
+			DrawSortKey::BackToFront(order, layer, material, geometry, depth) :
+			DrawSortKey::Opaque(order, layer, material, geometry, depth);
+		p.Pso = mLayerPSOs[layer];
+		p.InstancedPso = mLayerInstancedPSOs[layer];
+		p.Geo = mesh.Geo;
+		p.PrimitiveType = ri->PrimitiveType;
+		p.TextureIndex = mBindlessTextures ? 0 : ri->Mat->DiffuseSrvHeapIndex;
+		p.MaterialCBIndex = material;
+		p.ObjectCBIndex = mStore.DenseIndex(ri->Transform);
+		p.IndexCount = mesh.IndexCount;
+		p.StartIndexLocation = mesh.StartIndexLocation;
+		p.BaseVertexLocation = mesh.BaseVertexLocation;
+
+		mDrawQueue.Add(p);
+	}
+
+	mDrawQueue.Sort();
+}
@@ -0,0 +1,206 @@
+//***************************************************************************************
+// TreeBillboardsScene.h
+//
+// The tree billboards app's scene without a device: the castle, the wave pool and the
+// tree sprites as render items, their materials, and the CPU work done on them every
+// frame.  TreeBillboardsApp draws it, Tools/HeadlessSim runs it headless.
+//   -The caller registers the meshes (AddMesh) with their submesh, local bounds and
+//    the MeshGeometry the draw packets bind; the scene never looks inside it.
+//    CreateShapes() hands out the castle's shapes for the caller to turn into meshes.
+//   -BuildMaterials() then BuildScene() create the materials and the render items.
+//    Each material names its diffuse texture; the caller sets DiffuseSrvHeapIndex.
+//   -Per frame: AnimateMaterials(), CullRenderItems() against the camera,
+//    UpdateObjectConstants() and UpdateMaterialConstants() into memory the caller
+//    provides (a constant buffer allocation on a device), and BuildDrawQueue() to sort
+//    the visible items into Queue().
+//
+// AddMesh and BuildMaterials touch separate state, so the geometry and material
+// startup stages can run them concurrently.
+// Needs DirectXMath and the D3D12 type declarations through DrawQueue.h but no device,
+// so it also builds on Linux against the DirectX-Headers project (see Tools/HeadlessSim).
+//***************************************************************************************
+
+#ifndef TREEBILLBOARDSSCENE_H
+#define TREEBILLBOARDSSCENE_H
+
+#include "Bvh.h"
+#include "DrawQueue.h"
+#include "GeometryGenerator.h"
+#include "NameRegistry.h"
+#include "SceneStore.h"
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+enum class RenderLayer : int
+{
+	Opaque = 0,
+	Transparent,
+	AlphaTested,
+	AlphaTestedTreeSprites,
+	Count
+};
+
+class TreeBillboardsScene
+{
+public:
+	struct Material
+	{
+		std::string Name;
+
+		// Name of the diffuse texture, and the SRV heap slot the caller gave it.
+		std::string DiffuseTexture;
+		UINT DiffuseSrvHeapIndex = 0;
+
+		// Slot in the frame's material constants.
+		UINT MatCBIndex = 0;
+
+		DirectX::XMFLOAT4 DiffuseAlbedo = { 1.0f, 1.0f, 1.0f, 1.0f };
+		DirectX::XMFLOAT3 FresnelR0 = { 0.01f, 0.01f, 0.01f };
+		float Roughness = 0.25f;
+		DirectX::XMFLOAT4X4 MatTransform;
+	};
+
+	// Layout of the shaders' cbMaterial (MaterialConstants in d3dUtil.h).
+	struct MaterialData
+	{
+		DirectX::XMFLOAT4 DiffuseAlbedo;
+		DirectX::XMFLOAT3 FresnelR0;
+		float Roughness;
+		DirectX::XMFLOAT4X4 MatTransform;
+		UINT DiffuseMapIndex;
+		UINT Pad[3];
+	};
+
+	// A submesh of one of the caller's geometries.
+	struct Mesh
+	{
+		MeshGeometry* Geo = nullptr;
+
+		UINT IndexCount = 0;
+		UINT StartIndexLocation = 0;
+		int BaseVertexLocation = 0;
+
+		// Bounds in local space.
+		DirectX::XMFLOAT3 Center = { 0.0f, 0.0f, 0.0f };
+		DirectX::XMFLOAT3 Extents = { 0.0f, 0.0f, 0.0f };
+	};
+
+	typedef NameRegistry<Mesh>::Id MeshId;
+	typedef NameRegistry<std::unique_ptr<Material>>::Id MaterialId;
+
+	struct RenderItem
+	{
+		// World and texture transform, kept in Store().  The handle's dense index is also
+		// the item's slot in the frame's object constants.
+		SceneStore::Handle Transform;
+
+		Material* Mat = nullptr;
+
+		// Id of the item's Mesh, used as the geometry field of the draw sort keys.
+		// Meshes packed into one geometry get consecutive ids, so sorting by mesh keeps
+		// their shared buffers bound.  The mesh is looked up by id when it is used, since
+		// meshes added later move the registry's storage.
+		UINT MeshId = 0;
+
+		D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+
+		// Layer, and so PSO, the item is drawn with.
+		RenderLayer Layer = RenderLayer::Opaque;
+	};
+
+	// Items per job of the constant updates.  Object jobs start on multiples of
+	// SceneStore::UpdateGranularity so they never share dirty words.
+	static const UINT ObjectsPerJob = 1024;
+	static const UINT MaterialsPerJob = 256;
+
+	explicit TreeBillboardsScene(JobSystem& jobs);
+	TreeBillboardsScene(const TreeBillboardsScene& rhs) = delete;
+	TreeBillboardsScene& operator=(const TreeBillboardsScene& rhs) = delete;
+
+	// The shapes BuildScene places, by mesh name.
+	static void CreateShapes(const std::function<void(const std::string&, const GeometryGenerator::MeshData&)>& add);
+
+	MeshId AddMesh(const std::string& name, const Mesh& mesh);
+
+	void BuildMaterials();
+
+	// Needs every mesh of CreateShapes, "waterGeo" and "treeSpritesGeo", and the materials.
+	void BuildScene();
+
+	// PSO of each layer, and its instanced variant or null if the layer's items are never
+	// merged.  With bindless textures every draw uses the same texture table, so texture
+	// changes never break up a batch.
+	void SetLayerPsos(RenderLayer layer, ID3D12PipelineState* pso, ID3D12PipelineState* instancedPso);
+	void SetBindlessTextures(bool bindless) { mBindlessTextures = bindless; }
+
+	// Scrolls the water material's texture coordinates.
+	void AnimateMaterials(float dt);
+
+	// Keeps the items inside the view frustum; AllVisible() keeps every item.
+	void CullRenderItems(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& proj);
+	void AllVisible();
+
+	// Write Store().Size() ObjectData and one MaterialData per material (at its
+	// MatCBIndex) 'dstStride' bytes apart, on the scene's JobSystem.
+	void UpdateObjectConstants(std::uint8_t* dst, std::uint32_t dstStride);
+	void UpdateMaterialConstants(std::uint8_t* dst, std::uint32_t dstStride);
+
+	// Sorts the visible items into Queue(); depth is measured in 'view'.
+	void BuildDrawQueue(const DirectX::XMFLOAT4X4& view);
+
+	DrawQueue& Queue() { return mDrawQueue; }
+	const SceneStore& Store()const { return mStore; }
+
+	NameRegistry<std::unique_ptr<Material>>& Materials() { return mMaterials; }
+	std::uint32_t MaterialCount()const { return mMaterials.Size(); }
+
+	std::uint32_t ItemCount()const { return (std::uint32_t)mAllRitems.size(); }
+	std::uint32_t VisibleCount()const { return (std::uint32_t)mVisibleRitems.size(); }
+
+private:
+	void BuildRenderItems(const std::string& mesh, const std::string& material,
+		float sX, float sY, float sZ, float tX, float tY, float tZ);
+	void AddRenderItem(MeshId mesh, Material* mat, const DirectX::XMFLOAT4X4& world,
+		const DirectX::XMFLOAT4X4& texTransform, RenderLayer layer, D3D12_PRIMITIVE_TOPOLOGY topology);
+	void BuildCullBounds();
+
+private:
+	JobSystem& mJobs;
+
+	// Looked up by name while the scene is built, by id after.
+	NameRegistry<Mesh> mMeshes;
+	NameRegistry<std::unique_ptr<Material>> mMaterials;
+	MaterialId mWaterMaterial = NameRegistry<std::unique_ptr<Material>>::InvalidId;
+
+	// mMaterials in a flat array for splitting the material update into jobs.
+	std::vector<Material*> mMaterialList;
+
+	std::vector<std::unique_ptr<RenderItem>> mAllRitems;
+
+	// Transforms of every render item, packed for the per-frame constant update.
+	SceneStore mStore;
+
+	// Hierarchy over the world space bounds of mAllRitems; item i of the tree is
+	// mAllRitems[i].  The castle does not move after it is built, so it is built once.
+	Bvh mSceneBvh;
+
+	// Items inside the view frustum this frame.
+	std::vector<std::uint32_t> mVisibleIndices;
+	std::vector<RenderItem*> mVisibleRitems;
+
+	ID3D12PipelineState* mLayerPSOs[(int)RenderLayer::Count] = {};
+	ID3D12PipelineState* mLayerInstancedPSOs[(int)RenderLayer::Count] = {};
+	bool mBindlessTextures = false;
+
+	// This frame's draws, sorted by layer, state and depth.
+	DrawQueue mDrawQueue;
+};
+
+#endif // TREEBILLBOARDSSCENE_H
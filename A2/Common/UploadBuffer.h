@@ -1,13 +1,14 @@
 #pragma once
 
 #include "d3dUtil.h"
+#include "UploadCopy.h"
 
 template<typename T>
 class UploadBuffer
 {
 public:
     UploadBuffer(ID3D12Device* device, UINT elementCount, bool isConstantBuffer) : 
-        mIsConstantBuffer(isConstantBuffer)
+        mElementCount(elementCount), mIsConstantBuffer(isConstantBuffer)
     {
         mElementByteSize = sizeof(T);
 
@@ -57,10 +58,43 @@ public:
         memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
     }
 
+    // Writes 'count' consecutive elements starting at 'firstElement' in one call.
+    void CopyRange(int firstElement, const T* data, UINT count)
+    {
+        assert(firstElement >= 0 && (UINT64)firstElement + count <= mElementCount);
+        UploadCopy::Strided(&mMappedData[firstElement*mElementByteSize], mElementByteSize,
+            data, sizeof(T), sizeof(T), count);
+    }
+
+    void CopyRange(int firstElement, const std::vector<T>& data)
+    {
+        CopyRange(firstElement, data.data(), (UINT)data.size());
+    }
+
+    // Same as CopyRange but with non-temporal stores, for large writes the CPU will not
+    // touch again.  The stores are fenced before returning.
+    void StreamRange(int firstElement, const T* data, UINT count)
+    {
+        assert(firstElement >= 0 && (UINT64)firstElement + count <= mElementCount);
+        UploadCopy::Stream(&mMappedData[firstElement*mElementByteSize], mElementByteSize,
+            data, sizeof(T), sizeof(T), count);
+        UploadCopy::Fence();
+    }
+
+    // Direct pointer to an element in the mapped memory, for building data in place.
+    // The memory is write combined: write every field once, in order, and never read it.
+    // Only valid for buffers without constant buffer padding.
+    T* Element(int elementIndex)
+    {
+        assert(!mIsConstantBuffer || mElementByteSize == sizeof(T));
+        return reinterpret_cast<T*>(&mMappedData[elementIndex*mElementByteSize]);
+    }
+
 private:
     Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
     BYTE* mMappedData = nullptr;
 
     UINT mElementByteSize = 0;
+    UINT mElementCount = 0;
     bool mIsConstantBuffer = false;
 };
\ No newline at end of file
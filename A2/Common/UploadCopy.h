@@ -0,0 +1,110 @@
+//***************************************************************************************
+// UploadCopy.h
+//
+// Copy routines for filling mapped upload heap memory.  Upload heaps are write
+// combined on most hardware: the CPU should write them in order, in whole cache
+// lines, and never read them back.
+//   -Strided() packs 'count' elements into a destination with a different stride
+//    (constant buffers pad every element to 256 bytes) with one memcpy when the
+//    strides match.
+//   -Stream() does the same with SSE2 non-temporal stores, which bypass the cache
+//    so large writes do not evict the data the CPU is still working on.
+//
+// Only depends on the C++ standard library and SSE2 intrinsics so it can be
+// benchmarked outside of the D3D12 projects (see Tools/UploadBench).
+//***************************************************************************************
+
+#ifndef UPLOADCOPY_H
+#define UPLOADCOPY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace UploadCopy
+{
+	inline void Strided(void* dst, std::size_t dstStride, const void* src, std::size_t srcStride,
+		std::size_t elementSize, std::size_t count)
+	{
+		auto d = static_cast<std::uint8_t*>(dst);
+		auto s = static_cast<const std::uint8_t*>(src);
+
+		if (dstStride == elementSize && srcStride == elementSize)
+		{
+			std::memcpy(d, s, elementSize * count);
+			return;
+		}
+
+		for (std::size_t i = 0; i < count; ++i)
+			std::memcpy(d + i * dstStride, s + i * srcStride, elementSize);
+	}
+
+	// Non-temporal copy of 'size' bytes.  Falls back to memcpy for whatever cannot be
+	// written in aligned 16 byte pieces.  Call Fence() before the GPU may read the data.
+	inline void StreamBytes(void* dst, const void* src, std::size_t size)
+	{
+		auto d = static_cast<std::uint8_t*>(dst);
+		auto s = static_cast<const std::uint8_t*>(src);
+
+		std::size_t head = (16 - (reinterpret_cast<std::uintptr_t>(d) & 15)) & 15;
+		if (head > size)
+			head = size;
+
+		std::memcpy(d, s, head);
+		d += head;
+		s += head;
+		size -= head;
+
+		std::size_t blocks = size / 64;
+		for (std::size_t i = 0; i < blocks; ++i)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+			__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+			__m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48));
+			_mm_stream_si128(reinterpret_cast<__m128i*>(d), a);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(d + 16), b);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(d + 32), c);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(d + 48), e);
+			d += 64;
+			s += 64;
+		}
+		size -= blocks * 64;
+
+		while (size >= 16)
+		{
+			_mm_stream_si128(reinterpret_cast<__m128i*>(d),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(s)));
+			d += 16;
+			s += 16;
+			size -= 16;
+		}
+
+		std::memcpy(d, s, size);
+	}
+
+	inline void Stream(void* dst, std::size_t dstStride, const void* src, std::size_t srcStride,
+		std::size_t elementSize, std::size_t count)
+	{
+		auto d = static_cast<std::uint8_t*>(dst);
+		auto s = static_cast<const std::uint8_t*>(src);
+
+		if (dstStride == elementSize && srcStride == elementSize)
+		{
+			StreamBytes(d, s, elementSize * count);
+			return;
+		}
+
+		for (std::size_t i = 0; i < count; ++i)
+			StreamBytes(d + i * dstStride, s + i * srcStride, elementSize);
+	}
+
+	// Orders the streaming stores before any later store, e.g. the fence signal.
+	inline void Fence()
+	{
+		_mm_sfence();
+	}
+}
+
+#endif // UPLOADCOPY_H
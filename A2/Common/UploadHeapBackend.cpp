@@ -0,0 +1,64 @@
+//***************************************************************************************
+// UploadHeapBackend.cpp
+//***************************************************************************************
+
+#include "UploadHeapBackend.h"
+
+using Microsoft::WRL::ComPtr;
+
+static_assert(UploadRingBuffer::ConstantAlignment == D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT,
+	"Root CBVs must be D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT aligned.");
+static_assert(UploadRingBuffer::BufferAlignment == D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+	"Ring buffers are sized in multiples of the default placement alignment.");
+
+UploadHeapBackend::UploadHeapBackend(ID3D12Device* device)
+	: mDevice(device)
+{
+}
+
+UploadHeapBackend::~UploadHeapBackend()
+{
+	for (auto& e : mBuffers)
+		e.second->Unmap(0, nullptr);
+}
+
+BYTE* UploadHeapBackend::CreateBuffer(UINT64 byteSize, D3D12_GPU_VIRTUAL_ADDRESS& gpuAddress)
+{
+	ComPtr<ID3D12Resource> buffer;
+
+	auto upload = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	auto desc = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
+	ThrowIfFailed(mDevice->CreateCommittedResource(
+		&upload,
+		D3D12_HEAP_FLAG_NONE,
+		&desc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&buffer)));
+
+	// Mapped until the buffer is destroyed; the ring's fences keep the CPU from
+	// overwriting data the GPU has not consumed yet.
+	BYTE* mappedData = nullptr;
+	ThrowIfFailed(buffer->Map(0, nullptr, reinterpret_cast<void**>(&mappedData)));
+
+	gpuAddress = buffer->GetGPUVirtualAddress();
+	mBuffers[mappedData] = buffer;
+
+	return mappedData;
+}
+
+void UploadHeapBackend::DestroyBuffer(BYTE* cpuAddress)
+{
+	auto it = mBuffers.find(cpuAddress);
+	if (it == mBuffers.end())
+		return;
+
+	it->second->Unmap(0, nullptr);
+	mBuffers.erase(it);
+}
+
+ID3D12Resource* UploadHeapBackend::GetResource(BYTE* cpuAddress)
+{
+	auto it = mBuffers.find(cpuAddress);
+	return it != mBuffers.end() ? it->second.Get() : nullptr;
+}
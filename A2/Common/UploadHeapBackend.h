@@ -0,0 +1,29 @@
+//***************************************************************************************
+// UploadHeapBackend.h
+//
+// UploadRingBuffer backend that allocates upload heap buffers on a D3D12 device and
+// keeps them mapped for their whole lifetime.
+//***************************************************************************************
+
+#ifndef UPLOADHEAPBACKEND_H
+#define UPLOADHEAPBACKEND_H
+
+#include "d3dUtil.h"
+#include "UploadRingBuffer.h"
+
+class UploadHeapBackend : public UploadRingBuffer::Backend
+{
+public:
+	explicit UploadHeapBackend(ID3D12Device* device);
+	~UploadHeapBackend();
+
+	virtual BYTE* CreateBuffer(UINT64 byteSize, D3D12_GPU_VIRTUAL_ADDRESS& gpuAddress)override;
+	virtual void DestroyBuffer(BYTE* cpuAddress)override;
+	virtual ID3D12Resource* GetResource(BYTE* cpuAddress)override;
+
+private:
+	ID3D12Device* mDevice = nullptr;
+	std::unordered_map<BYTE*, Microsoft::WRL::ComPtr<ID3D12Resource>> mBuffers;
+};
+
+#endif // UPLOADHEAPBACKEND_H
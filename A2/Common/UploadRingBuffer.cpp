@@ -0,0 +1,160 @@
+//***************************************************************************************
+// UploadRingBuffer.cpp
+//***************************************************************************************
+
+#include "UploadRingBuffer.h"
+
+#include <algorithm>
+
+static std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+UploadRingBuffer::UploadRingBuffer(Backend* backend, std::uint64_t capacity)
+	: mBackend(backend)
+{
+	mBuffer.Capacity = AlignUp(std::max<std::uint64_t>(capacity, 1), BufferAlignment);
+	mBuffer.CpuAddress = mBackend->CreateBuffer(mBuffer.Capacity, mBuffer.GpuAddress);
+	mBuffer.Resource = mBackend->GetResource(mBuffer.CpuAddress);
+
+	mStats.Capacity = mBuffer.Capacity;
+}
+
+UploadRingBuffer::~UploadRingBuffer()
+{
+	// The owner flushes the GPU before tearing the ring down.
+	for (auto& r : mRetiredBuffers)
+		mBackend->DestroyBuffer(r.Buf.CpuAddress);
+
+	if (mBuffer.CpuAddress != nullptr)
+		mBackend->DestroyBuffer(mBuffer.CpuAddress);
+}
+
+UploadRingBuffer::Allocation UploadRingBuffer::Allocate(std::uint64_t byteSize, std::uint64_t alignment)
+{
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0 && alignment <= BufferAlignment);
+
+	byteSize = AlignUp(std::max<std::uint64_t>(byteSize, 1), alignment);
+
+	std::uint64_t offset = mHead % mBuffer.Capacity;
+	std::uint64_t start = AlignUp(offset, alignment);
+
+	// An allocation never straddles the end of the buffer; the tail end is skipped and
+	// comes back when this frame retires.
+	if (start + byteSize > mBuffer.Capacity)
+		start = mBuffer.Capacity;
+
+	std::uint64_t newHead = mHead + (start - offset) + byteSize;
+	if (start == mBuffer.Capacity)
+	{
+		start = 0;
+		newHead = mHead + (mBuffer.Capacity - offset) + byteSize;
+	}
+
+	if (newHead - mTail > mBuffer.Capacity)
+	{
+		Grow(byteSize);
+		start = 0;
+		newHead = byteSize;
+	}
+
+	mHead = newHead;
+
+	mStats.UsedBytes = mHead - mTail;
+	mStats.PeakUsedBytes = std::max<std::uint64_t>(mStats.PeakUsedBytes, mStats.UsedBytes);
+
+	Allocation a;
+	a.CpuAddress = mBuffer.CpuAddress + start;
+	a.GpuAddress = mBuffer.GpuAddress + start;
+	a.Size = byteSize;
+	a.Resource = mBuffer.Resource;
+	a.Offset = start;
+	return a;
+}
+
+void UploadRingBuffer::FinishFrame(std::uint64_t fence)
+{
+	FrameMarker marker;
+	marker.Fence = fence;
+	marker.Head = mHead;
+	mFrames.push_back(marker);
+
+	// Buffers replaced during this frame may still be read by it.
+	for (auto& r : mRetiredBuffers)
+	{
+		if (!r.FenceKnown)
+		{
+			r.Fence = fence;
+			r.FenceKnown = true;
+		}
+	}
+
+	mStats.BytesLastFrame = mHead - mFrameStart;
+	mFrameStart = mHead;
+}
+
+void UploadRingBuffer::Retire(std::uint64_t completedFence)
+{
+	while (!mFrames.empty() && mFrames.front().Fence <= completedFence)
+	{
+		mTail = mFrames.front().Head;
+		mFrames.pop_front();
+	}
+
+	mStats.UsedBytes = mHead - mTail;
+
+	auto last = std::remove_if(mRetiredBuffers.begin(), mRetiredBuffers.end(),
+		[&](const RetiredBuffer& r)
+		{
+			if (!r.FenceKnown || r.Fence > completedFence)
+				return false;
+
+			mBackend->DestroyBuffer(r.Buf.CpuAddress);
+			return true;
+		});
+	mRetiredBuffers.erase(last, mRetiredBuffers.end());
+}
+
+void UploadRingBuffer::Grow(std::uint64_t byteSize)
+{
+	// Keep the old buffer until every frame that wrote into it has completed; the
+	// frames already closed are covered by the fence of the frame being recorded.
+	RetiredBuffer retired;
+	retired.Buf = mBuffer;
+	mRetiredBuffers.push_back(retired);
+
+	std::uint64_t capacity = mBuffer.Capacity * 2;
+	while (capacity < byteSize)
+		capacity *= 2;
+
+	mBuffer.Capacity = AlignUp(capacity, BufferAlignment);
+	mBuffer.CpuAddress = mBackend->CreateBuffer(mBuffer.Capacity, mBuffer.GpuAddress);
+	mBuffer.Resource = mBackend->GetResource(mBuffer.CpuAddress);
+
+	mFrames.clear();
+	mHead = 0;
+	mTail = 0;
+	mFrameStart = 0;
+
+	mStats.Capacity = mBuffer.Capacity;
+	mStats.Grows++;
+}
+
+std::uint8_t* SystemMemoryBackend::CreateBuffer(std::uint64_t byteSize, UploadRingBuffer::GpuAddress& gpuAddress)
+{
+	auto memory = std::make_unique<std::uint8_t[]>((size_t)byteSize);
+	std::uint8_t* cpuAddress = memory.get();
+
+	gpuAddress = mNextGpuAddress;
+	mNextGpuAddress += AlignUp(byteSize, UploadRingBuffer::BufferAlignment);
+
+	mBuffers[cpuAddress] = std::move(memory);
+
+	return cpuAddress;
+}
+
+void SystemMemoryBackend::DestroyBuffer(std::uint8_t* cpuAddress)
+{
+	mBuffers.erase(cpuAddress);
+}
@@ -0,0 +1,171 @@
+//***************************************************************************************
+// UploadRingBuffer.h
+//
+// Linear allocator for per-frame constant data.  Allocations are carved out of one
+// persistently mapped upload buffer, 256 byte aligned so each can be bound directly
+// as a root CBV, and handed back in bulk once the fence of the frame that used them
+// has completed.  Nothing has to be sized up front: if a frame needs more than the
+// ring has free, a buffer twice the size replaces it and the old one is released
+// after the frames still reading it are done.
+//
+// Memory comes from an UploadRingBuffer::Backend: UploadHeapBackend (UploadHeapBackend.h)
+// on a device, SystemMemoryBackend on the CPU.  Only depends on the C++ standard
+// library, so the allocator builds and can be checked off Windows.
+//***************************************************************************************
+
+#ifndef UPLOADRINGBUFFER_H
+#define UPLOADRINGBUFFER_H
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+struct ID3D12Resource;
+
+class UploadRingBuffer
+{
+public:
+	// Same type as D3D12_GPU_VIRTUAL_ADDRESS.
+	typedef std::uint64_t GpuAddress;
+
+	class Backend
+	{
+	public:
+		virtual ~Backend() = default;
+
+		// Returns the mapped CPU address of a new buffer and its GPU virtual address.
+		virtual std::uint8_t* CreateBuffer(std::uint64_t byteSize, GpuAddress& gpuAddress) = 0;
+		virtual void DestroyBuffer(std::uint8_t* cpuAddress) = 0;
+
+		// The resource behind a buffer, for copies out of the ring; null without a device.
+		virtual ID3D12Resource* GetResource(std::uint8_t*) { return nullptr; }
+	};
+
+	struct Allocation
+	{
+		std::uint8_t* CpuAddress = nullptr;
+		UploadRingBuffer::GpuAddress GpuAddress = 0;
+		std::uint64_t Size = 0;
+
+		// Source of CopyBufferRegion calls: the ring's buffer and the offset in it.
+		ID3D12Resource* Resource = nullptr;
+		std::uint64_t Offset = 0;
+
+		// Stride between elements written with CopyData.
+		std::uint32_t ElementByteSize = 0;
+
+		template<typename T>
+		void CopyData(std::uint32_t elementIndex, const T& data)
+		{
+			assert((std::uint64_t)(elementIndex + 1) * ElementByteSize <= Size);
+			std::memcpy(CpuAddress + (std::uint64_t)elementIndex * ElementByteSize, &data, sizeof(T));
+		}
+
+		UploadRingBuffer::GpuAddress ElementAddress(std::uint32_t elementIndex)const
+		{
+			return GpuAddress + (std::uint64_t)elementIndex * ElementByteSize;
+		}
+	};
+
+	struct Stats
+	{
+		std::uint64_t Capacity = 0;
+		std::uint64_t UsedBytes = 0;
+		std::uint64_t PeakUsedBytes = 0;
+		std::uint64_t BytesLastFrame = 0;
+		std::uint64_t Grows = 0;
+	};
+
+	// Allocations default to D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, and buffers
+	// are created in multiples of D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT so wrapped
+	// offsets stay aligned.  UploadHeapBackend.cpp checks both against d3d12.h.
+	static const std::uint64_t ConstantAlignment = 256;
+	static const std::uint64_t BufferAlignment = 65536;
+
+	UploadRingBuffer(Backend* backend, std::uint64_t capacity);
+	UploadRingBuffer(const UploadRingBuffer& rhs) = delete;
+	UploadRingBuffer& operator=(const UploadRingBuffer& rhs) = delete;
+	~UploadRingBuffer();
+
+	// 'alignment' must be a power of two no larger than BufferAlignment.
+	Allocation Allocate(std::uint64_t byteSize, std::uint64_t alignment = ConstantAlignment);
+
+	// Room for 'elementCount' constant buffers of type T, each padded to 256 bytes.
+	template<typename T>
+	Allocation AllocateConstants(std::uint32_t elementCount)
+	{
+		std::uint32_t elementByteSize = (std::uint32_t)((sizeof(T) + 255) & ~(std::size_t)255);
+
+		Allocation a = Allocate((std::uint64_t)elementByteSize * elementCount);
+		a.ElementByteSize = elementByteSize;
+		return a;
+	}
+
+	// Everything allocated since the previous call belongs to the frame that signals
+	// 'fence'; its memory is reused once Retire() sees that value completed.
+	void FinishFrame(std::uint64_t fence);
+
+	void Retire(std::uint64_t completedFence);
+
+	const Stats& GetStats()const { return mStats; }
+
+private:
+	struct Buffer
+	{
+		std::uint8_t* CpuAddress = nullptr;
+		UploadRingBuffer::GpuAddress GpuAddress = 0;
+		std::uint64_t Capacity = 0;
+		ID3D12Resource* Resource = nullptr;
+	};
+
+	struct FrameMarker
+	{
+		std::uint64_t Fence = 0;
+		std::uint64_t Head = 0;
+	};
+
+	struct RetiredBuffer
+	{
+		Buffer Buf;
+		std::uint64_t Fence = 0;
+		bool FenceKnown = false;
+	};
+
+	void Grow(std::uint64_t byteSize);
+
+private:
+	Backend* mBackend = nullptr;
+
+	Buffer mBuffer;
+
+	// Monotonic byte positions; the live region is [mTail, mHead) modulo Capacity.
+	std::uint64_t mHead = 0;
+	std::uint64_t mTail = 0;
+	std::uint64_t mFrameStart = 0;
+
+	std::deque<FrameMarker> mFrames;
+	std::vector<RetiredBuffer> mRetiredBuffers;
+
+	Stats mStats;
+};
+
+// Plain CPU memory with made-up GPU addresses, for exercising the allocator without
+// a device.
+class SystemMemoryBackend : public UploadRingBuffer::Backend
+{
+public:
+	virtual std::uint8_t* CreateBuffer(std::uint64_t byteSize, UploadRingBuffer::GpuAddress& gpuAddress)override;
+	virtual void DestroyBuffer(std::uint8_t* cpuAddress)override;
+
+	size_t LiveBuffers()const { return mBuffers.size(); }
+
+private:
+	std::unordered_map<std::uint8_t*, std::unique_ptr<std::uint8_t[]>> mBuffers;
+	UploadRingBuffer::GpuAddress mNextGpuAddress = 0x10000;
+};
+
+#endif // UPLOADRINGBUFFER_H
@@ -1,10 +1,39 @@
 
 #include "d3dUtil.h"
+#include "PlacedBufferPool.h"
+#include "UploadRingBuffer.h"
+#include "ShaderCache.h"
+#include "FileIO.h"
 #include <comdef.h>
-#include <fstream>
 
 using Microsoft::WRL::ComPtr;
 
+namespace
+{
+    // The shader cache takes UTF-8 paths.
+    std::string ToUtf8(const std::wstring& s)
+    {
+        if(s.empty())
+            return std::string();
+
+        int count = WideCharToMultiByte(CP_UTF8, 0, s.data(), (int)s.size(), nullptr, 0, nullptr, nullptr);
+        std::string utf8(count, '\0');
+        WideCharToMultiByte(CP_UTF8, 0, s.data(), (int)s.size(), &utf8[0], count, nullptr, nullptr);
+        return utf8;
+    }
+
+    std::wstring FromUtf8(const std::string& s)
+    {
+        if(s.empty())
+            return std::wstring();
+
+        int count = MultiByteToWideChar(CP_UTF8, 0, s.data(), (int)s.size(), nullptr, 0);
+        std::wstring wide(count, L'\0');
+        MultiByteToWideChar(CP_UTF8, 0, s.data(), (int)s.size(), &wide[0], count);
+        return wide;
+    }
+}
+
 DxException::DxException(HRESULT hr, const std::wstring& functionName, const std::wstring& filename, int lineNumber) :
     ErrorCode(hr),
     FunctionName(functionName),
@@ -20,17 +49,21 @@ bool d3dUtil::IsKeyDown(int vkeyCode)
 
 ComPtr<ID3DBlob> d3dUtil::LoadBinary(const std::wstring& filename)
 {
-    std::ifstream fin(filename, std::ios::binary);
-
-    fin.seekg(0, std::ios_base::end);
-    std::ifstream::pos_type size = (int)fin.tellg();
-    fin.seekg(0, std::ios_base::beg);
-
+    // The file is read straight into the blob, with its full 64-bit size.
     ComPtr<ID3DBlob> blob;
-    ThrowIfFailed(D3DCreateBlob(size, blob.GetAddressOf()));
-
-    fin.read((char*)blob->GetBufferPointer(), size);
-    fin.close();
+    HRESULT blobResult = S_OK;
+    bool read = FileIO::Read(filename, [&](std::uint64_t size) -> void*
+    {
+        blobResult = size > SIZE_MAX ? E_OUTOFMEMORY : D3DCreateBlob((SIZE_T)size, blob.GetAddressOf());
+        return SUCCEEDED(blobResult) ? blob->GetBufferPointer() : nullptr;
+    });
+
+    ThrowIfFailed(blobResult);
+    if(!read)
+    {
+        HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+        ThrowIfFailed(FAILED(hr) ? hr : E_FAIL);
+    }
 
     return blob;
 }
@@ -93,6 +126,32 @@ Microsoft::WRL::ComPtr<ID3D12Resource> d3dUtil::CreateDefaultBuffer(
     return defaultBuffer;
 }
 
+ComPtr<ID3D12Resource> d3dUtil::CreateDefaultBuffer(
+    PlacedBufferPool& buffers,
+    UploadRingBuffer& uploads,
+    ID3D12GraphicsCommandList* cmdList,
+    const void* initData,
+    UINT64 byteSize)
+{
+    // Placed buffers start out in COPY_DEST, so only the transition to GENERIC_READ
+    // is needed after the copy.
+    ComPtr<ID3D12Resource> defaultBuffer = buffers.CreateBuffer(byteSize, D3D12_RESOURCE_STATE_COPY_DEST);
+
+    // The copy needs the ring's resource, which a backend without a device does not have.
+    UploadRingBuffer::Allocation staging = uploads.Allocate(byteSize, 16);
+    if(staging.CpuAddress == nullptr || staging.Resource == nullptr)
+        ThrowIfFailed(E_OUTOFMEMORY);
+    memcpy(staging.CpuAddress, initData, (size_t)byteSize);
+
+    cmdList->CopyBufferRegion(defaultBuffer.Get(), 0, staging.Resource, staging.Offset, byteSize);
+
+    auto transition = CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
+        D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ);
+    cmdList->ResourceBarrier(1, &transition);
+
+    return defaultBuffer;
+}
+
 ComPtr<ID3DBlob> d3dUtil::CompileShader(
 	const std::wstring& filename,
 	const D3D_SHADER_MACRO* defines,
@@ -119,6 +178,38 @@ ComPtr<ID3DBlob> d3dUtil::CompileShader(
 	return byteCode;
 }
 
+ComPtr<ID3DBlob> d3dUtil::CompileShader(
+	ShaderCache& cache,
+	const std::wstring& filename,
+	const D3D_SHADER_MACRO* defines,
+	const std::string& entrypoint,
+	const std::string& target)
+{
+	// Must match the flags the uncached overload compiles with.
+	UINT compileFlags = 0;
+#if defined(DEBUG) || defined(_DEBUG)  
+	compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+
+	std::vector<ShaderCache::Define> cacheDefines;
+	for(const D3D_SHADER_MACRO* d = defines; d != nullptr && d->Name != nullptr; ++d)
+		cacheDefines.push_back({ d->Name, d->Definition != nullptr ? d->Definition : "" });
+
+	std::string key;
+	if(!cache.MakeKey(ToUtf8(filename), cacheDefines, entrypoint, target, compileFlags, key))
+		return CompileShader(filename, defines, entrypoint, target);
+
+	if(cache.Lookup(key))
+		return LoadBinary(FromUtf8(cache.EntryPath(key)));
+
+	ComPtr<ID3DBlob> byteCode = CompileShader(filename, defines, entrypoint, target);
+
+	// A failed store only costs the next launch a compile.
+	cache.Store(key, byteCode->GetBufferPointer(), byteCode->GetBufferSize());
+
+	return byteCode;
+}
+
 std::wstring DxException::ToString()const
 {
     // Get the string description of the error code.
@@ -27,6 +27,10 @@
 
 extern const int gNumFrameResources;
 
+class PlacedBufferPool;
+class UploadRingBuffer;
+class ShaderCache;
+
 inline void d3dSetDebugName(IDXGIObject* obj, const char* name)
 {
 	if (obj)
@@ -117,11 +121,31 @@ public:
 		UINT64 byteSize,
 		Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer);
 
+	// Same, but the buffer is placed in one of the pool's heaps and the data is staged
+	// in 'uploads', which reuses the space once the frame's fence completes.  No
+	// uploader has to be kept alive by the caller.
+	static Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(
+		PlacedBufferPool& buffers,
+		UploadRingBuffer& uploads,
+		ID3D12GraphicsCommandList* cmdList,
+		const void* initData,
+		UINT64 byteSize);
+
 	static Microsoft::WRL::ComPtr<ID3DBlob> CompileShader(
 		const std::wstring& filename,
 		const D3D_SHADER_MACRO* defines,
 		const std::string& entrypoint,
 		const std::string& target);
+
+	// Same, but bytecode already in 'cache' for this source, its includes, the defines,
+	// entry point, target and flags is loaded instead of compiled, and new bytecode is
+	// stored there.
+	static Microsoft::WRL::ComPtr<ID3DBlob> CompileShader(
+		ShaderCache& cache,
+		const std::wstring& filename,
+		const D3D_SHADER_MACRO* defines,
+		const std::string& entrypoint,
+		const std::string& target);
 };
 
 class DxException
@@ -260,6 +284,12 @@ struct MaterialConstants
 
 	// Used in texture mapping.
 	DirectX::XMFLOAT4X4 MatTransform = MathHelper::Identity4x4();
+
+	// Heap slot of the diffuse map, for shaders that index a bindless texture table.
+	UINT DiffuseMapIndex = 0;
+	UINT MaterialPad0 = 0;
+	UINT MaterialPad1 = 0;
+	UINT MaterialPad2 = 0;
 };
 
 // Simple struct to represent a material for our demos.  A production 3D engine
@@ -278,12 +308,6 @@ struct Material
 	// Index into SRV heap for normal texture.
 	int NormalSrvHeapIndex = -1;
 
-	// Dirty flag indicating the material has changed and we need to update the constant buffer.
-	// Because we have a material constant buffer for each FrameResource, we have to apply the
-	// update to each FrameResource.  Thus, when we modify a material we should set 
-	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
-	int NumFramesDirty = gNumFrameResources;
-
 	// Material constant buffer data used for shading.
 	DirectX::XMFLOAT4 DiffuseAlbedo = { 1.0f, 1.0f, 1.0f, 1.0f };
 	DirectX::XMFLOAT3 FresnelR0 = { 0.01f, 0.01f, 0.01f };
@@ -0,0 +1,227 @@
+//***************************************************************************************
+// main.cpp - times building render items from string keyed maps and from NameRegistry ids.
+//
+// Usage:
+//   BuildBench [-r repeats]
+//
+// For 10k, 100k and 1M items, each naming one of 12 meshes and 7 materials the way the
+// castle in TreeBillboardsApp does, builds a flat list of items
+//   -"strings": passing the names by value and looking the mesh, the material and the
+//    submesh's four draw arguments up in unordered_maps keyed by std::string, as
+//    BuildRenderItems used to, and
+//   -"ids": resolving each name to a NameRegistry id once and building the items from
+//    the ids,
+// and checks that both produce the same items.
+//
+// Build:
+//   g++ -std=c++17 -O2 main.cpp -o BuildBench
+//***************************************************************************************
+
+#include "../../Common/NameRegistry.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+template<typename Fn>
+static double Measure(int repeats, Fn fn)
+{
+	using Clock = std::chrono::steady_clock;
+
+	fn();
+
+	auto start = Clock::now();
+	for (int r = 0; r < repeats; ++r)
+		fn();
+	auto end = Clock::now();
+
+	return std::chrono::duration<double, std::milli>(end - start).count() / repeats;
+}
+
+// Stand-ins for the app's SubmeshGeometry, MeshGeometry and Material.
+struct Submesh
+{
+	unsigned IndexCount = 0;
+	unsigned StartIndexLocation = 0;
+	int BaseVertexLocation = 0;
+	float Bounds[6] = {};
+};
+
+struct Geometry
+{
+	std::string Name;
+	std::unordered_map<std::string, Submesh> DrawArgs;
+};
+
+struct Material
+{
+	std::string Name;
+	unsigned MatCBIndex = 0;
+};
+
+struct Mesh
+{
+	Geometry* Geo = nullptr;
+	unsigned GeometryId = 0;
+	Submesh Args;
+};
+
+struct Item
+{
+	Material* Mat = nullptr;
+	Geometry* Geo = nullptr;
+	unsigned GeometryId = 0;
+	unsigned IndexCount = 0;
+	unsigned StartIndexLocation = 0;
+	int BaseVertexLocation = 0;
+	float Bounds[6];
+};
+
+static const char* MeshNames[] = { "Box", "Box2", "Box3", "Cylinder", "Sphere", "Grid", "Grid2", "Grid3",
+	"Pyramid", "Cone2", "Wedge", "Diamond" };
+static const char* MaterialNames[] = { "grass", "water", "wirefence", "treeSprites", "woodCrate", "bricks", "ice" };
+
+static const unsigned MeshCount = sizeof(MeshNames) / sizeof(MeshNames[0]);
+static const unsigned MaterialCount = sizeof(MaterialNames) / sizeof(MaterialNames[0]);
+
+struct Scene
+{
+	std::unordered_map<std::string, std::unique_ptr<Geometry>> GeometryMap;
+	std::unordered_map<std::string, std::unique_ptr<Material>> MaterialMap;
+
+	NameRegistry<std::unique_ptr<Geometry>> Geometries;
+	NameRegistry<Mesh> Meshes;
+	NameRegistry<std::unique_ptr<Material>> Materials;
+};
+
+static void BuildScene(Scene& scene)
+{
+	for (unsigned i = 0; i < MeshCount; ++i)
+	{
+		Submesh args;
+		args.IndexCount = 36 + i;
+		args.StartIndexLocation = i * 3;
+
+		auto mapGeo = std::make_unique<Geometry>();
+		mapGeo->Name = MeshNames[i];
+		mapGeo->DrawArgs["box"] = args;
+		scene.GeometryMap[MeshNames[i]] = std::move(mapGeo);
+
+		// The registry owns a geometry of its own; the items are compared by their
+		// draw arguments only.
+		auto geo = std::make_unique<Geometry>(*scene.GeometryMap[MeshNames[i]]);
+		Mesh mesh;
+		mesh.Geo = geo.get();
+		mesh.Args = args;
+		mesh.GeometryId = scene.Geometries.Add(MeshNames[i], std::move(geo));
+		scene.Meshes.Add(MeshNames[i], mesh);
+	}
+
+	for (unsigned i = 0; i < MaterialCount; ++i)
+	{
+		auto mat = std::make_unique<Material>();
+		mat->Name = MaterialNames[i];
+		mat->MatCBIndex = i;
+		scene.MaterialMap[MaterialNames[i]] = std::make_unique<Material>(*mat);
+		scene.Materials.Add(MaterialNames[i], std::move(mat));
+	}
+}
+
+// The old BuildRenderItems: names by value, every field looked up by string.
+static void AddItemByName(Scene& scene, std::vector<Item>& items, std::string name, std::string material)
+{
+	Item item;
+	item.Mat = scene.MaterialMap[material].get();
+	item.Geo = scene.GeometryMap[name].get();
+	item.IndexCount = item.Geo->DrawArgs["box"].IndexCount;
+	item.StartIndexLocation = item.Geo->DrawArgs["box"].StartIndexLocation;
+	item.BaseVertexLocation = item.Geo->DrawArgs["box"].BaseVertexLocation;
+	std::memcpy(item.Bounds, item.Geo->DrawArgs["box"].Bounds, sizeof(item.Bounds));
+	items.push_back(item);
+}
+
+static void AddItemById(Scene& scene, std::vector<Item>& items, NameRegistry<Mesh>::Id mesh, NameRegistry<std::unique_ptr<Material>>::Id material)
+{
+	const Mesh& m = scene.Meshes[mesh];
+
+	Item item;
+	item.Mat = scene.Materials[material].get();
+	item.Geo = m.Geo;
+	item.GeometryId = m.GeometryId;
+	item.IndexCount = m.Args.IndexCount;
+	item.StartIndexLocation = m.Args.StartIndexLocation;
+	item.BaseVertexLocation = m.Args.BaseVertexLocation;
+	std::memcpy(item.Bounds, m.Args.Bounds, sizeof(item.Bounds));
+	items.push_back(item);
+}
+
+static void Run(std::uint32_t count, int repeats, Scene& scene)
+{
+	std::cout << count << " items\n";
+
+	std::vector<Item> byName, byId;
+	byName.reserve(count);
+	byId.reserve(count);
+
+	double names = Measure(repeats, [&]()
+	{
+		byName.clear();
+		for (std::uint32_t i = 0; i < count; ++i)
+			AddItemByName(scene, byName, MeshNames[i % MeshCount], MaterialNames[i % MaterialCount]);
+	});
+
+	double ids = Measure(repeats, [&]()
+	{
+		NameRegistry<Mesh>::Id meshIds[MeshCount];
+		NameRegistry<std::unique_ptr<Material>>::Id materialIds[MaterialCount];
+		for (unsigned i = 0; i < MeshCount; ++i)
+			meshIds[i] = scene.Meshes.Get(MeshNames[i]);
+		for (unsigned i = 0; i < MaterialCount; ++i)
+			materialIds[i] = scene.Materials.Get(MaterialNames[i]);
+
+		byId.clear();
+		for (std::uint32_t i = 0; i < count; ++i)
+			AddItemById(scene, byId, meshIds[i % MeshCount], materialIds[i % MaterialCount]);
+	});
+
+	// The two sets of maps own separate objects, so compare the draw arguments and
+	// material names.
+	bool same = byName.size() == byId.size();
+	for (size_t i = 0; same && i < byName.size(); ++i)
+	{
+		same = byName[i].Mat->Name == byId[i].Mat->Name &&
+			byName[i].Geo->Name == byId[i].Geo->Name &&
+			byName[i].IndexCount == byId[i].IndexCount &&
+			byName[i].StartIndexLocation == byId[i].StartIndexLocation;
+	}
+
+	std::cout << "  strings " << names << " ms  ids " << ids << " ms  ("
+		<< (same ? "same items" : "MISMATCH") << ")\n";
+}
+
+int main(int argc, char* argv[])
+{
+	int repeats = 5;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "-r") == 0)
+			repeats = std::atoi(argv[i + 1]);
+	}
+
+	Scene scene;
+	BuildScene(scene);
+
+	std::cout << std::fixed << std::setprecision(3);
+
+	for (std::uint32_t count : { 10000u, 100000u, 1000000u })
+		Run(count, repeats, scene);
+
+	return 0;
+}
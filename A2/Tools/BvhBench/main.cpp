@@ -0,0 +1,207 @@
+//***************************************************************************************
+// main.cpp - compares Bvh queries with linear scans at growing scene sizes.
+//
+// Usage:
+//   BvhBench [-r repeats] [-j threads]
+//
+// For 10k, 100k and 1M boxes scattered at a constant density around a camera, times
+//   -"build": Bvh::Build on one thread and on a JobSystem with the given threads,
+//   -"cull": FrustumCull::CullAabbs over every box against Bvh::Cull,
+//   -"ray": a nearest hit scan over every box against Bvh::Raycast, for 1000 rays,
+//   -"refit": moving 1% of the boxes with SetBounds + Refit,
+// checking that the BVH queries return the same items as the scans.
+//
+// Build (DirectXMath is header only; on Linux point -I at a checkout of its Inc folder):
+//   g++ -std=c++17 -O2 -pthread -I<DirectXMath>/Inc main.cpp ../../Common/Bvh.cpp
+//       ../../Common/FrustumCull.cpp ../../Common/JobSystem.cpp -o BvhBench
+//***************************************************************************************
+
+#include "../../Common/Bvh.h"
+#include "../../Common/FrustumCull.h"
+#include "../../Common/JobSystem.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+template<typename Fn>
+static double Measure(int repeats, Fn fn)
+{
+	using Clock = std::chrono::steady_clock;
+
+	fn();
+
+	auto start = Clock::now();
+	for (int r = 0; r < repeats; ++r)
+		fn();
+	auto end = Clock::now();
+
+	return std::chrono::duration<double, std::milli>(end - start).count() / repeats;
+}
+
+static const int RayCount = 1000;
+
+static bool ScanRay(const std::vector<Bvh::Aabb>& boxes, const XMFLOAT3& o, const XMFLOAT3& d, Bvh::RayHit& hit)
+{
+	hit = Bvh::RayHit();
+	float nearest = FLT_MAX;
+
+	for (std::uint32_t i = 0; i < (std::uint32_t)boxes.size(); ++i)
+	{
+		const Bvh::Aabb& b = boxes[i];
+		float tx0 = (b.Min.x - o.x) / d.x, tx1 = (b.Max.x - o.x) / d.x;
+		float ty0 = (b.Min.y - o.y) / d.y, ty1 = (b.Max.y - o.y) / d.y;
+		float tz0 = (b.Min.z - o.z) / d.z, tz1 = (b.Max.z - o.z) / d.z;
+
+		float tmin = std::max<float>(std::max<float>(std::min<float>(tx0, tx1), std::min<float>(ty0, ty1)), std::min<float>(tz0, tz1));
+		float tmax = std::min<float>(std::min<float>(std::max<float>(tx0, tx1), std::max<float>(ty0, ty1)), std::max<float>(tz0, tz1));
+		tmin = std::max<float>(tmin, 0.0f);
+
+		if (tmin <= tmax && tmin < nearest)
+		{
+			nearest = tmin;
+			hit.Item = i;
+			hit.T = tmin;
+		}
+	}
+
+	return hit.Item != UINT32_MAX;
+}
+
+static void Run(std::uint32_t count, int repeats, JobSystem& jobs)
+{
+	// Keep the density constant so the view sees more boxes as the scene grows.
+	float half = 50.0f * std::cbrt(count / 1000.0f);
+
+	std::mt19937 rng(count);
+	std::uniform_real_distribution<float> position(-half, half);
+	std::uniform_real_distribution<float> size(0.5f, 3.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	std::vector<Bvh::Aabb> boxes(count);
+	FrustumCull::AabbList list;
+	list.Resize(count);
+
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		XMFLOAT3 c(position(rng), position(rng), position(rng));
+		XMFLOAT3 e(size(rng), size(rng), size(rng));
+		boxes[i] = Bvh::Aabb::FromCenterExtents(c, e);
+		list.Set(i, c, e);
+	}
+
+	XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 0.0f, -half, 1.0f),
+		XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, half);
+	FrustumCull::Frustum frustum = FrustumCull::Frustum::FromViewProj(XMMatrixMultiply(view, proj));
+
+	std::cout << std::setw(8) << count << " boxes\n";
+
+	// Build.
+	Bvh bvh;
+	double serialBuild = Measure(repeats, [&]() { bvh.Build(boxes); });
+	double parallelBuild = Measure(repeats, [&]() { bvh.Build(boxes, &jobs); });
+	std::cout << "  build   1 thread " << serialBuild << " ms  " << jobs.ThreadCount() << " threads "
+		<< parallelBuild << " ms  (" << bvh.NodeCount() << " nodes)\n";
+
+	// Frustum culling.
+	std::vector<std::uint32_t> scanVisible(count);
+	std::vector<std::uint32_t> bvhVisible;
+	std::uint32_t scanCount = 0;
+
+	double scanCull = Measure(repeats, [&]() { scanCount = FrustumCull::CullAabbs(frustum, list, scanVisible.data()); });
+	double bvhCull = Measure(repeats, [&]() { bvh.Cull(frustum, bvhVisible); });
+
+	scanVisible.resize(scanCount);
+	std::sort(bvhVisible.begin(), bvhVisible.end());
+	bool cullMatch = scanVisible == bvhVisible;
+
+	std::cout << "  cull    visible " << scanCount << "  scan " << scanCull << " ms  bvh " << bvhCull
+		<< " ms  (" << scanCull / bvhCull << "x)" << (cullMatch ? "" : "  MISMATCH") << "\n";
+
+	// Ray picking from the camera.
+	std::vector<XMFLOAT3> dirs(RayCount);
+	for (auto& d : dirs)
+		d = XMFLOAT3(0.3f * unit(rng), 0.3f * unit(rng), 1.0f);
+
+	XMFLOAT3 origin(0.0f, 0.0f, -half);
+	std::vector<Bvh::RayHit> scanHits(RayCount);
+	std::vector<Bvh::RayHit> bvhHits(RayCount);
+
+	double scanRay = Measure(1, [&]()
+	{
+		for (int r = 0; r < RayCount; ++r)
+			ScanRay(boxes, origin, dirs[r], scanHits[r]);
+	});
+	double bvhRay = Measure(repeats, [&]()
+	{
+		for (int r = 0; r < RayCount; ++r)
+			bvh.Raycast(origin, dirs[r], FLT_MAX, bvhHits[r]);
+	});
+
+	int rayMismatches = 0;
+	for (int r = 0; r < RayCount; ++r)
+	{
+		if (scanHits[r].Item != bvhHits[r].Item && scanHits[r].T != bvhHits[r].T)
+			rayMismatches++;
+	}
+
+	std::cout << "  ray     " << RayCount << " rays  scan " << scanRay << " ms  bvh " << bvhRay
+		<< " ms  (" << scanRay / bvhRay << "x)";
+	if (rayMismatches != 0)
+		std::cout << "  " << rayMismatches << " MISMATCHES";
+	std::cout << "\n";
+
+	// Refit after moving a few items.
+	std::vector<std::uint32_t> moved;
+	for (std::uint32_t i = 0; i < count; i += 100)
+		moved.push_back(i);
+
+	double refit = Measure(repeats, [&]()
+	{
+		for (std::uint32_t i : moved)
+		{
+			Bvh::Aabb b = boxes[i];
+			float dx = unit(rng);
+			b.Min.x += dx;
+			b.Max.x += dx;
+			bvh.SetBounds(i, b);
+		}
+		bvh.Refit();
+	});
+
+	std::cout << "  refit   " << moved.size() << " items " << refit << " ms\n";
+}
+
+int main(int argc, char* argv[])
+{
+	int repeats = 5;
+	unsigned threads = std::thread::hardware_concurrency();
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "-r") == 0)
+			repeats = std::atoi(argv[i + 1]);
+		else if (std::strcmp(argv[i], "-j") == 0)
+			threads = (unsigned)std::atoi(argv[i + 1]);
+	}
+
+	JobSystem jobs(threads > 1 ? threads - 1 : 0);
+
+	std::cout << std::fixed << std::setprecision(3);
+
+	for (std::uint32_t count : { 10000u, 100000u, 1000000u })
+		Run(count, repeats, jobs);
+
+	return 0;
+}
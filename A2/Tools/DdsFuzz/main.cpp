@@ -0,0 +1,274 @@
+//***************************************************************************************
+// main.cpp - fuzzes the D3D12 DDS loader's header parsing and times it on the repo's
+// textures.
+//
+// Usage:
+//   DdsFuzz [-d textureDir] [-n mutations] [-r repeats] [-f input]
+//
+// LLVMFuzzerTestOneInput runs a buffer through ValidateDDSHeader and ParseDDSTexture12
+// (which calls FillInitData12): everything the loader does with a file before it needs
+// a device.  It aborts if a subresource it accepted reaches outside the buffer or a
+// size is out of the D3D12 limits.  Built with DDSFUZZ_LIBFUZZER and -fsanitize=fuzzer,
+// libFuzzer drives it; use 'textureDir' as the seed corpus.  Otherwise main() is a
+// standalone driver:
+//   -every .dds in 'textureDir' must parse;
+//   -'mutations' inputs made from them by flipping header bytes, writing boundary
+//    values into header fields and truncating, each in an exactly sized allocation so
+//    a sanitizer build catches any read past the end;
+//   -'input', if given, is replayed first (e.g. a crash file libFuzzer saved);
+//   -then prints each texture's parse time, averaged over 'repeats' runs.
+//
+// The parsing functions are file-static, so this includes DDSTextureLoader.cpp.
+//
+// Build (Windows SDK; the first with libFuzzer, the second standalone):
+//   cl /std:c++14 /O2 /EHsc /fsanitize=address,fuzzer /DDDSFUZZ_LIBFUZZER main.cpp
+//       ../../Common/TextureContainer.cpp ../../Common/FileIO.cpp
+//   cl /std:c++14 /O2 /EHsc main.cpp ../../Common/TextureContainer.cpp ../../Common/FileIO.cpp
+//***************************************************************************************
+
+#include "../../Common/DDSTextureLoader.cpp"
+#include "../../Common/HighResClock.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <dirent.h>
+#endif
+
+namespace
+{
+	// Parses like CreateTextureFromDDS12 up to resource creation.  Returns true if the
+	// input was accepted.
+	bool ParseDDS(const uint8_t* data, size_t size)
+	{
+		const DDS_HEADER* header = nullptr;
+		size_t offset = 0;
+		if (FAILED(ValidateDDSHeader(data, size, &header, &offset)))
+			return false;
+
+		const uint8_t* bitData = data + offset;
+		const size_t bitSize = size - offset;
+
+		DDSTextureDesc12 desc;
+		std::unique_ptr<D3D12_SUBRESOURCE_DATA[]> initData;
+		if (FAILED(ParseDDSTexture12(header, bitData, bitSize, 0, desc, initData)))
+			return false;
+
+		if (desc.mipCount == 0 || desc.mipCount > D3D12_REQ_MIP_LEVELS ||
+			desc.arraySize == 0 || desc.arraySize > D3D12_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION ||
+			desc.width == 0 || desc.width > D3D12_REQ_TEXTURE1D_U_DIMENSION ||
+			desc.height == 0 || desc.height > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION ||
+			desc.depth == 0 || desc.depth > D3D12_REQ_TEXTURE3D_U_V_OR_W_DIMENSION)
+		{
+			std::abort();
+		}
+
+		// Every subresource, all depth slices of it, inside the buffer.  Touch its first
+		// and last byte so a sanitizer sees the same reads the upload would make.
+		volatile uint8_t sink = 0;
+		for (size_t j = 0; j < desc.arraySize; ++j)
+		{
+			for (size_t i = 0; i < desc.mipCount; ++i)
+			{
+				const D3D12_SUBRESOURCE_DATA& sub = initData[j * desc.mipCount + i];
+				const uint8_t* p = static_cast<const uint8_t*>(sub.pData);
+				const size_t slices = std::max<size_t>(desc.depth >> i, 1);
+
+				if (p < bitData || p > bitData + bitSize || sub.SlicePitch <= 0 || sub.RowPitch <= 0 ||
+					sub.RowPitch > sub.SlicePitch ||
+					static_cast<size_t>(sub.SlicePitch) > static_cast<size_t>(bitData + bitSize - p) / slices)
+				{
+					std::abort();
+				}
+
+				sink = sink + p[0] + p[static_cast<size_t>(sub.SlicePitch) * slices - 1];
+			}
+		}
+
+		return true;
+	}
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	ParseDDS(data, size);
+	return 0;
+}
+
+#if !defined(DDSFUZZ_LIBFUZZER)
+
+namespace
+{
+	int gErrors = 0;
+
+	void Check(bool ok, const std::string& what)
+	{
+		if (!ok)
+		{
+			std::cout << "  FAILED: " << what << "\n";
+			gErrors++;
+		}
+	}
+
+	std::vector<std::string> ListDDS(const std::string& dir)
+	{
+		std::vector<std::string> names;
+#if defined(_WIN32)
+		_finddata_t found;
+		intptr_t find = _findfirst((dir + "/*.dds").c_str(), &found);
+		if (find != -1)
+		{
+			do
+				names.push_back(found.name);
+			while (_findnext(find, &found) == 0);
+			_findclose(find);
+		}
+#else
+		if (DIR* d = opendir(dir.c_str()))
+		{
+			while (dirent* e = readdir(d))
+			{
+				std::string name = e->d_name;
+				if (name.size() > 4 && name.compare(name.size() - 4, 4, ".dds") == 0)
+					names.push_back(name);
+			}
+			closedir(d);
+		}
+#endif
+		std::sort(names.begin(), names.end());
+		return names;
+	}
+
+	// Runs the target on an exactly sized copy, so reading one byte too far is caught.
+	bool RunExact(const std::vector<uint8_t>& bytes)
+	{
+		std::unique_ptr<uint8_t[]> input(new uint8_t[std::max<size_t>(bytes.size(), 1)]);
+		if (!bytes.empty())
+			memcpy(input.get(), bytes.data(), bytes.size());
+
+		return ParseDDS(input.get(), bytes.size());
+	}
+
+	void Mutate(std::vector<uint8_t>& bytes, std::mt19937& rng)
+	{
+		// Offsets of the header's 32 bit fields: magic, size, flags, height, width,
+		// pitch, depth, mip count, pixel format size/flags/fourCC/bit count, caps2, and
+		// the DX10 header's format, dimension, misc flag and array size.
+		static const size_t fields[] = { 0, 4, 8, 12, 16, 20, 24, 28, 76, 80, 84, 88, 112, 128, 132, 136, 140 };
+		static const uint32_t values[] = { 0, 1, 2, 3, 6, 0xFF, 0x8000, 16384, 16385, 2048, 2049,
+			0x7FFFFFFF, 0x80000000, 0xFFFFFFFF, 0xFFFFFFFE, 0x30315844 /* DX10 */, 0x200 /* cube */ };
+
+		int count = 1 + (int)(rng() % 4);
+		for (int m = 0; m < count && !bytes.empty(); ++m)
+		{
+			switch (rng() % 4)
+			{
+			case 0:
+				bytes[rng() % std::min<size_t>(bytes.size(), 148)] ^= (uint8_t)(1u << (rng() % 8));
+				break;
+
+			case 1:
+			{
+				size_t at = fields[rng() % (sizeof(fields) / sizeof(fields[0]))];
+				uint32_t v = values[rng() % (sizeof(values) / sizeof(values[0]))];
+				if (at + 4 <= bytes.size())
+					memcpy(&bytes[at], &v, 4);
+				break;
+			}
+
+			case 2:
+				bytes.resize(rng() % (bytes.size() + 1));
+				break;
+
+			default:
+				bytes[rng() % bytes.size()] = (uint8_t)rng();
+				break;
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string dir = "../../Textures";
+	int mutations = 200000;
+	int repeats = 2000;
+	std::string replay;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "-d") == 0)
+			dir = argv[i + 1];
+		else if (std::strcmp(argv[i], "-n") == 0)
+			mutations = std::max(0, std::atoi(argv[i + 1]));
+		else if (std::strcmp(argv[i], "-r") == 0)
+			repeats = std::max(1, std::atoi(argv[i + 1]));
+		else if (std::strcmp(argv[i], "-f") == 0)
+			replay = argv[i + 1];
+	}
+
+	if (!replay.empty())
+	{
+		std::vector<uint8_t> bytes;
+		Check(FileIO::Read(FileIO::ToPath(replay), bytes), "read " + replay);
+		std::cout << replay << ": " << (RunExact(bytes) ? "accepted" : "rejected") << "\n";
+	}
+
+	std::vector<std::string> names = ListDDS(dir);
+	std::vector<std::vector<uint8_t>> seeds;
+	for (const std::string& name : names)
+	{
+		std::vector<uint8_t> bytes;
+		Check(FileIO::Read(FileIO::ToPath(dir + "/" + name), bytes), "read " + name);
+		Check(RunExact(bytes), name + " parses");
+		seeds.push_back(std::move(bytes));
+	}
+	Check(!seeds.empty(), "textures found in " + dir);
+
+	if (!seeds.empty())
+	{
+		std::mt19937 rng(1);
+		int accepted = 0;
+		for (int n = 0; n < mutations; ++n)
+		{
+			std::vector<uint8_t> bytes = seeds[rng() % seeds.size()];
+			Mutate(bytes, rng);
+			if (RunExact(bytes))
+				accepted++;
+		}
+
+		std::cout << seeds.size() << " seeds, " << mutations << " mutations, "
+			<< accepted << " accepted, " << mutations - accepted << " rejected\n";
+	}
+
+	// Parse time per texture.
+	std::cout << std::left << std::setw(24) << "texture" << std::right << std::setw(10) << "KiB"
+		<< std::setw(12) << "parse us" << "\n" << std::fixed << std::setprecision(2);
+
+	double totalUs = 0.0;
+	for (size_t i = 0; i < seeds.size(); ++i)
+	{
+		HighResClock::Ticks start = HighResClock::Now();
+		for (int r = 0; r < repeats; ++r)
+			ParseDDS(seeds[i].data(), seeds[i].size());
+		double us = HighResClock::ToMicroseconds(HighResClock::Now() - start) / repeats;
+		totalUs += us;
+
+		std::cout << std::left << std::setw(24) << names[i] << std::right
+			<< std::setw(10) << seeds[i].size() / 1024 << std::setw(12) << us << "\n";
+	}
+	std::cout << "total " << totalUs << " us\n";
+
+	std::cout << (gErrors == 0 ? "passed" : "FAILED") << "\n";
+	return gErrors == 0 ? 0 : 1;
+}
+
+#endif // !DDSFUZZ_LIBFUZZER
@@ -0,0 +1,200 @@
+//***************************************************************************************
+// main.cpp - randomized stress test of DescriptorAllocator.
+//
+// Usage:
+//   DescriptorStress [-f frames] [-s seed]
+//
+// Runs frames of random persistent allocations and frees (runs of 1 to 8 slots) and
+// transient ring allocations against a simulated GPU that completes each frame two
+// frames late.  Every slot has a shadow owner, and the test fails if
+//   -an allocation overlaps a live run, a run freed in a frame the GPU has not finished,
+//    or a ring slot of a frame still in flight,
+//   -an allocation fails while a long enough free run provably exists,
+//   -the persistent region is not one free run again once everything is freed.
+//
+// Build:
+//   g++ -std=c++17 -O2 main.cpp ../../Common/DescriptorAllocator.cpp -o DescriptorStress
+//***************************************************************************************
+
+#include "../../Common/DescriptorAllocator.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static const std::uint32_t PersistentCount = 1024;
+static const std::uint32_t RingCount = 256;
+static const std::uint64_t GpuLatency = 2;
+
+// Shadow state of each slot.
+enum SlotState : std::uint8_t
+{
+	Free,
+	Live,
+	FreedPending,
+	Transient
+};
+
+struct Run
+{
+	std::uint32_t First;
+	std::uint32_t Count;
+};
+
+static int gErrors = 0;
+
+static void Fail(const char* what, std::uint64_t frame)
+{
+	if (gErrors++ < 10)
+		std::cout << "  frame " << frame << ": " << what << "\n";
+}
+
+// Longest run of slots that are free in the shadow and not waiting on the GPU.
+static std::uint32_t LongestFreeRun(const std::vector<SlotState>& slots)
+{
+	std::uint32_t best = 0, run = 0;
+	for (std::uint32_t i = 0; i < PersistentCount; ++i)
+	{
+		run = slots[i] == Free ? run + 1 : 0;
+		best = run > best ? run : best;
+	}
+	return best;
+}
+
+int main(int argc, char* argv[])
+{
+	std::uint64_t frames = 20000;
+	unsigned seed = 1;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "-f") == 0)
+			frames = std::strtoull(argv[i + 1], nullptr, 10);
+		else if (std::strcmp(argv[i], "-s") == 0)
+			seed = (unsigned)std::atoi(argv[i + 1]);
+	}
+
+	std::mt19937 rng(seed);
+	DescriptorAllocator alloc(PersistentCount, RingCount);
+
+	std::vector<SlotState> slots(PersistentCount + RingCount, Free);
+	std::vector<std::uint64_t> slotFence(PersistentCount + RingCount, 0);
+	std::vector<Run> live;
+
+	std::uint64_t allocations = 0, transients = 0, fullHeap = 0;
+
+	for (std::uint64_t frame = 1; frame <= frames + GpuLatency; ++frame)
+	{
+		// The GPU finishes frames GpuLatency behind the CPU.
+		std::uint64_t completed = frame > GpuLatency ? frame - GpuLatency : 0;
+		alloc.Retire(completed);
+		for (std::uint32_t i = 0; i < PersistentCount + RingCount; ++i)
+		{
+			if ((slots[i] == FreedPending || slots[i] == Transient) && slotFence[i] <= completed)
+				slots[i] = Free;
+		}
+
+		bool draining = frame > frames;
+		int ops = draining ? 0 : (int)(rng() % 16);
+
+		for (int op = 0; op < ops; ++op)
+		{
+			bool doFree = !live.empty() && (rng() % 100) < (live.size() > 200 ? 60u : 40u);
+			if (doFree)
+			{
+				size_t k = rng() % live.size();
+				Run r = live[k];
+				live[k] = live.back();
+				live.pop_back();
+
+				alloc.Free(r.First, r.Count);
+				for (std::uint32_t i = r.First; i < r.First + r.Count; ++i)
+				{
+					slots[i] = FreedPending;
+					slotFence[i] = frame;
+				}
+				continue;
+			}
+
+			std::uint32_t count = 1 + rng() % 8;
+			std::uint32_t first = alloc.Allocate(count);
+			allocations++;
+
+			if (first == DescriptorAllocator::InvalidIndex)
+			{
+				fullHeap++;
+				if (LongestFreeRun(slots) >= count)
+					Fail("allocation failed with a long enough free run", frame);
+				continue;
+			}
+
+			if (first + count > PersistentCount)
+				Fail("persistent run outside its region", frame);
+
+			for (std::uint32_t i = first; i < first + count && i < PersistentCount; ++i)
+			{
+				if (slots[i] != Free)
+					Fail(slots[i] == Live ? "overlaps a live run" : "reuses a slot the GPU may still read", frame);
+				slots[i] = Live;
+			}
+			live.push_back(Run{ first, count });
+		}
+
+		int ringOps = draining ? 0 : (int)(rng() % 8);
+		for (int op = 0; op < ringOps; ++op)
+		{
+			std::uint32_t count = 1 + rng() % 24;
+			std::uint32_t first = alloc.AllocateTransient(count);
+			transients++;
+
+			if (first == DescriptorAllocator::InvalidIndex)
+				continue;
+
+			if (first < PersistentCount || first + count > PersistentCount + RingCount)
+				Fail("transient run outside the ring", frame);
+
+			for (std::uint32_t i = first; i < first + count && i < PersistentCount + RingCount; ++i)
+			{
+				if (slots[i] != Free)
+					Fail("transient run overlaps a frame in flight", frame);
+				slots[i] = Transient;
+				slotFence[i] = frame;
+			}
+		}
+
+		// Free everything once the random frames are done.
+		if (frame == frames)
+		{
+			for (const Run& r : live)
+			{
+				alloc.Free(r.First, r.Count);
+				for (std::uint32_t i = r.First; i < r.First + r.Count; ++i)
+				{
+					slots[i] = FreedPending;
+					slotFence[i] = frame;
+				}
+			}
+			live.clear();
+		}
+
+		alloc.FinishFrame(frame);
+	}
+
+	alloc.Retire(frames + GpuLatency);
+
+	const DescriptorAllocator::Stats& stats = alloc.GetStats();
+	if (stats.PersistentUsed != 0 || stats.FreeRuns != 1)
+		Fail("persistent region not whole after freeing everything", frames);
+	if (stats.RingUsed != 0)
+		Fail("ring not empty after every frame retired", frames);
+
+	std::cout << allocations << " allocations (" << fullHeap << " found the heap full), "
+		<< transients << " transient runs, peak " << stats.PersistentPeak << "/" << PersistentCount
+		<< " persistent and " << stats.RingPeak << "/" << RingCount << " ring slots\n";
+	std::cout << (gErrors == 0 ? "passed" : "FAILED") << "\n";
+
+	return gErrors == 0 ? 0 : 1;
+}
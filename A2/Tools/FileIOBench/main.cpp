@@ -0,0 +1,275 @@
+//***************************************************************************************
+// main.cpp - compares FileIO's ways of loading files against the std::ifstream
+// seekg/tellg/read that d3dUtil::LoadBinary used, cold and warm.
+//
+// Usage:
+//   FileIOBench [-n files] [-s sizeKiB] [-d dir]
+//
+// Writes 'files' files of 'sizeKiB' KiB into 'dir' and loads all of them with:
+//   ifstream      seekg/tellg, then read into a buffer (the old LoadBinary)
+//   FileIO::Read  one open, read straight into the caller's buffer
+//   MappedFile    map, then copy into a buffer (what a blob load would do)
+//   Async threads AsyncFileReader on its thread pool, every file queued up front
+//   Async uring   AsyncFileReader on io_uring (Linux; falls back to threads elsewhere)
+// Cold runs first drop the files from the page cache (posix_fadvise DONTNEED; on other
+// platforms every run is warm).  Prints MiB/s for each and checks every load returned
+// the bytes written.  Also checks empty and missing files, and that a sparse 5 GiB
+// file reports its full 64 bit size and maps.
+//
+// Build:
+//   g++ -std=c++17 -O2 -pthread main.cpp ../../Common/FileIO.cpp -o FileIOBench
+//***************************************************************************************
+
+#include "../../Common/FileIO.h"
+#include "../../Common/HighResClock.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	typedef std::function<bool(const std::string& path, std::vector<std::uint8_t>& data)> LoadFn;
+
+	bool LoadIfstream(const std::string& path, std::vector<std::uint8_t>& data)
+	{
+		std::ifstream fin(path, std::ios::binary);
+
+		fin.seekg(0, std::ios_base::end);
+		std::ifstream::pos_type size = (int)fin.tellg();
+		fin.seekg(0, std::ios_base::beg);
+
+		data.resize((size_t)size);
+		fin.read((char*)data.data(), size);
+		return (bool)fin;
+	}
+
+	bool LoadFileIO(const std::string& path, std::vector<std::uint8_t>& data)
+	{
+		return FileIO::Read(FileIO::ToPath(path), data);
+	}
+
+	bool LoadMapped(const std::string& path, std::vector<std::uint8_t>& data)
+	{
+		MappedFile file;
+		if (!file.Open(FileIO::ToPath(path)))
+			return false;
+
+		data.assign(file.Data(), file.Data() + file.Size());
+		return true;
+	}
+
+	void DropFromCache(const std::string& path)
+	{
+#if defined(POSIX_FADV_DONTNEED)
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd >= 0)
+		{
+			fdatasync(fd);
+			posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+			close(fd);
+		}
+#else
+		(void)path;
+#endif
+	}
+
+	std::uint64_t Checksum(const std::vector<std::uint8_t>& data)
+	{
+		std::uint64_t h = 14695981039346656037ull;
+		for (std::uint8_t b : data)
+		{
+			h ^= b;
+			h *= 1099511628211ull;
+		}
+		return h ^ data.size();
+	}
+
+	int gErrors = 0;
+
+	void Check(bool ok, const char* what)
+	{
+		if (!ok)
+		{
+			std::cout << "  FAILED: " << what << "\n";
+			gErrors++;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int fileCount = 32;
+	int sizeKiB = 4096;
+	std::string dir = ".";
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "-n") == 0)
+			fileCount = std::max(1, std::atoi(argv[i + 1]));
+		else if (std::strcmp(argv[i], "-s") == 0)
+			sizeKiB = std::max(1, std::atoi(argv[i + 1]));
+		else if (std::strcmp(argv[i], "-d") == 0)
+			dir = argv[i + 1];
+	}
+
+	// Files of varying length, so chunk ends do not line up with pages.
+	std::vector<std::string> paths;
+	std::vector<std::uint64_t> sums;
+	std::uint64_t totalBytes = 0;
+	std::uint32_t seed = 12345;
+	for (int i = 0; i < fileCount; ++i)
+	{
+		std::vector<std::uint8_t> data((size_t)sizeKiB * 1024 + (size_t)i * 37);
+		for (std::uint8_t& b : data)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			b = (std::uint8_t)(seed >> 24);
+		}
+
+		paths.push_back(dir + "/FileIOBench" + std::to_string(i) + ".bin");
+		std::ofstream fout(paths.back(), std::ios::binary);
+		fout.write((const char*)data.data(), (std::streamsize)data.size());
+		if (!fout)
+		{
+			std::cout << "Can not write " << paths.back() << "\n";
+			return 1;
+		}
+
+		sums.push_back(Checksum(data));
+		totalBytes += data.size();
+	}
+
+	std::cout << fileCount << " files, " << totalBytes / (1024 * 1024) << " MiB\n";
+
+	struct Method
+	{
+		const char* Name;
+		LoadFn Load;
+		AsyncFileReader::Backend Backend;
+		bool Async;
+	};
+
+	std::vector<Method> methods = {
+		{ "ifstream", LoadIfstream, AsyncFileReader::Backend::Threads, false },
+		{ "FileIO::Read", LoadFileIO, AsyncFileReader::Backend::Threads, false },
+		{ "MappedFile", LoadMapped, AsyncFileReader::Backend::Threads, false },
+		{ "Async threads", nullptr, AsyncFileReader::Backend::Threads, true },
+		{ "Async uring", nullptr, AsyncFileReader::Backend::IoUring, true },
+	};
+
+	std::cout << std::left << std::setw(24) << "method" << std::right
+		<< std::setw(12) << "cold MiB/s" << std::setw(12) << "warm MiB/s" << "\n";
+
+	for (const Method& m : methods)
+	{
+		std::string name = m.Name;
+		double rates[2];
+
+		for (int warm = 0; warm < 2; ++warm)
+		{
+			if (!warm)
+			{
+				for (const std::string& path : paths)
+					DropFromCache(path);
+			}
+
+			std::vector<std::vector<std::uint8_t>> loaded(paths.size());
+			std::vector<bool> ok(paths.size(), false);
+
+			HighResClock::Ticks start = HighResClock::Now();
+			if (m.Async)
+			{
+				AsyncFileReader reader(m.Backend);
+				if (reader.GetBackend() != m.Backend)
+					name = std::string(m.Name) + " (threads)";
+
+				std::vector<AsyncFileReader::Ticket> tickets;
+				for (const std::string& path : paths)
+					tickets.push_back(reader.Read(FileIO::ToPath(path)));
+				for (size_t i = 0; i < paths.size(); ++i)
+					ok[i] = reader.Wait(tickets[i], loaded[i]);
+			}
+			else
+			{
+				for (size_t i = 0; i < paths.size(); ++i)
+					ok[i] = m.Load(paths[i], loaded[i]);
+			}
+			double seconds = HighResClock::ToSeconds(HighResClock::Now() - start);
+
+			rates[warm] = (double)totalBytes / (1024.0 * 1024.0) / seconds;
+
+			for (size_t i = 0; i < paths.size(); ++i)
+				Check(ok[i] && Checksum(loaded[i]) == sums[i], m.Name);
+		}
+
+		std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(0)
+			<< std::setw(12) << rates[0] << std::setw(12) << rates[1] << "\n";
+	}
+
+	// Edge cases.
+	{
+		std::string empty = dir + "/FileIOBenchEmpty.bin";
+		std::ofstream(empty, std::ios::binary).close();
+		std::string missing = dir + "/FileIOBenchMissing.bin";
+
+		std::vector<std::uint8_t> data(3, 1);
+		Check(FileIO::Read(FileIO::ToPath(empty), data) && data.empty(), "empty file reads");
+		Check(!FileIO::Read(FileIO::ToPath(missing), data), "missing file fails");
+
+		MappedFile mapped;
+		Check(mapped.Open(FileIO::ToPath(empty)) && mapped.Size() == 0, "empty file maps");
+		Check(!mapped.Open(FileIO::ToPath(missing)) && !mapped.IsOpen(), "missing file does not map");
+
+		for (AsyncFileReader::Backend backend : { AsyncFileReader::Backend::Threads, AsyncFileReader::Backend::IoUring })
+		{
+			AsyncFileReader reader(backend);
+			AsyncFileReader::Ticket a = reader.Read(FileIO::ToPath(empty));
+			AsyncFileReader::Ticket b = reader.Read(FileIO::ToPath(missing));
+			data.assign(3, 1);
+			Check(reader.Wait(a, data) && data.empty(), "async empty file");
+			Check(!reader.Wait(b, data), "async missing file");
+
+			// Queued but never waited on: the destructor still finishes them.
+			reader.Read(FileIO::ToPath(paths[0]));
+		}
+
+		std::remove(empty.c_str());
+
+#if !defined(_WIN32)
+		// Sparse, so it costs no disk; only the size and the last page are touched.
+		std::string big = dir + "/FileIOBenchBig.bin";
+		const std::uint64_t bigSize = 5ull * 1024 * 1024 * 1024 + 123;
+		int fd = open(big.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		bool created = fd >= 0 && ftruncate(fd, (off_t)bigSize) == 0;
+		if (fd >= 0)
+			close(fd);
+
+		if (created)
+		{
+			std::uint64_t size = 0;
+			Check(FileIO::Size(FileIO::ToPath(big), size) && size == bigSize, "5 GiB size");
+			Check(mapped.Open(FileIO::ToPath(big)) && mapped.Size() == bigSize &&
+				mapped.Data()[bigSize - 1] == 0, "5 GiB map");
+			mapped.Close();
+			std::cout << "5 GiB sparse file: size " << size << "\n";
+		}
+		std::remove(big.c_str());
+#endif
+	}
+
+	for (const std::string& path : paths)
+		std::remove(path.c_str());
+
+	std::cout << (gErrors == 0 ? "passed" : "FAILED") << "\n";
+	return gErrors == 0 ? 0 : 1;
+}
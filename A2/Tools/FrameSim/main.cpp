@@ -0,0 +1,189 @@
+//***************************************************************************************
+// main.cpp - runs FrameScheduler against a simulated GPU timeline.
+//
+// Usage:
+//   FrameSim [-f frames] [-u updateMs] [-s simulateMs] [-r recordMs] [-g gpuMs]
+//
+// Each frame the CPU updates (u), steps its simulation (s) and records and submits
+// (r); the GPU then takes g to execute it, one frame after another on its own thread.
+// The work is slept rather than computed, so the overlap shows on any core count.
+// For 1 to 4 frames in flight, with the simulation step run inline and run ahead
+// through RunAhead(), prints the average frame time and CPU time spent waiting, and
+// checks that no frame slot is reused before the GPU has finished with it.
+//
+// Build:
+//   g++ -std=c++17 -O2 -pthread main.cpp ../../Common/FrameScheduler.cpp -o FrameSim
+//***************************************************************************************
+
+#include "../../Common/FrameScheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static void Work(double ms)
+{
+	std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(ms));
+}
+
+// Executes submitted frames in order on a thread of its own, completing each frame's
+// fence value once its time has passed.
+class SimulatedGpu : public FrameTimeline
+{
+public:
+	SimulatedGpu() : mThread(&SimulatedGpu::Loop, this) {}
+
+	~SimulatedGpu()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mQuit = true;
+		}
+		mWake.notify_all();
+		mThread.join();
+	}
+
+	void Submit(std::uint64_t fenceValue, double gpuMs)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mQueue.push_back(Frame{ fenceValue, gpuMs });
+		}
+		mWake.notify_all();
+	}
+
+	virtual std::uint64_t CompletedValue()override { return mCompleted.load(); }
+
+	virtual void WaitFor(std::uint64_t value, std::uint32_t)override
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mWake.wait(lock, [&]() { return mCompleted.load() >= value; });
+	}
+
+private:
+	struct Frame
+	{
+		std::uint64_t Fence;
+		double Ms;
+	};
+
+	void Loop()
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		for (;;)
+		{
+			mWake.wait(lock, [&]() { return mQuit || !mQueue.empty(); });
+			if (mQueue.empty())
+				return;
+
+			Frame f = mQueue.front();
+			mQueue.pop_front();
+
+			lock.unlock();
+			Work(f.Ms);
+			lock.lock();
+
+			mCompleted.store(f.Fence);
+			mWake.notify_all();
+		}
+	}
+
+private:
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::deque<Frame> mQueue;
+	std::atomic<std::uint64_t> mCompleted{ 0 };
+	bool mQuit = false;
+	std::thread mThread;
+};
+
+struct Timings
+{
+	double UpdateMs = 2.0;
+	double SimulateMs = 4.0;
+	double RecordMs = 4.0;
+	double GpuMs = 8.0;
+};
+
+static void Run(std::uint32_t framesInFlight, bool runAhead, int frames, const Timings& t)
+{
+	SimulatedGpu gpu;
+	FrameScheduler scheduler(&gpu, framesInFlight);
+
+	std::uint64_t fence = 0;
+	int reused = 0;
+
+	auto start = Clock::now();
+	for (int i = 0; i < frames; ++i)
+	{
+		scheduler.BeginFrame();
+
+		// The slot's last frame must be done, so at most framesInFlight - 1 remain.
+		if (fence - gpu.CompletedValue() > framesInFlight - 1)
+			reused++;
+
+		scheduler.WaitAhead();
+		Work(t.UpdateMs);
+
+		if (runAhead)
+			scheduler.RunAhead([&t]() { Work(t.SimulateMs); });
+		else
+			Work(t.SimulateMs);
+
+		Work(t.RecordMs);
+		gpu.Submit(++fence, t.GpuMs);
+		scheduler.EndFrame(fence);
+	}
+	scheduler.WaitAhead();
+	scheduler.WaitIdle();
+	double totalMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	const FrameScheduler::Stats& stats = scheduler.GetStats();
+	std::cout << "  " << framesInFlight << " in flight  " << (runAhead ? "run ahead" : "inline   ")
+		<< "  frame " << totalMs / frames << " ms"
+		<< "  GPU wait " << stats.TotalGpuWaitMs / frames << " ms (" << stats.StalledFrames << " stalls)"
+		<< "  step wait " << stats.TotalAheadWaitMs / frames << " ms"
+		<< (reused == 0 ? "" : "  SLOT REUSED EARLY") << "\n";
+}
+
+int main(int argc, char* argv[])
+{
+	int frames = 100;
+	Timings t;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "-f") == 0)
+			frames = std::atoi(argv[i + 1]);
+		else if (std::strcmp(argv[i], "-u") == 0)
+			t.UpdateMs = std::atof(argv[i + 1]);
+		else if (std::strcmp(argv[i], "-s") == 0)
+			t.SimulateMs = std::atof(argv[i + 1]);
+		else if (std::strcmp(argv[i], "-r") == 0)
+			t.RecordMs = std::atof(argv[i + 1]);
+		else if (std::strcmp(argv[i], "-g") == 0)
+			t.GpuMs = std::atof(argv[i + 1]);
+	}
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "update " << t.UpdateMs << " ms, simulate " << t.SimulateMs << " ms, record "
+		<< t.RecordMs << " ms, GPU " << t.GpuMs << " ms\n";
+
+	for (std::uint32_t framesInFlight = 1; framesInFlight <= 4; ++framesInFlight)
+	{
+		Run(framesInFlight, false, frames, t);
+		Run(framesInFlight, true, frames, t);
+	}
+
+	return 0;
+}
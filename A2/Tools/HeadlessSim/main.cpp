@@ -0,0 +1,376 @@
+//***************************************************************************************
+// main.cpp - runs the tree billboards app's scene logic headless, as fast as it can.
+//
+// Usage:
+//   HeadlessSim [-u updates] [-s stepMs] [-j threads]
+//
+// A HeadlessApp around the app's TreeBillboardsScene: the castle, wave pool and tree
+// sprites, with stand-in meshes of the same bounds.  Each update does what
+// TreeBillboardsApp::Update and Draw do on the CPU, through the same scene code:
+//   -moves the camera (orbiting slowly, in place of the mouse) and culls the items
+//    against its frustum with the Bvh,
+//   -scrolls the water material, refreshes the object constants from the SceneStore
+//    on a JobSystem and the material constants,
+//   -disturbs and steps the waves and copies them out as vertices,
+//   -sorts the visible items into a DrawQueue, merges instances and submits it to the
+//    RecordingSink of the null renderer.
+// Buffers the GPU would read are plain memory; pass constants are left out.
+//
+// Prints the updates per second, what was recorded per update and the CPU time per
+// phase, and checks that a second run over the same updates ends in exactly the same
+// state (the fixed step makes the runs deterministic).
+//
+// Build (Waves.cpp comes from the app's project; point -I at DirectXMath's Inc folder
+// and at the DirectX-Headers project for DrawQueue's D3D12 types):
+//   g++ -std=c++17 -O2 -pthread -I<DirectXMath>/Inc -I<DirectX-Headers>/include/directx
+//       -I<DirectX-Headers>/include/wsl/stubs main.cpp ../../Common/HeadlessApp.cpp
+//       ../../Common/TreeBillboardsScene.cpp ../../Common/GameTimer.cpp ../../Common/DrawQueue.cpp ../../Common/SceneStore.cpp
+//       ../../Common/JobSystem.cpp ../../Common/Bvh.cpp ../../Common/FrustumCull.cpp
+//       ../../Common/GeometryGenerator.cpp ../../Common/GeometryPacker.cpp ../../Common/Profiler.cpp
+//       ../../Week2Solution/Week2Project/Waves.cpp -o HeadlessSim
+//***************************************************************************************
+
+#include "../../Common/HeadlessApp.h"
+#include "../../Common/GeometryPacker.h"
+#include "../../Common/JobSystem.h"
+#include "../../Common/Profiler.h"
+#include "../../Common/TreeBillboardsScene.h"
+#include "../../Week2Solution/Week2Project/Waves.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+struct Vertex
+{
+	XMFLOAT3 Pos;
+	XMFLOAT3 Normal;
+	XMFLOAT2 TexC;
+};
+
+static XMFLOAT4X4 Identity()
+{
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, XMMatrixIdentity());
+	return m;
+}
+
+static std::uint64_t Fnv(std::uint64_t h, const void* data, size_t size)
+{
+	auto bytes = static_cast<const std::uint8_t*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		h ^= bytes[i];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+class HeadlessTreeBillboards : public HeadlessApp
+{
+public:
+	HeadlessTreeBillboards(float step, unsigned threads)
+		: HeadlessApp(step), mJobs(threads), mScene(mJobs), mRandom(1234)
+	{
+	}
+
+	virtual bool Initialize()override;
+
+	// Hash of the state an update leaves behind.
+	std::uint64_t Checksum()const;
+
+	UINT ItemCount()const { return mScene.ItemCount(); }
+	std::uint64_t VisibleTotal()const { return mVisibleTotal; }
+
+private:
+	virtual void Update(const GameTimer& gt)override;
+	virtual void Draw(const GameTimer& gt, DrawCommandSink& sink)override;
+
+	void AddShape(GeometryPacker& packer, const std::string& name, const GeometryGenerator::MeshData& shape);
+
+	void UpdateCamera(const GameTimer& gt);
+	void UpdateWaves(const GameTimer& gt);
+	void BuildInstanceData();
+
+	float RandF(float a, float b) { return std::uniform_real_distribution<float>(a, b)(mRandom); }
+	int Rand(int a, int b) { return std::uniform_int_distribution<int>(a, b)(mRandom); }
+
+	static float GetHillsHeight(float x, float z) { return 0.3f * (z * sinf(0.1f * x) + x * cosf(0.1f * z)); }
+
+private:
+	JobSystem mJobs;
+	TreeBillboardsScene mScene;
+	std::mt19937 mRandom;
+
+	std::uint64_t mVisibleTotal = 0;
+
+	std::unique_ptr<Waves> mWaves;
+	float mWaveTimeBase = 0.0f;
+
+	// Stand-ins for the PSOs and geometries; the sink only compares them.  As in the app,
+	// the shapes share one geometry and the water and the trees have their own.
+	char mPsoTokens[2][(int)RenderLayer::Count] = {};
+	char mGeoTokens[3] = {};
+
+	// What the frame would upload.
+	std::vector<SceneStore::ObjectData> mObjectCB;
+	std::vector<TreeBillboardsScene::MaterialData> mMaterialCB;
+	std::vector<Vertex> mWavesVB;
+	std::vector<SceneStore::ObjectData> mInstanceData;
+
+	XMFLOAT4X4 mView = Identity();
+	XMFLOAT4X4 mProj = Identity();
+	float mTheta = 1.5f * XM_PI;
+	float mPhi = 0.5f * XM_PI - 0.1f;
+	float mRadius = 50.0f;
+};
+
+bool HeadlessTreeBillboards::Initialize()
+{
+	if (!HeadlessApp::Initialize())
+		return false;
+
+	XMStoreFloat4x4(&mProj, XMMatrixPerspectiveFovLH(0.25f * XM_PI, AspectRatio(), 1.0f, 1000.0f));
+
+	for (int i = 0; i < (int)RenderLayer::Count; ++i)
+	{
+		ID3D12PipelineState* instanced = i != (int)RenderLayer::AlphaTestedTreeSprites ?
+			(ID3D12PipelineState*)&mPsoTokens[1][i] : nullptr;
+		mScene.SetLayerPsos((RenderLayer)i, (ID3D12PipelineState*)&mPsoTokens[0][i], instanced);
+	}
+
+	mWaves = std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f);
+	mWavesVB.resize(mWaves->VertexCount());
+
+	GeometryPacker shapePacker((UINT)sizeof(Vertex));
+	TreeBillboardsScene::CreateShapes([&](const std::string& name, const GeometryGenerator::MeshData& shape)
+	{
+		AddShape(shapePacker, name, shape);
+	});
+
+	TreeBillboardsScene::Mesh water;
+	water.Geo = (MeshGeometry*)&mGeoTokens[1];
+	water.IndexCount = 3 * mWaves->TriangleCount();
+	water.Extents = XMFLOAT3(0.5f * mWaves->Width(), 2.0f, 0.5f * mWaves->Depth());
+	mScene.AddMesh("waterGeo", water);
+
+	// Same placement as BuildTreeSpritesGeometry, from this run's random sequence.
+	XMFLOAT3 treeMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 treeMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (int i = 0; i < 16; ++i)
+	{
+		float x = RandF(-45.0f, 45.0f);
+		float z = RandF(-45.0f, 45.0f);
+		float y = GetHillsHeight(x, z) + 8.0f;
+		treeMin = XMFLOAT3(std::min(treeMin.x, x), std::min(treeMin.y, y), std::min(treeMin.z, z));
+		treeMax = XMFLOAT3(std::max(treeMax.x, x), std::max(treeMax.y, y), std::max(treeMax.z, z));
+	}
+	TreeBillboardsScene::Mesh trees;
+	trees.Geo = (MeshGeometry*)&mGeoTokens[2];
+	trees.IndexCount = 16;
+	trees.Center = XMFLOAT3(0.5f * (treeMin.x + treeMax.x), 0.5f * (treeMin.y + treeMax.y), 0.5f * (treeMin.z + treeMax.z));
+	trees.Extents = XMFLOAT3(0.5f * (treeMax.x - treeMin.x) + 10.0f, 0.5f * (treeMax.y - treeMin.y) + 10.0f,
+		0.5f * (treeMax.z - treeMin.z) + 10.0f);
+	mScene.AddMesh("treeSpritesGeo", trees);
+
+	// Each material gets a texture slot of its own, in the order the app loads them.
+	mScene.BuildMaterials();
+	UINT slot = 0;
+	for (auto& mat : mScene.Materials())
+		mat->DiffuseSrvHeapIndex = slot++;
+	mMaterialCB.resize(mScene.MaterialCount());
+
+	mScene.BuildScene();
+	mObjectCB.resize(mScene.Store().Size());
+
+	return true;
+}
+
+void HeadlessTreeBillboards::AddShape(GeometryPacker& packer, const std::string& name,
+	const GeometryGenerator::MeshData& shape)
+{
+	// Packed as BuildShapeGeometry packs them, so identical shapes share a range and
+	// merge into the same instanced draws as in the app.
+	std::vector<Vertex> vertices(shape.Vertices.size());
+	XMFLOAT3 vMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 vMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (size_t i = 0; i < shape.Vertices.size(); ++i)
+	{
+		const XMFLOAT3& p = shape.Vertices[i].Position;
+		vertices[i].Pos = p;
+		vertices[i].Normal = shape.Vertices[i].Normal;
+		vertices[i].TexC = shape.Vertices[i].TexC;
+		vMin = XMFLOAT3(std::min(vMin.x, p.x), std::min(vMin.y, p.y), std::min(vMin.z, p.z));
+		vMax = XMFLOAT3(std::max(vMax.x, p.x), std::max(vMax.y, p.y), std::max(vMax.z, p.z));
+	}
+
+	std::vector<std::uint16_t> indices(shape.Indices32.begin(), shape.Indices32.end());
+	GeometryPacker::Range range = packer.Add(vertices.data(), (UINT)vertices.size(),
+		indices.data(), (UINT)indices.size());
+
+	TreeBillboardsScene::Mesh mesh;
+	mesh.Geo = (MeshGeometry*)&mGeoTokens[0];
+	mesh.IndexCount = range.IndexCount;
+	mesh.StartIndexLocation = range.StartIndex;
+	mesh.BaseVertexLocation = (int)range.BaseVertex;
+	mesh.Center = XMFLOAT3(0.5f * (vMin.x + vMax.x), 0.5f * (vMin.y + vMax.y), 0.5f * (vMin.z + vMax.z));
+	mesh.Extents = XMFLOAT3(0.5f * (vMax.x - vMin.x), 0.5f * (vMax.y - vMin.y), 0.5f * (vMax.z - vMin.z));
+	mScene.AddMesh(name, mesh);
+}
+
+void HeadlessTreeBillboards::Update(const GameTimer& gt)
+{
+	PROFILE_SCOPE("Update");
+
+	UpdateCamera(gt);
+	mScene.CullRenderItems(mView, mProj);
+	mVisibleTotal += mScene.VisibleCount();
+
+	mScene.AnimateMaterials(gt.DeltaTime());
+	mScene.UpdateObjectConstants((std::uint8_t*)mObjectCB.data(), SceneStore::ConstantsStride);
+	mScene.UpdateMaterialConstants((std::uint8_t*)mMaterialCB.data(), sizeof(TreeBillboardsScene::MaterialData));
+	UpdateWaves(gt);
+}
+
+void HeadlessTreeBillboards::Draw(const GameTimer&, DrawCommandSink& sink)
+{
+	PROFILE_SCOPE("Draw");
+
+	mScene.BuildDrawQueue(mView);
+	BuildInstanceData();
+	mScene.Queue().Submit(sink);
+}
+
+void HeadlessTreeBillboards::UpdateCamera(const GameTimer& gt)
+{
+	// Orbit the castle, once every two minutes.
+	mTheta += gt.DeltaTime() * XM_2PI / 120.0f;
+
+	XMFLOAT3 eye(mRadius * sinf(mPhi) * cosf(mTheta), mRadius * cosf(mPhi), mRadius * sinf(mPhi) * sinf(mTheta));
+
+	XMVECTOR pos = XMVectorSet(eye.x, eye.y, eye.z, 1.0f);
+	XMVECTOR target = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+	XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	XMStoreFloat4x4(&mView, XMMatrixLookAtLH(pos, target, up));
+}
+
+void HeadlessTreeBillboards::UpdateWaves(const GameTimer& gt)
+{
+	PROFILE_SCOPE("UpdateWaves");
+
+	// SimulateWaves: every quarter second, generate a random wave.
+	if ((gt.TotalTime() - mWaveTimeBase) >= 0.25f)
+	{
+		mWaveTimeBase += 0.25f;
+
+		int i = Rand(4, mWaves->RowCount() - 5);
+		int j = Rand(4, mWaves->ColumnCount() - 5);
+
+		mWaves->Disturb(i, j, RandF(0.2f, 0.5f));
+	}
+
+	mWaves->Update(gt.DeltaTime());
+
+	for (int i = 0; i < mWaves->VertexCount(); ++i)
+	{
+		Vertex& v = mWavesVB[i];
+		v.Pos = mWaves->Position(i);
+		v.Normal = mWaves->Normal(i);
+		v.TexC.x = 0.5f + v.Pos.x / mWaves->Width();
+		v.TexC.y = 0.5f - v.Pos.z / mWaves->Depth();
+	}
+}
+
+void HeadlessTreeBillboards::BuildInstanceData()
+{
+	mScene.Queue().MergeInstances();
+
+	const auto& instances = mScene.Queue().InstanceObjects();
+	mInstanceData.resize(instances.size());
+	for (size_t i = 0; i < instances.size(); ++i)
+		mInstanceData[i] = mObjectCB[instances[i]];
+}
+
+std::uint64_t HeadlessTreeBillboards::Checksum()const
+{
+	std::uint64_t h = 14695981039346656037ull;
+	h = Fnv(h, mObjectCB.data(), mObjectCB.size() * sizeof(SceneStore::ObjectData));
+	h = Fnv(h, mMaterialCB.data(), mMaterialCB.size() * sizeof(TreeBillboardsScene::MaterialData));
+	h = Fnv(h, mWavesVB.data(), mWavesVB.size() * sizeof(Vertex));
+	h = Fnv(h, &mView, sizeof(mView));
+
+	RecordingSink::Counts counts = GetStats().Recorded;
+	h = Fnv(h, &counts, sizeof(counts));
+	return h;
+}
+
+int main(int argc, char* argv[])
+{
+	std::uint64_t updates = 3600;
+	float stepMs = 1000.0f / 60.0f;
+	unsigned threads = 0;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "-u") == 0)
+			updates = std::max<std::uint64_t>(1, std::strtoull(argv[i + 1], nullptr, 10));
+		else if (std::strcmp(argv[i], "-s") == 0)
+			stepMs = (float)std::atof(argv[i + 1]);
+		else if (std::strcmp(argv[i], "-j") == 0)
+			threads = (unsigned)std::atoi(argv[i + 1]);
+	}
+
+	HeadlessTreeBillboards sim(stepMs / 1000.0f, threads);
+	if (!sim.Initialize())
+		return 1;
+
+	Profiler::Clear();
+	sim.Run(updates);
+
+	const HeadlessApp::Stats& stats = sim.GetStats();
+	std::vector<Profiler::ScopeStats> phases = Profiler::Summarize();
+
+	// The same updates again from a fresh start must end in the same state.
+	HeadlessTreeBillboards again(stepMs / 1000.0f, threads);
+	again.Initialize();
+	again.Run(updates);
+
+	int errors = 0;
+	if (sim.Checksum() != again.Checksum())
+	{
+		std::cout << "  a second run ended in a different state\n";
+		errors++;
+	}
+	if (stats.Updates != updates || stats.Recorded.Draws == 0)
+		errors++;
+
+	const double n = (double)stats.Updates;
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << sim.ItemCount() << " items, " << stats.Updates << " updates of " << stepMs << " ms ("
+		<< stats.Updates * stepMs / 1000.0f << " s simulated) in " << std::setprecision(3) << stats.Seconds << " s\n";
+	std::cout << std::setprecision(0) << "  " << stats.UpdatesPerSecond << " updates per second\n";
+	std::cout << std::setprecision(2) << "  per update: " << sim.VisibleTotal() / n << " visible, "
+		<< stats.Recorded.Draws / n << " draws, " << stats.Recorded.Instances / n << " instances, "
+		<< stats.Recorded.StateChanges() / n << " state changes\n";
+	std::cout << std::setprecision(4);
+	for (const auto& s : phases)
+	{
+		std::cout << "  " << std::string(2 * s.Depth, ' ') << std::left << std::setw(18 - 2 * s.Depth) << s.Name
+			<< std::right << " avg " << s.AvgMs << "  p99 " << s.P99Ms << "  max " << s.MaxMs << " ms\n";
+	}
+	std::cout << "  checksum " << std::hex << sim.Checksum() << std::dec << "\n";
+	std::cout << (errors == 0 ? "passed\n" : "FAILED\n");
+
+	return errors == 0 ? 0 : 1;
+}
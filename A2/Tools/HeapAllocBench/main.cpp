@@ -0,0 +1,311 @@
+//***************************************************************************************
+// main.cpp - allocation speed and fragmentation of TlsfAllocator on a simulated heap.
+//
+// Usage:
+//   HeapAllocBench [-f frames] [-s seed]
+//
+// Plays the same random buffer traffic against TlsfAllocator and against a first fit
+// free list kept in a std::map (the approach of DescriptorAllocator), and reports the
+// time per allocation, failed requests and, at the end, the fragmentation of the free
+// space (1 - largest free block / free bytes).  Two workloads:
+//   -"placed": 4KB to 4MB buffers at the 64KB placement alignment in a 256MB heap,
+//    as PlacedBufferPool creates them,
+//   -"small": 256B to 64KB ranges at 256 byte alignment in a 16MB heap.
+// Each frame allocates a few buffers and frees random live ones until the heap is
+// about 70% full again; freed ranges come back two frames later, as they would after
+// the GPU's fence.  A validation pass checks every offset against the live ranges
+// for overlap and alignment.  "one heap each" is how many heaps committed resources
+// would have created for the same live buffers.
+//
+// Build:
+//   g++ -std=c++17 -O2 main.cpp ../../Common/TlsfAllocator.cpp -o HeapAllocBench
+//***************************************************************************************
+
+#include "../../Common/TlsfAllocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+static const std::uint64_t InvalidOffset = UINT64_MAX;
+static const std::uint64_t GpuLatency = 2;
+
+static std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// First fit over free ranges sorted by offset, merging neighbours on Free.
+class FirstFitAllocator
+{
+public:
+	FirstFitAllocator(std::uint64_t size, std::uint64_t granularity)
+		: mGranularity(granularity)
+	{
+		mFree[0] = size;
+	}
+
+	std::uint64_t Allocate(std::uint64_t size, std::uint64_t alignment)
+	{
+		size = AlignUp(std::max<std::uint64_t>(size, 1), mGranularity);
+
+		for (auto it = mFree.begin(); it != mFree.end(); ++it)
+		{
+			std::uint64_t offset = AlignUp(it->first, alignment);
+			std::uint64_t end = it->first + it->second;
+			if (offset + size > end)
+				continue;
+
+			std::uint64_t start = it->first;
+			mFree.erase(it);
+			if (offset > start)
+				mFree[start] = offset - start;
+			if (offset + size < end)
+				mFree[offset + size] = end - (offset + size);
+
+			mSizes[offset] = size;
+			return offset;
+		}
+
+		return InvalidOffset;
+	}
+
+	void Free(std::uint64_t offset)
+	{
+		auto s = mSizes.find(offset);
+		std::uint64_t size = s->second;
+		mSizes.erase(s);
+
+		auto next = mFree.lower_bound(offset);
+		if (next != mFree.end() && next->first == offset + size)
+		{
+			size += next->second;
+			next = mFree.erase(next);
+		}
+
+		if (next != mFree.begin())
+		{
+			auto prev = std::prev(next);
+			if (prev->first + prev->second == offset)
+			{
+				prev->second += size;
+				return;
+			}
+		}
+
+		mFree[offset] = size;
+	}
+
+	std::uint64_t LargestFreeBlock()const
+	{
+		std::uint64_t largest = 0;
+		for (const auto& f : mFree)
+			largest = std::max<std::uint64_t>(largest, f.second);
+		return largest;
+	}
+
+	std::uint64_t FreeBlocks()const { return mFree.size(); }
+
+private:
+	std::uint64_t mGranularity;
+	std::map<std::uint64_t, std::uint64_t> mFree;
+	std::map<std::uint64_t, std::uint64_t> mSizes;
+};
+
+struct Workload
+{
+	const char* Name;
+	std::uint64_t HeapSize;
+	std::uint64_t Granularity;
+	std::uint64_t Alignment;
+	std::uint64_t MinSize;
+	std::uint64_t MaxSize;
+};
+
+struct Result
+{
+	double Ms = 0.0;
+	std::uint64_t Allocations = 0;
+	std::uint64_t Failures = 0;
+	std::uint64_t LiveBuffers = 0;
+	std::uint64_t FreeBytes = 0;
+	std::uint64_t LargestFree = 0;
+	int Errors = 0;
+};
+
+struct Live
+{
+	std::uint64_t Offset;
+	std::uint64_t Size;
+};
+
+struct Pending
+{
+	std::uint64_t Offset;
+	std::uint64_t Size;
+	std::uint64_t Frame;
+};
+
+template<typename Allocator>
+static Result Run(Allocator& alloc, const Workload& w, std::uint64_t frames, unsigned seed, bool validate)
+{
+	using Clock = std::chrono::steady_clock;
+
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<double> logSize(std::log((double)w.MinSize), std::log((double)w.MaxSize));
+
+	std::vector<Live> live;
+	std::vector<Pending> pending;
+	std::map<std::uint64_t, std::uint64_t> shadow;
+
+	std::uint64_t used = 0;
+	const std::uint64_t target = w.HeapSize * 7 / 10;
+
+	Result r;
+	auto start = Clock::now();
+
+	for (std::uint64_t frame = 0; frame < frames; ++frame)
+	{
+		// Ranges of frames the GPU has finished become free.
+		auto last = std::remove_if(pending.begin(), pending.end(), [&](const Pending& p)
+		{
+			if (p.Frame + GpuLatency > frame)
+				return false;
+
+			alloc.Free(p.Offset);
+			if (validate)
+				shadow.erase(p.Offset);
+			return true;
+		});
+		pending.erase(last, pending.end());
+
+		for (int i = 0; i < 8; ++i)
+		{
+			std::uint64_t size = (std::uint64_t)std::exp(logSize(rng));
+			std::uint64_t offset = alloc.Allocate(size, w.Alignment);
+			r.Allocations++;
+
+			if (offset == InvalidOffset)
+			{
+				r.Failures++;
+				continue;
+			}
+
+			size = AlignUp(size, w.Granularity);
+			live.push_back({ offset, size });
+			used += size;
+
+			if (validate)
+			{
+				bool bad = offset % w.Alignment != 0 || offset + size > w.HeapSize;
+				auto next = shadow.lower_bound(offset);
+				if (next != shadow.end() && next->first < offset + size)
+					bad = true;
+				if (next != shadow.begin())
+				{
+					auto prev = std::prev(next);
+					if (prev->first + prev->second > offset)
+						bad = true;
+				}
+				if (bad && r.Errors++ < 10)
+					std::cout << "    frame " << frame << ": bad range at " << offset << "\n";
+				shadow[offset] = size;
+			}
+		}
+
+		while (used > target && !live.empty())
+		{
+			size_t i = rng() % live.size();
+			pending.push_back({ live[i].Offset, live[i].Size, frame });
+			used -= live[i].Size;
+			live[i] = live.back();
+			live.pop_back();
+		}
+	}
+
+	r.Ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	r.LiveBuffers = live.size();
+	r.FreeBytes = w.HeapSize - used;
+	for (const auto& p : pending)
+		r.FreeBytes -= p.Size;
+	r.LargestFree = alloc.LargestFreeBlock();
+
+	return r;
+}
+
+template<typename Allocator>
+static void Report(const char* name, const Workload& w, std::uint64_t frames, unsigned seed, int& errors)
+{
+	Result check;
+	{
+		Allocator alloc(w.HeapSize, w.Granularity);
+		check = Run(alloc, w, frames, seed, true);
+	}
+
+	Allocator alloc(w.HeapSize, w.Granularity);
+	Result r = Run(alloc, w, frames, seed, false);
+
+	double fragmentation = r.FreeBytes > 0 ? 1.0 - (double)r.LargestFree / (double)r.FreeBytes : 0.0;
+
+	std::cout << "  " << std::left << std::setw(10) << name << std::right
+		<< std::setw(9) << r.Ms * 1e6 / r.Allocations << " ns/alloc"
+		<< std::setw(8) << r.Failures << " failed"
+		<< "  fragmentation " << std::setw(5) << fragmentation * 100.0 << "%"
+		<< "  largest free " << std::setw(6) << r.LargestFree / 1024 << " KB";
+	if (check.Errors != 0)
+		std::cout << "  " << check.Errors << " BAD RANGES";
+	std::cout << "\n";
+
+	errors += check.Errors;
+}
+
+int main(int argc, char* argv[])
+{
+	std::uint64_t frames = 20000;
+	unsigned seed = 1;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "-f") == 0)
+			frames = std::strtoull(argv[i + 1], nullptr, 10);
+		else if (std::strcmp(argv[i], "-s") == 0)
+			seed = (unsigned)std::atoi(argv[i + 1]);
+	}
+
+	const Workload workloads[] =
+	{
+		{ "placed", 256ull << 20, 64 * 1024, 64 * 1024, 4 * 1024, 4ull << 20 },
+		{ "small", 16ull << 20, 256, 256, 256, 64 * 1024 },
+	};
+
+	std::cout << std::fixed << std::setprecision(1);
+
+	int errors = 0;
+	for (const auto& w : workloads)
+	{
+		std::cout << w.Name << ": " << frames << " frames\n";
+		Report<TlsfAllocator>("tlsf", w, frames, seed, errors);
+		Report<FirstFitAllocator>("first fit", w, frames, seed, errors);
+
+		// Live buffers at the end of the run, which committed resources would each
+		// have given an implicit heap.
+		Result r;
+		{
+			TlsfAllocator alloc(w.HeapSize, w.Granularity);
+			r = Run(alloc, w, frames, seed, false);
+		}
+		std::cout << "  one heap each: " << r.LiveBuffers << " heaps instead of 1\n";
+	}
+
+	std::cout << (errors == 0 ? "passed\n" : "FAILED\n");
+	return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,200 @@
+//***************************************************************************************
+// main.cpp - measures the cost of a Profiler scope and checks what the profiler records
+// while other threads read it.
+//
+// Usage:
+//   ProfilerBench [-f frames] [-t threads] [-o trace.json]
+//
+// Each thread runs 'frames' frames of the tree billboards app's scope tree (Update with
+// WaitForFrame, UpdateObjectCBs and UpdateWaves under it, then Draw) with a little
+// work in each, while the main thread collects and summarizes the history over and
+// over.  Prints
+//   -the time of an empty scope, enabled and disabled,
+//   -the summary: min, avg, p99 and max per scope,
+// and checks that every scope was recorded once per frame (or, past the ring's
+// capacity, that the newest frames were kept), that nested scopes lie inside their
+// parent, and that the Chrome trace holds every event.  -o also writes the trace.
+//
+// Build:
+//   g++ -std=c++17 -O2 -pthread main.cpp ../../Common/Profiler.cpp -o ProfilerBench
+//***************************************************************************************
+
+#include "../../Common/Profiler.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static thread_local std::uint64_t tSink = 0;
+
+static void Work(int iterations)
+{
+	std::uint64_t x = tSink;
+	for (int i = 0; i < iterations; ++i)
+		x = x * 6364136223846793005ull + 1442695040888963407ull;
+	tSink = x;
+}
+
+static void RunFrames(int frames)
+{
+	for (int f = 0; f < frames; ++f)
+	{
+		{
+			PROFILE_SCOPE("Update");
+			{
+				PROFILE_SCOPE("WaitForFrame");
+				Work(100);
+			}
+			{
+				PROFILE_SCOPE("UpdateObjectCBs");
+				Work(400);
+			}
+			{
+				PROFILE_SCOPE("UpdateWaves");
+				Work(200);
+			}
+		}
+		{
+			PROFILE_SCOPE("Draw");
+			Work(800);
+		}
+	}
+}
+
+static double ScopeNs(int count)
+{
+	auto start = HighResClock::Now();
+	for (int i = 0; i < count; ++i)
+	{
+		PROFILE_SCOPE("Empty");
+	}
+	return (double)(HighResClock::Now() - start) / count;
+}
+
+int main(int argc, char* argv[])
+{
+	int frames = 2000;
+	int threads = 4;
+	const char* tracePath = nullptr;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "-f") == 0)
+			frames = std::atoi(argv[i + 1]);
+		else if (std::strcmp(argv[i], "-t") == 0)
+			threads = std::max<int>(1, std::atoi(argv[i + 1]));
+		else if (std::strcmp(argv[i], "-o") == 0)
+			tracePath = argv[i + 1];
+	}
+
+	const int scopeCount = 1000000;
+	double enabledNs = ScopeNs(scopeCount);
+	Profiler::SetEnabled(false);
+	double disabledNs = ScopeNs(scopeCount);
+	Profiler::SetEnabled(true);
+	Profiler::Clear();
+
+	std::atomic<int> running(threads);
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; ++t)
+	{
+		workers.emplace_back([&]()
+		{
+			RunFrames(frames);
+			running--;
+		});
+	}
+
+	int reads = 0;
+	while (running > 0)
+	{
+		Profiler::Summarize();
+		reads++;
+	}
+	for (auto& w : workers)
+		w.join();
+
+	std::vector<Profiler::Event> events = Profiler::Collect();
+	std::vector<Profiler::ScopeStats> stats = Profiler::Summarize(events);
+
+	int errors = 0;
+
+	// Every thread keeps its newest events, 5 per frame; past the ring's capacity the
+	// oldest frame kept may be partial.
+	const std::uint64_t keptFrames = std::min<std::uint64_t>(frames, Profiler::EventsPerThread / 5);
+	const std::uint64_t partial = (std::uint64_t)frames > keptFrames ? threads : 0;
+	for (const auto& s : stats)
+	{
+		std::uint32_t depth = s.Name == "Update" || s.Name == "Draw" ? 0 : 1;
+		if (s.Depth != depth || s.Count < keptFrames * threads || s.Count > keptFrames * threads + partial)
+		{
+			std::cout << "  " << s.Name << ": " << s.Count << " at depth " << s.Depth << ", expected "
+				<< keptFrames * threads << " at depth " << depth << "\n";
+			errors++;
+		}
+	}
+	if (stats.size() != 5)
+	{
+		std::cout << "  " << stats.size() << " scopes, expected 5\n";
+		errors++;
+	}
+
+	// Children start after and end before the parent opened last on their thread.
+	std::vector<const Profiler::Event*> parents(threads + 1, nullptr);
+	for (const auto& e : events)
+	{
+		if (e.End < e.Start || e.Thread >= parents.size())
+		{
+			errors++;
+			continue;
+		}
+
+		if (e.Depth == 0)
+		{
+			parents[e.Thread] = &e;
+		}
+		else
+		{
+			const Profiler::Event* p = parents[e.Thread];
+			if (p == nullptr || std::strcmp(p->Name, "Update") != 0 || e.Start < p->Start || e.End > p->End)
+				errors++;
+		}
+	}
+
+	std::ostringstream trace;
+	Profiler::WriteChromeTrace(trace, events);
+	std::string json = trace.str();
+	size_t traced = 0;
+	for (size_t at = json.find("\"ph\":\"X\""); at != std::string::npos; at = json.find("\"ph\":\"X\"", at + 1))
+		traced++;
+	if (traced != events.size() || json.front() != '{' || json.compare(json.size() - 3, 3, "]}\n") != 0)
+	{
+		std::cout << "  trace holds " << traced << " of " << events.size() << " events\n";
+		errors++;
+	}
+
+	if (tracePath != nullptr)
+		std::ofstream(tracePath) << json;
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "scope: " << enabledNs << " ns enabled, " << disabledNs << " ns disabled\n";
+	std::cout << threads << " threads x " << frames << " frames, " << events.size() << " events, "
+		<< reads << " summaries taken while recording\n";
+	std::cout << std::setprecision(4);
+	for (const auto& s : stats)
+	{
+		std::cout << "  " << std::string(2 * s.Depth, ' ') << std::left << std::setw(18 - 2 * s.Depth) << s.Name
+			<< std::right << " n " << s.Count << "  min " << s.MinMs << "  avg " << s.AvgMs
+			<< "  p99 " << s.P99Ms << "  max " << s.MaxMs << " ms\n";
+	}
+	std::cout << (errors == 0 ? "passed\n" : "FAILED\n");
+
+	return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+//***************************************************************************************
+// main.cpp - times recording a sorted DrawQueue on one thread and split across threads.
+//
+// Usage:
+//   RecordBench [-r repeats] [-j maxThreads]
+//
+// For 10k, 100k and 1M packets spread over 4 layers, sorts the queue, then records it
+//   -into one command buffer with DrawQueue::Submit, and
+//   -split with SplitByLayer into one command buffer per range with SubmitParallel,
+//    on 1, 2, 4, ... up to maxThreads threads,
+// and prints draws recorded per millisecond.  The command buffers are a no-op backend
+// that encodes each call into a byte vector the way a driver appends to a command
+// list, so no device is needed.  Each parallel buffer is checked against recording its
+// range on the calling thread.
+//
+// Build (DrawQueue only needs the D3D12 type declarations; on Linux point -I at a
+// checkout of the DirectX-Headers project):
+//   g++ -std=c++17 -O2 -pthread -I<DirectX-Headers>/include/directx
+//       -I<DirectX-Headers>/include/wsl/stubs main.cpp ../../Common/DrawQueue.cpp
+//       ../../Common/JobSystem.cpp -o RecordBench
+//***************************************************************************************
+
+#include "../../Common/DrawQueue.h"
+#include "../../Common/JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+template<typename Fn>
+static double Measure(int repeats, Fn fn)
+{
+	using Clock = std::chrono::steady_clock;
+
+	fn();
+
+	auto start = Clock::now();
+	for (int r = 0; r < repeats; ++r)
+		fn();
+	auto end = Clock::now();
+
+	return std::chrono::duration<double, std::milli>(end - start).count() / repeats;
+}
+
+// Appends every call as an opcode and its arguments.
+class CommandBufferSink : public DrawCommandSink
+{
+public:
+	void Reset() { mBytes.clear(); }
+	const std::vector<unsigned char>& Bytes()const { return mBytes; }
+
+	virtual void SetPipelineState(ID3D12PipelineState* pso)override { Put(1, &pso, sizeof(pso)); }
+	virtual void SetGeometry(const MeshGeometry* geo)override { Put(2, &geo, sizeof(geo)); }
+	virtual void SetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)override { Put(3, &topology, sizeof(topology)); }
+	virtual void SetTexture(UINT textureIndex)override { Put(4, &textureIndex, sizeof(textureIndex)); }
+	virtual void SetMaterialConstants(UINT materialCBIndex)override { Put(5, &materialCBIndex, sizeof(materialCBIndex)); }
+	virtual void SetObjectConstants(UINT objectCBIndex)override { Put(6, &objectCBIndex, sizeof(objectCBIndex)); }
+	virtual void SetInstanceData(UINT firstInstance)override { Put(7, &firstInstance, sizeof(firstInstance)); }
+
+	virtual void DrawIndexed(UINT indexCount, UINT instanceCount, UINT startIndexLocation, int baseVertexLocation)override
+	{
+		UINT args[4] = { indexCount, instanceCount, startIndexLocation, (UINT)baseVertexLocation };
+		Put(8, args, sizeof(args));
+	}
+
+private:
+	void Put(unsigned char op, const void* args, size_t size)
+	{
+		size_t at = mBytes.size();
+		mBytes.resize(at + 1 + size);
+		mBytes[at] = op;
+		std::memcpy(&mBytes[at + 1], args, size);
+	}
+
+private:
+	std::vector<unsigned char> mBytes;
+};
+
+static void BuildQueue(std::uint32_t count, DrawQueue& queue)
+{
+	// Only the addresses of the PSOs and geometries are used.
+	static unsigned char psos[16];
+	static unsigned char geos[64];
+
+	std::mt19937 rng(count);
+	std::uniform_int_distribution<UINT> layerDist(0, 3), psoDist(0, 15), geoDist(0, 63), matDist(0, 255);
+	std::uniform_real_distribution<float> depthDist(0.0f, 1.0f);
+
+	queue.Clear();
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		UINT layer = layerDist(rng);
+		UINT pso = psoDist(rng);
+		UINT geo = geoDist(rng);
+		UINT mat = matDist(rng);
+		float depth = depthDist(rng);
+
+		DrawPacket p;
+		p.SortKey = layer == 1 ?
+			DrawSortKey::BackToFront(layer, pso, mat, geo, depth) :
+			DrawSortKey::Opaque(layer, pso, mat, geo, depth);
+		p.Pso = (ID3D12PipelineState*)&psos[pso];
+		p.Geo = (MeshGeometry*)&geos[geo];
+		p.TextureIndex = mat % 32;
+		p.MaterialCBIndex = mat;
+		p.ObjectCBIndex = i;
+		p.IndexCount = 36;
+		queue.Add(p);
+	}
+
+	queue.Sort();
+}
+
+static void Run(std::uint32_t count, int repeats, unsigned maxThreads)
+{
+	std::cout << count << " packets\n";
+
+	DrawQueue queue;
+	BuildQueue(count, queue);
+
+	CommandBufferSink single;
+	double serial = Measure(repeats, [&]()
+	{
+		single.Reset();
+		queue.Submit(single);
+	});
+	std::cout << "  1 list              " << serial << " ms  " << count / serial << " draws/ms\n";
+
+	for (unsigned threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		JobSystem jobs(threads - 1);
+
+		std::vector<PacketRange> ranges;
+		queue.SplitByLayer(ranges, std::max<std::uint32_t>(64, (count + threads - 1) / threads));
+
+		std::vector<std::unique_ptr<CommandBufferSink>> sinks;
+		std::vector<DrawCommandSink*> sinkPtrs;
+		for (size_t i = 0; i < ranges.size(); ++i)
+		{
+			sinks.push_back(std::make_unique<CommandBufferSink>());
+			sinkPtrs.push_back(sinks.back().get());
+		}
+
+		double parallel = Measure(repeats, [&]()
+		{
+			for (auto& s : sinks)
+				s->Reset();
+			queue.SubmitParallel(jobs, ranges, sinkPtrs.data());
+		});
+
+		bool same = true;
+		for (size_t i = 0; i < ranges.size(); ++i)
+		{
+			CommandBufferSink check;
+			queue.Submit(check, ranges[i]);
+			same = same && check.Bytes() == sinks[i]->Bytes();
+		}
+
+		std::cout << "  " << std::setw(2) << ranges.size() << " lists " << std::setw(2) << threads << " threads  "
+			<< parallel << " ms  " << count / parallel << " draws/ms  "
+			<< (same ? "(same commands)" : "(MISMATCH)") << "\n";
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int repeats = 5;
+	unsigned maxThreads = std::thread::hardware_concurrency();
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "-r") == 0)
+			repeats = std::atoi(argv[i + 1]);
+		else if (std::strcmp(argv[i], "-j") == 0)
+			maxThreads = (unsigned)std::atoi(argv[i + 1]);
+	}
+
+	maxThreads = std::max<unsigned>(maxThreads, 1);
+
+	std::cout << std::fixed << std::setprecision(3);
+
+	for (std::uint32_t count : { 10000u, 100000u, 1000000u })
+		Run(count, repeats, maxThreads);
+
+	return 0;
+}
@@ -0,0 +1,194 @@
+//***************************************************************************************
+// main.cpp - measures the per-frame object constant update at different scene sizes.
+//
+// Usage:
+//   SceneBench [-r repeats] [-d dirtyPercent] [-j maxThreads]
+//
+// For 10k, 100k and 1M items compares
+//   -"items": one heap allocated item per object holding its matrices, every item
+//    transposed and copied one at a time into the frame's constants (the RenderItem
+//    path), with
+//   -"store": SceneStore, which transposes only the dirty items into its packed
+//    constant array and streams the whole array into the frame's constants,
+//   -"store xN": the same split into chunks run on a JobSystem with N threads, as
+//    TreeBillboardsApp::UpdateObjectCBs does, for N = 2, 4, ... up to maxThreads.
+// Both rewrite every item's constants each frame, as the upload ring requires.  The
+// destination is a plain heap buffer standing in for the mapped upload heap.
+//
+// Build (DirectXMath is header only; on Linux point -I at a checkout of its Inc folder):
+//   g++ -std=c++17 -O2 -pthread -I<DirectXMath>/Inc main.cpp ../../Common/SceneStore.cpp
+//       ../../Common/JobSystem.cpp -o SceneBench
+//***************************************************************************************
+
+#include "../../Common/JobSystem.h"
+#include "../../Common/SceneStore.h"
+#include "../../Common/UploadCopy.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+struct Item
+{
+	XMFLOAT4X4 World;
+	XMFLOAT4X4 TexTransform;
+	std::uint32_t ObjCBIndex = 0;
+};
+
+template<typename Fn>
+static double Measure(int repeats, Fn fn)
+{
+	using Clock = std::chrono::steady_clock;
+
+	fn();
+
+	auto start = Clock::now();
+	for (int r = 0; r < repeats; ++r)
+		fn();
+	auto end = Clock::now();
+
+	return std::chrono::duration<double, std::milli>(end - start).count() / repeats;
+}
+
+static XMFLOAT4X4 Translation(float x, float y, float z)
+{
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, XMMatrixTranslation(x, y, z));
+	return m;
+}
+
+static const std::uint32_t ObjectsPerJob = 1024;
+
+static void Run(std::uint32_t count, int repeats, int dirtyPercent, unsigned maxThreads)
+{
+	std::mt19937 rng(count);
+	std::vector<std::uint32_t> dirty;
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		if ((int)(rng() % 100) < dirtyPercent)
+			dirty.push_back(i);
+	}
+
+	std::vector<std::unique_ptr<Item>> items;
+	SceneStore store;
+	std::vector<SceneStore::Handle> handles;
+
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		auto item = std::make_unique<Item>();
+		item->World = Translation((float)i, 0.0f, 0.0f);
+		item->TexTransform = identity;
+		item->ObjCBIndex = i;
+		items.push_back(std::move(item));
+
+		handles.push_back(store.Create(Translation((float)i, 0.0f, 0.0f), identity));
+	}
+
+	auto upload = std::unique_ptr<SceneStore::ObjectData[]>(new SceneStore::ObjectData[count]);
+	auto mapped = reinterpret_cast<std::uint8_t*>(upload.get());
+
+	float t = 0.0f;
+
+	double itemMs = Measure(repeats, [&]()
+	{
+		t += 1.0f;
+		for (std::uint32_t i : dirty)
+			items[i]->World = Translation(t, (float)i, 0.0f);
+
+		for (auto& e : items)
+		{
+			XMMATRIX world = XMLoadFloat4x4(&e->World);
+			XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
+
+			SceneStore::ObjectData objConstants;
+			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
+			XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
+
+			std::memcpy(mapped + (std::size_t)e->ObjCBIndex * SceneStore::ConstantsStride,
+				&objConstants, 2 * sizeof(XMFLOAT4X4));
+		}
+	});
+
+	double storeMs = Measure(repeats, [&]()
+	{
+		t += 1.0f;
+		for (std::uint32_t i : dirty)
+			store.SetWorld(handles[i], Translation(t, (float)i, 0.0f));
+
+		store.UpdateConstants();
+
+		UploadCopy::Stream(mapped, SceneStore::ConstantsStride, store.Constants(),
+			SceneStore::ConstantsStride, SceneStore::ConstantsStride, store.Size());
+		UploadCopy::Fence();
+	});
+
+	std::cout << std::fixed << std::setprecision(3) << std::setw(8) << count << " items, "
+		<< dirty.size() << " dirty: items " << itemMs << " ms, store " << storeMs << " ms";
+
+	for (unsigned threads = 2; threads <= maxThreads; threads *= 2)
+	{
+		JobSystem jobs(threads - 1);
+
+		double parallelMs = Measure(repeats, [&]()
+		{
+			t += 1.0f;
+			for (std::uint32_t i : dirty)
+				store.SetWorld(handles[i], Translation(t, (float)i, 0.0f));
+
+			jobs.ParallelFor(store.Size(), ObjectsPerJob, [&](std::uint32_t begin, std::uint32_t end)
+			{
+				store.UpdateConstants(begin, end);
+
+				UploadCopy::Stream(mapped + (std::size_t)begin * SceneStore::ConstantsStride,
+					SceneStore::ConstantsStride, store.Constants() + begin,
+					SceneStore::ConstantsStride, SceneStore::ConstantsStride, end - begin);
+				UploadCopy::Fence();
+			});
+		});
+
+		std::cout << ", store x" << threads << " " << parallelMs << " ms";
+	}
+
+	std::cout << "\n";
+}
+
+int main(int argc, char* argv[])
+{
+	int repeats = 20;
+	int dirtyPercent = 10;
+	unsigned maxThreads = std::thread::hardware_concurrency();
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+			repeats = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+			dirtyPercent = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+			maxThreads = (unsigned)std::atoi(argv[++i]);
+		else
+		{
+			std::cerr << "Usage: SceneBench [-r repeats] [-d dirtyPercent] [-j maxThreads]\n";
+			return 1;
+		}
+	}
+
+	if (repeats <= 0)
+		return 1;
+
+	for (std::uint32_t count : { 10000u, 100000u, 1000000u })
+		Run(count, repeats, dirtyPercent, maxThreads);
+
+	return 0;
+}
@@ -0,0 +1,310 @@
+//***************************************************************************************
+// main.cpp - checks ShaderCache's keys and hit/miss logic without the shader compiler.
+//
+// Usage:
+//   ShaderCacheCheck [-s shaderDir] [-n iterations]
+//
+// The app's shaders (Default.hlsl, TreeSprite.hlsl and the LightingUtil.hlsl both
+// include) are loaded into an in-memory Storage.  Checks that:
+//   -the same compile gives the same key, and editing the source, an included file, a
+//    define, the entry point, the target, the flags or the salt gives a new one;
+//   -a missing source makes no key, a missing include is part of the key, and an
+//    include cycle terminates;
+//   -the app's seven compiles miss and are stored on the first launch and all hit on
+//    the second, on disk through DiskStorage in a scratch directory;
+// then times making the seven keys, which is what a launch with a warm cache pays
+// instead of compiling.
+//
+// Build:
+//   g++ -std=c++17 -O2 main.cpp ../../Common/ShaderCache.cpp -o ShaderCacheCheck
+//***************************************************************************************
+
+#include "../../Common/ShaderCache.h"
+#include "../../Common/HighResClock.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+	class MemoryStorage : public ShaderCache::Storage
+	{
+	public:
+		virtual bool Read(const std::string& path, std::string& contents)override
+		{
+			auto it = Files.find(path);
+			if (it == Files.end())
+				return false;
+			contents = it->second;
+			return true;
+		}
+
+		virtual bool Write(const std::string& path, const void* data, std::uint64_t byteSize)override
+		{
+			Files[path].assign(static_cast<const char*>(data), (size_t)byteSize);
+			return true;
+		}
+
+		virtual bool Exists(const std::string& path)override
+		{
+			return Files.count(path) != 0;
+		}
+
+		std::map<std::string, std::string> Files;
+	};
+
+	struct Compile
+	{
+		const char* File;
+		std::vector<ShaderCache::Define> Defines;
+		const char* Entry;
+		const char* Target;
+	};
+
+	// BuildShadersAndInputLayout's compiles, with bindless off.
+	std::vector<Compile> AppCompiles()
+	{
+		std::vector<ShaderCache::Define> fog = { { "FOG", "1" }, { "BINDLESS", "0" }, { "BINDLESS_TEXTURE_COUNT", "256" } };
+		std::vector<ShaderCache::Define> alphaTest = { { "FOG", "1" }, { "ALPHA_TEST", "1" }, { "BINDLESS", "0" }, { "BINDLESS_TEXTURE_COUNT", "256" } };
+		std::vector<ShaderCache::Define> instanced = { { "INSTANCED", "1" } };
+
+		return {
+			{ "Shaders/Default.hlsl", {}, "VS", "vs_5_1" },
+			{ "Shaders/Default.hlsl", instanced, "VS", "vs_5_1" },
+			{ "Shaders/Default.hlsl", fog, "PS", "ps_5_1" },
+			{ "Shaders/Default.hlsl", alphaTest, "PS", "ps_5_1" },
+			{ "Shaders/TreeSprite.hlsl", {}, "VS", "vs_5_1" },
+			{ "Shaders/TreeSprite.hlsl", {}, "GS", "gs_5_1" },
+			{ "Shaders/TreeSprite.hlsl", alphaTest, "PS", "ps_5_1" },
+		};
+	}
+
+	std::string KeyOf(ShaderCache& cache, const Compile& c, std::uint32_t flags = 0)
+	{
+		std::string key;
+		if (!cache.MakeKey(c.File, c.Defines, c.Entry, c.Target, flags, key))
+			return "<none>";
+		return key;
+	}
+
+	int gErrors = 0;
+
+	void Check(bool ok, const char* what)
+	{
+		if (!ok)
+		{
+			std::cout << "  FAILED: " << what << "\n";
+			gErrors++;
+		}
+	}
+
+	// Stand-in for d3dUtil::CompileShader(ShaderCache&, ...): the "bytecode" is the key.
+	int Launch(ShaderCache& cache, const std::vector<Compile>& compiles)
+	{
+		int compiled = 0;
+		for (const Compile& c : compiles)
+		{
+			std::string key = KeyOf(cache, c);
+			if (cache.Lookup(key))
+				continue;
+
+			compiled++;
+			cache.Store(key, key.data(), key.size());
+		}
+		return compiled;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string shaderDir = "../../Week2Solution/Week2Project/Shaders";
+	int iterations = 10000;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "-s") == 0)
+			shaderDir = argv[i + 1];
+		else if (std::strcmp(argv[i], "-n") == 0)
+			iterations = std::max(1, std::atoi(argv[i + 1]));
+	}
+
+	std::unique_ptr<MemoryStorage> owned(new MemoryStorage());
+	MemoryStorage& files = *owned;
+	for (const char* name : { "Default.hlsl", "TreeSprite.hlsl", "LightingUtil.hlsl" })
+	{
+		std::ifstream fin(shaderDir + "/" + name, std::ios::binary);
+		if (!fin)
+		{
+			std::cout << "Can not read " << shaderDir << "/" << name << "\n";
+			return 1;
+		}
+		files.Files[std::string("Shaders/") + name].assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+	}
+
+	ShaderCache cache("Cache", "d3dcompiler_47", std::move(owned));
+	std::vector<Compile> compiles = AppCompiles();
+
+	std::cout << "Keys:\n";
+	std::vector<std::string> keys;
+	for (const Compile& c : compiles)
+	{
+		keys.push_back(KeyOf(cache, c));
+		std::cout << "  " << c.File << " " << c.Entry << " -> " << keys.back() << "\n";
+	}
+
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		Check(KeyOf(cache, compiles[i]) == keys[i], "same compile, same key");
+		for (size_t j = 0; j < i; ++j)
+			Check(keys[i] != keys[j], "different compiles, different keys");
+	}
+
+	// Every input the compile depends on changes the key.
+	const Compile& ps = compiles[3];
+	std::string psKey = keys[3];
+	{
+		Compile c = ps;
+		c.Defines[1].Value = "0";
+		Check(KeyOf(cache, c) != psKey, "define value");
+		c = ps;
+		c.Defines.push_back({ "NUM_DIR_LIGHTS", "3" });
+		Check(KeyOf(cache, c) != psKey, "added define");
+		c = ps;
+		std::swap(c.Defines[0], c.Defines[1]);
+		Check(KeyOf(cache, c) != psKey, "define order");
+		c = ps;
+		c.Defines[0] = { "FO", "G1" };
+		Check(KeyOf(cache, c) != psKey, "define name and value boundary");
+		c = ps;
+		c.Entry = "VS";
+		Check(KeyOf(cache, c) != psKey, "entry point");
+		c = ps;
+		c.Target = "ps_5_0";
+		Check(KeyOf(cache, c) != psKey, "target");
+		Check(KeyOf(cache, ps, 1) != psKey, "flags");
+
+		MemoryStorage* other = new MemoryStorage(files);
+		ShaderCache salted("Cache", "d3dcompiler_48", std::unique_ptr<ShaderCache::Storage>(other));
+		Check(KeyOf(salted, ps) != psKey, "salt");
+	}
+
+	// Source and include edits.
+	{
+		std::string original = files.Files["Shaders/Default.hlsl"];
+		files.Files["Shaders/Default.hlsl"] += " ";
+		Check(KeyOf(cache, ps) != psKey, "source edit");
+		Check(KeyOf(cache, compiles[4]) == keys[4], "unrelated source edit");
+		files.Files["Shaders/Default.hlsl"] = original;
+
+		original = files.Files["Shaders/LightingUtil.hlsl"];
+		files.Files["Shaders/LightingUtil.hlsl"][original.size() / 2] ^= 1;
+		Check(KeyOf(cache, ps) != psKey, "include edit changes the includer");
+		Check(KeyOf(cache, compiles[4]) != keys[4], "include edit changes the other includer");
+		files.Files["Shaders/LightingUtil.hlsl"] = original;
+
+		Check(KeyOf(cache, ps) == psKey, "edits undone, key restored");
+	}
+
+	// Missing files and cycles.
+	{
+		Compile c = ps;
+		c.File = "Shaders/Missing.hlsl";
+		Check(KeyOf(cache, c) == "<none>", "missing source makes no key");
+
+		files.Files["Cycle/A.hlsl"] = "#include \"B.hlsl\"\n  #  include \"Inc/C.hlsl\"\nfloat a;\n";
+		files.Files["Cycle/B.hlsl"] = "#include \"A.hlsl\"\nfloat b;\n";
+		c.File = "Cycle/A.hlsl";
+		std::string missingKey = KeyOf(cache, c);
+		Check(missingKey != "<none>", "missing include still makes a key");
+
+		files.Files["Cycle/Inc/C.hlsl"] = "float c;\n";
+		std::string cycleKey = KeyOf(cache, c);
+		Check(cycleKey != missingKey, "include appearing changes the key");
+
+		files.Files["Cycle/Inc/C.hlsl"] = "float c2;\n";
+		Check(KeyOf(cache, c) != cycleKey, "nested include edit");
+
+		files.Files["Cycle/B.hlsl"] += "// comment\n";
+		Check(KeyOf(cache, c) != cycleKey, "edit in cycle");
+	}
+
+	// Two launches in memory: everything compiles once.
+	{
+		int first = Launch(cache, compiles);
+		int second = Launch(cache, compiles);
+		const ShaderCache::Stats& stats = cache.GetStats();
+		std::cout << "In memory: first launch compiled " << first << ", second " << second
+			<< " (" << stats.Hits << " hits, " << stats.Misses << " misses, " << stats.Stores << " stores)\n";
+		Check(first == (int)compiles.size() && second == 0, "second launch compiles nothing");
+		Check(stats.Hits == compiles.size() && stats.Misses == compiles.size() && stats.Stores == compiles.size(), "stats");
+	}
+
+	// The same on disk, in a directory that does not exist yet.
+	{
+		std::string dir = "ShaderCacheCheck.tmp";
+		// DiskStorage reads the sources from disk too, so point the compiles at shaderDir.
+		std::vector<Compile> diskCompiles = compiles;
+		for (Compile& c : diskCompiles)
+			c.File = std::strstr(c.File, "Default") ? "Default.hlsl" : "TreeSprite.hlsl";
+		std::vector<std::string> paths;
+		for (Compile& c : diskCompiles)
+			paths.push_back(shaderDir + "/" + c.File);
+		for (size_t i = 0; i < diskCompiles.size(); ++i)
+			diskCompiles[i].File = paths[i].c_str();
+
+		int first = 0, second = 0;
+		std::string firstPath;
+		for (int launch = 0; launch < 2; ++launch)
+		{
+			ShaderCache disk(dir);
+			int compiled = Launch(disk, diskCompiles);
+			(launch == 0 ? first : second) = compiled;
+			Check(disk.GetStats().StoreFailures == 0, "disk stores");
+			if (launch == 0)
+				firstPath = disk.EntryPath(KeyOf(disk, diskCompiles[0]));
+		}
+
+		std::ifstream fin(firstPath, std::ios::binary);
+		std::string stored((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+		fin.close();
+		std::cout << "On disk: first launch compiled " << first << ", second " << second
+			<< "; " << firstPath << " holds " << stored.size() << " bytes\n";
+		Check(first == (int)compiles.size() && second == 0, "second launch from disk compiles nothing");
+		Check(!stored.empty() && firstPath.find(stored) != std::string::npos, "stored entry reads back");
+
+		ShaderCache disk(dir);
+		for (const Compile& c : diskCompiles)
+			std::remove(disk.EntryPath(KeyOf(disk, c)).c_str());
+#if defined(_WIN32)
+		_rmdir(dir.c_str());
+#else
+		rmdir(dir.c_str());
+#endif
+	}
+
+	// Cost of a warm launch: one key per compile, reading the sources from memory.
+	HighResClock::Ticks start = HighResClock::Now();
+	std::uint64_t sink = 0;
+	for (int i = 0; i < iterations; ++i)
+	{
+		for (const Compile& c : compiles)
+			sink += KeyOf(cache, c).size();
+	}
+	double us = HighResClock::ToMicroseconds(HighResClock::Now() - start) / ((double)iterations * compiles.size());
+	std::cout << "Key: " << us << " us per compile (" << sink % 10 << ")\n";
+
+	std::cout << (gErrors == 0 ? "passed" : "FAILED") << "\n";
+	return gErrors == 0 ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+//***************************************************************************************
+// main.cpp - packs the tree billboards app's shapes with GeometryPacker and reports the
+// buffer memory against one vertex and index buffer per shape.
+//
+// Usage:
+//   ShapePack [-r repeats]
+//
+// Builds the same GeometryGenerator shapes as TreeBillboardsApp::Initialize, in the
+// app's vertex layout, and prints
+//   -the shapes and unique shapes, and the bytes of the packed buffers against the
+//    separate ones, both raw and rounded to the 64KB pages a placed buffer takes,
+//   -the time to pack them,
+// and checks that every shape's range in the packed arrays holds its own vertices and
+// indices.
+//
+// Build (DirectXMath is header only; on Linux point -I at a checkout of its Inc folder):
+//   g++ -std=c++17 -O2 -I<DirectXMath>/Inc main.cpp ../../Common/GeometryPacker.cpp
+//       ../../Common/GeometryGenerator.cpp -o ShapePack
+//***************************************************************************************
+
+#include "../../Common/GeometryPacker.h"
+#include "../../Common/GeometryGenerator.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+// Same layout as the app's Vertex.
+struct Vertex
+{
+	XMFLOAT3 Pos;
+	XMFLOAT3 Normal;
+	XMFLOAT2 TexC;
+};
+
+struct Shape
+{
+	std::string Name;
+	std::vector<Vertex> Vertices;
+	std::vector<std::uint16_t> Indices;
+};
+
+static const std::uint64_t Page = 64 * 1024;
+
+static std::uint64_t Pages(std::uint64_t bytes)
+{
+	return (bytes + Page - 1) / Page * Page;
+}
+
+static Shape MakeShape(const char* name, GeometryGenerator::MeshData mesh)
+{
+	Shape s;
+	s.Name = name;
+	s.Vertices.resize(mesh.Vertices.size());
+	for (size_t i = 0; i < mesh.Vertices.size(); ++i)
+	{
+		s.Vertices[i].Pos = mesh.Vertices[i].Position;
+		s.Vertices[i].Normal = mesh.Vertices[i].Normal;
+		s.Vertices[i].TexC = mesh.Vertices[i].TexC;
+	}
+	s.Indices = mesh.GetIndices16();
+	return s;
+}
+
+int main(int argc, char* argv[])
+{
+	int repeats = 100;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "-r") == 0)
+			repeats = std::atoi(argv[i + 1]);
+	}
+
+	GeometryGenerator geoGen;
+	std::vector<Shape> shapes;
+	shapes.push_back(MakeShape("Box", geoGen.CreateBox(1.0f, 1.0f, 1.0f, 0)));
+	shapes.push_back(MakeShape("Box2", geoGen.CreateBox(1.0f, 1.0f, 1.0f, 0)));
+	shapes.push_back(MakeShape("Box3", geoGen.CreateBox(1.0f, 1.0f, 1.0f, 0)));
+	shapes.push_back(MakeShape("Cylinder", geoGen.CreateCylinder(1.0f, 1.0f, 1.0f, 30, 1)));
+	shapes.push_back(MakeShape("Sphere", geoGen.CreateSphere(1.0f, 30, 30)));
+	shapes.push_back(MakeShape("Grid", geoGen.CreateGrid(1.0f, 5.0f, 2, 2)));
+	shapes.push_back(MakeShape("Grid2", geoGen.CreateGrid(1.0f, 5.0f, 2, 2)));
+	shapes.push_back(MakeShape("Grid3", geoGen.CreateGrid(1.0f, 5.0f, 2, 2)));
+	shapes.push_back(MakeShape("Pyramid", geoGen.CreatePyramid(1.0f, 1.0f, 1.0f, 0)));
+	shapes.push_back(MakeShape("Cone2", geoGen.CreateCone(1.0f, 1.0f, 10, 2)));
+	shapes.push_back(MakeShape("Wedge", geoGen.CreateWedge(1.0f, 1.0f, 1.0f, 0)));
+	shapes.push_back(MakeShape("TriangularPrism", geoGen.CreateTriangularPrism(1.0f, 1.0f, 1.0f, 0)));
+	shapes.push_back(MakeShape("Diamond", geoGen.CreateDiamond(1.0f)));
+
+	auto pack = [&](GeometryPacker& packer, std::vector<GeometryPacker::Range>& ranges)
+	{
+		ranges.clear();
+		for (const auto& s : shapes)
+		{
+			ranges.push_back(packer.Add(s.Vertices.data(), (std::uint32_t)s.Vertices.size(),
+				s.Indices.data(), (std::uint32_t)s.Indices.size()));
+		}
+	};
+
+	using Clock = std::chrono::steady_clock;
+	auto start = Clock::now();
+	for (int r = 0; r < repeats; ++r)
+	{
+		GeometryPacker packer(sizeof(Vertex));
+		std::vector<GeometryPacker::Range> ranges;
+		pack(packer, ranges);
+	}
+	double packMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / repeats;
+
+	GeometryPacker packer(sizeof(Vertex));
+	std::vector<GeometryPacker::Range> ranges;
+	pack(packer, ranges);
+
+	int errors = 0;
+	std::uint64_t separateBytes = 0;
+	std::uint64_t separatePages = 0;
+	for (size_t i = 0; i < shapes.size(); ++i)
+	{
+		const Shape& s = shapes[i];
+		const GeometryPacker::Range& r = ranges[i];
+
+		std::uint64_t vb = s.Vertices.size() * sizeof(Vertex);
+		std::uint64_t ib = s.Indices.size() * sizeof(std::uint16_t);
+		separateBytes += vb + ib;
+		separatePages += Pages(vb) + Pages(ib);
+
+		bool ok = r.VertexCount == s.Vertices.size() && r.IndexCount == s.Indices.size() &&
+			std::memcmp(&packer.Vertices()[(size_t)r.BaseVertex * sizeof(Vertex)], s.Vertices.data(), vb) == 0 &&
+			std::memcmp(&packer.Indices()[r.StartIndex], s.Indices.data(), ib) == 0;
+		if (!ok)
+		{
+			std::cout << "  " << s.Name << ": range does not hold the shape\n";
+			errors++;
+		}
+	}
+
+	std::uint64_t packedBytes = packer.VertexBytes() + packer.IndexBytes();
+	std::uint64_t packedPages = Pages(packer.VertexBytes()) + Pages(packer.IndexBytes());
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << packer.GetStats().Meshes << " shapes, " << packer.GetStats().UniqueMeshes << " unique\n";
+	std::cout << "  separate: " << 2 * shapes.size() << " buffers, " << separateBytes / 1024.0 << " KB, "
+		<< separatePages / 1024 << " KB of heap\n";
+	std::cout << "  packed:   2 buffers, " << packedBytes / 1024.0 << " KB, " << packedPages / 1024 << " KB of heap\n";
+	std::cout << "  pack time " << packMs << " ms\n";
+	std::cout << (errors == 0 ? "passed\n" : "FAILED\n");
+
+	return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,564 @@
+//***************************************************************************************
+// TextureArrayAssembler.cpp
+//***************************************************************************************
+
+#include "TextureArrayAssembler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+	const std::uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+
+	// DDS_HEADER flags/caps we need to write a mipped 2D array.
+	const std::uint32_t DDSD_CAPS = 0x00000001;
+	const std::uint32_t DDSD_HEIGHT = 0x00000002;
+	const std::uint32_t DDSD_WIDTH = 0x00000004;
+	const std::uint32_t DDSD_PITCH = 0x00000008;
+	const std::uint32_t DDSD_PIXELFORMAT = 0x00001000;
+	const std::uint32_t DDSD_MIPMAPCOUNT = 0x00020000;
+	const std::uint32_t DDSD_LINEARSIZE = 0x00080000;
+	const std::uint32_t DDPF_FOURCC = 0x00000004;
+	const std::uint32_t DDSCAPS_COMPLEX = 0x00000008;
+	const std::uint32_t DDSCAPS_TEXTURE = 0x00001000;
+	const std::uint32_t DDSCAPS_MIPMAP = 0x00400000;
+	const std::uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+	const std::uint32_t BI_RGB = 0;
+	const std::uint32_t BI_BITFIELDS = 3;
+
+	std::uint16_t ReadU16(const std::uint8_t* p)
+	{
+		return (std::uint16_t)(p[0] | (p[1] << 8));
+	}
+
+	std::uint32_t ReadU32(const std::uint8_t* p)
+	{
+		return (std::uint32_t)p[0] | ((std::uint32_t)p[1] << 8) |
+			((std::uint32_t)p[2] << 16) | ((std::uint32_t)p[3] << 24);
+	}
+
+	void WriteU32(std::vector<std::uint8_t>& out, std::uint32_t v)
+	{
+		out.push_back((std::uint8_t)(v & 0xff));
+		out.push_back((std::uint8_t)((v >> 8) & 0xff));
+		out.push_back((std::uint8_t)((v >> 16) & 0xff));
+		out.push_back((std::uint8_t)((v >> 24) & 0xff));
+	}
+
+	// Extracts the channel selected by 'mask' and rescales it to 8 bits.
+	std::uint8_t ExtractChannel(std::uint32_t pixel, std::uint32_t mask, std::uint8_t fallback)
+	{
+		if (mask == 0)
+			return fallback;
+
+		std::uint32_t shift = 0;
+		while (((mask >> shift) & 1) == 0)
+			++shift;
+
+		std::uint32_t bits = 0;
+		while (shift + bits < 32 && ((mask >> (shift + bits)) & 1) != 0)
+			++bits;
+
+		std::uint64_t v = (pixel & mask) >> shift;
+		std::uint64_t maxV = (1ull << bits) - 1;
+		return (std::uint8_t)((v * 255 + maxV / 2) / maxV);
+	}
+
+	std::uint16_t PackRGB565(int r, int g, int b)
+	{
+		return (std::uint16_t)(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+	}
+
+	void UnpackRGB565(std::uint16_t c, int rgb[3])
+	{
+		int r = (c >> 11) & 31;
+		int g = (c >> 5) & 63;
+		int b = c & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+}
+
+TextureArrayAssembler::Image TextureArrayAssembler::LoadBmp(const std::string& filename)
+{
+	std::ifstream fin(filename, std::ios::binary);
+	if (!fin)
+		throw std::runtime_error("Cannot open " + filename);
+
+	std::vector<std::uint8_t> file((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+
+	// BITMAPFILEHEADER (14 bytes) + at least a BITMAPINFOHEADER (40 bytes).
+	if (file.size() < 54 || file[0] != 'B' || file[1] != 'M')
+		throw std::runtime_error(filename + " is not a BMP file");
+
+	std::uint32_t bitsOffset = ReadU32(&file[10]);
+	std::uint32_t infoSize = ReadU32(&file[14]);
+	std::int32_t width = (std::int32_t)ReadU32(&file[18]);
+	std::int32_t height = (std::int32_t)ReadU32(&file[22]);
+	std::uint16_t bitCount = ReadU16(&file[28]);
+	std::uint32_t compression = ReadU32(&file[30]);
+
+	if (infoSize < 40 || 14 + (std::uint64_t)infoSize > file.size())
+		throw std::runtime_error(filename + " has an invalid BMP info header");
+
+	if (width <= 0 || height == 0 || width > 16384 || height > 16384 || height < -16384)
+		throw std::runtime_error(filename + " has unsupported dimensions");
+
+	if (bitCount != 24 && bitCount != 32)
+		throw std::runtime_error(filename + ": only 24 and 32 bit BMP files are supported");
+
+	// Default masks for BI_RGB.  32 bit BI_RGB files written by paint tools usually keep
+	// the alpha channel in the otherwise unused fourth byte.
+	std::uint32_t rMask = 0x00ff0000, gMask = 0x0000ff00, bMask = 0x000000ff;
+	std::uint32_t aMask = (bitCount == 32) ? 0xff000000 : 0;
+
+	if (compression == BI_BITFIELDS)
+	{
+		// Masks live inside BITMAPV4/V5 headers, or directly after a BITMAPINFOHEADER.
+		std::size_t maskOffset = 14 + 40;
+		if (maskOffset + 12 > file.size())
+			throw std::runtime_error(filename + " is truncated");
+
+		rMask = ReadU32(&file[maskOffset]);
+		gMask = ReadU32(&file[maskOffset + 4]);
+		bMask = ReadU32(&file[maskOffset + 8]);
+		aMask = (infoSize >= 56 && maskOffset + 16 <= file.size()) ? ReadU32(&file[maskOffset + 12]) : 0;
+	}
+	else if (compression != BI_RGB)
+	{
+		throw std::runtime_error(filename + ": compressed BMP files are not supported");
+	}
+
+	bool topDown = height < 0;
+	std::uint32_t w = (std::uint32_t)width;
+	std::uint32_t h = (std::uint32_t)(topDown ? -height : height);
+
+	// Rows are padded to 4 byte boundaries.
+	std::uint64_t rowPitch = ((std::uint64_t)w * bitCount / 8 + 3) & ~3ull;
+	if ((std::uint64_t)bitsOffset + rowPitch * h > file.size())
+		throw std::runtime_error(filename + " is truncated");
+
+	Image img;
+	img.Width = w;
+	img.Height = h;
+	img.Pixels.resize((std::size_t)w * h * 4);
+
+	bool anyAlpha = false;
+	for (std::uint32_t y = 0; y < h; ++y)
+	{
+		std::uint32_t srcRow = topDown ? y : (h - 1 - y);
+		const std::uint8_t* src = &file[bitsOffset + srcRow * rowPitch];
+		std::uint8_t* dst = &img.Pixels[(std::size_t)y * w * 4];
+
+		for (std::uint32_t x = 0; x < w; ++x)
+		{
+			std::uint32_t pixel = (bitCount == 32) ? ReadU32(src + x * 4)
+				: (std::uint32_t)(src[x * 3] | (src[x * 3 + 1] << 8) | (src[x * 3 + 2] << 16));
+
+			dst[x * 4 + 0] = ExtractChannel(pixel, rMask, 0);
+			dst[x * 4 + 1] = ExtractChannel(pixel, gMask, 0);
+			dst[x * 4 + 2] = ExtractChannel(pixel, bMask, 0);
+			dst[x * 4 + 3] = ExtractChannel(pixel, aMask, 255);
+
+			anyAlpha |= dst[x * 4 + 3] != 0;
+		}
+	}
+
+	// A fully transparent image almost always means the fourth byte was just padding.
+	if (!anyAlpha)
+	{
+		for (std::size_t i = 3; i < img.Pixels.size(); i += 4)
+			img.Pixels[i] = 255;
+	}
+
+	return img;
+}
+
+std::uint32_t TextureArrayAssembler::CalcMipLevels(std::uint32_t width, std::uint32_t height)
+{
+	std::uint32_t levels = 1;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(1u, width >> 1);
+		height = std::max(1u, height >> 1);
+		++levels;
+	}
+	return levels;
+}
+
+TextureArrayAssembler::Image TextureArrayAssembler::Downsample(const Image& src)
+{
+	Image dst;
+	dst.Width = std::max(1u, src.Width >> 1);
+	dst.Height = std::max(1u, src.Height >> 1);
+	dst.Pixels.resize((std::size_t)dst.Width * dst.Height * 4);
+
+	// 2x2 box filter.  Odd source sizes clamp to the last row/column.
+	for (std::uint32_t y = 0; y < dst.Height; ++y)
+	{
+		std::uint32_t y0 = std::min(y * 2, src.Height - 1);
+		std::uint32_t y1 = std::min(y * 2 + 1, src.Height - 1);
+
+		for (std::uint32_t x = 0; x < dst.Width; ++x)
+		{
+			std::uint32_t x0 = std::min(x * 2, src.Width - 1);
+			std::uint32_t x1 = std::min(x * 2 + 1, src.Width - 1);
+
+			const std::uint8_t* p00 = &src.Pixels[((std::size_t)y0 * src.Width + x0) * 4];
+			const std::uint8_t* p01 = &src.Pixels[((std::size_t)y0 * src.Width + x1) * 4];
+			const std::uint8_t* p10 = &src.Pixels[((std::size_t)y1 * src.Width + x0) * 4];
+			const std::uint8_t* p11 = &src.Pixels[((std::size_t)y1 * src.Width + x1) * 4];
+			std::uint8_t* d = &dst.Pixels[((std::size_t)y * dst.Width + x) * 4];
+
+			for (int c = 0; c < 4; ++c)
+				d[c] = (std::uint8_t)((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+		}
+	}
+
+	return dst;
+}
+
+void TextureArrayAssembler::EncodeBC1Block(const std::uint8_t block[64], std::uint8_t out[8], bool punchThrough)
+{
+	// BC1 can only store 1-bit alpha, and only in three color mode.
+	bool hasTransparent = false;
+	if (punchThrough)
+	{
+		for (int i = 0; i < 16; ++i)
+			hasTransparent |= block[i * 4 + 3] < 128;
+	}
+
+	// Bounding box endpoints, inset by 1/16 of the range to reduce quantization error.
+	int minC[3] = { 255, 255, 255 };
+	int maxC[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; ++i)
+	{
+		if (hasTransparent && block[i * 4 + 3] < 128)
+			continue;
+
+		for (int c = 0; c < 3; ++c)
+		{
+			minC[c] = std::min(minC[c], (int)block[i * 4 + c]);
+			maxC[c] = std::max(maxC[c], (int)block[i * 4 + c]);
+		}
+	}
+
+	if (minC[0] > maxC[0])
+	{
+		// Every texel is transparent.
+		minC[0] = minC[1] = minC[2] = 0;
+		maxC[0] = maxC[1] = maxC[2] = 0;
+	}
+
+	for (int c = 0; c < 3; ++c)
+	{
+		int inset = (maxC[c] - minC[c]) >> 4;
+		minC[c] = std::min(255, minC[c] + inset);
+		maxC[c] = std::max(0, maxC[c] - inset);
+	}
+
+	std::uint16_t c0 = PackRGB565(maxC[0], maxC[1], maxC[2]);
+	std::uint16_t c1 = PackRGB565(minC[0], minC[1], minC[2]);
+
+	// Four color mode requires c0 > c1, three color mode (index 3 = transparent) c0 <= c1.
+	if ((c0 < c1) != hasTransparent)
+		std::swap(c0, c1);
+
+	std::uint32_t indices = 0;
+	if (c0 != c1 || hasTransparent)
+	{
+		int palette[4][3];
+		UnpackRGB565(c0, palette[0]);
+		UnpackRGB565(c1, palette[1]);
+		for (int c = 0; c < 3; ++c)
+		{
+			if (hasTransparent)
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+			else
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+		}
+
+		int paletteSize = hasTransparent ? 3 : 4;
+		for (int i = 0; i < 16; ++i)
+		{
+			if (hasTransparent && block[i * 4 + 3] < 128)
+			{
+				indices |= 3u << (i * 2);
+				continue;
+			}
+
+			int best = 0;
+			int bestDist = 0x7fffffff;
+			for (int p = 0; p < paletteSize; ++p)
+			{
+				int dr = block[i * 4 + 0] - palette[p][0];
+				int dg = block[i * 4 + 1] - palette[p][1];
+				int db = block[i * 4 + 2] - palette[p][2];
+				int dist = dr * dr + dg * dg + db * db;
+				if (dist < bestDist)
+				{
+					bestDist = dist;
+					best = p;
+				}
+			}
+			indices |= (std::uint32_t)best << (i * 2);
+		}
+	}
+
+	out[0] = (std::uint8_t)(c0 & 0xff);
+	out[1] = (std::uint8_t)(c0 >> 8);
+	out[2] = (std::uint8_t)(c1 & 0xff);
+	out[3] = (std::uint8_t)(c1 >> 8);
+	out[4] = (std::uint8_t)(indices & 0xff);
+	out[5] = (std::uint8_t)((indices >> 8) & 0xff);
+	out[6] = (std::uint8_t)((indices >> 16) & 0xff);
+	out[7] = (std::uint8_t)(indices >> 24);
+}
+
+void TextureArrayAssembler::EncodeBC3AlphaBlock(const std::uint8_t block[64], std::uint8_t out[8])
+{
+	int a0 = 0;
+	int a1 = 255;
+	for (int i = 0; i < 16; ++i)
+	{
+		a0 = std::max(a0, (int)block[i * 4 + 3]);
+		a1 = std::min(a1, (int)block[i * 4 + 3]);
+	}
+
+	// Eight alpha mode (a0 > a1): palette interpolates six values between the endpoints.
+	int palette[8];
+	palette[0] = a0;
+	palette[1] = a1;
+	for (int p = 1; p < 7; ++p)
+		palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+
+	std::uint64_t indices = 0;
+	if (a0 != a1)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			int a = block[i * 4 + 3];
+			int best = 0;
+			int bestDist = 256;
+			for (int p = 0; p < 8; ++p)
+			{
+				int dist = std::abs(a - palette[p]);
+				if (dist < bestDist)
+				{
+					bestDist = dist;
+					best = p;
+				}
+			}
+			indices |= (std::uint64_t)best << (i * 3);
+		}
+	}
+
+	out[0] = (std::uint8_t)a0;
+	out[1] = (std::uint8_t)a1;
+	for (int b = 0; b < 6; ++b)
+		out[2 + b] = (std::uint8_t)((indices >> (b * 8)) & 0xff);
+}
+
+void TextureArrayAssembler::EncodeLevel(const Image& img, Format format, std::vector<std::uint8_t>& out)
+{
+	if (format == Format::R8G8B8A8_UNORM)
+	{
+		out.insert(out.end(), img.Pixels.begin(), img.Pixels.end());
+		return;
+	}
+
+	// Block compressed formats work on 4x4 blocks; edge blocks replicate the last texel.
+	std::uint32_t blocksX = std::max(1u, (img.Width + 3) / 4);
+	std::uint32_t blocksY = std::max(1u, (img.Height + 3) / 4);
+
+	for (std::uint32_t by = 0; by < blocksY; ++by)
+	{
+		for (std::uint32_t bx = 0; bx < blocksX; ++bx)
+		{
+			std::uint8_t block[64];
+			for (std::uint32_t y = 0; y < 4; ++y)
+			{
+				std::uint32_t sy = std::min(by * 4 + y, img.Height - 1);
+				for (std::uint32_t x = 0; x < 4; ++x)
+				{
+					std::uint32_t sx = std::min(bx * 4 + x, img.Width - 1);
+					std::memcpy(&block[(y * 4 + x) * 4], &img.Pixels[((std::size_t)sy * img.Width + sx) * 4], 4);
+				}
+			}
+
+			std::uint8_t encoded[16];
+			if (format == Format::BC3_UNORM)
+			{
+				EncodeBC3AlphaBlock(block, encoded);
+				EncodeBC1Block(block, encoded + 8, false);
+				out.insert(out.end(), encoded, encoded + 16);
+			}
+			else
+			{
+				EncodeBC1Block(block, encoded, true);
+				out.insert(out.end(), encoded, encoded + 8);
+			}
+		}
+	}
+}
+
+TextureArrayAssembler::Slice TextureArrayAssembler::EncodeSlice(const Image& img, std::uint32_t mipLevels, Format format)
+{
+	Slice slice;
+
+	Image level = img;
+	for (std::uint32_t mip = 0; mip < mipLevels; ++mip)
+	{
+		EncodeLevel(level, format, slice.Data);
+
+		if (mip + 1 < mipLevels)
+			level = Downsample(level);
+	}
+
+	return slice;
+}
+
+void TextureArrayAssembler::WriteDDS(const std::string& filename, std::uint32_t width, std::uint32_t height,
+	std::uint32_t mipLevels, Format format, const std::vector<Slice>& slices)
+{
+	bool compressed = format != Format::R8G8B8A8_UNORM;
+	std::uint32_t blockBytes = (format == Format::BC1_UNORM) ? 8 : 16;
+	std::uint32_t pitchOrLinearSize = compressed
+		? std::max(1u, (width + 3) / 4) * std::max(1u, (height + 3) / 4) * blockBytes
+		: width * 4;
+
+	std::vector<std::uint8_t> header;
+	header.reserve(4 + 124 + 20);
+
+	WriteU32(header, DDS_MAGIC);
+
+	// DDS_HEADER
+	WriteU32(header, 124);
+	WriteU32(header, DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT |
+		(compressed ? DDSD_LINEARSIZE : DDSD_PITCH));
+	WriteU32(header, height);
+	WriteU32(header, width);
+	WriteU32(header, pitchOrLinearSize);
+	WriteU32(header, 0); // depth
+	WriteU32(header, mipLevels);
+	for (int i = 0; i < 11; ++i)
+		WriteU32(header, 0); // reserved1
+
+	// DDS_PIXELFORMAT: 'DX10' tells the loader to read the extended header.
+	WriteU32(header, 32);
+	WriteU32(header, DDPF_FOURCC);
+	WriteU32(header, 0x30315844); // 'DX10'
+	for (int i = 0; i < 5; ++i)
+		WriteU32(header, 0);
+
+	WriteU32(header, DDSCAPS_TEXTURE | DDSCAPS_COMPLEX | (mipLevels > 1 ? DDSCAPS_MIPMAP : 0));
+	WriteU32(header, 0); // caps2
+	WriteU32(header, 0); // caps3
+	WriteU32(header, 0); // caps4
+	WriteU32(header, 0); // reserved2
+
+	// DDS_HEADER_DXT10
+	WriteU32(header, (std::uint32_t)format);
+	WriteU32(header, DDS_DIMENSION_TEXTURE2D);
+	WriteU32(header, 0); // miscFlag
+	WriteU32(header, (std::uint32_t)slices.size());
+	WriteU32(header, 0); // miscFlags2
+
+	std::ofstream fout(filename, std::ios::binary);
+	if (!fout)
+		throw std::runtime_error("Cannot create " + filename);
+
+	fout.write(reinterpret_cast<const char*>(header.data()), header.size());
+	for (const auto& s : slices)
+		fout.write(reinterpret_cast<const char*>(s.Data.data()), s.Data.size());
+
+	if (!fout)
+		throw std::runtime_error("Failed writing " + filename);
+}
+
+void TextureArrayAssembler::Assemble(const std::vector<std::string>& filenames,
+	const std::string& outFilename, const Options& options)
+{
+	if (filenames.empty())
+		throw std::runtime_error("No input images");
+
+	const std::size_t sliceCount = filenames.size();
+
+	std::vector<Image> images(sliceCount);
+	std::vector<Slice> slices(sliceCount);
+	std::uint32_t mipLevels = 0;
+
+	// Every slice is independent, so load and encode them on a pool of worker threads.
+	// The first exception thrown by any worker is re-thrown on the calling thread.
+	auto runParallel = [&](auto&& work)
+	{
+		std::uint32_t threadCount = options.MaxThreads ? options.MaxThreads : std::thread::hardware_concurrency();
+		threadCount = std::max(1u, std::min<std::uint32_t>(threadCount, (std::uint32_t)sliceCount));
+
+		std::atomic<std::size_t> next(0);
+		std::vector<std::exception_ptr> errors(sliceCount);
+		std::vector<std::thread> workers;
+		for (std::uint32_t t = 0; t < threadCount; ++t)
+		{
+			workers.emplace_back([&]()
+			{
+				for (std::size_t i = next++; i < sliceCount; i = next++)
+				{
+					try
+					{
+						work(i);
+					}
+					catch (...)
+					{
+						errors[i] = std::current_exception();
+					}
+				}
+			});
+		}
+
+		for (auto& w : workers)
+			w.join();
+
+		for (auto& e : errors)
+		{
+			if (e)
+				std::rethrow_exception(e);
+		}
+	};
+
+	runParallel([&](std::size_t i) { images[i] = LoadBmp(filenames[i]); });
+
+	for (std::size_t i = 1; i < sliceCount; ++i)
+	{
+		if (images[i].Width != images[0].Width || images[i].Height != images[0].Height)
+			throw std::runtime_error(filenames[i] + " does not match the size of " + filenames[0]);
+	}
+
+	std::uint32_t fullChain = CalcMipLevels(images[0].Width, images[0].Height);
+	mipLevels = (options.MipLevels == 0) ? fullChain : std::min(options.MipLevels, fullChain);
+
+	runParallel([&](std::size_t i)
+	{
+		slices[i] = EncodeSlice(images[i], mipLevels, options.OutputFormat);
+		images[i].Pixels.clear();
+		images[i].Pixels.shrink_to_fit();
+	});
+
+	WriteDDS(outFilename, images[0].Width, images[0].Height, mipLevels, options.OutputFormat, slices);
+}
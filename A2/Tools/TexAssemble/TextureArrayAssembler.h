@@ -0,0 +1,84 @@
+//***************************************************************************************
+// TextureArrayAssembler.h
+//
+// Portable replacement for the DirectXTex 'texassemble array' command.  Loads a set of
+// uncompressed BMP images of equal size, builds a full mip chain for each one and
+// writes them out as a single Texture2DArray DDS file (DX10 header), optionally BC1 or
+// BC3 compressed.  Each array slice is processed on its own thread.
+//
+// The code only depends on the C++ standard library so it can run on the Linux build
+// farm as well as on Windows.
+//***************************************************************************************
+
+#ifndef TEXTUREARRAYASSEMBLER_H
+#define TEXTUREARRAYASSEMBLER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TextureArrayAssembler
+{
+public:
+	// Output pixel formats.  Values match DXGI_FORMAT so they can be written straight
+	// into the DDS_HEADER_DXT10 without pulling in the DXGI headers.
+	enum class Format : std::uint32_t
+	{
+		R8G8B8A8_UNORM = 28,
+		BC1_UNORM = 71,
+		BC3_UNORM = 77
+	};
+
+	// 32-bit RGBA image, rows stored top to bottom.
+	struct Image
+	{
+		std::uint32_t Width = 0;
+		std::uint32_t Height = 0;
+		std::vector<std::uint8_t> Pixels;
+	};
+
+	// Encoded data for one array slice: every mip level of that slice, back to back,
+	// in the order they appear in the DDS file.
+	struct Slice
+	{
+		std::vector<std::uint8_t> Data;
+	};
+
+	struct Options
+	{
+		Format OutputFormat = Format::BC3_UNORM;
+
+		// Number of mip levels to generate; 0 builds the full chain down to 1x1.
+		std::uint32_t MipLevels = 0;
+
+		// Maximum number of worker threads; 0 uses the hardware concurrency.
+		std::uint32_t MaxThreads = 0;
+	};
+
+	// Reads an uncompressed 24 or 32 bit BMP file (BI_RGB or BI_BITFIELDS).
+	// Throws std::runtime_error on failure.
+	static Image LoadBmp(const std::string& filename);
+
+	// Loads every file in 'filenames' and writes them as a Texture2DArray DDS file.
+	static void Assemble(const std::vector<std::string>& filenames,
+		const std::string& outFilename, const Options& options);
+
+	// Builds the mip chain of 'img' and encodes every level in the given format.
+	static Slice EncodeSlice(const Image& img, std::uint32_t mipLevels, Format format);
+
+	// Writes 'slices' as a Texture2DArray DDS file.  All slices must share the same
+	// size, format and mip count.
+	static void WriteDDS(const std::string& filename, std::uint32_t width, std::uint32_t height,
+		std::uint32_t mipLevels, Format format, const std::vector<Slice>& slices);
+
+	static std::uint32_t CalcMipLevels(std::uint32_t width, std::uint32_t height);
+
+private:
+	static Image Downsample(const Image& src);
+
+	static void EncodeLevel(const Image& img, Format format, std::vector<std::uint8_t>& out);
+	static void EncodeBC1Block(const std::uint8_t block[64], std::uint8_t out[8], bool punchThrough);
+	static void EncodeBC3AlphaBlock(const std::uint8_t block[64], std::uint8_t out[8]);
+};
+
+#endif // TEXTUREARRAYASSEMBLER_H
@@ -0,0 +1,95 @@
+//***************************************************************************************
+// main.cpp - texassemble replacement for building Texture2DArray DDS files.
+//
+// Usage:
+//   TexAssemble [-f rgba|bc1|bc3] [-m mipLevels] [-j threads] -o out.dds in0.bmp in1.bmp ...
+//
+// Example (tree sprites used by TreeSprite.hlsl):
+//   TexAssemble -f bc3 -o ../../Textures/treeArray.dds
+//       ../../Textures/tree0.bmp ../../Textures/tree1.bmp ../../Textures/tree2.bmp
+//
+// Build on Linux:
+//   g++ -std=c++17 -O2 -pthread main.cpp TextureArrayAssembler.cpp -o TexAssemble
+//***************************************************************************************
+
+#include "TextureArrayAssembler.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+static void PrintUsage()
+{
+	std::cerr << "Usage: TexAssemble [-f rgba|bc1|bc3] [-m mipLevels] [-j threads] -o out.dds in0.bmp [in1.bmp ...]\n"
+		<< "  -f  output format (default bc3)\n"
+		<< "  -m  number of mip levels, 0 = full chain (default 0)\n"
+		<< "  -j  maximum worker threads, 0 = one per core (default 0)\n";
+}
+
+int main(int argc, char* argv[])
+{
+	TextureArrayAssembler::Options options;
+	std::string outFilename;
+	std::vector<std::string> inputs;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		bool hasValue = i + 1 < argc;
+
+		if (std::strcmp(argv[i], "-o") == 0 && hasValue)
+		{
+			outFilename = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "-m") == 0 && hasValue)
+		{
+			options.MipLevels = (std::uint32_t)std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "-j") == 0 && hasValue)
+		{
+			options.MaxThreads = (std::uint32_t)std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "-f") == 0 && hasValue)
+		{
+			std::string fmt = argv[++i];
+			if (fmt == "rgba")
+				options.OutputFormat = TextureArrayAssembler::Format::R8G8B8A8_UNORM;
+			else if (fmt == "bc1")
+				options.OutputFormat = TextureArrayAssembler::Format::BC1_UNORM;
+			else if (fmt == "bc3")
+				options.OutputFormat = TextureArrayAssembler::Format::BC3_UNORM;
+			else
+			{
+				PrintUsage();
+				return 1;
+			}
+		}
+		else if (argv[i][0] == '-')
+		{
+			PrintUsage();
+			return 1;
+		}
+		else
+		{
+			inputs.push_back(argv[i]);
+		}
+	}
+
+	if (outFilename.empty() || inputs.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	try
+	{
+		TextureArrayAssembler::Assemble(inputs, outFilename, options);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "TexAssemble: " << e.what() << "\n";
+		return 1;
+	}
+
+	return 0;
+}
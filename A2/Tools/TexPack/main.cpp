@@ -0,0 +1,132 @@
+//***************************************************************************************
+// main.cpp - packs DDS files into the chunked LZ4 container read by DDSTextureLoader.
+//
+// Usage:
+//   TexPack [-c chunkKB] [-j threads] in.dds out.ddz
+//
+// The packed file is decoded again and compared against the input before it is kept,
+// and the time taken to decode it is reported next to the time to read the raw DDS.
+//
+// Build on Linux:
+//   g++ -std=c++17 -O2 -pthread main.cpp ../../Common/TextureContainer.cpp -o TexPack
+//***************************************************************************************
+
+#include "../../Common/TextureContainer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+static bool ReadFile(const std::string& filename, std::vector<std::uint8_t>& data)
+{
+	std::ifstream fin(filename, std::ios::binary);
+	if (!fin)
+		return false;
+
+	data.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+	return true;
+}
+
+// Spreads the chunks over up to 'maxThreads' threads (0 for one per hardware thread).
+static TextureContainer::Executor ThreadExecutor(unsigned maxThreads)
+{
+	return [maxThreads](std::size_t count, const std::function<void(std::size_t)>& work)
+	{
+		unsigned threadCount = maxThreads ? maxThreads : std::thread::hardware_concurrency();
+		threadCount = (unsigned)std::max<std::size_t>(1, std::min<std::size_t>(threadCount, count));
+
+		std::atomic<std::size_t> next(0);
+		std::vector<std::thread> workers;
+		for (unsigned t = 0; t < threadCount; ++t)
+		{
+			workers.emplace_back([&]()
+			{
+				for (std::size_t i = next++; i < count; i = next++)
+					work(i);
+			});
+		}
+
+		for (auto& w : workers)
+			w.join();
+	};
+}
+
+static void PrintUsage()
+{
+	std::cerr << "Usage: TexPack [-c chunkKB] [-j threads] in.dds out.ddz\n";
+}
+
+int main(int argc, char* argv[])
+{
+	std::uint32_t chunkSize = TextureContainer::DefaultChunkSize;
+	unsigned threads = 0;
+	std::vector<std::string> files;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+			chunkSize = (std::uint32_t)std::strtoul(argv[++i], nullptr, 10) * 1024;
+		else if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+			threads = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+		else if (argv[i][0] == '-')
+		{
+			PrintUsage();
+			return 1;
+		}
+		else
+			files.push_back(argv[i]);
+	}
+
+	if (files.size() != 2 || chunkSize == 0)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	using Clock = std::chrono::steady_clock;
+
+	auto readStart = Clock::now();
+	std::vector<std::uint8_t> dds;
+	if (!ReadFile(files[0], dds) || dds.size() < 4 || std::memcmp(dds.data(), "DDS ", 4) != 0)
+	{
+		std::cerr << "TexPack: " << files[0] << " is not a DDS file\n";
+		return 1;
+	}
+	auto readEnd = Clock::now();
+
+	TextureContainer::Executor executor = ThreadExecutor(threads);
+	std::vector<std::uint8_t> packed = TextureContainer::Compress(dds.data(), dds.size(), chunkSize, executor);
+
+	auto decodeStart = Clock::now();
+	std::vector<std::uint8_t> check(dds.size());
+	bool ok = TextureContainer::Decompress(packed.data(), packed.size(), check.data(), check.size(), executor);
+	auto decodeEnd = Clock::now();
+
+	if (!ok || check != dds)
+	{
+		std::cerr << "TexPack: round trip failed for " << files[0] << "\n";
+		return 1;
+	}
+
+	std::ofstream fout(files[1], std::ios::binary);
+	fout.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+	if (!fout)
+	{
+		std::cerr << "TexPack: cannot write " << files[1] << "\n";
+		return 1;
+	}
+
+	auto ms = [](Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+	std::cout << files[0] << ": " << dds.size() << " -> " << packed.size() << " bytes ("
+		<< (100.0 * packed.size() / dds.size()) << "%), raw read " << ms(readEnd - readStart)
+		<< " ms, decode " << ms(decodeEnd - decodeStart) << " ms\n";
+
+	return 0;
+}
@@ -0,0 +1,304 @@
+//***************************************************************************************
+// main.cpp - drives TextureResidency, the policy behind TextureCache, with a simulated
+// allocator and GPU, and reports its stats.
+//
+// Usage:
+//   TextureCacheCheck [-f frames] [-b budgetKiB] [-t textures]
+//
+// Policy: with a hand-built set of textures checks that eviction takes unreferenced
+// textures only, lowest priority first and least recently used within a priority; that
+// evicted textures are unloaded only once their last fence completes, even if they
+// were loaded again meanwhile; that upload memory is released after its copy; and
+// that a loader that throws leaves the state unchanged.
+// Simulation: 'textures' textures of random size and priority, 'frames' frames with
+// three in flight, each referencing a random working set (sometimes bigger than the
+// budget).  Checks no allocation is unloaded while a frame that used it is
+// in flight, that referenced textures stay resident, and that the resident size is
+// within the budget whenever an unreferenced texture could have been evicted.  Prints
+// the cache's stats.
+//
+// Build:
+//   g++ -std=c++17 -O2 main.cpp ../../Common/TextureResidency.cpp -o TextureCacheCheck
+//***************************************************************************************
+
+#include "../../Common/TextureResidency.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <stdexcept>
+
+namespace
+{
+	int gErrors = 0;
+
+	void Check(bool ok, const char* what)
+	{
+		if (!ok)
+		{
+			std::cout << "  FAILED: " << what << "\n";
+			gErrors++;
+		}
+	}
+
+	// Hands out ids for made-up allocations and remembers what the GPU could still be
+	// reading, so an early unload shows up.
+	class SimulatedLoader : public TextureResidency::Loader
+	{
+	public:
+		struct Allocation
+		{
+			std::string Name;
+			std::uint64_t Bytes = 0;
+			bool Uploading = false;
+		};
+
+		std::map<std::string, std::uint64_t> Sizes;
+		std::map<std::uint64_t, Allocation> Live;
+		std::vector<std::string> Unloaded;
+
+		// Last fence each allocation was submitted with, and the GPU's completed fence.
+		std::map<std::uint64_t, std::uint64_t> LastUse;
+		std::uint64_t Completed = 0;
+
+		bool FailNext = false;
+		int EarlyUnloads = 0;
+		int UploadsReleased = 0;
+
+		virtual std::uint64_t Load(const std::string& name, std::uint64_t& residentBytes, bool& uploading)override
+		{
+			if (FailNext)
+			{
+				FailNext = false;
+				throw std::runtime_error("out of memory");
+			}
+
+			Allocation a;
+			a.Name = name;
+			a.Bytes = Sizes[name];
+			a.Uploading = true;
+
+			std::uint64_t id = mNext++;
+			Live[id] = a;
+
+			residentBytes = a.Bytes;
+			uploading = true;
+			return id;
+		}
+
+		virtual void Unload(std::uint64_t allocation)override
+		{
+			auto it = Live.find(allocation);
+			Check(it != Live.end(), "unload of a live allocation");
+			if (it == Live.end())
+				return;
+
+			if (LastUse[allocation] > Completed)
+				EarlyUnloads++;
+
+			Unloaded.push_back(it->second.Name);
+			Live.erase(it);
+		}
+
+		virtual void ReleaseUpload(std::uint64_t allocation)override
+		{
+			Check(Live.count(allocation) == 1 && Live[allocation].Uploading, "upload released once");
+			Live[allocation].Uploading = false;
+			UploadsReleased++;
+		}
+
+	private:
+		std::uint64_t mNext = 1;
+	};
+
+	std::uint64_t Acquire(TextureResidency& cache, SimulatedLoader& loader, const std::string& name, std::uint64_t fence)
+	{
+		std::uint64_t allocation = 0;
+		Check(cache.Acquire(name, fence, allocation), "acquire of a registered texture");
+		loader.LastUse[allocation] = std::max<std::uint64_t>(loader.LastUse[allocation], fence);
+		return allocation;
+	}
+
+	void Policy()
+	{
+		SimulatedLoader loader;
+		TextureResidency cache(&loader, 300);
+
+		const char* names[] = { "a", "b", "c", "d" };
+		for (const char* n : names)
+		{
+			loader.Sizes[n] = 100;
+			cache.Register(n, n[0] == 'a' ? 1 : 0);
+		}
+
+		std::uint64_t unused = 0;
+		Check(!cache.Acquire("missing", 1, unused), "unregistered name fails");
+		Check(!cache.Find("a", unused), "nothing resident before Acquire");
+
+		// a, b, c fit; all referenced by frame 1.
+		for (const char* n : { "a", "b", "c" })
+			Acquire(cache, loader, n, 1);
+		loader.Completed = 1;
+		cache.Update(1);
+		Check(loader.UploadsReleased == 3, "uploads released after their fence");
+
+		// Going over budget with everything referenced keeps everything.
+		std::uint64_t d = Acquire(cache, loader, "d", 2);
+		cache.Update(1);
+		Check(cache.GetStats().ResidentBytes == 400 && cache.GetStats().Evictions == 0, "referenced textures are not evicted");
+
+		// Unreference a, b and c; b is then used again so c is the least recently used
+		// of the priority 0 textures, and a outranks both.
+		for (const char* n : { "a", "b", "c" })
+			cache.Release(n);
+		cache.Touch("b", 2);
+		cache.Update(1);
+		Check(!cache.Find("c", unused) && cache.Find("a", unused) && cache.Find("b", unused), "lowest priority, least recently used evicted");
+		Check(loader.Unloaded.empty(), "evicted texture kept while in flight");
+
+		// c comes back before its old allocation's fence completes: a new allocation is
+		// loaded and the old one is still unloaded later, on its own fence.
+		cache.Release("d");
+		std::uint64_t c = Acquire(cache, loader, "c", 3);
+		cache.Update(1);
+		Check(cache.Find("c", unused) && unused == c && c != d, "reloaded texture gets a new allocation");
+		Check(!cache.Find("d", unused) && cache.Find("b", unused), "d, used before b was touched, evicted next");
+
+		loader.Completed = 2;
+		cache.Update(2);
+		Check(loader.Unloaded.size() == 2 && loader.EarlyUnloads == 0, "old allocations unloaded once complete");
+
+		// Shrinking the budget evicts down to what is referenced.
+		cache.SetBudget(0);
+		Check(cache.GetStats().ResidentBytes == 100 && cache.Find("c", unused), "SetBudget evicts unreferenced textures");
+
+		// A failed load leaves nothing behind and the next try succeeds.
+		cache.SetBudget(1000);
+		std::uint64_t missesBefore = cache.GetStats().Misses;
+		loader.FailNext = true;
+		bool threw = false;
+		try
+		{
+			cache.Acquire("b", 4, unused);
+		}
+		catch (const std::runtime_error&)
+		{
+			threw = true;
+		}
+		Check(threw && !cache.Find("b", unused), "failed load not resident");
+		Acquire(cache, loader, "b", 4);
+		Check(cache.Find("b", unused) && cache.GetStats().Misses == missesBefore + 2, "load retried");
+
+		loader.Completed = 4;
+		cache.Update(4);
+		std::cout << "Policy: " << cache.GetStats().Evictions << " evictions, "
+			<< loader.Unloaded.size() << " unloads\n";
+	}
+
+	void Simulate(int frames, std::uint64_t budget, int textureCount)
+	{
+		const int FramesInFlight = 3;
+
+		std::mt19937 rng(11);
+		SimulatedLoader loader;
+		TextureResidency cache(&loader, budget);
+
+		std::vector<std::string> names;
+		for (int i = 0; i < textureCount; ++i)
+		{
+			names.push_back("tex" + std::to_string(i));
+			loader.Sizes[names.back()] = (std::uint64_t)(64 + rng() % 1024) * 1024;
+			cache.Register(names.back(), (int)(rng() % 3));
+		}
+
+		int overBudgetFrames = 0;
+
+		for (int frame = 1; frame <= frames; ++frame)
+		{
+			std::uint64_t fence = (std::uint64_t)frame;
+
+			// The GPU finishes the frame that was submitted FramesInFlight frames ago.
+			loader.Completed = fence > FramesInFlight ? fence - FramesInFlight : 0;
+			cache.Update(loader.Completed);
+
+			// A working set that drifts: mostly neighbours of a moving window.
+			std::set<std::string> used;
+			int window = (frame / 40) % textureCount;
+			int count = 1 + (int)(rng() % 12);
+			for (int i = 0; i < count; ++i)
+			{
+				int pick = (window + (int)(rng() % 16)) % textureCount;
+				if (rng() % 10 == 0)
+					pick = (int)(rng() % textureCount);
+				used.insert(names[pick]);
+			}
+
+			std::uint64_t referencedBytes = 0;
+			for (const std::string& n : used)
+			{
+				Acquire(cache, loader, n, fence);
+				referencedBytes += loader.Sizes[n];
+			}
+
+			// Materials hold their textures while the frame is recorded.
+			cache.Update(loader.Completed);
+			for (const std::string& n : used)
+			{
+				std::uint64_t allocation = 0;
+				if (!cache.Find(n, allocation))
+					Check(false, "referenced texture stays resident");
+			}
+
+			const TextureResidency::Stats& stats = cache.GetStats();
+			if (stats.ResidentBytes > budget)
+			{
+				overBudgetFrames++;
+				Check(stats.ResidentBytes == referencedBytes, "over budget only with everything referenced");
+			}
+
+			for (const std::string& n : used)
+				cache.Release(n);
+		}
+
+		loader.Completed = (std::uint64_t)frames;
+		cache.Update(loader.Completed);
+		Check(loader.EarlyUnloads == 0, "no allocation unloaded while in flight");
+		Check(cache.GetStats().ResidentBytes <= budget, "settles within budget");
+
+		const TextureResidency::Stats& s = cache.GetStats();
+		double hitRate = 100.0 * (double)s.Hits / (double)std::max<std::uint64_t>(1, s.Hits + s.Misses);
+		std::cout << "Simulation: " << frames << " frames, " << textureCount << " textures, budget "
+			<< budget / 1024 << " KiB\n"
+			<< "  hits " << s.Hits << ", misses " << s.Misses << " (" << (int)hitRate << "% hit rate)\n"
+			<< "  evictions " << s.Evictions << ", upload heaps released " << s.UploadHeapsReleased << "\n"
+			<< "  resident " << s.ResidentBytes / 1024 << " KiB, peak " << s.PeakResidentBytes / 1024 << " KiB\n"
+			<< "  frames over budget (working set too big) " << overBudgetFrames << "\n";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int frames = 5000;
+	int budgetKiB = 8 * 1024;
+	int textures = 64;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "-f") == 0)
+			frames = std::max(1, std::atoi(argv[i + 1]));
+		else if (std::strcmp(argv[i], "-b") == 0)
+			budgetKiB = std::max(0, std::atoi(argv[i + 1]));
+		else if (std::strcmp(argv[i], "-t") == 0)
+			textures = std::max(1, std::atoi(argv[i + 1]));
+	}
+
+	Policy();
+	Simulate(frames, (std::uint64_t)budgetKiB * 1024, textures);
+
+	std::cout << (gErrors == 0 ? "passed" : "FAILED") << "\n";
+	return gErrors == 0 ? 0 : 1;
+}
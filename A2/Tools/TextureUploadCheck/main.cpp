@@ -0,0 +1,242 @@
+//***************************************************************************************
+// main.cpp - runs TextureUploadQueue, the batching behind TextureUploadBatch, against a
+// stand-in device that records every call, and reports bytes and allocation counts.
+//
+// Usage:
+//   TextureUploadCheck [-d textureDir] [-f frames] [-r reloadsPerFrame]
+//
+// Startup: the app's seven textures (sizes from the files in 'textureDir', less the
+// DDS header; made-up sizes if they are missing) queued and recorded once, as
+// Initialize does.  Frames: 'frames' frames with three in flight, each reloading up
+// to 'reloadsPerFrame' textures the way TextureCache does after an eviction, recorded
+// on the frame's command list as Draw does.
+// The stand-in checks that every copy starts 512 byte aligned, lies inside its buffer
+// and does not overlap another copy, that each texture is copied once and transitioned
+// after its copy, and that no buffer is destroyed before its fence completes or
+// leaked.  Prints the upload bytes and allocations against one committed upload heap
+// per texture (64 KiB granularity), which is what CreateDDSTextureFromFile12 made.
+//
+// Build:
+//   g++ -std=c++17 -O2 main.cpp ../../Common/TextureUploadQueue.cpp -o TextureUploadCheck
+//***************************************************************************************
+
+#include "../../Common/TextureUploadQueue.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+
+namespace
+{
+	int gErrors = 0;
+
+	void Check(bool ok, const char* what)
+	{
+		if (!ok)
+		{
+			std::cout << "  FAILED: " << what << "\n";
+			gErrors++;
+		}
+	}
+
+	// Stands in for the device and the command list.
+	class RecordingBackend : public TextureUploadQueue::Backend
+	{
+	public:
+		struct Buffer
+		{
+			std::uint64_t Bytes = 0;
+			std::uint64_t Fence = 0;
+			std::vector<std::pair<std::uint64_t, std::uint64_t>> Copies;
+		};
+
+		std::map<std::uint64_t, std::uint64_t> TextureSizes;
+		std::set<std::uint64_t> Copied;
+		std::set<std::uint64_t> Transitioned;
+
+		std::map<std::uint64_t, Buffer> Live;
+		std::uint64_t Completed = 0;
+		std::uint64_t RecordingFence = 0;
+
+		std::uint64_t Allocations = 0;
+		std::uint64_t AllocatedBytes = 0;
+		std::uint64_t PeakLiveBytes = 0;
+
+		virtual std::uint64_t UploadSize(std::uint64_t texture)override
+		{
+			return TextureSizes.at(texture);
+		}
+
+		virtual std::uint64_t CreateUploadBuffer(std::uint64_t bytes)override
+		{
+			Buffer b;
+			b.Bytes = bytes;
+			b.Fence = RecordingFence;
+
+			std::uint64_t id = mNext++;
+			Live[id] = b;
+			Allocations++;
+			AllocatedBytes += bytes;
+
+			std::uint64_t liveBytes = 0;
+			for (auto& l : Live)
+				liveBytes += l.second.Bytes;
+			PeakLiveBytes = std::max<std::uint64_t>(PeakLiveBytes, liveBytes);
+
+			return id;
+		}
+
+		virtual void DestroyUploadBuffer(std::uint64_t buffer)override
+		{
+			auto it = Live.find(buffer);
+			Check(it != Live.end(), "destroy of a live buffer");
+			if (it == Live.end())
+				return;
+
+			Check(it->second.Fence <= Completed, "buffer destroyed after its fence");
+			Live.erase(it);
+		}
+
+		virtual void RecordCopy(std::uint64_t texture, std::uint64_t buffer, std::uint64_t offset)override
+		{
+			Buffer& b = Live.at(buffer);
+			std::uint64_t end = offset + TextureSizes.at(texture);
+
+			Check(offset % 512 == 0, "copy source aligned");
+			Check(end <= b.Bytes, "copy inside its buffer");
+			for (auto& c : b.Copies)
+				Check(end <= c.first || offset >= c.second, "copies do not overlap");
+			b.Copies.push_back(std::make_pair(offset, end));
+
+			Check(Copied.insert(texture).second, "texture copied once");
+		}
+
+		virtual void RecordTransitions(const std::vector<std::uint64_t>& textures)override
+		{
+			for (std::uint64_t t : textures)
+			{
+				Check(Copied.count(t) == 1, "transition after the copy");
+				Check(Transitioned.insert(t).second, "texture transitioned once");
+			}
+		}
+
+	private:
+		std::uint64_t mNext = 1;
+	};
+
+	// What one committed upload heap per texture would have used.
+	std::uint64_t HeapBytes(std::uint64_t bytes)
+	{
+		const std::uint64_t granularity = 64 * 1024;
+		return (bytes + granularity - 1) / granularity * granularity;
+	}
+
+	std::uint64_t FileUploadSize(const std::string& path, std::uint64_t fallback)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file)
+			return fallback;
+
+		std::uint64_t size = (std::uint64_t)file.tellg();
+		return size > 128 ? size - 128 : fallback;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string dir = "../../Textures";
+	int frames = 2000;
+	int reloads = 2;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "-d") == 0)
+			dir = argv[i + 1];
+		else if (std::strcmp(argv[i], "-f") == 0)
+			frames = std::max(1, std::atoi(argv[i + 1]));
+		else if (std::strcmp(argv[i], "-r") == 0)
+			reloads = std::max(0, std::atoi(argv[i + 1]));
+	}
+
+	const char* files[] = { "stone.dds", "bricks3.dds", "ice.dds", "grass.dds", "water1.dds", "WireFence.dds", "treearray.dds" };
+	std::vector<std::uint64_t> sizes;
+	for (const char* f : files)
+		sizes.push_back(FileUploadSize(dir + "/" + f, 349552));
+
+	RecordingBackend backend;
+	std::uint64_t nextTexture = 1;
+	std::uint64_t perTextureAllocations = 0;
+	std::uint64_t perTextureBytes = 0;
+	{
+		TextureUploadQueue queue(&backend);
+
+		auto add = [&](std::uint64_t bytes)
+		{
+			std::uint64_t id = nextTexture++;
+			backend.TextureSizes[id] = bytes;
+			queue.Add(id);
+
+			perTextureAllocations++;
+			perTextureBytes += HeapBytes(bytes);
+		};
+
+		// Startup: everything goes through one buffer, recorded once.
+		for (std::uint64_t bytes : sizes)
+			add(bytes);
+		backend.RecordingFence = 1;
+		queue.Record(1);
+		Check(backend.Allocations == 1 && !queue.HasPending(), "startup uploads in one allocation");
+		backend.Completed = 1;
+		queue.Update(1);
+		Check(queue.InFlightCount() == 0, "startup buffer freed after the flush");
+
+		std::uint64_t startupBytes = backend.AllocatedBytes;
+		std::uint64_t startupHeapBytes = perTextureBytes;
+		std::cout << "Startup: " << sizes.size() << " textures, 1 allocation of " << startupBytes / 1024
+			<< " KiB (one heap each: " << sizes.size() << " allocations, " << startupHeapBytes / 1024 << " KiB)\n";
+
+		// Frames: Update retires, the cache reloads, Draw records.
+		const std::uint64_t FramesInFlight = 3;
+		std::mt19937 rng(5);
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			std::uint64_t fence = 2 + (std::uint64_t)frame;
+			backend.Completed = fence > FramesInFlight ? fence - FramesInFlight : 0;
+			queue.Update(backend.Completed);
+
+			int count = reloads > 0 ? (int)(rng() % (reloads + 1)) : 0;
+			for (int i = 0; i < count; ++i)
+				add(sizes[rng() % sizes.size()]);
+
+			backend.RecordingFence = fence;
+			if (queue.HasPending())
+				queue.Record(fence);
+
+			Check(queue.InFlightCount() <= FramesInFlight, "at most one buffer per frame in flight");
+		}
+
+		backend.Completed = 2 + (std::uint64_t)frames;
+		queue.Update(backend.Completed);
+		Check(backend.Live.empty(), "every buffer freed once complete");
+
+		// Buffers still in flight are freed with the queue.
+		add(sizes[0]);
+		backend.RecordingFence = backend.Completed;
+		queue.Record(backend.Completed);
+	}
+	Check(backend.Live.empty(), "queue destructor frees its buffers");
+	Check(backend.Copied.size() == nextTexture - 1 && backend.Transitioned.size() == nextTexture - 1, "every texture uploaded");
+
+	std::cout << "Total: " << nextTexture - 1 << " textures in " << backend.Allocations << " allocations, "
+		<< backend.AllocatedBytes / 1024 << " KiB, peak live " << backend.PeakLiveBytes / 1024 << " KiB\n"
+		<< "  one heap each: " << perTextureAllocations << " allocations, " << perTextureBytes / 1024 << " KiB\n";
+
+	std::cout << (gErrors == 0 ? "passed" : "FAILED") << "\n";
+	return gErrors == 0 ? 0 : 1;
+}
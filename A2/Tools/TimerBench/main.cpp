@@ -0,0 +1,157 @@
+//***************************************************************************************
+// main.cpp - checks GameTimer's fixed steps against a scripted clock and its frame
+// pacing against the real one.
+//
+// Usage:
+//   TimerBench [-f frames] [-r rate]
+//
+// Fixed steps: 'frames' frames of uneven length, a pause and a 2 second stall are fed
+// through a clock the test advances by hand, and the steps taken, the leftover and
+// Alpha() are checked against the time fed in.
+// Pacing: 'frames' frames at 'rate' frames per second on the real clock; prints the
+// average and worst frame time and the CPU time the thread used, and checks the
+// average is on the target and the thread slept (used well under half the time)
+// instead of spinning.
+//
+// Build:
+//   g++ -std=c++17 -O2 -pthread main.cpp ../../Common/GameTimer.cpp -o TimerBench
+//***************************************************************************************
+
+#include "../../Common/GameTimer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+
+static int CheckFixedSteps(int frames)
+{
+	int errors = 0;
+
+	HighResClock::Ticks now = 1000;
+	GameTimer timer([&now]() { return now; });
+
+	const HighResClock::Ticks step = HighResClock::FromSeconds(1.0 / 60.0);
+	const HighResClock::Ticks maxFrame = HighResClock::FromSeconds(0.25);
+	timer.SetFixedStep(1.0f / 60.0f, 0.25f);
+	timer.Reset();
+
+	HighResClock::Ticks fed = 0;
+	std::uint64_t steps = 0;
+	std::uint64_t seed = 12345;
+
+	auto frame = [&](HighResClock::Ticks length)
+	{
+		now += length;
+		timer.Tick();
+		fed += std::min<HighResClock::Ticks>(length, maxFrame);
+		while (timer.StepFixed())
+			steps++;
+
+		float alpha = timer.Alpha();
+		if (alpha < 0.0f || alpha >= 1.0f)
+			errors++;
+	};
+
+	for (int f = 0; f < frames; ++f)
+	{
+		// 5 to 30 ms.
+		seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+		frame(HighResClock::FromSeconds(0.005 + 0.025 * (double)(seed >> 40) / (double)(1ull << 24)));
+
+		// Paused time counts for nothing.
+		if (f == frames / 3)
+		{
+			timer.Stop();
+			now += HighResClock::FromSeconds(5.0);
+			timer.Tick();
+			if (timer.DeltaTime() != 0.0f || timer.StepFixed())
+				errors++;
+			timer.Start();
+		}
+
+		// A stall adds at most maxFrame.
+		if (f == frames / 2)
+		{
+			std::uint64_t before = steps;
+			frame(HighResClock::FromSeconds(2.0));
+			if (steps - before > (std::uint64_t)(maxFrame / step) + 1)
+				errors++;
+		}
+	}
+
+	HighResClock::Ticks leftover = fed - (HighResClock::Ticks)steps * step;
+	if (steps != timer.FixedStepCount() || leftover < 0 || leftover >= step ||
+		std::fabs(timer.Alpha() - (double)leftover / step) > 1e-4)
+	{
+		errors++;
+	}
+
+	std::cout << "fixed steps: " << frames << " frames, " << steps << " steps of " << timer.FixedStep() * 1000.0f
+		<< " ms, alpha " << timer.Alpha() << ", total " << timer.TotalTime() << " s\n";
+
+	return errors;
+}
+
+static int CheckPacing(int frames, float rate)
+{
+	GameTimer timer;
+	timer.SetTargetFrameRate(rate);
+	timer.Reset();
+
+	std::clock_t cpuStart = std::clock();
+	auto start = HighResClock::Now();
+
+	double worst = 0.0;
+	for (int f = 0; f < frames; ++f)
+	{
+		timer.Tick();
+		if (f > 0)
+			worst = std::max<double>(worst, timer.DeltaTime());
+	}
+
+	double wall = HighResClock::ToSeconds(HighResClock::Now() - start);
+	double cpu = (double)(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+	// The first frame is not waited for.
+	double average = wall / (frames - 1);
+	double target = 1.0 / rate;
+
+	std::cout << "pacing at " << rate << " fps: average " << average * 1000.0 << " ms (target "
+		<< target * 1000.0 << "), worst " << worst * 1000.0 << " ms, cpu " << 100.0 * cpu / wall << "% of "
+		<< wall << " s\n";
+
+	int errors = 0;
+	if (std::fabs(average - target) > 0.05 * target)
+		errors++;
+	if (cpu > 0.5 * wall)
+		errors++;
+
+	return errors;
+}
+
+int main(int argc, char* argv[])
+{
+	int frames = 240;
+	float rate = 120.0f;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "-f") == 0)
+			frames = std::max<int>(10, std::atoi(argv[i + 1]));
+		else if (std::strcmp(argv[i], "-r") == 0)
+			rate = (float)std::atof(argv[i + 1]);
+	}
+
+	std::cout << std::fixed << std::setprecision(3);
+
+	int errors = CheckFixedSteps(frames);
+	errors += CheckPacing(frames, rate);
+
+	std::cout << (errors == 0 ? "passed\n" : "FAILED\n");
+
+	return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,248 @@
+//***************************************************************************************
+// main.cpp - checks UploadRingBuffer on SystemMemoryBackend with three frames in
+// flight: wrapping, growing, and that no allocation overlaps one the GPU may still read.
+//
+// Usage:
+//   UploadRingCheck [-f frames] [-c capacityKiB] [-s seed]
+//
+// Each frame allocates a random mix of constant buffers and small 16 byte aligned
+// blocks (now and then a burst several times the ring's size), fills every allocation
+// with a pattern of its own, and finishes with a fence the simulated GPU completes
+// three frames later.  Checks that
+//   -every allocation is aligned, inside its buffer, and overlaps no allocation of a
+//    frame still in flight;
+//   -when its frame completes, every allocation still holds its pattern;
+//   -a buffer is only destroyed once no frame in flight uses it;
+//   -the ring wraps, grows on bursts, and ends with one buffer.
+// Prints the ring's stats.
+//
+// Build:
+//   g++ -std=c++17 -O2 main.cpp ../../Common/UploadRingBuffer.cpp -o UploadRingCheck
+//***************************************************************************************
+
+#include "../../Common/UploadRingBuffer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <set>
+
+namespace
+{
+	int gErrors = 0;
+
+	void Check(bool ok, const char* what)
+	{
+		if (!ok)
+		{
+			std::cout << "  FAILED: " << what << "\n";
+			gErrors++;
+		}
+	}
+
+	struct Block
+	{
+		std::uint8_t* Begin = nullptr;
+		std::uint64_t Size = 0;
+		std::uint8_t* Buffer = nullptr;
+		std::uint8_t Pattern = 0;
+	};
+
+	struct Frame
+	{
+		std::uint64_t Fence = 0;
+		std::vector<Block> Blocks;
+	};
+
+	// SystemMemoryBackend that remembers buffer extents and refuses to destroy one a
+	// frame in flight still uses.
+	class TrackingBackend : public SystemMemoryBackend
+	{
+	public:
+		std::vector<std::pair<std::uint8_t*, std::uint64_t>> Live;
+		const std::deque<Frame>* InFlight = nullptr;
+		int Created = 0;
+
+		virtual std::uint8_t* CreateBuffer(std::uint64_t byteSize, UploadRingBuffer::GpuAddress& gpuAddress)override
+		{
+			std::uint8_t* p = SystemMemoryBackend::CreateBuffer(byteSize, gpuAddress);
+			Live.push_back(std::make_pair(p, byteSize));
+			Created++;
+			return p;
+		}
+
+		virtual void DestroyBuffer(std::uint8_t* cpuAddress)override
+		{
+			if (InFlight != nullptr)
+			{
+				for (const Frame& f : *InFlight)
+				{
+					for (const Block& b : f.Blocks)
+						Check(b.Buffer != cpuAddress, "buffer destroyed while in flight");
+				}
+			}
+
+			Live.erase(std::remove_if(Live.begin(), Live.end(),
+				[&](const std::pair<std::uint8_t*, std::uint64_t>& l) { return l.first == cpuAddress; }), Live.end());
+			SystemMemoryBackend::DestroyBuffer(cpuAddress);
+		}
+
+		std::uint8_t* BufferOf(const std::uint8_t* p, std::uint64_t& size)const
+		{
+			for (const auto& l : Live)
+			{
+				if (p >= l.first && p < l.first + l.second)
+				{
+					size = l.second;
+					return l.first;
+				}
+			}
+			return nullptr;
+		}
+	};
+
+	struct Constants
+	{
+		float World[16];
+		float TexTransform[16];
+	};
+}
+
+int main(int argc, char** argv)
+{
+	int frames = 20000;
+	int capacityKiB = 64;
+	unsigned seed = 3;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (std::strcmp(argv[i], "-f") == 0)
+			frames = std::max(1, std::atoi(argv[i + 1]));
+		else if (std::strcmp(argv[i], "-c") == 0)
+			capacityKiB = std::max(1, std::atoi(argv[i + 1]));
+		else if (std::strcmp(argv[i], "-s") == 0)
+			seed = (unsigned)std::atoi(argv[i + 1]);
+	}
+
+	const std::uint64_t FramesInFlight = 3;
+
+	std::mt19937 rng(seed);
+	std::deque<Frame> inFlight;
+	TrackingBackend backend;
+	backend.InFlight = &inFlight;
+
+	int wraps = 0;
+	std::uint64_t allocations = 0;
+	std::uint8_t nextPattern = 1;
+	{
+		UploadRingBuffer ring(&backend, (std::uint64_t)capacityKiB * 1024);
+		std::uint8_t* lastBuffer = nullptr;
+		std::uint64_t lastOffset = 0;
+
+		for (int f = 1; f <= frames; ++f)
+		{
+			std::uint64_t fence = (std::uint64_t)f;
+
+			// The GPU is FramesInFlight frames behind; what it finished is checked and
+			// handed back.
+			std::uint64_t completed = fence > FramesInFlight ? fence - FramesInFlight : 0;
+			while (!inFlight.empty() && inFlight.front().Fence <= completed)
+			{
+				for (const Block& b : inFlight.front().Blocks)
+				{
+					bool intact = true;
+					for (std::uint64_t i = 0; i < b.Size; ++i)
+						intact = intact && b.Begin[i] == b.Pattern;
+					Check(intact, "allocation unchanged until its frame completed");
+				}
+				inFlight.pop_front();
+			}
+			ring.Retire(completed);
+
+			Frame frame;
+			frame.Fence = fence;
+
+			// Mostly a frame's worth of constants; every 500th frame a burst that
+			// forces a grow.
+			int count = 1 + (int)(rng() % 24);
+			if (f % 500 == 0)
+				count += 4 * capacityKiB;
+
+			for (int i = 0; i < count; ++i)
+			{
+				UploadRingBuffer::Allocation a;
+				std::uint64_t alignment = UploadRingBuffer::ConstantAlignment;
+				if (rng() % 3 == 0)
+				{
+					alignment = 16;
+					a = ring.Allocate(1 + rng() % 700, alignment);
+				}
+				else
+				{
+					a = ring.AllocateConstants<Constants>(1 + (std::uint32_t)(rng() % 4));
+					Check(a.ElementByteSize == 256 && a.Size == 256ull * (a.Size / 256), "constants padded to 256 bytes");
+				}
+				allocations++;
+
+				std::uint64_t bufferSize = 0;
+				std::uint8_t* buffer = backend.BufferOf(a.CpuAddress, bufferSize);
+				Check(buffer != nullptr && a.Offset + a.Size <= bufferSize && buffer + a.Offset == a.CpuAddress, "inside its buffer");
+				Check(a.Offset % alignment == 0, "aligned");
+
+				if (buffer == lastBuffer && a.Offset < lastOffset)
+					wraps++;
+				lastBuffer = buffer;
+				lastOffset = a.Offset;
+
+				Block block;
+				block.Begin = a.CpuAddress;
+				block.Size = a.Size;
+				block.Buffer = buffer;
+				block.Pattern = nextPattern++;
+				if (nextPattern == 0)
+					nextPattern = 1;
+
+				for (const Frame& other : inFlight)
+				{
+					for (const Block& b : other.Blocks)
+					{
+						bool apart = block.Begin + block.Size <= b.Begin || b.Begin + b.Size <= block.Begin;
+						if (!apart)
+							Check(false, "no overlap with a frame in flight");
+					}
+				}
+				for (const Block& b : frame.Blocks)
+				{
+					bool apart = block.Begin + block.Size <= b.Begin || b.Begin + b.Size <= block.Begin;
+					if (!apart)
+						Check(false, "no overlap within a frame");
+				}
+
+				std::memset(block.Begin, block.Pattern, (size_t)block.Size);
+				frame.Blocks.push_back(block);
+			}
+
+			ring.FinishFrame(fence);
+			inFlight.push_back(std::move(frame));
+		}
+
+		inFlight.clear();
+		ring.Retire((std::uint64_t)frames);
+
+		const UploadRingBuffer::Stats& s = ring.GetStats();
+		Check(wraps > 0, "the ring wrapped");
+		Check(s.Grows > 0, "the ring grew");
+		Check(backend.LiveBuffers() == 1 && s.UsedBytes == 0, "one buffer left, empty");
+
+		std::cout << frames << " frames, " << allocations << " allocations, " << wraps << " wraps\n"
+			<< "  capacity " << s.Capacity / 1024 << " KiB after " << s.Grows << " grows ("
+			<< backend.Created << " buffers created), peak used " << s.PeakUsedBytes / 1024 << " KiB\n";
+	}
+	Check(backend.LiveBuffers() == 0, "ring destructor frees its buffers");
+
+	std::cout << (gErrors == 0 ? "passed" : "FAILED") << "\n";
+	return gErrors == 0 ? 0 : 1;
+}
@@ -1,5 +1,29 @@
 #include "FrameResource.h"
 
+FrameResource::FrameResource(ID3D12Device* device, UINT waveVertCount, UINT recordListCount)
+{
+    ThrowIfFailed(device->CreateCommandAllocator(
+        D3D12_COMMAND_LIST_TYPE_DIRECT,
+		IID_PPV_ARGS(CmdListAlloc.GetAddressOf())));
+
+    RecordAllocs.resize(recordListCount);
+    RecordLists.resize(recordListCount);
+    for (UINT i = 0; i < recordListCount; ++i)
+    {
+        ThrowIfFailed(device->CreateCommandAllocator(
+            D3D12_COMMAND_LIST_TYPE_DIRECT,
+            IID_PPV_ARGS(RecordAllocs[i].GetAddressOf())));
+
+        ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT,
+            RecordAllocs[i].Get(), nullptr,
+            IID_PPV_ARGS(RecordLists[i].GetAddressOf())));
+
+        ThrowIfFailed(RecordLists[i]->Close());
+    }
+
+    WavesVB = std::make_unique<UploadBuffer<Vertex>>(device, waveVertCount, false);
+}
+
 FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount)
 {
     ThrowIfFailed(device->CreateCommandAllocator(
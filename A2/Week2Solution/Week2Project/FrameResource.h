@@ -10,6 +10,14 @@ struct ObjectConstants
 	DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
 };
 
+// One element of the structured buffer read by instanced draws; must match InstanceData
+// in Default.hlsl.
+struct InstanceData
+{
+    DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
+	DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+};
+
 struct PassConstants
 {
     DirectX::XMFLOAT4X4 View = MathHelper::Identity4x4();
@@ -54,6 +62,9 @@ struct FrameResource
 {
 public:
     
+    // 'recordListCount' extra allocator/command list pairs are made for recording the
+    // frame's draws on several threads.
+    FrameResource(ID3D12Device* device, UINT waveVertCount, UINT recordListCount = 0);
     FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount);
 	FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount);
     FrameResource(const FrameResource& rhs) = delete;
@@ -64,6 +75,11 @@ public:
     // So each frame needs their own allocator.
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CmdListAlloc;
 
+    // One allocator per list, since an allocator may only be recorded into by one
+    // thread at a time.  The lists are created closed.
+    std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> RecordAllocs;
+    std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>> RecordLists;
+
     // We cannot update a cbuffer until the GPU is done processing the commands
     // that reference it.  So each frame needs their own cbuffers.
    // std::unique_ptr<UploadBuffer<FrameConstants>> FrameCB = nullptr;
@@ -71,6 +87,13 @@ public:
     std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialCB = nullptr;
     std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
 
+    // Constants sub-allocated from a shared UploadRingBuffer for this frame instead of
+    // the fixed buffers above.  Set each frame before drawing.
+    D3D12_GPU_VIRTUAL_ADDRESS PassCBAddress = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS MaterialCBAddress = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS ObjectCBAddress = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS InstanceDataAddress = 0;
+
     // We cannot update a dynamic vertex buffer until the GPU is done processing
     // the commands that reference it.  So each frame needs their own.
     std::unique_ptr<UploadBuffer<Vertex>> WavesVB = nullptr;
@@ -20,7 +20,16 @@
 // Include structures and functions for lighting.
 #include "LightingUtil.hlsl"
 
+#ifndef BINDLESS
+    #define BINDLESS 0
+#endif
+
+// With BINDLESS the texture is picked from the whole texture table by the material.
+#if BINDLESS
+Texture2D    gTextureMaps[BINDLESS_TEXTURE_COUNT] : register(t0, space2);
+#else
 Texture2D    gDiffuseMap : register(t0);
+#endif
 
 
 SamplerState gsamPointWrap        : register(s0);
@@ -37,6 +46,18 @@ cbuffer cbPerObject : register(b0)
 	float4x4 gTexTransform;
 };
 
+#ifdef INSTANCED
+// Per-instance transforms of an instanced draw, replacing cbPerObject.  The root SRV
+// points at the draw's first instance.
+struct InstanceData
+{
+    float4x4 World;
+	float4x4 TexTransform;
+};
+
+StructuredBuffer<InstanceData> gInstanceData : register(t0, space1);
+#endif
+
 // Constant data that varies per material.
 cbuffer cbPass : register(b1)
 {
@@ -74,6 +95,8 @@ cbuffer cbMaterial : register(b2)
     float3   gFresnelR0;
     float    gRoughness;
 	float4x4 gMatTransform;
+	uint     gDiffuseMapIndex;
+	uint3    cbMaterialPad;
 };
 
 struct VertexIn
@@ -91,22 +114,30 @@ struct VertexOut
 	float2 TexC    : TEXCOORD;
 };
 
-VertexOut VS(VertexIn vin)
+VertexOut VS(VertexIn vin, uint instanceID : SV_InstanceID)
 {
 	VertexOut vout = (VertexOut)0.0f;
+
+#ifdef INSTANCED
+    float4x4 world = gInstanceData[instanceID].World;
+    float4x4 texTransform = gInstanceData[instanceID].TexTransform;
+#else
+    float4x4 world = gWorld;
+    float4x4 texTransform = gTexTransform;
+#endif
 	
     // Transform to world space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    float4 posW = mul(float4(vin.PosL, 1.0f), world);
     vout.PosW = posW.xyz;
 
     // Assumes nonuniform scaling; otherwise, need to use inverse-transpose of world matrix.
-    vout.NormalW = mul(vin.NormalL, (float3x3)gWorld);
+    vout.NormalW = mul(vin.NormalL, (float3x3)world);
 
     // Transform to homogeneous clip space.
     vout.PosH = mul(posW, gViewProj);
 	
 	// Output vertex attributes for interpolation across triangle.
-	float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), gTexTransform);
+	float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), texTransform);
 	vout.TexC = mul(texC, gMatTransform).xy;
 
     return vout;
@@ -114,7 +145,11 @@ VertexOut VS(VertexIn vin)
 
 float4 PS(VertexOut pin) : SV_Target
 {
+#if BINDLESS
+    float4 diffuseAlbedo = gTextureMaps[gDiffuseMapIndex].Sample(gsamAnisotropicWrap, pin.TexC) * gDiffuseAlbedo;
+#else
     float4 diffuseAlbedo = gDiffuseMap.Sample(gsamAnisotropicWrap, pin.TexC) * gDiffuseAlbedo;
+#endif
 	
 #ifdef ALPHA_TEST
 	// Discard pixel if texture alpha < 0.1.  We do this test as soon 
@@ -18,7 +18,16 @@
 // Include structures and functions for lighting.
 #include "LightingUtil.hlsl"
 //step5
+#ifndef BINDLESS
+    #define BINDLESS 0
+#endif
+
+// With BINDLESS the texture is picked from the whole texture table by the material.
+#if BINDLESS
+Texture2DArray gTextureArrayMaps[BINDLESS_TEXTURE_COUNT] : register(t0, space3);
+#else
 Texture2DArray gTreeMapArray : register(t0);
+#endif
 
 //you can use dynamic indexing as well. Pay attention how we changed the sampler!
 //Texture2D gTreeMapArray[3] : register(t0);
@@ -75,6 +84,8 @@ cbuffer cbMaterial : register(b2)
     float3   gFresnelR0;
     float    gRoughness;
 	float4x4 gMatTransform;
+	uint     gDiffuseMapIndex;
+	uint3    cbMaterialPad;
 };
  
 struct VertexIn
@@ -171,7 +182,11 @@ void GS(point VertexOut gin[1], //PrimitiveType InputVertexType InputName[NumEle
 float4 PS(GeoOut pin) : SV_Target
 {
 	float3 uvw = float3(pin.TexC, pin.PrimID%3);
+#if BINDLESS
+    float4 diffuseAlbedo = gTextureArrayMaps[gDiffuseMapIndex].Sample(gsamAnisotropicWrap, uvw) * gDiffuseAlbedo;
+#else
     float4 diffuseAlbedo = gTreeMapArray.Sample(gsamAnisotropicWrap, uvw) * gDiffuseAlbedo;
+#endif
 
     //using dynamic indexing
     //float4 diffuseAlbedo = gTreeMapArray[pin.PrimID % 3].Sample(gsamAnisotropicWrap, pin.TexC) * gDiffuseAlbedo;
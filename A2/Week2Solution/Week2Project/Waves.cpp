@@ -3,13 +3,29 @@
 //***************************************************************************************
 
 #include "Waves.h"
-#include <ppl.h>
+#include "../../Common/Profiler.h"
 #include <algorithm>
 #include <vector>
 #include <cassert>
+#if defined(_MSC_VER)
+#include <ppl.h>
+#endif
 
 using namespace DirectX;
 
+// Rows are updated independently, so they are spread over the Concurrency Runtime's
+// threads where it exists (MSVC) and run in order elsewhere.
+template<typename Fn>
+static void ParallelRows(int begin, int end, const Fn& fn)
+{
+#if defined(_MSC_VER)
+	concurrency::parallel_for(begin, end, fn);
+#else
+	for(int i = begin; i < end; ++i)
+		fn(i);
+#endif
+}
+
 Waves::Waves(int m, int n, float dx, float dt, float speed, float damping)
 {
     mNumRows = m;
@@ -87,16 +103,16 @@ float Waves::Depth()const
 
 void Waves::Update(float dt)
 {
-	static float t = 0;
+	PROFILE_SCOPE("Waves::Update");
 
 	// Accumulate time.
-	t += dt;
+	mTime += dt;
 
 	// Only update the simulation at the specified time step.
-	if( t >= mTimeStep )
+	if( mTime >= mTimeStep )
 	{
 		// Only update interior points; we use zero boundary conditions.
-		concurrency::parallel_for(1, mNumRows - 1, [this](int i)
+		ParallelRows(1, mNumRows - 1, [this](int i)
 		//for(int i = 1; i < mNumRows-1; ++i)
 		{
 			for(int j = 1; j < mNumCols-1; ++j)
@@ -125,12 +141,12 @@ void Waves::Update(float dt)
 		// current solution becomes the new previous solution.
 		std::swap(mPrevSolution, mCurrSolution);
 
-		t = 0.0f; // reset time
+		mTime = 0.0f; // reset time
 
 		//
 		// Compute normals using finite difference scheme.
 		//
-		concurrency::parallel_for(1, mNumRows - 1, [this](int i)
+		ParallelRows(1, mNumRows - 1, [this](int i)
 		//for(int i = 1; i < mNumRows - 1; ++i)
 		{
 			for(int j = 1; j < mNumCols-1; ++j)
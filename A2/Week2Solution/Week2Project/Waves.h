@@ -54,6 +54,10 @@ private:
     float mTimeStep = 0.0f;
     float mSpatialStep = 0.0f;
 
+    // Time accumulated towards the next step.  Kept per instance, so several
+    // simulations (e.g. headless runs side by side) do not share it.
+    float mTime = 0.0f;
+
     std::vector<DirectX::XMFLOAT3> mPrevSolution;
     std::vector<DirectX::XMFLOAT3> mCurrSolution;
     std::vector<DirectX::XMFLOAT3> mNormals;
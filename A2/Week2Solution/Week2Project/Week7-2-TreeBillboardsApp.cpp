@@ -13,9 +13,30 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/TextureCache.h"
+#include "../../Common/TextureUploadBatch.h"
+#include "../../Common/UploadHeapBackend.h"
+#include "../../Common/SceneStore.h"
+#include "../../Common/JobSystem.h"
+#include "../../Common/DrawQueue.h"
+#include "../../Common/CommandListSink.h"
+#include "../../Common/FrameScheduler.h"
+#include "../../Common/FenceTimeline.h"
+#include "../../Common/NameRegistry.h"
+#include "../../Common/DescriptorHeap.h"
+#include "../../Common/PlacedBufferPool.h"
+#include "../../Common/GeometryPacker.h"
+#include "../../Common/Profiler.h"
+#include "../../Common/ShaderCache.h"
+#include "../../Common/TaskGraph.h"
+#include "../../Common/TreeBillboardsScene.h"
 #include "FrameResource.h"
 #include "Waves.h"
 
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
 using namespace DirectX::PackedVector;
@@ -24,55 +45,54 @@ using namespace std;
 #pragma comment(lib, "d3dcompiler.lib")
 #pragma comment(lib, "D3D12.lib")
 
+// Default frames in flight; the app's frame count can be changed with -frames N on the
+// command line.  -trace <file> writes the profiled CPU scopes of the last frames as
+// Chrome trace JSON on exit.
 const int gNumFrameResources = 3;
 
-// Lightweight structure stores parameters to draw a shape.  This will
-// vary from app-to-app.
-struct RenderItem
-{
-	RenderItem() = default;
+// -fps N paces frames to N per second, sleeping in between; by default frames run as
+// fast as presenting allows.
+const float gTargetFrameRate = 0.0f;
 
-	// World matrix of the shape that describes the object's local space
-	// relative to the world space, which defines the position, orientation,
-	// and scale of the object in the world.
-	XMFLOAT4X4 World = MathHelper::Identity4x4();
+// GPU memory the texture cache may keep resident before evicting unused textures.  Every
+// material holds a reference to its texture for the life of the app, so nothing here is
+// ever evicted; Tools/TextureCacheCheck exercises the eviction policy.
+const UINT64 gTextureBudgetBytes = 256ull * 1024 * 1024;
 
-	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+// Initial size of the ring that per-frame constants are allocated from; it grows on demand.
+const UINT64 gConstantRingBytes = 256ull * 1024;
 
-	// Dirty flag indicating the object data has changed and we need to update the constant buffer.
-	// Because we have an object cbuffer for each FrameResource, we have to apply the
-	// update to each FrameResource.  Thus, when we modify obect data we should set 
-	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
-	int NumFramesDirty = gNumFrameResources;
+// Size of the default heaps static vertex and index buffers are placed in, and the
+// initial size of the ring their data is staged in.
+const UINT64 gBufferHeapBytes = 16ull * 1024 * 1024;
+const UINT64 gGeometryUploadBytes = 1024ull * 1024;
 
-	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
-	UINT ObjCBIndex = -1;
+// The draws are recorded into up to gRecordThreads + one per layer command lists in
+// parallel; layers with fewer than gMinPacketsPerList packets are not split further.
+const UINT gRecordThreads = 4;
+const UINT gMinPacketsPerList = 64;
 
-	Material* Mat = nullptr;
-	MeshGeometry* Geo = nullptr;
+// Texture SRVs live in the first gMaxTextures slots of the SRV heap; the slots after them
+// are a ring for descriptors that only live for a frame.
+const UINT gMaxTextures = 256;
+const UINT gTransientDescriptors = 256;
 
-	// Primitive topology.
-	D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+// Bind the whole texture region as one table per command list and let the shaders index
+// it with the material's DiffuseMapIndex, instead of setting a table for each material.
+// The table's two ranges add up to 2 * gMaxTextures SRVs; Resource Binding Tier 1 only
+// allows gTier1SrvsPerStage, so there Initialize falls back to a table per material.
+const bool gBindlessTextures = true;
+const UINT gTier1SrvsPerStage = 128;
 
-	// DrawIndexedInstanced parameters.
-	UINT IndexCount = 0;
-	UINT StartIndexLocation = 0;
-	int BaseVertexLocation = 0;
-};
-
-enum class RenderLayer : int
-{
-	Opaque = 0,
-	Transparent,
-	AlphaTested,
-	AlphaTestedTreeSprites,
-	Count
-};
+// Compiled shaders are kept here, next to the executable's working directory, and only
+// recompiled when a source, include, define or the compile flags change.
+const char* const gShaderCacheDirectory = "ShaderCache";
 
 class TreeBillboardsApp : public D3DApp
 {
 public:
-	TreeBillboardsApp(HINSTANCE hInstance);
+	TreeBillboardsApp(HINSTANCE hInstance, UINT framesInFlight = gNumFrameResources,
+		float targetFrameRate = gTargetFrameRate);
 	TreeBillboardsApp(const TreeBillboardsApp& rhs) = delete;
 	TreeBillboardsApp& operator=(const TreeBillboardsApp& rhs) = delete;
 	~TreeBillboardsApp();
@@ -90,11 +110,16 @@ private:
 
 	void OnKeyboardInput(const GameTimer& gt);
 	void UpdateCamera(const GameTimer& gt);
-	void AnimateMaterials(const GameTimer& gt);
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMaterialCBs(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
 	void UpdateWaves(const GameTimer& gt);
+	void SimulateWaves(float totalTime, float dt);
+
+	// Startup stages made of the Build steps below; Initialize runs them as a TaskGraph.
+	void BuildGeometry();
+	void BuildScene();
+	void LogStartup(const TaskGraph& startup);
 
 	void LoadTextures();
 	void BuildRootSignature();
@@ -104,13 +129,18 @@ private:
 	void BuildWavesGeometry();
 	void BuildBoxGeometry();
 	void BuildShapeGeometry(string name, const GeometryGenerator::MeshData& shape);
+	void BuildShapeBuffers();
 	void BuildTreeSpritesGeometry();
 	void BuildPSOs();
+	ID3D12PipelineState* CreatePSO(const std::string& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
 	void BuildFrameResources();
 	void BuildMaterials();
-	void BuildRenderItems(string name, string materials, float sX, float sY, float sZ, float tX, float tY, float tZ);
-	void BuildRenderWorld();
-	void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+	void AddGeometry(std::unique_ptr<MeshGeometry> geo, const std::string& submesh);
+	void AddMesh(const std::string& name, MeshGeometry* geo, const SubmeshGeometry& submesh);
+	void BuildInstanceData();
+	UINT RecordRenderItems();
+	void BeginRecordList(ID3D12GraphicsCommandList* cmdList, ID3D12CommandAllocator* alloc);
+	void LogDrawStateChanges();
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();
 
@@ -119,36 +149,82 @@ private:
 
 private:
 
+	UINT mFramesInFlight = gNumFrameResources;
 	std::vector<std::unique_ptr<FrameResource>> mFrameResources;
 	FrameResource* mCurrFrameResource = nullptr;
 	int mCurrFrameResourceIndex = 0;
 
 	UINT mCbvSrvDescriptorSize = 0;
 
+	// gBindlessTextures, if the device's resource binding tier can hold the table.
+	bool mBindlessTextures = false;
+
 	ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
 
-	ComPtr<ID3D12DescriptorHeap> mSrvDescriptorHeap = nullptr;
+	std::unique_ptr<DescriptorHeap> mSrvHeap;
+
+	// Geometry buffers are placed in these heaps, so they are declared before the
+	// geometry that references them.
+	std::unique_ptr<PlacedBufferPool> mBufferPool;
+	std::unique_ptr<UploadHeapBackend> mGeometryUploadBackend;
+	std::unique_ptr<UploadRingBuffer> mGeometryUploads;
 
-	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
-	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
-	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
+	// Shapes from BuildShapeGeometry are packed here and put in one vertex and index
+	// buffer by BuildShapeBuffers.
+	struct PackedShape
+	{
+		std::string Name;
+		SubmeshGeometry Submesh;
+		UINT VertexCount = 0;
+	};
+	std::unique_ptr<GeometryPacker> mShapePacker;
+	std::vector<PackedShape> mPackedShapes;
+
+	// Looked up by name while the scene is built, by id after.
+	NameRegistry<std::unique_ptr<MeshGeometry>> mGeometries;
+	std::unique_ptr<TextureUploadBatch> mTextureUploads;
+	std::unique_ptr<TextureCache> mTextureCache;
+
+	// Pass, material and object constants are rewritten into this ring every frame.
+	std::unique_ptr<UploadHeapBackend> mConstantBackend;
+	std::unique_ptr<UploadRingBuffer> mConstantRing;
+
+	// Texture referenced by each SRV heap slot, indexed by DiffuseSrvHeapIndex,
+	// and the slot each texture was given.
+	std::vector<std::string> mSrvHeapTextures;
+	NameRegistry<UINT> mTextureSlots;
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
-	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
+	NameRegistry<ComPtr<ID3D12PipelineState>> mPSOs;
 
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mStdInputLayout;
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mTreeSpriteInputLayout;
 
-	RenderItem* mWavesRitem = nullptr;
+	// The wave pool's geometry, whose vertex buffer is the current frame's WavesVB.
+	MeshGeometry* mWavesGeo = nullptr;
+
+	// Workers for the per-frame constant buffer updates.
+	JobSystem mJobs;
+
+	// Render items, materials, culling and the frame's sorted draws; the app only
+	// uploads what it produces and records the draws.
+	TreeBillboardsScene mScene;
 
-	// List of all the render items.
-	std::vector<std::unique_ptr<RenderItem>> mAllRitems;
+	// PSO each layer is drawn with.
+	ID3D12PipelineState* mLayerPSOs[(int)RenderLayer::Count] = {};
 
-	// Render items divided by PSO.
-	std::vector<RenderItem*> mRitemLayer[(int)RenderLayer::Count];
+	// Variant of each layer's PSO for instanced draws, or null if the layer's items are
+	// never merged.
+	ID3D12PipelineState* mLayerInstancedPSOs[(int)RenderLayer::Count] = {};
+
+	// Packets recorded into each of the frame's record lists.
+	std::vector<PacketRange> mRecordRanges;
 
 	std::unique_ptr<Waves> mWaves;
 
-	std::vector<RenderItem*> mOpaqueRitems;
+	// Picks the frame resource of each frame and runs the next frame's wave step while
+	// the current one is submitted.  Declared after mWaves so the step finishes first.
+	std::unique_ptr<FenceTimeline> mFrameTimeline;
+	std::unique_ptr<FrameScheduler> mFrameScheduler;
 
 	PassConstants mMainPassCB;
 
@@ -173,11 +249,31 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 
 	try
 	{
-		TreeBillboardsApp theApp(hInstance);
+		UINT framesInFlight = gNumFrameResources;
+		if (const char* arg = std::strstr(cmdLine, "-frames "))
+			framesInFlight = (UINT)std::max<int>(1, std::atoi(arg + 8));
+
+		float targetFrameRate = gTargetFrameRate;
+		if (const char* arg = std::strstr(cmdLine, "-fps "))
+			targetFrameRate = std::max<float>(0.0f, (float)std::atof(arg + 5));
+
+		std::string tracePath;
+		if (const char* arg = std::strstr(cmdLine, "-trace "))
+			tracePath = std::string(arg + 7, std::strcspn(arg + 7, " \t"));
+
+		TreeBillboardsApp theApp(hInstance, framesInFlight, targetFrameRate);
 		if (!theApp.Initialize())
 			return 0;
 
-		return theApp.Run();
+		int result = theApp.Run();
+
+		if (!tracePath.empty())
+		{
+			std::ofstream trace(tracePath);
+			Profiler::WriteChromeTrace(trace);
+		}
+
+		return result;
 	}
 	catch (DxException& e)
 	{
@@ -186,13 +282,39 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 	}
 }
 
-TreeBillboardsApp::TreeBillboardsApp(HINSTANCE hInstance)
-	: D3DApp(hInstance)
+TreeBillboardsApp::TreeBillboardsApp(HINSTANCE hInstance, UINT framesInFlight, float targetFrameRate)
+	: D3DApp(hInstance),
+	mFramesInFlight(framesInFlight),
+	mScene(mJobs)
 {
+	mTimer.SetTargetFrameRate(targetFrameRate);
 }
 
 TreeBillboardsApp::~TreeBillboardsApp()
 {
+	if (mFrameScheduler != nullptr)
+	{
+		mFrameScheduler->WaitAhead();
+
+		const FrameScheduler::Stats& stats = mFrameScheduler->GetStats();
+		std::wostringstream msg;
+		msg << L"Frames: " << stats.Frames << L" with " << mFramesInFlight << L" in flight"
+			<< L", waited on the GPU in " << stats.StalledFrames
+			<< L" for " << stats.TotalGpuWaitMs << L" ms"
+			<< L", on the wave step for " << stats.TotalAheadWaitMs << L" ms\n";
+		OutputDebugString(msg.str().c_str());
+	}
+
+	// CPU time per profiled scope over the frames still in the profiler's history.
+	for (const Profiler::ScopeStats& s : Profiler::Summarize())
+	{
+		std::wostringstream msg;
+		msg << std::wstring(2 * s.Depth, L' ') << AnsiToWString(s.Name) << L": " << s.Count
+			<< L" calls, min " << s.MinMs << L" avg " << s.AvgMs
+			<< L" p99 " << s.P99Ms << L" max " << s.MaxMs << L" ms\n";
+		OutputDebugString(msg.str().c_str());
+	}
+
 	if (md3dDevice != nullptr)
 		FlushCommandQueue();
 }
@@ -205,99 +327,44 @@ bool TreeBillboardsApp::Initialize()
 	// Reset the command list to prep for initialization commands.
 	ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
 
+	mBufferPool = std::make_unique<PlacedBufferPool>(md3dDevice.Get(), gBufferHeapBytes);
+	mGeometryUploadBackend = std::make_unique<UploadHeapBackend>(md3dDevice.Get());
+	mGeometryUploads = std::make_unique<UploadRingBuffer>(mGeometryUploadBackend.get(), gGeometryUploadBytes);
+
 	// Get the increment size of a descriptor in this heap type.  This is hardware specific, 
 	// so we have to query this information.
 	mCbvSrvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
+	// Decided before the startup stages run: the root signature, the shader defines and
+	// the draw packets all depend on it.
+	D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+	ThrowIfFailed(md3dDevice->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)));
+	mBindlessTextures = gBindlessTextures &&
+		(options.ResourceBindingTier >= D3D12_RESOURCE_BINDING_TIER_2 || 2 * gMaxTextures <= gTier1SrvsPerStage);
+	mScene.SetBindlessTextures(mBindlessTextures);
+
 	mWaves = std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f);
 
-	LoadTextures();
-	BuildRootSignature();
-	BuildDescriptorHeaps();
-	BuildShadersAndInputLayouts();
-	BuildLandGeometry();
-	BuildWavesGeometry();
-	BuildBoxGeometry();
-	BuildTreeSpritesGeometry();
+	// Startup stages, in parallel where they do not depend on each other.  Only the
+	// geometry stage records into mCommandList.  The graph gets threads of its own, so
+	// the stages can still use mJobs.
+	TaskGraph startup;
+	TaskGraph::TaskId shaders = startup.Add("Shaders", [this]() { BuildShadersAndInputLayouts(); });
+	TaskGraph::TaskId textures = startup.Add("Textures", [this]() { LoadTextures(); BuildDescriptorHeaps(); });
+	TaskGraph::TaskId geometry = startup.Add("Geometry", [this]() { BuildGeometry(); });
+	TaskGraph::TaskId rootSignature = startup.Add("RootSignature", [this]() { BuildRootSignature(); });
+	TaskGraph::TaskId materials = startup.Add("Materials", [this]() { BuildMaterials(); }, { textures });
+	startup.Add("Scene", [this]() { BuildScene(); }, { geometry, materials });
+	startup.Add("FrameResources", [this]() { BuildFrameResources(); });
+	startup.Add("PSOs", [this]() { BuildPSOs(); }, { rootSignature, shaders });
+	{
+		JobSystem startupThreads;
+		startup.Run(startupThreads);
+	}
+	LogStartup(startup);
 
-	GeometryGenerator geoGen;
-	BuildShapeGeometry("Box", geoGen.CreateBox(1.0f, 1.0f, 1.0f, 0));
-	BuildShapeGeometry("Box2", geoGen.CreateBox(1.0f, 1.0f, 1.0f, 0));
-	BuildShapeGeometry("Box3", geoGen.CreateBox(1.0f, 1.0f, 1.0f, 0));
-	BuildShapeGeometry("Cylinder", geoGen.CreateCylinder(1.0f, 1.0f, 1.0f, 30, 1));
-	//BuildShapeGeometry("Cone", geoGen.CreateCylinder(1.0f, 0.0f, 1.0f, 30, 1), XMFLOAT4(DirectX::Colors::DarkRed));
-	BuildShapeGeometry("Sphere", geoGen.CreateSphere(1.0f, 30, 30));
-	//BuildShapeGeometry("Triangle", geoGen.CreateSphere(1.0f, 5, 2), XMFLOAT4(DirectX::Colors::Green));
-	BuildShapeGeometry("Grid", geoGen.CreateGrid(1.0f, 5.0f, 2, 2));
-	BuildShapeGeometry("Grid2", geoGen.CreateGrid(1.0f, 5.0f, 2, 2));
-	BuildShapeGeometry("Grid3", geoGen.CreateGrid(1.0f, 5.0f, 2, 2));
-
-	BuildShapeGeometry("Pyramid", geoGen.CreatePyramid(1.0f, 1.0f, 1.0f, 0));
-	BuildShapeGeometry("Cone2", geoGen.CreateCone(1.0f, 1.0f, 10, 2));
-	BuildShapeGeometry("Wedge", geoGen.CreateWedge(1.0f, 1.0f, 1.0f, 0));
-	BuildShapeGeometry("TriangularPrism", geoGen.CreateTriangularPrism(1.0f, 1.0f, 1.0f, 0));
-	BuildShapeGeometry("Diamond", geoGen.CreateDiamond(1.0f));
-
-	BuildMaterials();
-	//Decoration
-	BuildRenderItems("Diamond", "ice", 2.0f, 2.0f, 2.0f, 0.0f, 10.0f, 0.0f);
-	BuildRenderItems("Diamond", "ice", 2.0f, 2.0f, 2.0f, 0.0f, 10.0f, 0.0f);
-
-	//Chains for bridge
-	BuildRenderItems("Wedge", "woodCrate", 6.0f, 5.0f, 0.5f, 11.0f, 0.5f, -3.0f);
-	BuildRenderItems("Wedge", "woodCrate", 6.0f, 5.0f, 0.5f, 11.0f, 0.5f, 3.0f);
-	BuildRenderItems("Wedge", "woodCrate", 6.0f, 5.0f, 0.5f, 11.0f, 0.5f, 3.0f);
-
-	//Walls
-	BuildRenderItems("Box", "bricks", 2.0f, 6.0f, 12.0f, -8.0f, 1.0f, 0.0f);
-	BuildRenderItems("Box", "bricks", 2.0f, 6.0f, 12.0f, 8.0f, 1.0f, 0.0f);
-	BuildRenderItems("Box", "bricks", 12.0f, 6.0f, 2.0f, 0.0f, 1.0f, 8.0f);
-	BuildRenderItems("Box", "bricks", 12.0f, 6.0f, 2.0f, 0.0f, 1.0f, -8.0f);
-	BuildRenderItems("Box", "bricks", 2.0f, 6.0f, 12.0f, -8.0f, 1.0f, 0.0f);
-
-	////Towers
-	BuildRenderItems("Cylinder", "grass", 2.0f, 8.0f, 2.0f, -8.0f, 2.0f, 8.0f);
-	BuildRenderItems("Cylinder", "grass", 2.0f, 8.0f, 2.0f, 8.0f, 2.0f, 8.0f);
-	BuildRenderItems("Cylinder", "grass", 2.0f, 8.0f, 2.0f, -8.0f, 2.0f, -8.0f);
-	BuildRenderItems("Cylinder", "grass", 2.0f, 8.0f, 2.0f, 8.0f, 2.0f, -8.0f);
-
-	//Tower roofs
-	BuildRenderItems("Cone2", "woodCrate", 2.0f, 8.0f, 2.0f, -8.0f, 8.0f, 8.0f);
-	BuildRenderItems("Cone2", "woodCrate", 2.0f, 8.0f, 2.0f, 8.0f, 8.0f, 8.0f);
-	BuildRenderItems("Cone2", "woodCrate", 2.0f, 8.0f, 2.0f, -8.0f, 8.0f, -8.0f);
-	BuildRenderItems("Cone2", "woodCrate", 2.0f, 8.0f, 2.0f, 8.0f, 8.0f, -8.0f);
-
-	////Tower balls
-	BuildRenderItems("Sphere", "ice", 1.0f, 1.0f, 1.0f, -8.0f, 12.0f, 8.0f);
-	BuildRenderItems("Sphere", "ice", 1.0f, 1.0f, 1.0f, 8.0f, 12.0f, 8.0f);
-	BuildRenderItems("Sphere", "ice", 1.0f, 1.0f, 1.0f, -8.0f, 12.0f, -8.0f);
-	BuildRenderItems("Sphere", "ice", 1.0f, 1.0f, 1.0f, 8.0f, 12.0f, -8.0f);
-
-	////Gate and door
-	BuildRenderItems("Box2", "woodCrate", 6.0f, 0.5f, 6.0f, 11.0f, -2.0f, 0.0f);
-	BuildRenderItems("Box3", "woodCrate", 0.5f, 6.0f, 6.0f, 9.0f, 1.0f, 0.0f);
-
-	////Decoration on walls
-	BuildRenderItems("Pyramid", "ice", 1.0f, 1.0f, 1.0f, -8.0f, 4.0f, 0.0f);
-	BuildRenderItems("Pyramid", "ice", 1.0f, 1.0f, 1.0f, -8.0f, 4.0f, 4.0f);
-	BuildRenderItems("Pyramid", "ice", 1.0f, 1.0f, 1.0f, -8.0f, 4.0f, -4.0f);
-
-	BuildRenderItems("Pyramid", "ice", 1.0f, 1.0f, 1.0f, 0.0f, 4.0f, 8.0f);
-	BuildRenderItems("Pyramid", "ice", 1.0f, 1.0f, 1.0f, 4.0f, 4.0f, 8.0f);
-	BuildRenderItems("Pyramid", "ice", 1.0f, 1.0f, 1.0f, -4.0f, 4.0f, 8.0f);
-
-	BuildRenderItems("Pyramid", "ice", 1.0f, 1.0f, 1.0f, 4.0f, 4.0f, -8.0f);
-	BuildRenderItems("Pyramid", "ice", 1.0f, 1.0f, 1.0f, 0.0f, 4.0f, -8.0f);
-	BuildRenderItems("Pyramid", "ice", 1.0f, 1.0f, 1.0f, -4.0f, 4.0f, -8.0f);
-
-	//Moat, floor and grass
-	BuildRenderItems("Grid", "water", 25.0f, 20.0f, 5.0f, 0.0f, -2.0f, 0.0f);
-	BuildRenderItems("Grid2", "grass", 40.0f, 20.0f, 10.0f, 0.0f, -2.8f, 0.0f);
-	BuildRenderItems("Grid3", "woodCrate", 15.0f, 20.0f, 4.0f, 0.0f, -1.8f, 0.0f);
-
-	BuildRenderWorld();
-	BuildFrameResources();
-	BuildPSOs();
+	// Copy every texture created above through a single upload buffer.
+	mTextureUploads->Record(mCommandList.Get(), mCurrentFence + 1);
 
 	// Execute the initialization commands.
 	ThrowIfFailed(mCommandList->Close());
@@ -307,6 +374,16 @@ bool TreeBillboardsApp::Initialize()
 	// Wait until initialization is complete.
 	FlushCommandQueue();
 
+	// The texture and geometry copies have executed, so their upload space can go.
+	mTextureUploads->Update(mFence->GetCompletedValue());
+	mGeometryUploads->FinishFrame(mCurrentFence);
+	mGeometryUploads->Retire(mFence->GetCompletedValue());
+	mTextureCache->Update(mFence->GetCompletedValue());
+
+#if defined(DEBUG) | defined(_DEBUG)
+	LogDrawStateChanges();
+#endif
+
 	return true;
 }
 
@@ -321,24 +398,26 @@ void TreeBillboardsApp::OnResize()
 
 void TreeBillboardsApp::Update(const GameTimer& gt)
 {
+	PROFILE_SCOPE("Update");
+
 	OnKeyboardInput(gt);
 	UpdateCamera(gt);
+	mScene.CullRenderItems(mView, mProj);
 
-	// Cycle through the circular frame resource array.
-	mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % gNumFrameResources;
-	mCurrFrameResource = mFrameResources[mCurrFrameResourceIndex].get();
-
-	// Has the GPU finished processing the commands of the current frame resource?
-	// If not, wait until the GPU has completed commands up to this fence point.
-	if (mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
+	// Cycle through the circular frame resource array, waiting if the GPU has not
+	// finished the commands of the next frame resource yet.
 	{
-		HANDLE eventHandle = CreateEventEx(nullptr, nullptr, false, EVENT_ALL_ACCESS);
-		ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-		WaitForSingleObject(eventHandle, INFINITE);
-		CloseHandle(eventHandle);
+		PROFILE_SCOPE("WaitForFrame");
+		mCurrFrameResourceIndex = (int)mFrameScheduler->BeginFrame();
 	}
+	mCurrFrameResource = mFrameResources[mCurrFrameResourceIndex].get();
+
+	mTextureCache->Update(mFence->GetCompletedValue());
+	mTextureUploads->Update(mFence->GetCompletedValue());
+	mConstantRing->Retire(mFence->GetCompletedValue());
+	mSrvHeap->Allocator().Retire(mFence->GetCompletedValue());
 
-	AnimateMaterials(gt);
+	mScene.AnimateMaterials(gt.DeltaTime());
 	UpdateObjectCBs(gt);
 	UpdateMaterialCBs(gt);
 	UpdateMainPassCB(gt);
@@ -347,6 +426,15 @@ void TreeBillboardsApp::Update(const GameTimer& gt)
 
 void TreeBillboardsApp::Draw(const GameTimer& gt)
 {
+	PROFILE_SCOPE("Draw");
+
+	// UpdateWaves has copied this frame's wave solution, so step the simulation for the
+	// next frame while this one is recorded and submitted.  The timer ticks before the
+	// next Update, so pass the times by value.
+	float totalTime = gt.TotalTime();
+	float dt = gt.DeltaTime();
+	mFrameScheduler->RunAhead([this, totalTime, dt]() { SimulateWaves(totalTime, dt); });
+
 	auto cmdListAlloc = mCurrFrameResource->CmdListAlloc;
 
 	// Reuse the memory associated with command recording.
@@ -355,11 +443,16 @@ void TreeBillboardsApp::Draw(const GameTimer& gt)
 
 	// A command list can be reset after it has been added to the command queue via ExecuteCommandList.
 	// Reusing the command list reuses memory.
-	ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque"].Get()));
+	ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mLayerPSOs[(int)RenderLayer::Opaque]));
 
 	mCommandList->RSSetViewports(1, &mScreenViewport);
 	mCommandList->RSSetScissorRects(1, &mScissorRect);
 
+	// Textures the cache created since the last frame (e.g. reloaded after an eviction)
+	// are still in COPY_DEST; copy them before any draw can sample them.
+	if (mTextureUploads->HasPending())
+		mTextureUploads->Record(mCommandList.Get(), mCurrentFence + 1);
+
 	// Indicate a state transition on the resource usage.
 	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
 		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
@@ -368,40 +461,31 @@ void TreeBillboardsApp::Draw(const GameTimer& gt)
 	mCommandList->ClearRenderTargetView(CurrentBackBufferView(), (float*)&mMainPassCB.FogColor, 0, nullptr);
 	mCommandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
-	// Specify the buffers we are going to render to.
-	mCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
-
-	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap.Get() };
-	mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-
-	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
-
-	auto passCB = mCurrFrameResource->PassCB->Resource();
-	mCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
+	mScene.BuildDrawQueue(mView);
+	BuildInstanceData();
 
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
+	// The draws go into the frame's record lists, which execute after mCommandList in
+	// range order.  The last list used transitions the back buffer for presenting.
+	UINT listCount = RecordRenderItems();
 
-	mCommandList->SetPipelineState(mPSOs["alphaTested"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::AlphaTested]);
-
-	mCommandList->SetPipelineState(mPSOs["treeSprites"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::AlphaTestedTreeSprites]);
-
-	mCommandList->SetPipelineState(mPSOs["transparent"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Transparent]);
-
-	DrawRenderItems(mCommandList.Get(), mOpaqueRitems);
+	ID3D12GraphicsCommandList* lastList = listCount > 0 ?
+		mCurrFrameResource->RecordLists[listCount - 1].Get() : mCommandList.Get();
 
 	// Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
+	lastList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
 		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
 
 	// Done recording commands.
 	ThrowIfFailed(mCommandList->Close());
+	for (UINT i = 0; i < listCount; ++i)
+		ThrowIfFailed(mCurrFrameResource->RecordLists[i]->Close());
 
-	// Add the command list to the queue for execution.
-	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
-	mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+	// Add the command lists to the queue for execution.
+	std::vector<ID3D12CommandList*> cmdsLists;
+	cmdsLists.push_back(mCommandList.Get());
+	for (UINT i = 0; i < listCount; ++i)
+		cmdsLists.push_back(mCurrFrameResource->RecordLists[i].Get());
+	mCommandQueue->ExecuteCommandLists((UINT)cmdsLists.size(), cmdsLists.data());
 
 	// Swap the back and front buffers
 	ThrowIfFailed(mSwapChain->Present(0, 0));
@@ -409,6 +493,9 @@ void TreeBillboardsApp::Draw(const GameTimer& gt)
 
 	// Advance the fence value to mark commands up to this fence point.
 	mCurrFrameResource->Fence = ++mCurrentFence;
+	mConstantRing->FinishFrame(mCurrentFence);
+	mSrvHeap->Allocator().FinishFrame(mCurrentFence);
+	mFrameScheduler->EndFrame(mCurrentFence);
 
 	// Add an instruction to the command queue to set a new fence point. 
 	// Because we are on the GPU timeline, the new fence point won't be 
@@ -481,78 +568,29 @@ void TreeBillboardsApp::UpdateCamera(const GameTimer& gt)
 	XMStoreFloat4x4(&mView, view);
 }
 
-void TreeBillboardsApp::AnimateMaterials(const GameTimer& gt)
-{
-	// Scroll the water material texture coordinates.
-	auto waterMat = mMaterials["water"].get();
-
-	float& tu = waterMat->MatTransform(3, 0);
-	float& tv = waterMat->MatTransform(3, 1);
-
-	tu += 0.1f * gt.DeltaTime();
-	tv += 0.02f * gt.DeltaTime();
-
-	if (tu >= 1.0f)
-		tu -= 1.0f;
-
-	if (tv >= 1.0f)
-		tv -= 1.0f;
-
-	waterMat->MatTransform(3, 0) = tu;
-	waterMat->MatTransform(3, 1) = tv;
-
-	// Material has changed, so need to update cbuffer.
-	waterMat->NumFramesDirty = gNumFrameResources;
-}
-
 void TreeBillboardsApp::UpdateObjectCBs(const GameTimer& gt)
 {
-	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
-	for (auto& e : mAllRitems)
-	{
-		// Only update the cbuffer data if the constants have changed.  
-		// This needs to be tracked per frame resource.
-		if (e->NumFramesDirty > 0)
-		{
-			XMMATRIX world = XMLoadFloat4x4(&e->World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
+	static_assert(sizeof(ObjectConstants) <= SceneStore::ConstantsStride &&
+		offsetof(ObjectConstants, TexTransform) == offsetof(SceneStore::ObjectData, TexTransform),
+		"SceneStore::ObjectData must match the ObjectConstants layout.");
 
-			ObjectConstants objConstants;
-			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-			XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
+	// Ring memory is fresh every frame; the scene streams every item's constants into it.
+	auto currObjectCB = mConstantRing->AllocateConstants<ObjectConstants>(mScene.Store().Size());
+	mScene.UpdateObjectConstants(currObjectCB.CpuAddress, currObjectCB.ElementByteSize);
 
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
-
-			// Next FrameResource need to be updated too.
-			e->NumFramesDirty--;
-		}
-	}
+	mCurrFrameResource->ObjectCBAddress = currObjectCB.GpuAddress;
 }
 
 void TreeBillboardsApp::UpdateMaterialCBs(const GameTimer& gt)
 {
-	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
-	for (auto& e : mMaterials)
-	{
-		// Only update the cbuffer data if the constants have changed.  If the cbuffer
-		// data changes, it needs to be updated for each FrameResource.
-		Material* mat = e.second.get();
-		if (mat->NumFramesDirty > 0)
-		{
-			XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform);
-
-			MaterialConstants matConstants;
-			matConstants.DiffuseAlbedo = mat->DiffuseAlbedo;
-			matConstants.FresnelR0 = mat->FresnelR0;
-			matConstants.Roughness = mat->Roughness;
-			XMStoreFloat4x4(&matConstants.MatTransform, XMMatrixTranspose(matTransform));
+	static_assert(sizeof(MaterialConstants) == sizeof(TreeBillboardsScene::MaterialData) &&
+		offsetof(MaterialConstants, DiffuseMapIndex) == offsetof(TreeBillboardsScene::MaterialData, DiffuseMapIndex),
+		"TreeBillboardsScene::MaterialData must match the MaterialConstants layout.");
 
-			currMaterialCB->CopyData(mat->MatCBIndex, matConstants);
+	auto currMaterialCB = mConstantRing->AllocateConstants<MaterialConstants>(mScene.MaterialCount());
+	mScene.UpdateMaterialConstants(currMaterialCB.CpuAddress, currMaterialCB.ElementByteSize);
 
-			// Next FrameResource need to be updated too.
-			mat->NumFramesDirty--;
-		}
-	}
+	mCurrFrameResource->MaterialCBAddress = currMaterialCB.GpuAddress;
 }
 
 void TreeBillboardsApp::UpdateMainPassCB(const GameTimer& gt)
@@ -594,15 +632,17 @@ void TreeBillboardsApp::UpdateMainPassCB(const GameTimer& gt)
 	mMainPassCB.Lights[0, 4].Strength = { 1.0f, 1.0f, 0.0f };
 	mMainPassCB.Lights[0, 4].Position = { 0.0f, 2.0f, -10.0f };
 
-	auto currPassCB = mCurrFrameResource->PassCB.get();
-	currPassCB->CopyData(0, mMainPassCB);
+	auto currPassCB = mConstantRing->AllocateConstants<PassConstants>(1);
+	currPassCB.CopyData(0, mMainPassCB);
+	mCurrFrameResource->PassCBAddress = currPassCB.GpuAddress;
 }
 
-void TreeBillboardsApp::UpdateWaves(const GameTimer& gt)
+void TreeBillboardsApp::SimulateWaves(float totalTime, float dt)
 {
+	// Runs on the frame scheduler's thread; only touches mWaves.
 	// Every quarter second, generate a random wave.
 	static float t_base = 0.0f;
-	if ((mTimer.TotalTime() - t_base) >= 0.25f)
+	if ((totalTime - t_base) >= 0.25f)
 	{
 		t_base += 0.25f;
 
@@ -615,10 +655,21 @@ void TreeBillboardsApp::UpdateWaves(const GameTimer& gt)
 	}
 
 	// Update the wave simulation.
-	mWaves->Update(gt.DeltaTime());
+	mWaves->Update(dt);
+}
+
+void TreeBillboardsApp::UpdateWaves(const GameTimer& gt)
+{
+	PROFILE_SCOPE("UpdateWaves");
+
+	// The step started by the last Draw; the first frame shows the initial solution.
+	mFrameScheduler->WaitAhead();
 
 	// Update the wave vertex buffer with the new solution.
+	// Vertices are written straight into the mapped buffer, in order, one whole vertex
+	// at a time.
 	auto currWavesVB = mCurrFrameResource->WavesVB.get();
+	Vertex* dst = currWavesVB->Element(0);
 	for (int i = 0; i < mWaves->VertexCount(); ++i)
 	{
 		Vertex v;
@@ -631,93 +682,110 @@ void TreeBillboardsApp::UpdateWaves(const GameTimer& gt)
 		v.TexC.x = 0.5f + v.Pos.x / mWaves->Width();
 		v.TexC.y = 0.5f - v.Pos.z / mWaves->Depth();
 
-		currWavesVB->CopyData(i, v);
+		dst[i] = v;
 	}
 
 	// Set the dynamic VB of the wave renderitem to the current frame VB.
-	mWavesRitem->Geo->VertexBufferGPU = currWavesVB->Resource();
+	mWavesGeo->VertexBufferGPU = currWavesVB->Resource();
+}
+
+void TreeBillboardsApp::BuildGeometry()
+{
+	BuildLandGeometry();
+	BuildWavesGeometry();
+	BuildBoxGeometry();
+	BuildTreeSpritesGeometry();
+
+	mShapePacker = std::make_unique<GeometryPacker>((UINT)sizeof(Vertex));
+	TreeBillboardsScene::CreateShapes([this](const std::string& name, const GeometryGenerator::MeshData& shape)
+	{
+		BuildShapeGeometry(name, shape);
+	});
+	BuildShapeBuffers();
+
+	mWavesGeo = mGeometries[mGeometries.Get("waterGeo")].get();
+}
+
+void TreeBillboardsApp::BuildScene()
+{
+	mScene.BuildScene();
+}
+
+void TreeBillboardsApp::LogStartup(const TaskGraph& startup)
+{
+	double busyMs = 0.0;
+	for (const TaskGraph::Timing& t : startup.Timings())
+	{
+		std::wostringstream msg;
+		msg << L"Startup " << AnsiToWString(t.Name) << L": " << t.StartMs << L" - " << t.EndMs
+			<< L" ms (" << t.EndMs - t.StartMs << L" ms) on lane " << t.Lane << L"\n";
+		OutputDebugString(msg.str().c_str());
+
+		busyMs += t.EndMs - t.StartMs;
+	}
+
+	std::wostringstream msg;
+	msg << L"Startup: " << startup.WallMs() << L" ms for " << busyMs << L" ms of stages"
+		<< L", critical path " << startup.CriticalPathMs() << L" ms\n";
+	OutputDebugString(msg.str().c_str());
 }
 
 void TreeBillboardsApp::LoadTextures()
 {
-	auto woodCrateTex = std::make_unique<Texture>();
-	woodCrateTex->Name = "woodCrateTex";
-	woodCrateTex->Filename = L"../../Textures/stone.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), woodCrateTex->Filename.c_str(),
-		woodCrateTex->Resource, woodCrateTex->UploadHeap));
-
-	//Bricks
-	auto bricksTex = std::make_unique<Texture>();
-	bricksTex->Name = "bricksTex";
-	bricksTex->Filename = L"../../Textures/bricks3.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), bricksTex->Filename.c_str(),
-		bricksTex->Resource, bricksTex->UploadHeap));
-
-	//Ice
-	auto iceTex = std::make_unique<Texture>();
-	iceTex->Name = "iceTex";
-	iceTex->Filename = L"../../Textures/ice.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), iceTex->Filename.c_str(),
-		iceTex->Resource, iceTex->UploadHeap));
-
-	auto grassTex = std::make_unique<Texture>();
-	grassTex->Name = "grassTex";
-	grassTex->Filename = L"../../Textures/grass.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), grassTex->Filename.c_str(),
-		grassTex->Resource, grassTex->UploadHeap));
-
-	auto waterTex = std::make_unique<Texture>();
-	waterTex->Name = "waterTex";
-	waterTex->Filename = L"../../Textures/water1.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), waterTex->Filename.c_str(),
-		waterTex->Resource, waterTex->UploadHeap));
-
-	auto fenceTex = std::make_unique<Texture>();
-	fenceTex->Name = "fenceTex";
-	fenceTex->Filename = L"../../Textures/WireFence.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), fenceTex->Filename.c_str(),
-		fenceTex->Resource, fenceTex->UploadHeap));
-
-	auto treeArrayTex = std::make_unique<Texture>();
-	treeArrayTex->Name = "treeArrayTex";
-	treeArrayTex->Filename = L"../../Textures/treeArray.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), treeArrayTex->Filename.c_str(),
-		treeArrayTex->Resource, treeArrayTex->UploadHeap));
-
-	mTextures[woodCrateTex->Name] = std::move(woodCrateTex);
-	mTextures[bricksTex->Name] = std::move(bricksTex);
-	mTextures[iceTex->Name] = std::move(iceTex);
-	mTextures[grassTex->Name] = std::move(grassTex);
-	mTextures[waterTex->Name] = std::move(waterTex);
-	mTextures[fenceTex->Name] = std::move(fenceTex);
-	mTextures[treeArrayTex->Name] = std::move(treeArrayTex);
+	// Compressed textures decode their chunks on mJobs.  The Scene stage, the only other
+	// startup stage using mJobs, runs after this one.
+	auto decode = [this](std::size_t count, const std::function<void(std::size_t)>& work)
+	{
+		mJobs.ParallelFor((std::uint32_t)count, 1, [&](std::uint32_t begin, std::uint32_t end)
+		{
+			for (std::uint32_t i = begin; i < end; ++i)
+				work(i);
+		});
+	};
+	mTextureUploads = std::make_unique<TextureUploadBatch>(md3dDevice.Get(), decode);
+	mTextureCache = std::make_unique<TextureCache>(mTextureUploads.get(), gTextureBudgetBytes);
+
+	// Textures are created on first Acquire, when the descriptor heap is built.
+	mTextureCache->Register("woodCrateTex", L"../../Textures/stone.dds");
+	mTextureCache->Register("bricksTex", L"../../Textures/bricks3.dds");
+	mTextureCache->Register("iceTex", L"../../Textures/ice.dds");
+	mTextureCache->Register("grassTex", L"../../Textures/grass.dds");
+	mTextureCache->Register("waterTex", L"../../Textures/water1.dds");
+	mTextureCache->Register("fenceTex", L"../../Textures/WireFence.dds");
+	mTextureCache->Register("treeArrayTex", L"../../Textures/treeArray.dds");
 }
 
 void TreeBillboardsApp::BuildRootSignature()
 {
-	CD3DX12_DESCRIPTOR_RANGE texTable;
-	texTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+	// Bindless: two ranges over the same texture slots, seen as Texture2D in space2 and as
+	// Texture2DArray in space3.  Otherwise one SRV at t0, set per material.
+	CD3DX12_DESCRIPTOR_RANGE texTable[2];
+	UINT texRangeCount = 1;
+	if (mBindlessTextures)
+	{
+		texTable[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, gMaxTextures, 0, 2, 0);
+		texTable[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, gMaxTextures, 0, 3, 0);
+		texRangeCount = 2;
+	}
+	else
+	{
+		texTable[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+	}
 
 	// Root parameter can be a table, root descriptor or root constants.
-	CD3DX12_ROOT_PARAMETER slotRootParameter[4];
+	CD3DX12_ROOT_PARAMETER slotRootParameter[5];
 
 	// Perfomance TIP: Order from most frequent to least frequent.
-	slotRootParameter[0].InitAsDescriptorTable(1, &texTable, D3D12_SHADER_VISIBILITY_PIXEL);
+	slotRootParameter[0].InitAsDescriptorTable(texRangeCount, texTable, D3D12_SHADER_VISIBILITY_PIXEL);
 	slotRootParameter[1].InitAsConstantBufferView(0);
 	slotRootParameter[2].InitAsConstantBufferView(1);
 	slotRootParameter[3].InitAsConstantBufferView(2);
+	slotRootParameter[4].InitAsShaderResourceView(0, 1, D3D12_SHADER_VISIBILITY_VERTEX);
 
 	auto staticSamplers = GetStaticSamplers();
 
 	// A root signature is an array of root parameters.
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(4, slotRootParameter,
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(5, slotRootParameter,
 		(UINT)staticSamplers.size(), staticSamplers.data(),
 		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
@@ -742,81 +810,71 @@ void TreeBillboardsApp::BuildRootSignature()
 
 void TreeBillboardsApp::BuildDescriptorHeaps()
 {
-	//
-	// Create the SRV heap.
-	//
-	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 7;
-	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&mSrvDescriptorHeap)));
-
-	//
-	// Fill out the heap with actual descriptors.
-	//
-	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-
-	auto woodCrateTex = mTextures["woodCrateTex"]->Resource;
-	auto bricksTex = mTextures["bricksTex"]->Resource;
-	auto iceTex = mTextures["iceTex"]->Resource;
-	auto grassTex = mTextures["grassTex"]->Resource;
-	auto waterTex = mTextures["waterTex"]->Resource;
-	auto fenceTex = mTextures["fenceTex"]->Resource;
-	auto treeArrayTex = mTextures["treeArrayTex"]->Resource;
-
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.Format = grassTex->GetDesc().Format;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.Texture2D.MipLevels = -1;
-	md3dDevice->CreateShaderResourceView(grassTex.Get(), &srvDesc, hDescriptor);
-
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-
-	srvDesc.Format = woodCrateTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(woodCrateTex.Get(), &srvDesc, hDescriptor);
-
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-
-	srvDesc.Format = iceTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(iceTex.Get(), &srvDesc, hDescriptor);
-
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-
-	srvDesc.Format = bricksTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(bricksTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-
-	srvDesc.Format = waterTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(waterTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+	mSrvHeap = std::make_unique<DescriptorHeap>(md3dDevice.Get(), gMaxTextures, gTransientDescriptors);
+
+	// The bindless table spans every texture slot, so slots without a texture get a
+	// null descriptor.  Both of its ranges see the same slots, so one descriptor cannot
+	// match the Texture2D range and the Texture2DArray range at once: the null ones are
+	// Texture2D, and a texture's slot holds a view of its own dimension.  The shaders
+	// only index a material's own DiffuseMapIndex, and each material is drawn by the
+	// shader whose range matches its texture (arrays only by the tree sprites), so no
+	// slot is read through a range of the wrong dimension.
+	D3D12_SHADER_RESOURCE_VIEW_DESC nullDesc = {};
+	nullDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	nullDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	nullDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	nullDesc.Texture2D.MipLevels = 1;
+	for (UINT i = 0; i < gMaxTextures; ++i)
+		md3dDevice->CreateShaderResourceView(nullptr, &nullDesc, mSrvHeap->CpuHandle(i));
+
+	// Each heap slot holds a reference to its texture for as long as the descriptor lives.
+	const char* textures[] = { "grassTex", "woodCrateTex", "iceTex", "bricksTex", "waterTex", "fenceTex", "treeArrayTex" };
+	mSrvHeapTextures.assign(gMaxTextures, std::string());
+
+	const UINT64 uploadFence = mCurrentFence + 1;
+	for (const char* name : textures)
+	{
+		auto tex = mTextureCache->Acquire(name, uploadFence)->Resource;
+		auto desc = tex->GetDesc();
 
-	srvDesc.Format = fenceTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(fenceTex.Get(), &srvDesc, hDescriptor);
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Format = desc.Format;
+		if (desc.DepthOrArraySize > 1)
+		{
+			srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+			srvDesc.Texture2DArray.MostDetailedMip = 0;
+			srvDesc.Texture2DArray.MipLevels = -1;
+			srvDesc.Texture2DArray.FirstArraySlice = 0;
+			srvDesc.Texture2DArray.ArraySize = desc.DepthOrArraySize;
+		}
+		else
+		{
+			srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+			srvDesc.Texture2D.MostDetailedMip = 0;
+			srvDesc.Texture2D.MipLevels = -1;
+		}
 
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+		UINT slot = mSrvHeap->Allocator().Allocate();
+		if (slot == DescriptorAllocator::InvalidIndex)
+			ThrowIfFailed(E_OUTOFMEMORY);
 
-	auto desc = treeArrayTex->GetDesc();
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
-	srvDesc.Format = treeArrayTex->GetDesc().Format;
-	srvDesc.Texture2DArray.MostDetailedMip = 0;
-	srvDesc.Texture2DArray.MipLevels = -1;
-	srvDesc.Texture2DArray.FirstArraySlice = 0;
-	srvDesc.Texture2DArray.ArraySize = treeArrayTex->GetDesc().DepthOrArraySize;
-	md3dDevice->CreateShaderResourceView(treeArrayTex.Get(), &srvDesc, hDescriptor);
+		md3dDevice->CreateShaderResourceView(tex.Get(), &srvDesc, mSrvHeap->CpuHandle(slot));
+		mSrvHeapTextures[slot] = name;
+		mTextureSlots.Add(name, slot);
+	}
 }
 
 void TreeBillboardsApp::BuildShadersAndInputLayouts()
 {
+	const char* bindless = mBindlessTextures ? "1" : "0";
+	const std::string textureCount = std::to_string(gMaxTextures);
+
 	const D3D_SHADER_MACRO defines[] =
 	{
 		"FOG", "1",
+		"BINDLESS", bindless,
+		"BINDLESS_TEXTURE_COUNT", textureCount.c_str(),
 		NULL, NULL
 	};
 
@@ -824,16 +882,33 @@ void TreeBillboardsApp::BuildShadersAndInputLayouts()
 	{
 		"FOG", "1",
 		"ALPHA_TEST", "1",
+		"BINDLESS", bindless,
+		"BINDLESS_TEXTURE_COUNT", textureCount.c_str(),
 		NULL, NULL
 	};
 
-	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", defines, "PS", "ps_5_1");
-	mShaders["alphaTestedPS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", alphaTestDefines, "PS", "ps_5_1");
+	const D3D_SHADER_MACRO instancedDefines[] =
+	{
+		"INSTANCED", "1",
+		NULL, NULL
+	};
 
-	mShaders["treeSpriteVS"] = d3dUtil::CompileShader(L"Shaders\\TreeSprite.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["treeSpriteGS"] = d3dUtil::CompileShader(L"Shaders\\TreeSprite.hlsl", nullptr, "GS", "gs_5_1");
-	mShaders["treeSpritePS"] = d3dUtil::CompileShader(L"Shaders\\TreeSprite.hlsl", alphaTestDefines, "PS", "ps_5_1");
+	ShaderCache cache(gShaderCacheDirectory);
+
+	mShaders["standardVS"] = d3dUtil::CompileShader(cache, L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_1");
+	mShaders["instancedVS"] = d3dUtil::CompileShader(cache, L"Shaders\\Default.hlsl", instancedDefines, "VS", "vs_5_1");
+	mShaders["opaquePS"] = d3dUtil::CompileShader(cache, L"Shaders\\Default.hlsl", defines, "PS", "ps_5_1");
+	mShaders["alphaTestedPS"] = d3dUtil::CompileShader(cache, L"Shaders\\Default.hlsl", alphaTestDefines, "PS", "ps_5_1");
+
+	mShaders["treeSpriteVS"] = d3dUtil::CompileShader(cache, L"Shaders\\TreeSprite.hlsl", nullptr, "VS", "vs_5_1");
+	mShaders["treeSpriteGS"] = d3dUtil::CompileShader(cache, L"Shaders\\TreeSprite.hlsl", nullptr, "GS", "gs_5_1");
+	mShaders["treeSpritePS"] = d3dUtil::CompileShader(cache, L"Shaders\\TreeSprite.hlsl", alphaTestDefines, "PS", "ps_5_1");
+
+	const ShaderCache::Stats& cacheStats = cache.GetStats();
+	std::wostringstream msg;
+	msg << L"Shader cache: " << cacheStats.Hits << L" hits, " << cacheStats.Misses << L" compiled, "
+		<< cacheStats.StoreFailures << L" not stored\n";
+	OutputDebugString(msg.str().c_str());
 
 	mStdInputLayout =
 	{
@@ -853,60 +928,92 @@ void TreeBillboardsApp::BuildShapeGeometry(string name, const GeometryGenerator:
 {
 	GeometryGenerator::MeshData box = shape;
 
-	UINT boxVertexOffset = 0;
-
-	UINT boxIndexOffset = 0;
-
-	SubmeshGeometry boxSubmesh;
-	boxSubmesh.IndexCount = (UINT)box.Indices32.size();
-	boxSubmesh.StartIndexLocation = boxIndexOffset;
-	boxSubmesh.BaseVertexLocation = boxVertexOffset;
-
-	auto totalVertexCount = box.Vertices.size();
-
-
-	std::vector<Vertex> vertices(totalVertexCount);
-
-	UINT k = 0;
-	for (size_t i = 0; i < box.Vertices.size(); ++i, ++k)
+	std::vector<Vertex> vertices(box.Vertices.size());
+	for (size_t i = 0; i < box.Vertices.size(); ++i)
 	{
-		vertices[k].Pos = box.Vertices[i].Position;
-		vertices[k].Normal = box.Vertices[k].Normal;
-		vertices[k].TexC = box.Vertices[k].TexC;
+		vertices[i].Pos = box.Vertices[i].Position;
+		vertices[i].Normal = box.Vertices[i].Normal;
+		vertices[i].TexC = box.Vertices[i].TexC;
 	}
 
+	const std::vector<std::uint16_t>& indices = box.GetIndices16();
 
-	std::vector<std::uint16_t> indices;
-	indices.insert(indices.end(), std::begin(box.GetIndices16()), std::end(box.GetIndices16()));
+	// Identical shapes (Grid, Grid2, Grid3, ...) share one range of the packed buffers.
+	GeometryPacker::Range range = mShapePacker->Add(vertices.data(), (UINT)vertices.size(),
+		indices.data(), (UINT)indices.size());
 
+	PackedShape packed;
+	packed.Name = name;
+	packed.Submesh.IndexCount = range.IndexCount;
+	packed.Submesh.StartIndexLocation = range.StartIndex;
+	packed.Submesh.BaseVertexLocation = (INT)range.BaseVertex;
+	packed.VertexCount = (UINT)vertices.size();
+	BoundingBox::CreateFromPoints(packed.Submesh.Bounds, vertices.size(), &vertices[0].Pos, sizeof(Vertex));
 
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
+	mPackedShapes.push_back(packed);
+}
+
+void TreeBillboardsApp::BuildShapeBuffers()
+{
+	const UINT vbByteSize = (UINT)mShapePacker->VertexBytes();
+	const UINT ibByteSize = (UINT)mShapePacker->IndexBytes();
 
 	auto geo = std::make_unique<MeshGeometry>();
-	geo->Name = name;
+	geo->Name = "shapeGeo";
 
 	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
+	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), mShapePacker->Vertices().data(), vbByteSize);
 
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), mShapePacker->Indices().data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(*mBufferPool, *mGeometryUploads,
+		mCommandList.Get(), mShapePacker->Vertices().data(), vbByteSize);
 
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(*mBufferPool, *mGeometryUploads,
+		mCommandList.Get(), mShapePacker->Indices().data(), ibByteSize);
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
 	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
 	geo->IndexBufferByteSize = ibByteSize;
 
-	geo->DrawArgs["box"] = boxSubmesh;
+	for (const auto& shape : mPackedShapes)
+		geo->DrawArgs[shape.Name] = shape.Submesh;
+
+	// Each shape is a mesh of the shared geometry; their ids follow each other.
+	MeshGeometry* shapeGeo = geo.get();
+	mGeometries.Add("shapeGeo", std::move(geo));
+
+	for (const auto& shape : mPackedShapes)
+		AddMesh(shape.Name, shapeGeo, shape.Submesh);
+
+	// Compare with one vertex and one index buffer per shape, each taking whole 64KB
+	// pages of a heap.
+	const UINT64 page = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	UINT64 separateBytes = 0;
+	UINT64 separateHeapBytes = 0;
+	for (const auto& shape : mPackedShapes)
+	{
+		UINT64 vb = (UINT64)shape.VertexCount * sizeof(Vertex);
+		UINT64 ib = (UINT64)shape.Submesh.IndexCount * sizeof(std::uint16_t);
+		separateBytes += vb + ib;
+		separateHeapBytes += (vb + page - 1) / page * page + (ib + page - 1) / page * page;
+	}
 
+	UINT64 packedBytes = (UINT64)vbByteSize + ibByteSize;
+	UINT64 packedHeapBytes = ((UINT64)vbByteSize + page - 1) / page * page + ((UINT64)ibByteSize + page - 1) / page * page;
 
-	mGeometries[geo->Name] = std::move(geo);
+	const GeometryPacker::Stats& stats = mShapePacker->GetStats();
+	std::wostringstream msg;
+	msg << L"Shapes: " << stats.Meshes << L" (" << stats.UniqueMeshes << L" unique)"
+		<< L" in 2 buffers of " << packedBytes / 1024 << L" KB (" << packedHeapBytes / 1024 << L" KB of heap)"
+		<< L" instead of " << 2 * stats.Meshes << L" buffers of " << separateBytes / 1024
+		<< L" KB (" << separateHeapBytes / 1024 << L" KB of heap)\n";
+	OutputDebugString(msg.str().c_str());
+
+	mShapePacker = nullptr;
+	mPackedShapes.clear();
 }
 
 void TreeBillboardsApp::BuildLandGeometry()
@@ -944,11 +1051,11 @@ void TreeBillboardsApp::BuildLandGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(*mBufferPool, *mGeometryUploads,
+		mCommandList.Get(), vertices.data(), vbByteSize);
 
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(*mBufferPool, *mGeometryUploads,
+		mCommandList.Get(), indices.data(), ibByteSize);
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -962,7 +1069,7 @@ void TreeBillboardsApp::BuildLandGeometry()
 
 	geo->DrawArgs["grid"] = submesh;
 
-	mGeometries["landGeo"] = std::move(geo);
+	AddGeometry(std::move(geo), "grid");
 }
 
 void TreeBillboardsApp::BuildWavesGeometry()
@@ -1003,8 +1110,8 @@ void TreeBillboardsApp::BuildWavesGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(*mBufferPool, *mGeometryUploads,
+		mCommandList.Get(), indices.data(), ibByteSize);
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -1016,9 +1123,13 @@ void TreeBillboardsApp::BuildWavesGeometry()
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
 
+	// The surface is flat until disturbed; leave room for the wave heights.
+	submesh.Bounds.Center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	submesh.Bounds.Extents = XMFLOAT3(0.5f * mWaves->Width(), 2.0f, 0.5f * mWaves->Depth());
+
 	geo->DrawArgs["grid"] = submesh;
 
-	mGeometries["waterGeo"] = std::move(geo);
+	AddGeometry(std::move(geo), "grid");
 }
 
 void TreeBillboardsApp::BuildBoxGeometry()
@@ -1049,11 +1160,11 @@ void TreeBillboardsApp::BuildBoxGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(*mBufferPool, *mGeometryUploads,
+		mCommandList.Get(), vertices.data(), vbByteSize);
 
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(*mBufferPool, *mGeometryUploads,
+		mCommandList.Get(), indices.data(), ibByteSize);
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -1067,7 +1178,7 @@ void TreeBillboardsApp::BuildBoxGeometry()
 
 	geo->DrawArgs["box"] = submesh;
 
-	mGeometries["boxGeo"] = std::move(geo);
+	AddGeometry(std::move(geo), "box");
 }
 
 void TreeBillboardsApp::BuildTreeSpritesGeometry()
@@ -1112,11 +1223,11 @@ void TreeBillboardsApp::BuildTreeSpritesGeometry()
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(*mBufferPool, *mGeometryUploads,
+		mCommandList.Get(), vertices.data(), vbByteSize);
 
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(*mBufferPool, *mGeometryUploads,
+		mCommandList.Get(), indices.data(), ibByteSize);
 
 	geo->VertexByteStride = sizeof(TreeSpriteVertex);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -1128,9 +1239,15 @@ void TreeBillboardsApp::BuildTreeSpritesGeometry()
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
 
+	// Tree centers, grown by half a sprite in every direction.
+	BoundingBox::CreateFromPoints(submesh.Bounds, vertices.size(), &vertices[0].Pos, sizeof(TreeSpriteVertex));
+	submesh.Bounds.Extents.x += 10.0f;
+	submesh.Bounds.Extents.y += 10.0f;
+	submesh.Bounds.Extents.z += 10.0f;
+
 	geo->DrawArgs["points"] = submesh;
 
-	mGeometries["treeSpritesGeo"] = std::move(geo);
+	AddGeometry(std::move(geo), "points");
 }
 
 void TreeBillboardsApp::BuildPSOs()
@@ -1168,7 +1285,7 @@ void TreeBillboardsApp::BuildPSOs()
 	opaquePsoDesc.SampleDesc.Count = m4xMsaaState ? 4 : 1;
 	opaquePsoDesc.SampleDesc.Quality = m4xMsaaState ? (m4xMsaaQuality - 1) : 0;
 	opaquePsoDesc.DSVFormat = mDepthStencilFormat;
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&mPSOs["opaque"])));
+	mLayerPSOs[(int)RenderLayer::Opaque] = CreatePSO("opaque", opaquePsoDesc);
 
 	//
 	// PSO for transparent objects
@@ -1191,7 +1308,7 @@ void TreeBillboardsApp::BuildPSOs()
 	//transparentPsoDesc.BlendState.AlphaToCoverageEnable = true;
 
 	transparentPsoDesc.BlendState.RenderTarget[0] = transparencyBlendDesc;
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&transparentPsoDesc, IID_PPV_ARGS(&mPSOs["transparent"])));
+	mLayerPSOs[(int)RenderLayer::Transparent] = CreatePSO("transparent", transparentPsoDesc);
 
 	//
 	// PSO for alpha tested objects
@@ -1204,7 +1321,7 @@ void TreeBillboardsApp::BuildPSOs()
 		mShaders["alphaTestedPS"]->GetBufferSize()
 	};
 	alphaTestedPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&alphaTestedPsoDesc, IID_PPV_ARGS(&mPSOs["alphaTested"])));
+	mLayerPSOs[(int)RenderLayer::AlphaTested] = CreatePSO("alphaTested", alphaTestedPsoDesc);
 
 	//
 	// PSO for tree sprites
@@ -1230,193 +1347,202 @@ void TreeBillboardsApp::BuildPSOs()
 	treeSpritePsoDesc.InputLayout = { mTreeSpriteInputLayout.data(), (UINT)mTreeSpriteInputLayout.size() };
 	treeSpritePsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
 
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&treeSpritePsoDesc, IID_PPV_ARGS(&mPSOs["treeSprites"])));
+	mLayerPSOs[(int)RenderLayer::AlphaTestedTreeSprites] = CreatePSO("treeSprites", treeSpritePsoDesc);
+
+	//
+	// Instanced variants of the layers drawn with Default.hlsl.  They only swap in the
+	// vertex shader that reads the world matrices from the instance buffer.
+	//
+	const char* instancedLayers[] = { "opaque", "transparent", "alphaTested" };
+	const RenderLayer instancedLayerIds[] = { RenderLayer::Opaque, RenderLayer::Transparent, RenderLayer::AlphaTested };
+
+	for (size_t i = 0; i < _countof(instancedLayers); ++i)
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC instancedPsoDesc = i == 0 ? opaquePsoDesc :
+			i == 1 ? transparentPsoDesc : alphaTestedPsoDesc;
+		instancedPsoDesc.VS =
+		{
+			reinterpret_cast<BYTE*>(mShaders["instancedVS"]->GetBufferPointer()),
+			mShaders["instancedVS"]->GetBufferSize()
+		};
+
+		std::string name = std::string(instancedLayers[i]) + "Instanced";
+		mLayerInstancedPSOs[(int)instancedLayerIds[i]] = CreatePSO(name, instancedPsoDesc);
+	}
+
+	for (int i = 0; i < (int)RenderLayer::Count; ++i)
+		mScene.SetLayerPsos((RenderLayer)i, mLayerPSOs[i], mLayerInstancedPSOs[i]);
+}
+
+ID3D12PipelineState* TreeBillboardsApp::CreatePSO(const std::string& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+	ComPtr<ID3D12PipelineState> pso;
+	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pso)));
+
+	return mPSOs[mPSOs.Add(name, pso)].Get();
 }
 
 void TreeBillboardsApp::BuildFrameResources()
 {
-	for (int i = 0; i < gNumFrameResources; ++i)
+	mConstantBackend = std::make_unique<UploadHeapBackend>(md3dDevice.Get());
+	mConstantRing = std::make_unique<UploadRingBuffer>(mConstantBackend.get(), gConstantRingBytes);
+
+	for (UINT i = 0; i < mFramesInFlight; ++i)
 	{
 		mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
-			1, (UINT)mAllRitems.size(), (UINT)mMaterials.size(), mWaves->VertexCount()));
+			mWaves->VertexCount(), gRecordThreads + (UINT)RenderLayer::Count));
 	}
+
+	mFrameTimeline = std::make_unique<FenceTimeline>(mFence.Get(), mFramesInFlight);
+	mFrameScheduler = std::make_unique<FrameScheduler>(mFrameTimeline.get(), mFramesInFlight);
 }
 
 void TreeBillboardsApp::BuildMaterials()
 {
+	mScene.BuildMaterials();
 
-	auto grass = std::make_unique<Material>();
-	grass->Name = "grass";
-	grass->MatCBIndex = 0;
-	grass->DiffuseSrvHeapIndex = 0;
-	grass->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	grass->FresnelR0 = XMFLOAT3(0.01f, 0.01f, 0.01f);
-	grass->Roughness = 0.125f;
-
-	// This is not a good water material definition, but we do not have all the rendering
-	// tools we need (transparency, environment reflection), so we fake it for now.
-	auto water = std::make_unique<Material>();
-	water->Name = "water";
-	water->MatCBIndex = 4;
-	water->DiffuseSrvHeapIndex = 4;
-	water->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 0.5f);
-	water->FresnelR0 = XMFLOAT3(0.1f, 0.1f, 0.1f);
-	water->Roughness = 0.0f;
-
-	auto wirefence = std::make_unique<Material>();
-	wirefence->Name = "wirefence";
-	wirefence->MatCBIndex = 5;
-	wirefence->DiffuseSrvHeapIndex = 5;
-	wirefence->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	wirefence->FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
-	wirefence->Roughness = 0.25f;
-
-	auto treeSprites = std::make_unique<Material>();
-	treeSprites->Name = "treeSprites";
-	treeSprites->MatCBIndex = 6;
-	treeSprites->DiffuseSrvHeapIndex = 6;
-	treeSprites->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	treeSprites->FresnelR0 = XMFLOAT3(0.01f, 0.01f, 0.01f);
-	treeSprites->Roughness = 0.125f;
-
-	auto woodCrate = std::make_unique<Material>();
-	woodCrate->Name = "woodCrate";
-	woodCrate->MatCBIndex = 1;
-	woodCrate->DiffuseSrvHeapIndex = 1;
-	woodCrate->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	woodCrate->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05f);
-	woodCrate->Roughness = 0.2f;
-
-	//Bricks
-	auto bricks = std::make_unique<Material>();
-	bricks->Name = "bricks";
-	bricks->MatCBIndex = 3;
-	bricks->DiffuseSrvHeapIndex = 3;
-	bricks->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	bricks->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05f);
-	bricks->Roughness = 0.2f;
-
-	//Ice
-	auto ice = std::make_unique<Material>();
-	ice->Name = "ice";
-	ice->MatCBIndex = 2;
-	ice->DiffuseSrvHeapIndex = 2;
-	ice->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	ice->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05f);
-	ice->Roughness = 0.2f;
-
-
-
-	mMaterials["grass"] = std::move(grass);
-	mMaterials["water"] = std::move(water);
-	mMaterials["wirefence"] = std::move(wirefence);
-	mMaterials["treeSprites"] = std::move(treeSprites);
-	mMaterials["woodCrate"] = std::move(woodCrate);
-	mMaterials["bricks"] = std::move(bricks);
-	mMaterials["ice"] = std::move(ice);
+	// Materials keep their diffuse texture resident.
+	for (auto& mat : mScene.Materials())
+	{
+		mat->DiffuseSrvHeapIndex = mTextureSlots[mTextureSlots.Get(mat->DiffuseTexture)];
+		mTextureCache->Acquire(mat->DiffuseTexture, mCurrentFence + 1);
+	}
 }
 
-void TreeBillboardsApp::BuildRenderItems(string name, string materials, float sX, float sY, float sZ, float tX, float tY, float tZ)
+void TreeBillboardsApp::AddGeometry(std::unique_ptr<MeshGeometry> geo, const std::string& submesh)
 {
-	auto boxRitem = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&boxRitem->World, XMMatrixScaling(sX, sY, sZ) * XMMatrixTranslation(tX, tY, tZ));
-	boxRitem->ObjCBIndex = static_cast<UINT>(mAllRitems.size());
-	boxRitem->Mat = mMaterials[materials].get();
-	boxRitem->Geo = mGeometries[name].get();
-	boxRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	boxRitem->IndexCount = boxRitem->Geo->DrawArgs["box"].IndexCount;
-	boxRitem->StartIndexLocation = boxRitem->Geo->DrawArgs["box"].StartIndexLocation;
-	boxRitem->BaseVertexLocation = boxRitem->Geo->DrawArgs["box"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(boxRitem));
-
-	//mRitemLayer[(int)RenderLayer::AlphaTested].push_back(boxRitem.get());
-
-	mOpaqueRitems.clear();
-	for (auto& e : mAllRitems)
-		mOpaqueRitems.push_back(e.get());
+	// Register the geometry, and its submesh as a mesh of the same name for render
+	// items to refer to by id.
+	std::string name = geo->Name;
+	AddMesh(name, geo.get(), geo->DrawArgs[submesh]);
+	mGeometries.Add(name, std::move(geo));
+}
 
+void TreeBillboardsApp::AddMesh(const std::string& name, MeshGeometry* geo, const SubmeshGeometry& submesh)
+{
+	TreeBillboardsScene::Mesh mesh;
+	mesh.Geo = geo;
+	mesh.IndexCount = submesh.IndexCount;
+	mesh.StartIndexLocation = submesh.StartIndexLocation;
+	mesh.BaseVertexLocation = submesh.BaseVertexLocation;
+	mesh.Center = submesh.Bounds.Center;
+	mesh.Extents = submesh.Bounds.Extents;
+	mScene.AddMesh(name, mesh);
 }
 
-void TreeBillboardsApp::BuildRenderWorld()
+void TreeBillboardsApp::BuildInstanceData()
 {
-	auto wavesRitem = std::make_unique<RenderItem>();
-	wavesRitem->World = MathHelper::Identity4x4();
-	XMStoreFloat4x4(&wavesRitem->World, XMMatrixTranslation(0.0f, -5.0f, 0.0f));
-	XMStoreFloat4x4(&wavesRitem->TexTransform, XMMatrixScaling(5.0f, 5.0f, 1.0f));
-	wavesRitem->ObjCBIndex = 0;
-	wavesRitem->Mat = mMaterials["water"].get();
-	wavesRitem->Geo = mGeometries["waterGeo"].get();
-	wavesRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	wavesRitem->IndexCount = wavesRitem->Geo->DrawArgs["grid"].IndexCount;
-	wavesRitem->StartIndexLocation = wavesRitem->Geo->DrawArgs["grid"].StartIndexLocation;
-	wavesRitem->BaseVertexLocation = wavesRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
-
-	mWavesRitem = wavesRitem.get();
-
-	mRitemLayer[(int)RenderLayer::Transparent].push_back(wavesRitem.get());
-	//
-	//auto gridRitem = std::make_unique<RenderItem>();
-	//gridRitem->World = MathHelper::Identity4x4();
-	//XMStoreFloat4x4(&gridRitem->TexTransform, XMMatrixScaling(5.0f, 5.0f, 1.0f));
-	//gridRitem->ObjCBIndex = 1;
-	//gridRitem->Mat = mMaterials["grass"].get();
-	//gridRitem->Geo = mGeometries["landGeo"].get();
-	//gridRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	//gridRitem->IndexCount = gridRitem->Geo->DrawArgs["grid"].IndexCount;
-	//gridRitem->StartIndexLocation = gridRitem->Geo->DrawArgs["grid"].StartIndexLocation;
-	//gridRitem->BaseVertexLocation = gridRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
-	//
-	//mRitemLayer[(int)RenderLayer::Opaque].push_back(gridRitem.get());
+	// Items that share geometry, material and PSO sort next to each other; each run
+	// becomes one instanced draw.  Copy their transforms into this frame's instance
+	// buffer in the order the draws index it.
+	mScene.Queue().MergeInstances();
 
+	const auto& instances = mScene.Queue().InstanceObjects();
 
-	auto treeSpritesRitem = std::make_unique<RenderItem>();
-	treeSpritesRitem->World = MathHelper::Identity4x4();
-	treeSpritesRitem->ObjCBIndex = 3;
-	treeSpritesRitem->Mat = mMaterials["treeSprites"].get();
-	treeSpritesRitem->Geo = mGeometries["treeSpritesGeo"].get();
-	//step2
-	treeSpritesRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_POINTLIST;
-	treeSpritesRitem->IndexCount = treeSpritesRitem->Geo->DrawArgs["points"].IndexCount;
-	treeSpritesRitem->StartIndexLocation = treeSpritesRitem->Geo->DrawArgs["points"].StartIndexLocation;
-	treeSpritesRitem->BaseVertexLocation = treeSpritesRitem->Geo->DrawArgs["points"].BaseVertexLocation;
+	mCurrFrameResource->InstanceDataAddress = 0;
+	if (instances.empty())
+		return;
 
-	mRitemLayer[(int)RenderLayer::AlphaTestedTreeSprites].push_back(treeSpritesRitem.get());
+	auto currInstanceData = mConstantRing->Allocate((UINT64)instances.size() * sizeof(InstanceData));
 
-	mAllRitems.push_back(std::move(wavesRitem));
-	//mAllRitems.push_back(std::move(gridRitem));
-	mAllRitems.push_back(std::move(treeSpritesRitem));
+	// Written straight into the upload memory, in order, like the wave vertices.
+	InstanceData* dst = reinterpret_cast<InstanceData*>(currInstanceData.CpuAddress);
+	const SceneStore::ObjectData* constants = mScene.Store().Constants();
+	for (UINT i = 0; i < (UINT)instances.size(); ++i)
+	{
+		const SceneStore::ObjectData& src = constants[instances[i]];
+		dst[i].World = src.World;
+		dst[i].TexTransform = src.TexTransform;
+	}
+
+	mCurrFrameResource->InstanceDataAddress = currInstanceData.GpuAddress;
 }
 
-void TreeBillboardsApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
+void TreeBillboardsApp::BeginRecordList(ID3D12GraphicsCommandList* cmdList, ID3D12CommandAllocator* alloc)
 {
-	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+	// Command lists do not inherit state from the lists executed before them.
+	ThrowIfFailed(alloc->Reset());
+	ThrowIfFailed(cmdList->Reset(alloc, nullptr));
 
-	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
-	auto matCB = mCurrFrameResource->MaterialCB->Resource();
+	cmdList->RSSetViewports(1, &mScreenViewport);
+	cmdList->RSSetScissorRects(1, &mScissorRect);
+	cmdList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
 
-	// For each render item...
-	for (size_t i = 0; i < ritems.size(); ++i)
-	{
-		auto ri = ritems[i];
+	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvHeap->Heap() };
+	cmdList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
-		cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
-		cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
-		//step3
-		cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
+	cmdList->SetGraphicsRootSignature(mRootSignature.Get());
+	cmdList->SetGraphicsRootConstantBufferView(2, mCurrFrameResource->PassCBAddress);
+}
 
-		CD3DX12_GPU_DESCRIPTOR_HANDLE tex(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		tex.Offset(ri->Mat->DiffuseSrvHeapIndex, mCbvSrvDescriptorSize);
+UINT TreeBillboardsApp::RecordRenderItems()
+{
+	// One range per layer, with big layers split so the workers get similar shares.
+	DrawQueue& drawQueue = mScene.Queue();
+	UINT packetCount = (UINT)drawQueue.Packets().size();
+	UINT maxPackets = std::max<UINT>(gMinPacketsPerList, (packetCount + gRecordThreads - 1) / gRecordThreads);
+	drawQueue.SplitByLayer(mRecordRanges, maxPackets);
+
+	UINT listCount = (UINT)mRecordRanges.size();
+	assert(listCount <= (UINT)mCurrFrameResource->RecordLists.size());
 
-		D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex * objCBByteSize;
-		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex * matCBByteSize;
+	for (UINT i = 0; i < listCount; ++i)
+	{
+		BeginRecordList(mCurrFrameResource->RecordLists[i].Get(),
+			mCurrFrameResource->RecordAllocs[i].Get());
+	}
 
-		cmdList->SetGraphicsRootDescriptorTable(0, tex);
-		cmdList->SetGraphicsRootConstantBufferView(1, objCBAddress);
-		cmdList->SetGraphicsRootConstantBufferView(3, matCBAddress);
+	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
 
-		cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+	std::vector<CommandListSink> sinks;
+	std::vector<DrawCommandSink*> sinkPtrs;
+	sinks.reserve(listCount);
+	for (UINT i = 0; i < listCount; ++i)
+	{
+		sinks.emplace_back(mCurrFrameResource->RecordLists[i].Get(),
+			mSrvHeap->GpuHandle(0), mCbvSrvDescriptorSize,
+			mCurrFrameResource->ObjectCBAddress, objCBByteSize,
+			mCurrFrameResource->MaterialCBAddress, matCBByteSize,
+			mCurrFrameResource->InstanceDataAddress, sizeof(InstanceData));
+		sinkPtrs.push_back(&sinks.back());
 	}
+
+	drawQueue.SubmitParallel(mJobs, mRecordRanges, sinkPtrs.data());
+
+	return listCount;
+}
+
+void TreeBillboardsApp::LogDrawStateChanges()
+{
+	// Count the draws and binds of one frame per item, sorted and filtered, and with
+	// repeated items merged into instanced draws.
+	// Count every item, as if the whole scene were in view.
+	mScene.AllVisible();
+
+	RecordingSink unsorted;
+	mScene.BuildDrawQueue(mView);
+	mScene.Queue().SubmitUnfiltered(unsorted);
+
+	RecordingSink sorted;
+	mScene.Queue().Submit(sorted);
+
+	RecordingSink instanced;
+	mScene.Queue().MergeInstances();
+	mScene.Queue().Submit(instanced);
+
+	std::wostringstream msg;
+	msg << L"Draws: " << sorted.GetCounts().Draws
+		<< L", state changes per item: " << unsorted.GetCounts().StateChanges()
+		<< L", sorted and filtered: " << sorted.GetCounts().StateChanges()
+		<< L" (PSO " << sorted.GetCounts().PipelineStates
+		<< L", geometry " << sorted.GetCounts().Geometries
+		<< L", texture " << sorted.GetCounts().Textures
+		<< L", material " << sorted.GetCounts().MaterialConstants << L")\n";
+	msg << L"Instanced draws: " << instanced.GetCounts().Draws
+		<< L" for " << instanced.GetCounts().Instances << L" items"
+		<< L", state changes: " << instanced.GetCounts().StateChanges() << L"\n";
+	OutputDebugString(msg.str().c_str());
 }
 
 std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> TreeBillboardsApp::GetStaticSamplers()
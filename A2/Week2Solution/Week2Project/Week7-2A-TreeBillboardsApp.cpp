@@ -418,9 +418,6 @@ void TreeBillboardsApp::AnimateMaterials(const GameTimer& gt)
 
 	waterMat->MatTransform(3, 0) = tu;
 	waterMat->MatTransform(3, 1) = tv;
-
-	// Material has changed, so need to update cbuffer.
-	waterMat->NumFramesDirty = gNumFrameResources;
 }
 
 void TreeBillboardsApp::UpdateObjectCBs(const GameTimer& gt)
@@ -452,24 +449,18 @@ void TreeBillboardsApp::UpdateMaterialCBs(const GameTimer& gt)
 	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
 	for(auto& e : mMaterials)
 	{
-		// Only update the cbuffer data if the constants have changed.  If the cbuffer
-		// data changes, it needs to be updated for each FrameResource.
+		// Each FrameResource has its own cbuffer, so every material is written every
+		// frame; there are only a handful.
 		Material* mat = e.second.get();
-		if(mat->NumFramesDirty > 0)
-		{
-			XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform);
-
-			MaterialConstants matConstants;
-			matConstants.DiffuseAlbedo = mat->DiffuseAlbedo;
-			matConstants.FresnelR0 = mat->FresnelR0;
-			matConstants.Roughness = mat->Roughness;
-			XMStoreFloat4x4(&matConstants.MatTransform, XMMatrixTranspose(matTransform));
+		XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform);
 
-			currMaterialCB->CopyData(mat->MatCBIndex, matConstants);
+		MaterialConstants matConstants;
+		matConstants.DiffuseAlbedo = mat->DiffuseAlbedo;
+		matConstants.FresnelR0 = mat->FresnelR0;
+		matConstants.Roughness = mat->Roughness;
+		XMStoreFloat4x4(&matConstants.MatTransform, XMMatrixTranspose(matTransform));
 
-			// Next FrameResource need to be updated too.
-			mat->NumFramesDirty--;
-		}
+		currMaterialCB->CopyData(mat->MatCBIndex, matConstants);
 	}
 }
 